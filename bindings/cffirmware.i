@@ -6,11 +6,14 @@
 
 %{
 #define SWIG_FILE_WITH_INIT
+#include <string.h>
+#include <time.h>
 #include "math3d.h"
 #include "pptraj.h"
 #include "planner.h"
 #include "stabilizer_types.h"
 #include "collision_avoidance.h"
+#include "peer_localization.h"
 #include "imu_types.h"
 #include "controller_pid.h"
 #include "position_controller.h"
@@ -25,6 +28,14 @@
 #include "outlierFilterTdoa.h"
 #include "kalman_core.h"
 #include "mm_tdoa.h"
+
+// Simulated tick count for peer_localization, in ms
+static uint32_t simulationTicks = 0;
+
+uint32_t xTaskGetTickCount()
+{
+    return simulationTicks;
+}
 %}
 
 %include "math3d.h"
@@ -89,7 +100,7 @@ void collisionAvoidanceUpdateSetpointWrap(
     setpoint_t *setpoint, sensorData_t const *sensorData, state_t const *state)
 {
     nOthers /= 3;
-    float *workspace = malloc(sizeof(float) * 7 * (nOthers + 6));
+    float *workspace = malloc(sizeof(float) * COLLISION_AVOIDANCE_WORKSPACE_SIZE(nOthers));
     collisionAvoidanceUpdateSetpointCore(
         params,
         collisionState,
@@ -100,6 +111,178 @@ void collisionAvoidanceUpdateSetpointWrap(
     free(workspace);
 }
 
+// Times collisionAvoidanceUpdateSetpointCore for a swarm of nOthers peers
+// spread over a square grid with the given spacing around our position. The
+// peer positions are regenerated for every call since the workspace overwrites
+// them. Returns the mean time per call in microseconds.
+double collisionAvoidanceBenchmark(
+    collision_avoidance_params_t const *params,
+    collision_avoidance_state_t *collisionState,
+    int nOthers, float spacing, int iterations,
+    setpoint_t *setpoint, state_t const *state)
+{
+    int const side = (int)ceilf(sqrtf((float)(nOthers + 1)));
+    float *workspace = malloc(sizeof(float) * COLLISION_AVOIDANCE_WORKSPACE_SIZE(nOthers));
+    setpoint_t const setpointIn = *setpoint;
+    sensorData_t sensorData = {0};
+
+    clock_t const start = clock();
+    for (int iter = 0; iter < iterations; ++iter) {
+        int peer = 0;
+        for (int cell = 0; peer < nOthers; ++cell) {
+            float const x = (cell % side - side / 2) * spacing;
+            float const y = (cell / side - side / 2) * spacing;
+            if (x == 0.0f && y == 0.0f) {
+                // Our own spot on the grid.
+                continue;
+            }
+            workspace[3 * peer + 0] = state->position.x + x;
+            workspace[3 * peer + 1] = state->position.y + y;
+            workspace[3 * peer + 2] = state->position.z;
+            ++peer;
+        }
+        *setpoint = setpointIn;
+        collisionAvoidanceUpdateSetpointCore(
+            params,
+            collisionState,
+            nOthers,
+            workspace,
+            workspace,
+            setpoint, &sensorData, state);
+    }
+    clock_t const end = clock();
+
+    free(workspace);
+    return 1e6 * (double)(end - start) / CLOCKS_PER_SEC / iterations;
+}
+
+// Simulates a swarm of n Crazyflies, spread evenly on a circle with the given
+// radius, flying to the opposite side of the circle at the given speed, with a
+// time step of 10 ms. Every Crazyflie tells peer_localization the positions
+// and velocities of the others latencyMs old, as when they are received from a
+// positioning system or over the radio, and gets its neighbors from it the way
+// collisionAvoidanceUpdateSetpoint() does. If extrapolate is not set, the
+// velocities are left out so the positions are used as they were captured.
+// Returns the smallest horizontal distance between two Crazyflies during the
+// flight.
+float collisionAvoidanceSwarmSimulation(
+    collision_avoidance_params_t const *params,
+    int n, float radius, float speed, int latencyMs, bool extrapolate)
+{
+    int const stepMs = 10;
+    int const steps = (int)(1000.0f * 3.0f * radius / speed) / stepMs;
+    int const delaySteps = latencyMs / stepMs;
+    int const historyLength = delaySteps + 1;
+
+    // The peer table is kept between simulations, start late enough for the
+    // peers of the previous simulation to be too old to be used
+    uint32_t const startTicks = simulationTicks + params->maxPeerLocAgeMillis + 1000;
+
+    collision_avoidance_state_t *collisionStates = calloc(n, sizeof(collision_avoidance_state_t));
+    state_t *states = calloc(n, sizeof(state_t));
+    struct vec *targets = malloc(sizeof(struct vec) * n);
+    // Ring buffer of the states of the last historyLength steps
+    state_t *history = calloc(n * historyLength, sizeof(state_t));
+    peerLocalizationOtherPosition_t const **neighbors = malloc(sizeof(peerLocalizationOtherPosition_t const *) * n);
+    float *workspace = malloc(sizeof(float) * COLLISION_AVOIDANCE_WORKSPACE_SIZE(n - 1));
+    sensorData_t sensorData = {0};
+
+    for (int i = 0; i < n; ++i) {
+        float const angle = 2.0f * (float)M_PI * i / n;
+        states[i].position.x = radius * cosf(angle);
+        states[i].position.y = radius * sinf(angle);
+        states[i].position.z = 1.0f;
+        targets[i] = mkvec(-states[i].position.x, -states[i].position.y, 1.0f);
+        collisionStates[i].lastFeasibleSetPosition = mkvec(NAN, NAN, NAN);
+    }
+
+    float minDistance = INFINITY;
+    for (int step = 0; step < steps; ++step) {
+        simulationTicks = startTicks + step * stepMs;
+
+        memcpy(&history[(step % historyLength) * n], states, sizeof(state_t) * n);
+        int const seenStep = step < delaySteps ? 0 : step - delaySteps;
+        state_t const *seen = &history[(seenStep % historyLength) * n];
+        uint32_t const seenTicks = startTicks + seenStep * stepMs;
+
+        for (int j = 0; j < n; ++j) {
+            positionMeasurement_t const position = {
+                .x = seen[j].position.x,
+                .y = seen[j].position.y,
+                .z = seen[j].position.z,
+            };
+            if (extrapolate) {
+                peerLocalizationTellStateAt(j + 1, &position, &seen[j].velocity, seenTicks);
+            } else {
+                peerLocalizationTellPositionAt(j + 1, &position, seenTicks);
+            }
+        }
+
+        for (int i = 0; i < n; ++i) {
+            for (int j = i + 1; j < n; ++j) {
+                float const dx = states[i].position.x - states[j].position.x;
+                float const dy = states[i].position.y - states[j].position.y;
+                minDistance = fminf(minDistance, sqrtf(dx * dx + dy * dy));
+            }
+        }
+
+        for (int i = 0; i < n; ++i) {
+            // The table holds all the Crazyflies, including this one
+            int const nNearest = peerLocalizationGetNearest(&states[i].position, &params->ellipsoidRadii, params->maxPeerLocAgeMillis, neighbors, n, NULL);
+            int nOthers = 0;
+            for (int j = 0; j < nNearest; ++j) {
+                if (neighbors[j]->id == i + 1) {
+                    continue;
+                }
+                point_t position;
+                peerLocalizationGetPosition(neighbors[j], &position);
+                workspace[3 * nOthers + 0] = position.x;
+                workspace[3 * nOthers + 1] = position.y;
+                workspace[3 * nOthers + 2] = position.z;
+                ++nOthers;
+            }
+
+            struct vec const toTarget = vsub(targets[i], vec2svec(states[i].position));
+            struct vec const velocity = vclampnorm(vscl(1.0f / ((float)stepMs / 1000.0f), toTarget), speed);
+            setpoint_t setpoint = {0};
+            setpoint.mode.x = modeVelocity;
+            setpoint.mode.y = modeVelocity;
+            setpoint.mode.z = modeVelocity;
+            setpoint.velocity = svec2vec(velocity);
+
+            collisionAvoidanceUpdateSetpointCore(
+                params,
+                &collisionStates[i],
+                nOthers,
+                workspace,
+                workspace,
+                &setpoint, &sensorData, &states[i]);
+
+            // The Crazyflie follows the setpoint perfectly
+            if (setpoint.mode.x == modeVelocity) {
+                states[i].velocity = setpoint.velocity;
+            } else {
+                states[i].velocity = svec2vec(vzero());
+            }
+        }
+
+        for (int i = 0; i < n; ++i) {
+            float const dt = stepMs / 1000.0f;
+            states[i].position.x += states[i].velocity.x * dt;
+            states[i].position.y += states[i].velocity.y * dt;
+            states[i].position.z += states[i].velocity.z * dt;
+        }
+    }
+
+    free(workspace);
+    free(neighbors);
+    free(history);
+    free(targets);
+    free(states);
+    free(collisionStates);
+    return minDistance;
+}
+
 void assertFail(char *exp, char *file, int line) {
     char buf[150];
     sprintf(buf, "%s in File: \"%s\", line %d\n", exp, file, line);
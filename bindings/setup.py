@@ -18,6 +18,8 @@ include = [
     "src/platform/interface",
     "vendor/CMSIS/CMSIS/DSP/Include",
     "vendor/CMSIS/CMSIS/Core/Include",
+    "vendor/FreeRTOS/include",
+    "vendor/FreeRTOS/portable/GCC/ARM_CM4F",
 ]
 
 fw_sources = [
@@ -36,6 +38,7 @@ fw_sources = [
     "src/modules/src/pptraj_compressed.c",
     "src/modules/src/planner.c",
     "src/modules/src/collision_avoidance.c",
+    "src/modules/src/peer_localization.c",
     "src/modules/src/controller/controller_pid.c",
     "src/modules/src/controller/position_controller_pid.c",
     "src/modules/src/controller/attitude_pid_controller.c",
@@ -45,10 +48,12 @@ fw_sources = [
     "src/utils/src/pid.c",
     "src/utils/src/filter.c",
     "src/utils/src/num.c",
+    "src/utils/src/statsCnt.c",
     "src/modules/src/power_distribution_quadrotor.c",
     # "src/modules/src/power_distribution_flapper.c",
     "src/modules/src/axis3fSubSampler.c",
     "src/modules/src/kalman_core/kalman_core.c",
+    "src/modules/src/kalman_core/kalman_core_kernels.c",
     "src/modules/src/kalman_core/mm_tdoa.c",
     "src/modules/src/outlierfilter/outlierFilterTdoa.c",
 ]
@@ -60,6 +60,7 @@ for improved position estimation.
 #include "tdoaEngineInstance.h"
 #include "tdoaStats.h"
 #include "estimator.h"
+#include "estimator_kalman.h"
 
 #include "libdw1000.h"
 #include "mac.h"
@@ -294,6 +295,13 @@ static void rxcallback(dwDevice_t *dev) {
     tdoaEngineGetAnchorCtxForPacketProcessing(&tdoaEngineState, anchorId, now_ms, &anchorCtx);
     int rangeDataLength = updateRemoteData(&anchorCtx, packet);
 
+    // The position is only estimated when the kalman estimator is active
+    if (tdoaEngineState.matchingAlgorithm == TdoaEngineMatchingAlgorithmBestPair && stateEstimatorGetType() == StateEstimatorTypeKalman) {
+      point_t position;
+      estimatorKalmanGetEstimatedPos(&position);
+      tdoaEngineSetPositionEstimate(&tdoaEngineState, &position);
+    }
+
 #ifdef CONFIG_DECK_LOCO_TDOA3_HYBRID_MODE
     const bool doExcludeId = ctx.isTwrActive;
     const uint8_t excludedId = ctx.anchorId;
@@ -29,7 +29,11 @@
 #define EERROM_H
 
 #include <stdbool.h>
-#include "i2cdev.h"
+#include <stdint.h>
+
+// The I2C bus is only passed by pointer, the users of the EEPROM do not need
+// the I2C driver headers
+struct I2cDrv_s;
 
 #define EEPROM_SIZE         0x1FFF
 
@@ -39,7 +43,7 @@
  *
  * @return True on success, else false.
  */
-bool eepromInit(I2C_Dev *i2cPort);
+bool eepromInit(struct I2cDrv_s *i2cPort);
 
 /**
  * Test that the eeprom is there
@@ -63,7 +63,7 @@ typedef struct
 
 } I2cDef;
 
-typedef struct
+typedef struct I2cDrv_s
 {
   const I2cDef *def;                    //< Definition of the i2c
   I2cMessage txMessage;                 //< The I2C send message
@@ -34,6 +34,7 @@
 #include "task.h"
 
 #include "eeprom.h"
+#include "i2cdev.h"
 #include "debug.h"
 #include "eprintf.h"
 #include "mem.h"
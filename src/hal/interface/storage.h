@@ -39,6 +39,13 @@
  */
 void storageInit();
 
+/**
+ * Release the RAM copy of the storage that serves reads during the boot
+ * phase. It is released by the worker a few seconds from now, when the tasks
+ * have read their stored data. Called when the system starts.
+ */
+void storageReleaseBootSnapshotAfterStart();
+
 /**
  * Test the storage subsystem
  *
@@ -44,6 +44,11 @@
 #include "queuemonitor.h"
 #include "static_mem.h"
 #include "cfassert.h"
+#include "autoconf.h"
+
+#ifdef CONFIG_SWARM_STATE
+#include "swarm_state.h"
+#endif
 
 #define RADIOLINK_TX_QUEUE_SIZE (1)
 #define RADIOLINK_CRTP_QUEUE_SIZE (5)
@@ -162,8 +167,11 @@ void radiolinkSyslinkDispatch(SyslinkPacket *slp)
   if (slp->type == SYSLINK_RADIO_RAW)
   {
     slp->length--; // Decrease to get CRTP size.
-    // Assert that we are not dropping any packets
-    ASSERT(xQueueSend(crtpPacketDelivery, &slp->length, 0) == pdPASS);
+    if (!crtpDispatchDirect(&radiolinkOp, (CRTPPacket*)&slp->length))
+    {
+      // Assert that we are not dropping any packets
+      ASSERT(xQueueSend(crtpPacketDelivery, &slp->length, 0) == pdPASS);
+    }
     ++count_rx_unicast;
     ledseqRun(&seq_linkUp);
     // If a radio packet is received, one can be sent
@@ -176,7 +184,11 @@ void radiolinkSyslinkDispatch(SyslinkPacket *slp)
   {
     slp->length--; // Decrease to get CRTP size.
     // broadcasts are best effort, so no need to handle the case where the queue is full
-    BaseType_t result = xQueueSend(crtpPacketDelivery, &slp->length, 0);
+    BaseType_t result = pdPASS;
+    if (!crtpDispatchDirect(&radiolinkOp, (CRTPPacket*)&slp->length))
+    {
+      result = xQueueSend(crtpPacketDelivery, &slp->length, 0);
+    }
     // only increment the received counter, if we were able to put it in the queue
     if (result == pdPASS) {
       ++count_rx_broadcast;
@@ -198,6 +210,11 @@ void radiolinkSyslinkDispatch(SyslinkPacket *slp)
     memcpy(&p2pp.data[0], &slp->data[2], p2pDataLength);
     p2pp.size = p2pDataLength;
 
+#ifdef CONFIG_SWARM_STATE
+    if (p2pp.port == SWARM_STATE_P2P_PORT) {
+      swarmStateReceive(&p2pp);
+    } else
+#endif
     if (p2p_callback) {
         p2p_callback(&p2pp);
     }
@@ -28,13 +28,16 @@
 
 #include "storage.h"
 #include "param.h"
+#include "log.h"
 
 #include "kve/kve.h"
+#include "kve/kve_storage.h"
 
 #include "FreeRTOS.h"
 #include "semphr.h"
+#include "task.h"
 
-#include "i2cdev.h"
+#include "worker.h"
 #include "eeprom.h"
 
 #include <string.h>
@@ -62,14 +65,83 @@
 #define DEFRAG_ON_STARTUP DEFAULT_DEFRAG_ON_STARTUP
 #endif
 
+#define DEFAULT_BOOT_SNAPSHOT_SIZE 2048
+
+#ifdef CONFIG_STORAGE_BOOT_SNAPSHOT_SIZE
+#define BOOT_SNAPSHOT_SIZE CONFIG_STORAGE_BOOT_SNAPSHOT_SIZE
+#else
+#define BOOT_SNAPSHOT_SIZE DEFAULT_BOOT_SNAPSHOT_SIZE
+#endif
+
+// The snapshot is loaded in chunks until the end of the table is found
+#define BOOT_SNAPSHOT_CHUNK_SIZE 256
+// Time after the system start when the snapshot is released, the tasks read
+// their stored data when they start
+#define BOOT_SNAPSHOT_HOLD_MS 3000
+
+// The kve table starts with a version byte, followed by the items
+#define KVE_FIRST_ITEM_ADDRESS 1
+
 static SemaphoreHandle_t storageMutex;
 
+// RAM copy of the start of the kve partition, used during the boot phase
+static struct {
+  uint8_t* data;
+  // Number of bytes in the snapshot, counted from the start of the partition
+  size_t length;
+} bootSnapshot;
+
+static uint16_t bootSnapshotLoadTimeMs;
+static uint16_t bootSnapshotLength;
+
+static void releaseBootSnapshot(void)
+{
+  if (bootSnapshot.data) {
+    vPortFree(bootSnapshot.data);
+    bootSnapshot.data = 0;
+    bootSnapshot.length = 0;
+  }
+}
+
+static void releaseBootSnapshotJob(void* arg)
+{
+  xSemaphoreTake(storageMutex, portMAX_DELAY);
+  releaseBootSnapshot();
+  xSemaphoreGive(storageMutex);
+}
+
+// Keeps the snapshot in sync with the EEPROM, the part of a write that is
+// outside the snapshot is only written to the EEPROM
+static void updateBootSnapshot(size_t address, const void* data, size_t length, bool success)
+{
+  if (!bootSnapshot.data || address >= bootSnapshot.length) {
+    return;
+  }
+
+  if (!success) {
+    // The content of the EEPROM is unknown
+    releaseBootSnapshot();
+    return;
+  }
+
+  size_t snapshotLength = bootSnapshot.length - address;
+  if (length < snapshotLength) {
+    snapshotLength = length;
+  }
+  memcpy(&bootSnapshot.data[address], data, snapshotLength);
+}
+
 static size_t readEeprom(size_t address, void* data, size_t length)
 {
   if (length == 0) {
     return 0;
   }
 
+  if (bootSnapshot.data && (address + length) <= bootSnapshot.length) {
+    memcpy(data, &bootSnapshot.data[address], length);
+    return length;
+  }
+
   bool success = eepromReadBuffer(data, KVE_PARTITION_START + address, length);
 
 #if TRACE_MEMORY_ACCESS
@@ -96,6 +168,7 @@ static size_t writeEeprom(size_t address, const void* data, size_t length)
   }
 
   bool success = eepromWriteBuffer(data, KVE_PARTITION_START + address, length);
+  updateBootSnapshot(address, data, length, success);
 
 #if TRACE_MEMORY_ACCESS
   DEBUG_PRINT("W %s @%04x: ", success?" OK ":"FAIL", address);
@@ -126,6 +199,72 @@ static kveMemory_t kve = {
   .flush = flushEeprom,
 };
 
+// Copies the used part of the kve partition to RAM, with one sequential read
+// per chunk. Items that do not fit in the snapshot are read from the EEPROM.
+static void loadBootSnapshot(void)
+{
+  if (BOOT_SNAPSHOT_SIZE == 0) {
+    return;
+  }
+
+  const uint32_t startMs = T2M(xTaskGetTickCount());
+
+  uint8_t* data = pvPortMalloc(BOOT_SNAPSHOT_SIZE);
+  if (!data) {
+    DEBUG_PRINT("No memory for the boot snapshot\n");
+    return;
+  }
+
+  size_t loaded = 0;
+  size_t itemAddress = KVE_FIRST_ITEM_ADDRESS;
+  bool isValid = true;
+  bool isComplete = false;
+
+  while (isValid && !isComplete) {
+    if ((itemAddress + sizeof(kveItemHeader_t)) > loaded) {
+      if (loaded >= BOOT_SNAPSHOT_SIZE || loaded >= KVE_PARTITION_LENGTH) {
+        break;
+      }
+
+      size_t chunkLength = BOOT_SNAPSHOT_CHUNK_SIZE;
+      if (chunkLength > BOOT_SNAPSHOT_SIZE - loaded) {
+        chunkLength = BOOT_SNAPSHOT_SIZE - loaded;
+      }
+      if (chunkLength > KVE_PARTITION_LENGTH - loaded) {
+        chunkLength = KVE_PARTITION_LENGTH - loaded;
+      }
+
+      isValid = eepromReadBuffer(&data[loaded], KVE_PARTITION_START + loaded, chunkLength);
+      loaded += chunkLength;
+      continue;
+    }
+
+    kveItemHeader_t header;
+    memcpy(&header, &data[itemAddress], sizeof(header));
+
+    if (header.full_length == KVE_END_TAG) {
+      isComplete = true;
+    } else if (header.full_length < (sizeof(header) + 1)) {
+      // Corrupt table, let kve handle it
+      isValid = false;
+    } else {
+      itemAddress += header.full_length;
+    }
+  }
+
+  if (!isValid) {
+    vPortFree(data);
+    DEBUG_PRINT("Boot snapshot failed, reading from EEPROM\n");
+    return;
+  }
+
+  bootSnapshot.data = data;
+  bootSnapshot.length = loaded;
+
+  bootSnapshotLength = loaded;
+  bootSnapshotLoadTimeMs = T2M(xTaskGetTickCount()) - startMs;
+}
+
 // Public API
 
 static bool isInit = false;
@@ -134,12 +273,25 @@ void storageInit()
 {
   storageMutex = xSemaphoreCreateMutex();
 
+  loadBootSnapshot();
+
   isInit = true;
   if (DEFRAG_ON_STARTUP) {
     kveDefrag(&kve);
   }
 }
 
+void storageReleaseBootSnapshotAfterStart()
+{
+  if (!bootSnapshot.data) {
+    return;
+  }
+
+  if (workerScheduleJob(releaseBootSnapshotJob, 0, workerPriorityLow, BOOT_SNAPSHOT_HOLD_MS) != 0) {
+    releaseBootSnapshotJob(0);
+  }
+}
+
 bool storageTest()
 {
   xSemaphoreTake(storageMutex, portMAX_DELAY);
@@ -289,3 +441,20 @@ PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, storageStats, &storageStats, printStats)
 PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, storageReformat, &reformatValue, doReformat)
 
 PARAM_GROUP_STOP(system)
+
+/**
+ * Boot time of the storage
+ */
+LOG_GROUP_START(sys)
+
+/**
+ * @brief Time [ms] to load the used part of the storage to RAM at startup
+ */
+LOG_ADD(LOG_UINT16, storLoadMs, &bootSnapshotLoadTimeMs)
+
+/**
+ * @brief Number of bytes of the storage loaded to RAM at startup, 0 if the snapshot is not used
+ */
+LOG_ADD(LOG_UINT16, storSnapLen, &bootSnapshotLength)
+
+LOG_GROUP_STOP(sys)
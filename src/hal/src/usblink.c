@@ -75,8 +75,11 @@ static void usblinkTask(void *param)
     usbGetDataBlocking(&usbIn);
     p.size = usbIn.size - 1;
     memcpy(&p.raw, usbIn.data, usbIn.size);
-    // This queuing will copy a CRTP packet size from usbIn
-    xQueueSend(crtpPacketDelivery, &p, portMAX_DELAY);
+    if (!crtpDispatchDirect(&usblinkOp, &p))
+    {
+      // This queuing will copy a CRTP packet size from usbIn
+      xQueueSend(crtpPacketDelivery, &p, portMAX_DELAY);
+    }
   }
 
 }
@@ -95,6 +95,14 @@ typedef struct collision_avoidance_params_s
 } collision_avoidance_params_t;
 
 
+// Maximum number of neighbors remembered as active cell walls between cycles.
+#define COLLISION_AVOIDANCE_MAX_ACTIVE_PEERS 8
+
+// Number of floats needed for the workspace argument of
+// collisionAvoidanceUpdateSetpointCore.
+#define COLLISION_AVOIDANCE_WORKSPACE_SIZE(nOthers) (8 * ((nOthers) + 6))
+
+
 // Mutable state of the algorithm.
 
 typedef struct collision_avoidance_state_s
@@ -105,12 +113,30 @@ typedef struct collision_avoidance_state_s
   // state as a setpoint.
   struct vec lastFeasibleSetPosition;
 
+  // Indices into otherPositions of the neighbors whose cell walls were active
+  // (or nearly so) at the setpoint of the previous cycle, sorted ascending.
+  // The projection is first tried on these walls only, and only falls back to
+  // the full cell if the result violates another wall. This is a hint: if the
+  // caller does not keep the neighbor order stable, results are still correct,
+  // only slower. Zero-initialize nActivePeers before the first call.
+  int activePeers[COLLISION_AVOIDANCE_MAX_ACTIVE_PEERS];
+  int nActivePeers;
+
+  // Number of polytope rows (6 bounding box faces plus the neighbors left after
+  // culling) in the most recent cycle. Only used for diagnostics.
+  int nCellRows;
+
 } collision_avoidance_state_t;
 
 
 // Main computational routine. Mutates the setpoint such that the new setpoint
 // respects the buffered Voronoi cell constraint.
 //
+// Neighbors that cannot constrain our motion within the planning horizon (i.e.
+// their cell wall lies entirely outside of the box we can reach with maxSpeed
+// in horizonSecs) are culled before the cell is built, so the cost scales with
+// the number of nearby neighbors rather than with the swarm size.
+//
 // To facilitate compiling and testing on a PC, we take neighbour positions via
 // array instead of having the implementation call peer_localization.h functions
 // directly. On the other hand, we wish to use the minimum possible amount of
@@ -123,7 +149,8 @@ typedef struct collision_avoidance_state_s
 //   collisionState: Algorithm mutable state.
 //   nOthers: Number of other Crazyflies in array arguments.
 //   otherPositions: [nOthers * 3] array of positions (meters).
-//   workspace: Space of no less than 7 * (nOthers + 6) floats. Used for
+//   workspace: Space of no less than COLLISION_AVOIDANCE_WORKSPACE_SIZE(nOthers)
+//     floats, i.e. 8 * (nOthers + 6). Used for
 //     temporary storage during computation. This can be the same address as
 //     otherPositions - otherPositions is copied into workspace immediately.
 //   setpoint: Setpoint from commander that will be mutated.
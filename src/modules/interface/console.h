@@ -30,6 +30,8 @@
 #include <stdbool.h>
 #include "eprintf.h"
 
+#define CONSOLE_TOKEN_CH 1
+
 /**
  * Initialize the console
  */
@@ -70,6 +72,24 @@ int consolePuts(const char *str);
  */
 void consoleFlush(void);
 
+/**
+ * Print with a tokenized format string
+ *
+ * Only the token of the format string and the arguments in binary form are
+ * sent, in one packet on the CONSOLE_TOKEN_CH channel. The token is the offset
+ * of the format string from _consoleFmt_start, the client looks up the string
+ * in the elf file and formats the text, see tools/console/console_decoder.py.
+ * Used by DEBUG_PRINT when CONFIG_DEBUG_PRINT_TOKENIZED is set.
+ *
+ * In an interrupt no packet can be sent, the text is formatted and added to
+ * the console buffer with consolePutcharFromISR() instead.
+ *
+ * @param fmt Format string, must be placed in the .consoleFmt section
+ * @param ... Parameters to print
+ * @return The number of bytes sent or buffered, 0 if the packet could not be sent
+ */
+int consoleTokenPrintf(const char *fmt, ...);
+
 /**
  * Macro implementing consolePrintf with eprintf
  *
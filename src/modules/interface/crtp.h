@@ -78,6 +78,29 @@ typedef struct _CRTPPacket
 
 typedef void (*CrtpCallback)(CRTPPacket *);
 
+/**
+ * What to do with a received packet when the queue of its port is full.
+ */
+typedef enum {
+  CRTP_RX_OVERFLOW_BLOCK = 0,       //< Wait until there is room in the queue, this stalls reception on all ports
+  CRTP_RX_OVERFLOW_DROP_NEWEST,     //< Drop the received packet
+  CRTP_RX_OVERFLOW_DROP_OLDEST,     //< Drop the oldest packet in the queue
+  CRTP_RX_OVERFLOW_COALESCE_LATEST, //< Drop all packets in the queue, for ports where only the latest packet is of interest
+} crtpRxOverflowPolicy_t;
+
+/**
+ * Transmit priority classes. Each class has its own bounded queue, the TX task
+ * sends from the highest priority class that has packets waiting. A lower
+ * class that has been passed over too many times in a row is sent from first,
+ * see crtp_tx_schedule.h.
+ */
+typedef enum {
+  CRTP_TX_PRIORITY_HIGH = 0,    //< Short replies to commands, for instance high level commander and link
+  CRTP_TX_PRIORITY_NORMAL,      //< Telemetry, the oldest packet is dropped when the queue is full
+  CRTP_TX_PRIORITY_LOW,         //< Bulk transfers, for instance console, parameters and memory
+  CRTP_TX_PRIORITY_COUNT,
+} crtpTxPriority_t;
+
 /**
  * Initialize the CRTP stack
  */
@@ -104,10 +127,40 @@ void crtpInitTaskQueue(CRTPPort taskId);
  */
 void crtpRegisterPortCB(int port, CrtpCallback cb);
 
+/**
+ * Register a callback that is called directly from the link task when a packet
+ * is received on 'port', before the packet is queued to the CRTP rx task.
+ * Packets for the port are never delayed by other ports with full queues.
+ *
+ * @param[in] port Crtp port for which the callback is set
+ * @param[in] cb Callback that will be called when a packet is received on
+ *            'port'. Must be short and must not block, neither directly nor
+ *            through functions it calls, since it stalls the link.
+ */
+void crtpRegisterPortDirectCB(int port, CrtpCallback cb);
+
+/**
+ * Set what to do with received packets when the queue of a port is full.
+ *
+ * @param[in] port   Crtp port
+ * @param[in] policy The overflow policy
+ */
+void crtpSetPortRxOverflowPolicy(CRTPPort port, crtpRxOverflowPolicy_t policy);
+
+/**
+ * Set the transmit priority class used for packets sent on a port.
+ *
+ * @param[in] port     Crtp port
+ * @param[in] priority The priority class for the port
+ */
+void crtpSetPortTxPriority(CRTPPort port, crtpTxPriority_t priority);
+
 /**
  * Put a packet in the TX task
  *
- * If the TX stack is full, the oldest lowest priority packet is dropped
+ * If the queue of the priority class of the port is full, the packet is
+ * dropped. For the CRTP_TX_PRIORITY_NORMAL class, the oldest packet in the
+ * queue is dropped instead.
  *
  * @param[in] p CRTPPacket to send
  */
@@ -148,6 +201,14 @@ int crtpReceivePacketWait(CRTPPort taskId, CRTPPacket *p, int wait);
  */
 int crtpGetFreeTxQueuePackets(void);
 
+/**
+ * Get the number of free tx packets in the queue used for a port
+ *
+ * @param[in] port Crtp port
+ * @return Number of free packets
+ */
+int crtpGetFreeTxQueuePacketsForPort(CRTPPort port);
+
 /**
  * Wait for a packet to arrive for the specified taskID
  *
@@ -173,6 +234,17 @@ struct crtpLinkOperations
 
 void crtpSetLink(struct crtpLinkOperations * lk);
 
+/**
+ * Called by a link when a packet is received, before it is queued for the
+ * CRTP rx task. Dispatches the packet if a direct callback is registered for
+ * its port and the link is the active link.
+ *
+ * @param[in] lk The link that received the packet
+ * @param[in] p  The received packet
+ * @return true if the packet was dispatched and should not be queued
+ */
+bool crtpDispatchDirect(const struct crtpLinkOperations * lk, CRTPPacket *p);
+
 /**
  * Check if the connection timeout has been reached, otherwise
  * we will assume that we are connected.
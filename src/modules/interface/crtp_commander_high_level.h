@@ -69,6 +69,13 @@ bool crtpCommanderHighLevelGetSetpoint(setpoint_t* setpoint, const state_t *stat
 // commander what initial conditions to use for trajectory planning.
 void crtpCommanderHighLevelTellState(const state_t *state);
 
+// Non-blocking versions of crtpCommanderHighLevelStop() and
+// crtpCommanderHighLevelTellState(), for callers that must not wait for the
+// trajectory lock. The requests are carried out before the next command or
+// setpoint evaluation uses the trajectory.
+void crtpCommanderHighLevelRequestStop();
+void crtpCommanderHighLevelRequestTellState(const state_t *state);
+
 // True if we have landed or stopped.
 bool crtpCommanderHighLevelIsStopped();
 
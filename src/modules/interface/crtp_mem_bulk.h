@@ -0,0 +1,105 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * crtp_mem_bulk.h - Windowed bulk transfers for the memory sub system
+ */
+
+/*
+The bulk channel transfers a range of a memory in chunks, without a request
+per chunk. The first byte of each packet is the command. All integers are
+little endian.
+
+Bulk read
+  Client:   READ_START  [cmd, memId, addr u32, len u32, window u8]
+  Firmware: READ_START  [cmd, memId, status, chunkSize u8, window u8]
+  Firmware: READ_DATA   [cmd, seq u16, data] for chunk 0, 1, 2 ...
+  Client:   ACK         [cmd, nextSeq u16, received u32]
+
+  The firmware streams chunks as long as there are less than 'window' chunks
+  that have not been acknowledged. In the ACK, all chunks before nextSeq have
+  been received and bit i of 'received' is set if chunk nextSeq + i has been
+  received. Since packets are delivered in order, the holes below the highest
+  received chunk are lost and are sent again. The transfer is done when
+  nextSeq is the number of chunks. If there is no ACK for a while, the oldest
+  chunk that is not acknowledged is sent again. If reading the memory fails,
+  the firmware sends READ_START with status EIO and ends the transfer.
+
+Bulk write
+  Client:   WRITE_START [cmd, memId, addr u32, len u32]
+  Firmware: WRITE_START [cmd, memId, status, chunkSize u8, window u8]
+  Client:   WRITE_DATA  [cmd, seq u16, data] for chunk 0, 1, 2 ...
+  Firmware: ACK         [cmd, status, nextSeq u16, received u32]
+
+  The client may send chunks up to 'window' chunks after the first chunk that
+  has not been acknowledged. The firmware acknowledges when it detects a
+  hole, every half window and when all chunks are received. A duplicate chunk
+  is also acknowledged, which lets the client recover from a lost ACK.
+
+ABORT [cmd] from the client ends the ongoing transfer. Only one bulk transfer
+is active at a time, a new start replaces the ongoing transfer.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "crtp.h"
+
+#define MEM_BULK_CH 3
+
+#define MEM_BULK_CMD_READ_START   0x01
+#define MEM_BULK_CMD_READ_DATA    0x02
+#define MEM_BULK_CMD_READ_ACK     0x03
+#define MEM_BULK_CMD_WRITE_START  0x10
+#define MEM_BULK_CMD_WRITE_DATA   0x11
+#define MEM_BULK_CMD_WRITE_ACK    0x12
+#define MEM_BULK_CMD_ABORT        0x20
+
+// Payload of a data packet: command and sequence number, followed by the data
+#define MEM_BULK_CHUNK_SIZE (CRTP_MAX_DATA_SIZE - 3)
+#define MEM_BULK_MAX_WINDOW 32
+
+// Time without ACK before a chunk is sent again during a bulk read
+#define MEM_BULK_READ_TIMEOUT_MS 200
+// Number of timeouts in a row before a bulk read is dropped
+#define MEM_BULK_READ_MAX_TIMEOUTS 10
+
+#define MEM_BULK_WAIT_FOREVER UINT32_MAX
+
+/**
+ * @brief Handle a packet received on the bulk channel
+ *
+ * @param p The packet, used for the response
+ * @param nowMs The current time
+ */
+void crtpMemBulkProcess(CRTPPacket* p, const uint32_t nowMs);
+
+/**
+ * @brief Send the next chunk of an ongoing bulk read, if any
+ *
+ * @param nowMs The current time
+ * @return The time (ms) to wait for packets from the client before calling
+ * again. 0 if there is more to send, MEM_BULK_WAIT_FOREVER if there is no bulk
+ * read going on.
+ */
+uint32_t crtpMemBulkRun(const uint32_t nowMs);
@@ -0,0 +1,58 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * crtp_tx_schedule.h - Selects the CRTP transmit priority class to send from
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "crtp.h"
+
+// A class with packets waiting is sent from at the latest after this many
+// packets from higher priority classes, it gets at least 1 / (N + 1) of the link
+#define CRTP_TX_MAX_SKIPPED 8
+
+typedef struct {
+  // Packets sent from higher priority classes while the class had packets waiting
+  uint16_t skipped[CRTP_TX_PRIORITY_COUNT];
+
+  // Packets sent out of priority order because a class had waited too long
+  uint32_t agedCount;
+} crtpTxSchedule_t;
+
+void crtpTxScheduleInit(crtpTxSchedule_t* this);
+
+/**
+ * @brief Select the priority class to send the next packet from. This is the
+ * highest priority class with packets waiting, unless a lower class has been
+ * skipped CRTP_TX_MAX_SKIPPED times in a row, then the highest of those
+ * classes is selected instead. This keeps a steady flow of telemetry from
+ * starving bulk transfers.
+ *
+ * @param hasPackets true for the classes that have packets waiting
+ * @return The class to send from, or CRTP_TX_PRIORITY_COUNT if there is none
+ */
+crtpTxPriority_t crtpTxScheduleNext(crtpTxSchedule_t* this, const bool hasPackets[CRTP_TX_PRIORITY_COUNT]);
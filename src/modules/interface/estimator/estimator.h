@@ -53,9 +53,11 @@ typedef enum {
   MeasurementTypeFlow,
   MeasurementTypeYawError,
   MeasurementTypeSweepAngle,
+  MeasurementTypeSweepAngleBatch,
   MeasurementTypeGyroscope,
   MeasurementTypeAcceleration,
   MeasurementTypeBarometer,
+  MeasurementType_COUNT,
 } MeasurementType;
 
 typedef struct
@@ -72,6 +74,7 @@ typedef struct
     flowMeasurement_t flow;
     yawErrorMeasurement_t yawError;
     sweepAngleMeasurement_t sweepAngle;
+    sweepAngleBatchMeasurement_t sweepAngleBatch;
     gyroscopeMeasurement_t gyroscope;
     accelerationMeasurement_t acceleration;
     barometerMeasurement_t barometer;
@@ -161,6 +164,14 @@ static inline void estimatorEnqueueSweepAngles(const sweepAngleMeasurement_t *sw
   estimatorEnqueue(&m);
 }
 
+static inline void estimatorEnqueueSweepAngleBatch(const sweepAngleBatchMeasurement_t *sweepAngleBatch)
+{
+  measurement_t m;
+  m.type = MeasurementTypeSweepAngleBatch;
+  m.data.sweepAngleBatch = *sweepAngleBatch;
+  estimatorEnqueue(&m);
+}
+
 // Helper function for state estimators
 bool estimatorDequeue(measurement_t *measurement);
 
@@ -69,3 +69,8 @@ void estimatorKalmanGetEstimatedPos(point_t* pos);
  * Copies 9 floats representing the current state rotation matrix
  */
 void estimatorKalmanGetEstimatedRot(float * rotationMatrix);
+
+/**
+ * Copies the 3x3 covariance matrix of the estimated position
+ */
+void estimatorKalmanGetEstimatedPosCovariance(float covariance[3][3]);
@@ -0,0 +1,150 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * estimator_ukf_kernels.h - Numerical kernels of the error-state UKF
+ */
+
+/*
+Numerical kernels of the error-state unscented Kalman filter in estimator_ukf.c,
+free of any RTOS dependencies.
+
+The sigma points are stored one sigma point per row, which makes each of them a
+state vector that can be passed to the measurement models as is. The Cholesky
+factor of the covariance is computed once after each change of the covariance
+and is then shared by the prediction and the measurement updates that follow.
+
+Scalar measurements of the same type are collected in a batch and fused in one
+update, with one factorization of the batch innovation covariance instead of
+one update and one refactorization of the state covariance per measurement.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define UKF_DIM_FILTER 9
+#define UKF_SIGMA_POINTS (UKF_DIM_FILTER + 2)
+
+// Max number of scalar measurements fused in one update
+#define UKF_MAX_BATCH 4
+
+typedef struct {
+  uint8_t count;
+
+  // The predicted measurement of each sigma point, minus the mean
+  float outputs[UKF_MAX_BATCH][UKF_SIGMA_POINTS];
+  float innovations[UKF_MAX_BATCH];
+  float noiseVariances[UKF_MAX_BATCH];
+
+  // Scratch memory for the update
+  float Pxy[UKF_MAX_BATCH][UKF_DIM_FILTER];
+  float Pyy[UKF_MAX_BATCH * UKF_MAX_BATCH];
+} ukfBatch_t;
+
+/**
+ * @brief Compute the weights of the simplex sigma points, and the scale of the
+ * normalized points that have mean 0 and covariance I
+ *
+ * @param weight0 The weight of the center sigma point
+ * @param weights The weight of each sigma point
+ * @param scales The scale of each dimension of the normalized points
+ */
+void ukfSigmaPointWeights(const float weight0, float weights[UKF_SIGMA_POINTS], float scales[UKF_DIM_FILTER]);
+
+/**
+ * @brief Cholesky factorization A = L * L', in place
+ *
+ * Only the lower triangle of A is read. It is overwritten with L and the upper
+ * triangle is set to zero.
+ *
+ * @param A A symmetric n x n matrix, stored by rows
+ * @param n The dimension of A
+ * @return true if A is positive definite, otherwise A is left partially factorized
+ */
+bool ukfCholeskyInPlace(float* A, const uint8_t n);
+
+/**
+ * @brief Compute the sigma points x + L * t, where t are the normalized points
+ *
+ * The structure of the normalized points is used to compute all the points
+ * with suffix sums over the rows of L, instead of a full matrix product.
+ *
+ * @param L Lower triangular Cholesky factor of the covariance
+ * @param scales From ukfSigmaPointWeights()
+ * @param x The error state estimate
+ * @param sigma The sigma points, one per row
+ */
+void ukfSigmaPoints(const float L[UKF_DIM_FILTER][UKF_DIM_FILTER], const float scales[UKF_DIM_FILTER], const float x[UKF_DIM_FILTER], float sigma[UKF_SIGMA_POINTS][UKF_DIM_FILTER]);
+
+/**
+ * @brief Propagate the sigma points through the linear error transition F,
+ * in place, and compute the covariance of the propagated points
+ *
+ * The error state is zero before the prediction, the sigma points are
+ * therefore used as deviations from the mean.
+ *
+ * @param F The error state transition matrix
+ * @param weights The weight of each sigma point
+ * @param sigma The sigma points, propagated in place
+ * @param P The predicted covariance, without process noise
+ */
+void ukfPropagate(const float F[UKF_DIM_FILTER][UKF_DIM_FILTER], const float weights[UKF_SIGMA_POINTS], float sigma[UKF_SIGMA_POINTS][UKF_DIM_FILTER], float P[UKF_DIM_FILTER][UKF_DIM_FILTER]);
+
+/**
+ * @brief Weighted mean and variance of a scalar measurement predicted for
+ * each sigma point
+ *
+ * @param outputs The predicted measurement of each sigma point
+ * @param weights The weight of each sigma point
+ * @param mean The mean of the prediction
+ * @param variance The variance of the prediction, without measurement noise
+ */
+void ukfOutputStatistics(const float outputs[UKF_SIGMA_POINTS], const float weights[UKF_SIGMA_POINTS], float* mean, float* variance);
+
+/**
+ * @brief Add a scalar measurement to a batch
+ *
+ * All measurements in a batch must be predicted from the same sigma points.
+ *
+ * @param batch The batch
+ * @param outputs The predicted measurement of each sigma point
+ * @param mean The mean of the prediction
+ * @param innovation The measured value minus the mean
+ * @param noiseVariance The variance of the measurement noise
+ * @return false if the batch is full
+ */
+bool ukfBatchAdd(ukfBatch_t* batch, const float outputs[UKF_SIGMA_POINTS], const float mean, const float innovation, const float noiseVariance);
+
+/**
+ * @brief Fuse all measurements in a batch and empty the batch
+ *
+ * @param batch The batch
+ * @param sigma The sigma points the measurements were predicted from
+ * @param weights The weight of each sigma point
+ * @param x The error state estimate, updated in place
+ * @param P The covariance, updated in place
+ * @return true if the state was updated, false if the batch was empty or the
+ * innovation covariance was not positive definite
+ */
+bool ukfBatchUpdate(ukfBatch_t* batch, const float sigma[UKF_SIGMA_POINTS][UKF_DIM_FILTER], const float weights[UKF_SIGMA_POINTS], float x[UKF_DIM_FILTER], float P[UKF_DIM_FILTER][UKF_DIM_FILTER]);
@@ -0,0 +1,100 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * measurement_scheduler.h - Priority and time budget for estimator measurements
+ */
+
+/*
+The IMU samples drive the prediction of the estimator and are always used right
+away. Other measurements are passed through the scheduler, which hands them out
+by priority, first in first out within a priority. When the estimator has spent
+its time budget for a cycle, the measurements that are left are deferred to the
+next cycle. If there is no room for a new measurement, the oldest measurement
+with the same priority is dropped, a flooding source replaces its own old data.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "estimator.h"
+
+// Max number of pending measurements per priority
+#define MEASUREMENT_SCHEDULER_LENGTH 6
+
+typedef enum {
+  measurementPriorityHigh = 0,
+  measurementPriorityNormal,
+  measurementPriorityLow,
+  measurementPriorityCount,
+} measurementPriority_t;
+
+typedef struct {
+  measurement_t items[MEASUREMENT_SCHEDULER_LENGTH];
+  uint8_t head;
+  uint8_t count;
+} measurementRing_t;
+
+typedef struct {
+  measurementRing_t rings[measurementPriorityCount];
+  uint8_t priorities[MeasurementType_COUNT];
+
+  // Statistics per measurement type, wrap around
+  uint16_t processedCount[MeasurementType_COUNT];
+  uint16_t deferredCount[MeasurementType_COUNT];
+  uint16_t droppedCount[MeasurementType_COUNT];
+} measurementScheduler_t;
+
+/**
+ * @brief Empty the scheduler, reset the statistics and set the default priorities
+ *
+ * Position, pose, ToF, height, flow and yaw error are high priority. TDoA,
+ * distance and sweep angles, that come in bursts, are normal priority. The
+ * barometer is low priority. The kalman estimator lets the priorities of the
+ * normal and low priority types be changed with the kalman.prio* parameters.
+ */
+void measurementSchedulerInit(measurementScheduler_t* this);
+
+void measurementSchedulerSetPriority(measurementScheduler_t* this, const MeasurementType type, const measurementPriority_t priority);
+
+/**
+ * @brief Add a measurement, the oldest measurement with the same priority is
+ * dropped if there is no room
+ *
+ * @return false if a measurement was dropped
+ */
+bool measurementSchedulerAdd(measurementScheduler_t* this, const measurement_t* measurement);
+
+/**
+ * @brief Take the oldest measurement with the highest priority
+ *
+ * @return false if there are no pending measurements
+ */
+bool measurementSchedulerTake(measurementScheduler_t* this, measurement_t* measurement);
+
+/**
+ * @brief End of a cycle, the measurements that are left are counted as deferred
+ * and are handed out in the next cycle
+ */
+void measurementSchedulerDefer(measurementScheduler_t* this);
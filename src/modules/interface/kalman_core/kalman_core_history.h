@@ -0,0 +1,136 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * kalman_core_history.h - Short history of the Kalman state for delayed measurements
+ */
+
+/*
+Measurements like external positions from a motion capture system are taken
+some time before they reach the filter. The history keeps the state, the
+covariance and the IMU input of the latest predictions, which makes it
+possible to fuse a delayed measurement at the time it was taken.
+
+A delayed measurement is fused in a copy of the state from the history
+(kalmanCoreHistoryRewind()). The copy is then predicted forward to the current
+time with the recorded IMU input, and so is the unchanged state from the
+history. The difference between the two is the effect of the measurement at
+the current time, and is added to the current state and covariance
+(kalmanCoreHistoryApply()). Measurements fused since the recorded state are
+kept in the current state, the correction is added on top of them.
+
+The cost of a delayed measurement is two predictions and finalizations per
+recorded step between the measurement and the current time, the memory is
+bounded by the length of the history.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "kalman_core.h"
+#include "autoconf.h"
+
+#ifndef CONFIG_ESTIMATOR_KALMAN_HISTORY_LENGTH
+#define CONFIG_ESTIMATOR_KALMAN_HISTORY_LENGTH 4
+#endif
+
+#define KALMAN_CORE_HISTORY_LENGTH CONFIG_ESTIMATOR_KALMAN_HISTORY_LENGTH
+
+typedef struct {
+  // The time of the state, the last prediction of the filter
+  uint32_t timestampMs;
+
+  float S[KC_STATE_DIM];
+  float q[4];
+  float R[3][3];
+  float P[KC_STATE_DIM][KC_STATE_DIM];
+
+  // The input to the prediction that followed the state
+  Axis3f acc;
+  Axis3f gyro;
+  bool quadIsFlying;
+} kalmanCoreHistoryEntry_t;
+
+typedef struct {
+  kalmanCoreHistoryEntry_t entries[KALMAN_CORE_HISTORY_LENGTH];
+  uint8_t head;
+  uint8_t count;
+
+  // Work area for a delayed measurement, the state the measurement is fused
+  // in and the same state without the measurement
+  kalmanCoreData_t updated;
+  kalmanCoreData_t reference;
+  uint8_t rewindIndex;
+
+  // Statistics
+  uint16_t delayedCount;
+  uint16_t tooOldCount;
+  uint8_t latestSteps;
+} kalmanCoreHistory_t;
+
+/**
+ * @brief Initialize an empty history. Must be called when the filter is reset.
+ *
+ * @param this The history
+ */
+void kalmanCoreHistoryInit(kalmanCoreHistory_t* this);
+
+/**
+ * @brief Record the current state and the input to the next prediction. Call
+ * right before kalmanCorePredict() with the same input. The oldest entry is
+ * replaced when the history is full.
+ *
+ * @param this The history
+ * @param coreData The finalized state of the filter
+ * @param acc The acceleration used in the prediction
+ * @param gyro The angular rates used in the prediction
+ * @param quadIsFlying Passed on to the prediction
+ */
+void kalmanCoreHistoryRecord(kalmanCoreHistory_t* this, const kalmanCoreData_t* coreData, const Axis3f* acc, const Axis3f* gyro, const bool quadIsFlying);
+
+/**
+ * @brief Prepare for a measurement taken at a given time.
+ *
+ * If the measurement is older than the last prediction of the filter, the
+ * state from the history at the time of the measurement is returned, and the
+ * measurement should be fused in it followed by a call to
+ * kalmanCoreHistoryApply(). Otherwise, or if the measurement is older than the
+ * history, 0 is returned and the measurement should be fused in the current
+ * state as usual.
+ *
+ * @param this The history
+ * @param coreData The current state of the filter
+ * @param timestampMs The time when the measurement was taken, 0 if unknown
+ * @return kalmanCoreData_t* The state to fuse the measurement in, or 0
+ */
+kalmanCoreData_t* kalmanCoreHistoryRewind(kalmanCoreHistory_t* this, const kalmanCoreData_t* coreData, const uint32_t timestampMs);
+
+/**
+ * @brief Move the effect of a measurement fused in the state from
+ * kalmanCoreHistoryRewind() to the current state. The current state must be
+ * finalized afterwards.
+ *
+ * @param this The history
+ * @param coreData The current state of the filter, updated
+ */
+void kalmanCoreHistoryApply(kalmanCoreHistory_t* this, kalmanCoreData_t* coreData);
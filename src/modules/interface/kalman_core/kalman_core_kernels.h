@@ -0,0 +1,68 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * kalman_core_kernels.h - Covariance kernels specialized for the state dimension
+ */
+
+/*
+The covariance updates of the Kalman core work on KC_STATE_DIM x KC_STATE_DIM
+matrices. The kernels below are written for that fixed size, with unrolled
+inner products and without the dimension checks and transposes of the generic
+matrix functions. On the host the row loops have a fixed length and no
+aliasing, which lets the compiler vectorize them.
+*/
+
+#pragma once
+
+#include "kalman_core.h"
+
+/**
+ * @brief P = A * P * A'
+ *
+ * @param A Matrix, for instance the linearized dynamics
+ * @param P The covariance, updated in place
+ */
+void kalmanCoreKernelSandwich(const float A[KC_STATE_DIM][KC_STATE_DIM], float P[KC_STATE_DIM][KC_STATE_DIM]);
+
+/**
+ * @brief P = (I - K * h) * P * (I - K * h)' for a scalar measurement
+ *
+ * The update is done as P - K * (h * P) - (P * h') * K' + (h * P * h') * K * K',
+ * which is the same as the Joseph form but only uses vector products since K * h
+ * is of rank one.
+ *
+ * @param P The covariance, updated in place
+ * @param h The measurement Jacobian, a row vector
+ * @param K The Kalman gain, a column vector
+ */
+void kalmanCoreKernelScalarJoseph(float P[KC_STATE_DIM][KC_STATE_DIM], const float h[KC_STATE_DIM], const float K[KC_STATE_DIM]);
+
+/**
+ * @brief P = A * P * A' where A is identity except for the attitude error
+ * block, A[D0..D2][D0..D2] = R. Only the rows and columns of the attitude
+ * error are changed.
+ *
+ * @param P The covariance, updated in place
+ * @param R The rotation of the attitude error
+ */
+void kalmanCoreKernelRotateAttitude(float P[KC_STATE_DIM][KC_STATE_DIM], const float R[3][3]);
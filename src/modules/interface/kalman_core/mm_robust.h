@@ -0,0 +1,51 @@
+/**
+ * This robust M-estimation-based Kalman filter was originally implemented in
+ * work by the Dynamic Systems Lab (DSL) at the University of Toronto
+ * Institute for Aerospace Studies (UTIAS) and the Vector Institute for
+ * Artificial Intelligence, Toronto, ON, Canada.
+ *
+ * It can be cited as:
+   @ARTICLE{Zhao2021Learningbased,
+    author={Zhao, Wenda and Panerati, Jacopo and Schoellig, Angela P.},
+    title={Learning-based Bias Correction for Time Difference of Arrival
+           Ultra-wideband Localization of Resource-constrained Mobile Robots},
+    journal={IEEE Robotics and Automation Letters},
+    year={2021},
+    publisher={IEEE}}
+ *
+ * mm_robust.h - Iteratively reweighted (M-estimation) scalar update, shared by
+ * the robust measurement models
+ */
+
+#pragma once
+
+#include "kalman_core.h"
+
+/**
+ * @brief Measurement model used by the robust update. Evaluates the predicted
+ * measurement and the measurement Jacobian at a state.
+ *
+ * @param state The state to linearize around
+ * @param measurement The measurement, passed through from kalmanCoreRobustScalarUpdate()
+ * @param predicted [out] The predicted measurement
+ * @param h [out] The measurement Jacobian, only the position elements must be set
+ * @return false if the measurement can not be linearized at the state
+ */
+typedef bool (*kalmanCoreRobustMeasurementModel_t)(const float state[KC_STATE_DIM], const void* measurement, float* predicted, float h[KC_STATE_DIM]);
+
+/**
+ * @brief Robust scalar measurement update. The covariance is factored once,
+ * the reweighting in each iteration is applied to the factor.
+ *
+ * Nothing is updated if the measurement model can not be linearized at the
+ * current state.
+ *
+ * @param this The kalman core data
+ * @param model The measurement model
+ * @param measurement The measurement, passed to the model
+ * @param measured The measured value
+ * @param stdDev Standard deviation of the measurement noise
+ * @param measurementSigma Sigma of the Geman-McClure weight function for the measurement error
+ * @param stateSigma Sigma of the Geman-McClure weight function for the state error
+ */
+void kalmanCoreRobustScalarUpdate(kalmanCoreData_t* this, kalmanCoreRobustMeasurementModel_t model, const void* measurement, const float measured, const float stdDev, const float measurementSigma, const float stateSigma);
@@ -30,3 +30,6 @@
 
 // Measurement of sweep angles from a Lighthouse base station
 void kalmanCoreUpdateWithSweepAngles(kalmanCoreData_t *this, sweepAngleMeasurement_t *angles, const uint32_t nowMs, OutlierFilterLhState_t* sweepOutlierFilterState);
+
+// Measurement of the sweep angles from all sensors for one rotation of a Lighthouse base station
+void kalmanCoreUpdateWithSweepAngleBatch(kalmanCoreData_t *this, const sweepAngleBatchMeasurement_t *batch, const uint32_t nowMs, OutlierFilterLhState_t* sweepOutlierFilterState);
@@ -27,6 +27,12 @@
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include "pulse_processor.h"
+
+typedef enum {
+  lh2ThrottleModeRandom = 0,
+  lh2ThrottleModeInformationGain = 1,
+} lh2ThrottleMode_t;
 
 /**
  * @brief Throttles how much of the data from lighthouse base stations that is used. When multiple base stations
@@ -40,3 +46,18 @@
  * @return false  If the sample should be discarded
  */
 bool throttleLh2Samples(const uint32_t now_ms);
+
+/**
+ * @brief Throttles the data from one lighthouse V2 base station. In the information gain mode, the samples are scored
+ * by the expected reduction of the position variance in the estimator (H * P * H' / (H * P * H' + R)) and by how
+ * often the base station has been used recently. Only the best scoring samples are used, to keep the rate of
+ * samples to the estimator below the maximum rate. In the random mode, this is the same as throttleLh2Samples().
+ *
+ * @param now_ms The current time in ms
+ * @param baseStation The base station the sample originates from
+ * @param angles The sweep angles of the sample
+ * @param geometry The geometry of the base station
+ * @return true   If the sample is to be used
+ * @return false  If the sample should be discarded
+ */
+bool throttleLh2SamplesFromBaseStation(const uint32_t now_ms, const int baseStation, const pulseProcessorResult_t* angles, const baseStationGeometry_t* geometry);
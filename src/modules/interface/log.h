@@ -115,6 +115,25 @@ int logGetInt(logVarId_t varid);
  */
 unsigned int logGetUint(logVarId_t varid);
 
+/** Phases of the stabilizer loop where synchronous log blocks are sampled */
+typedef enum {
+  logSyncPhaseEstimator = 0,  // After the state estimator
+  logSyncPhaseController,     // After the controller
+  logSyncPhaseMotors,         // After the motor outputs and the compressed log variables have been set
+  logSyncPhaseCount,
+} logSyncPhase_t;
+
+/** Sample the synchronous log blocks of a phase of the stabilizer loop
+ *
+ * The blocks are copied to a ring of snapshots and sent from the worker task,
+ * with the stabilizer tick as timestamp. Does not block, a snapshot is dropped
+ * if the log system is busy or the ring is full.
+ *
+ * @param phase The phase of the stabilizer loop
+ * @param tick The stabilizer tick
+ */
+void logSyncCapture(const logSyncPhase_t phase, const uint32_t tick);
+
 /* Basic log structure */
 struct log_s {
   uint8_t type;
@@ -0,0 +1,113 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * log_plan.h - Copy plans for log blocks
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "log.h"
+
+/**
+ * @brief A variable in a log block, as requested by the client
+ */
+typedef struct {
+  void* variable;           // Address of the variable, or of a logByFunction_t
+  uint8_t storageType : 4;  // Type of the variable in memory
+  uint8_t logType     : 4;  // Type of the value in the log packet
+  bool byFunction;          // The variable is acquired by calling a function
+} logPlanOp_t;
+
+// Writes a value of the storage type at src to dst, converted to the log type
+typedef void (*logPlanConvert_t)(uint8_t* dst, const void* src);
+
+// Acquires a value of the storage type by calling the function of a logByFunction_t
+typedef void (*logPlanFetch_t)(void* dst, const void* function, uint32_t timestamp);
+
+/**
+ * @brief One instruction of a copy plan. Variables that are stored as they are
+ * logged and are next to each other in memory are merged into one step.
+ */
+typedef struct {
+  const void* src;
+  logPlanFetch_t fetch;     // NULL for variables in memory
+  logPlanConvert_t convert; // NULL for a raw copy of length bytes
+  uint8_t length;           // Bytes written to the packet
+} logPlanStep_t;
+
+/**
+ * @brief Number of bytes used for a log type in a log packet
+ *
+ * @param logType The log type
+ * @return The length, 0 for unknown types
+ */
+uint8_t logPlanTypeLength(const uint8_t logType);
+
+/**
+ * @brief Compile the variables of a log block into a copy plan
+ *
+ * @param ops The variables of the block
+ * @param opCount Number of variables
+ * @param steps Output, room for at least opCount steps
+ * @return The number of steps
+ */
+int logPlanCompile(const logPlanOp_t* ops, const int opCount, logPlanStep_t* steps);
+
+/**
+ * @brief Run a copy plan
+ *
+ * @param steps The plan
+ * @param stepCount Number of steps
+ * @param dst Output buffer, must fit the length of all the variables of the block
+ * @param timestamp Passed to the variables that are acquired by function
+ * @return The number of bytes written
+ */
+int logPlanRun(const logPlanStep_t* steps, const int stepCount, uint8_t* dst, const uint32_t timestamp);
+
+// Length of the header of a log packet of a synchronous block
+#define LOG_PLAN_SYNC_HEADER_LENGTH 4
+
+/**
+ * @brief Check if a synchronous block is sampled in a phase of a stabilizer tick
+ *
+ * @param syncPhase The phase the block is sampled in
+ * @param syncDivider The block is sampled every syncDivider tick, 0 for blocks that are not synchronous
+ * @param phase The phase of the stabilizer loop
+ * @param tick The stabilizer tick
+ * @return true if the block is sampled
+ */
+bool logPlanIsSyncDue(const uint8_t syncPhase, const uint16_t syncDivider, const logSyncPhase_t phase, const uint32_t tick);
+
+/**
+ * @brief Write the header of a log packet of a synchronous block: the block
+ * id followed by the 24 lowest bits of the stabilizer tick it was sampled in
+ *
+ * @param dst Output buffer, LOG_PLAN_SYNC_HEADER_LENGTH bytes
+ * @param blockId The id of the block
+ * @param tick The stabilizer tick
+ * @return The number of bytes written
+ */
+int logPlanWriteSyncHeader(uint8_t* dst, const uint8_t blockId, const uint32_t tick);
@@ -40,7 +40,7 @@
 #include "radiolink.h"
 
 #define MAX_NETWORK_SIZE 20
-#define DTR_PACKET_HEADER_SIZE 5
+#define DTR_PACKET_HEADER_SIZE 6
 
 // max usable size for a packet is -1 byte for the port
 #define P2P_MAX_USABLE_DATA_SIZE P2P_MAX_DATA_SIZE -1
@@ -68,6 +68,8 @@ enum dtrMessageTypes {
 	CTS_FRAME = 2,
 	RTS_FRAME = 3,
 	DATA_ACK_FRAME = 4,
+	// Data frame in windowed mode, acknowledged in the token frames
+	WINDOW_DATA_FRAME = 5,
 };
 
 // |--------------------|
@@ -79,8 +81,12 @@ enum dtrMessageTypes {
 // |--------------------|
 // | 	sourceId     	|	(1 B)
 // |--------------------|
+// | 	targetId     	|	(1 B)
+// |--------------------|
 // | 	dataSize 		|	(1 B)
 // |--------------------|
+// | 	seq 			|	(1 B)
+// |--------------------|
 // | 	  data 			|	(dataSize B)
 // |--------------------|
 typedef struct {
@@ -89,6 +95,7 @@ typedef struct {
 	uint8_t sourceId;
 	uint8_t targetId;
 	uint8_t dataSize;
+	uint8_t seq; // sequence number of the source, only used in windowed mode
 	uint8_t data[MAXIMUM_DTR_PACKET_DATA_SIZE];
 } dtrPacket;
 
@@ -106,6 +113,9 @@ typedef struct {
 	uint32_t sendPackets;
 	uint32_t receivedPackets;
 
+	uint32_t retransmissions; // DATA frames sent again, after a timeout or a missing ack in windowed mode
+	uint32_t droppedPackets; // DATA packets dropped after too many sends in windowed mode
+
 } dtrRadioInfo;
 
 typedef struct {
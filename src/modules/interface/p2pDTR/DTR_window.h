@@ -0,0 +1,136 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 Christos Zosimidis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * DTR_window.h
+ *
+ *  Windowed mode of the DTR protocol. The token holder sends up to
+ *  windowSize DATA frames per token without waiting for acks. The receivers
+ *  acknowledge the frames in the next TOKEN frame they send, which all nodes
+ *  overhear. Frames that are not acknowledged when the token comes back are
+ *  sent again.
+ */
+
+#ifndef DTR_WINDOW_H
+#define DTR_WINDOW_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "DTR_types.h"
+
+// Limited by the 8 bit mask in the acks
+#define DTR_MAX_WINDOW_SIZE 8
+
+// A packet that is not acknowledged after this many sends is dropped
+#define DTR_WINDOW_MAX_SENDS 10
+
+#define DTR_BROADCAST_ID 0xFF
+
+// |--------------------|
+// |   ACK FORMAT       |
+// |--------------------|
+// | 	sourceId     	|	(1 B)	the node that sent the DATA frames
+// |--------------------|
+// | 	lastSeq     	|	(1 B)	latest sequence number received from sourceId
+// |--------------------|
+// | 	mask	     	|	(1 B)	bit i is set if lastSeq - i has been received
+// |--------------------|
+typedef struct {
+	uint8_t sourceId;
+	uint8_t lastSeq;
+	uint8_t mask;
+} __attribute__((packed)) dtrWindowAck;
+
+#define DTR_WINDOW_MAX_ACKS ((MAXIMUM_DTR_PACKET_DATA_SIZE) / sizeof(dtrWindowAck))
+
+// Called when the window is done with a packet, isAcked is false if the packet was dropped
+typedef void (*dtrWindowReleaseFn)(dtrPacket* packet, bool isAcked);
+
+typedef struct {
+	dtrPacket* packet; // NULL if the slot is free
+	uint32_t pendingMask; // bit i is set while the node at index i in the topology has not acked
+	uint8_t sendCount;
+} dtrWindowSlot;
+
+typedef struct {
+	bool isActive;
+	bool hasNews; // there is something to ack in the next token
+	uint8_t lastSeq;
+	uint8_t mask;
+} dtrWindowRxState;
+
+typedef struct {
+	dtrTopology topology;
+	uint8_t selfId;
+	uint8_t windowSize;
+	dtrWindowReleaseFn release;
+
+	uint8_t nextSeq;
+	dtrWindowSlot slots[DTR_MAX_WINDOW_SIZE];
+
+	// Received sequence numbers, by index of the source in the topology
+	dtrWindowRxState rx[MAX_NETWORK_SIZE];
+	uint8_t nextAckIndex;
+
+	// Stats
+	uint32_t sentFrames;
+	uint32_t retransmissions;
+	uint32_t ackedPackets;
+	uint32_t droppedPackets;
+	uint32_t deliveredPackets;
+	uint32_t duplicatePackets;
+} dtrWindow;
+
+void dtrWindowInit(dtrWindow* window, const dtrTopology* topology, const uint8_t selfId, const uint8_t windowSize, dtrWindowReleaseFn release);
+
+// Number of packets that can be added to the window
+uint8_t dtrWindowFreeSlots(const dtrWindow* window);
+
+// Adds a packet to send, sets the sequence number. The window holds the packet
+// until it is released. Returns false if the window is full or the target is not
+// in the topology, the packet is then not added.
+bool dtrWindowAdd(dtrWindow* window, dtrPacket* packet);
+
+// Gets the packets to send while holding the token: new packets and packets
+// that have not been acked by all targets. Packets that have been sent too many
+// times are released.
+// @return The number of packets written to packets
+uint8_t dtrWindowGetFramesToSend(dtrWindow* window, dtrPacket* packets[DTR_MAX_WINDOW_SIZE]);
+
+// Handles a received WINDOW_DATA_FRAME. A packet that has been received before
+// is acked again. A new packet is not acked until it has been accepted with
+// dtrWindowAccept(), if it can not be delivered the sender will send it again.
+// @return true if the packet is addressed to us and has not been received before
+bool dtrWindowReceive(dtrWindow* window, const dtrPacket* packet);
+
+// Marks a new packet from dtrWindowReceive() as received, once it has been
+// delivered. It is acked in the next token.
+void dtrWindowAccept(dtrWindow* window, const dtrPacket* packet);
+
+// Writes the acks for the received DATA frames to the data of a token
+void dtrWindowWriteAcks(dtrWindow* window, dtrPacket* token);
+
+// Handles the acks in a token from another node
+void dtrWindowHandleAcks(dtrWindow* window, const dtrPacket* token);
+
+#endif //DTR_WINDOW_H
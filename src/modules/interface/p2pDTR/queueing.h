@@ -46,6 +46,10 @@
 #define RX_SRV_QUEUE_SIZE 20
 #define RX_DATA_QUEUE_SIZE 10
 
+// The queues hold pointers to packets from a shared pool. A packet that can
+// not be allocated is handled as a full queue.
+#define DTR_PACKET_POOL_SIZE (TX_DATA_QUEUE_SIZE + RX_SRV_QUEUE_SIZE + RX_DATA_QUEUE_SIZE)
+
 #define TX_RECEIVED_WAIT_TIME 5// ms
 #define RX_RECEIVED_WAIT_TIME 5// ms
 
@@ -57,18 +61,31 @@ typedef enum queue_names_e {
 
 void dtrQueueingInit();
 
+// Gets a packet from the pool, returns NULL if all packets are in use
+dtrPacket* dtrAllocPacket(void);
+
+// Returns a packet to the pool
+void dtrFreePacket(dtrPacket* packet);
+
 bool dtrIsPacketInQueueAvailable(DTRQueue_Names qName);
 
 uint8_t dtrGetNumberOfPacketsInQueue(DTRQueue_Names qName);
 
-bool dtrGetPacketFromQueue(dtrPacket *packet, DTRQueue_Names qName, uint32_t timeout);
+// Gets the packet at the front of a queue. The packet stays in the TX_DATA queue
+// until it is released, packets from other queues are owned by the caller.
+bool dtrGetPacketFromQueue(dtrPacket **packet, DTRQueue_Names qName, uint32_t timeout);
+
+// Removes the packet at the front of a queue, the caller owns the packet
+bool dtrTakePacketFromQueue(dtrPacket **packet, DTRQueue_Names qName, uint32_t timeout);
 
 // Blocks to wait for a packet to be received for a given time
 // new_packet_received --> True if a new packet has been received and False if the timeout has been reached
-bool dtrReceivePacketWaitUntil(dtrPacket *packet, DTRQueue_Names qName, uint32_t timeout_ms, bool *new_packet_received);
+bool dtrReceivePacketWaitUntil(dtrPacket **packet, DTRQueue_Names qName, uint32_t timeout_ms, bool *new_packet_received);
 
+// Inserts a packet from the pool in a queue, the queue owns the packet if successful
 bool dtrInsertPacketToQueue(dtrPacket *packet, DTRQueue_Names qName);
 
+// Removes the packet at the front of a queue and returns it to the pool
 bool dtrReleasePacketFromQueue(DTRQueue_Names qName);
 
 void dtrEmptyQueue(DTRQueue_Names qName);
@@ -83,6 +83,13 @@ void dtrPrintPacket(dtrPacket* packet);
 uint8_t dtrGetSelfId(void);
 // =========================== DTR API ===========================
 
+// Sets the number of DATA packets a node may send each time it holds the token,
+// must be called before the protocol is enabled and be the same on all nodes.
+// With a window size larger than 1 the packets are acknowledged in the token
+// frames instead of one by one, and broadcasts are sent as a single frame.
+// @param size The window size, 1 (default) for stop-and-wait, max DTR_MAX_WINDOW_SIZE
+void dtrSetWindowSize(uint8_t size);
+
 // Starts the task of the Dynamic Token Ring Protocol (DTR) and initializes the protocol
 // @param topology The topology of the network (see DTR_types.h)
 void dtrEnableProtocol(dtrTopology topology);
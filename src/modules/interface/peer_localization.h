@@ -2,6 +2,7 @@
 #define __PEER_LOCALIZATION_H__
 
 #include <stdbool.h>
+#include "autoconf.h"
 #include "math3d.h"
 #include "stabilizer_types.h"
 
@@ -13,7 +14,13 @@
 
 // The maximum number of other Crazyflie ID's to track. This constant may be
 // needed for static allocations in other modules, e.g. collision avoidance.
-#define PEER_LOCALIZATION_MAX_NEIGHBORS 10
+#ifndef CONFIG_PEER_LOCALIZATION_MAX_NEIGHBORS
+#define CONFIG_PEER_LOCALIZATION_MAX_NEIGHBORS 10
+#endif
+#define PEER_LOCALIZATION_MAX_NEIGHBORS CONFIG_PEER_LOCALIZATION_MAX_NEIGHBORS
+
+// Radio ids are 8 bits, id 0 is not a valid peer.
+#define PEER_LOCALIZATION_ID_COUNT 256
 
 // Initialize and test the module.
 void peerLocalizationInit();
@@ -21,23 +28,79 @@ bool peerLocalizationTest();
 
 typedef struct peerLocalizationOtherPosition_s {
   uint8_t id;  // CF id
-  point_t pos; // position and timestamp (millisecs)
+  point_t pos; // position and the time it was captured (millisecs)
+  velocity_t vel; // velocity, zero if not known
 } peerLocalizationOtherPosition_t;
 
+// Default of peerLoc.maxExtrap, the longest time a peer position is
+// extrapolated [ms]
+#define PEER_LOCALIZATION_MAX_EXTRAPOLATION_MS 100
+
+// Extrapolates the position of a peer to the time now (millisecs) with its
+// velocity. The extrapolation is limited to maxMillis, to not let an old
+// velocity move the peer too far.
+static inline void peerLocalizationExtrapolate(peerLocalizationOtherPosition_t const *other, uint32_t now, uint32_t maxMillis, point_t *result)
+{
+  int32_t ageMillis = (int32_t)(now - other->pos.timestamp);
+  if (ageMillis < 0) {
+    ageMillis = 0;
+  }
+  if ((uint32_t)ageMillis > maxMillis) {
+    ageMillis = maxMillis;
+  }
+
+  float const dt = ageMillis / 1000.0f;
+  result->x = other->pos.x + other->vel.x * dt;
+  result->y = other->pos.y + other->vel.y * dt;
+  result->z = other->pos.z + other->vel.z * dt;
+  result->timestamp = now;
+}
+
 // Tell the peer localization system the position of another Crazyflie.
 // Should be called when the position is already known with high accuracy,
 // e.g. when a motion capture measurement packet is received.
+// If the table is full, the peer that was updated least recently is replaced,
+// provided it has not been heard from for peerLoc.staleAge ms. Otherwise the
+// new peer is dropped and false is returned.
 bool peerLocalizationTellPosition(int id, positionMeasurement_t const *pos);
 
+// Same as peerLocalizationTellPosition() for a position that was measured at
+// an earlier time, timestamp is in ticks. The position is ignored if the table
+// already has a more recent position for the peer.
+bool peerLocalizationTellPositionAt(int id, positionMeasurement_t const *pos, uint32_t timestamp);
+
+// Same as peerLocalizationTellPositionAt() with the velocity of the peer at the
+// same time, used to extrapolate the position to the current time.
+bool peerLocalizationTellStateAt(int id, positionMeasurement_t const *pos, velocity_t const *vel, uint32_t timestamp);
+
 // Returns true if we have a position value for the given radio ID.
 bool peerLocalizationIsIDActive(uint8_t id);
 
 // Returns the position value for the given radio ID, or NULL if none exists.
-// Performs a linear search.
+// The position is the latest one received, see peerLocalizationGetPosition()
+// for the position at the current time. Constant time, uses a table indexed by
+// radio ID.
 peerLocalizationOtherPosition_t *peerLocalizationGetPositionByID(uint8_t id);
 
 // Returns the position value based on index, uncorrelated with radio ID. More
 // efficient if iterating over all peers is needed.
 peerLocalizationOtherPosition_t *peerLocalizationGetPositionByIdx(uint8_t idx);
 
+// Writes the position of a peer from the table extrapolated to the current
+// time, limited to peerLoc.maxExtrap ms.
+void peerLocalizationGetPosition(peerLocalizationOtherPosition_t const *other, point_t *result);
+
+// Finds the (at most) k peers closest to center, ignoring peers whose position
+// is older than maxAgeMillis (no age filtering if negative). The distances are
+// computed with the positions extrapolated to the current time. If scale is
+// not NULL, the offset along each axis is divided by the scale before the
+// distance is computed, for instance to rank peers by the distance in units
+// of a collision ellipsoid. The peers are written to result in table order
+// rather than distance order, so the order is stable between calls as long as
+// no peer is added or evicted. If nDropped is not NULL, it is set to the
+// number of fresh peers that were left out since k was reached.
+// Returns the number of peers written to result. Uses a static scratch buffer,
+// so it must only be called from one task.
+int peerLocalizationGetNearest(point_t const *center, struct vec const *scale, int maxAgeMillis, peerLocalizationOtherPosition_t const *result[], int k, int *nDropped);
+
 #endif // __PEER_LOCALIZATION_H__
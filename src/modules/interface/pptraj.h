@@ -134,6 +134,14 @@ struct traj_eval traj_eval_invalid(void);
 // check if a traj_eval represents an invalid result.
 bool is_traj_eval_valid(struct traj_eval const *ev);
 
+// number of derivatives computed by poly4d_eval_derivs(), including the
+// polynomial itself: position, velocity, acceleration and jerk.
+#define PP_N_DERIVS (4)
+
+// evaluate all 4 dimensions (x, y, z, yaw) of a polynomial piece and their
+// derivatives in one pass. derivs[k][d] is the k:th derivative of dimension d.
+void poly4d_eval_derivs(struct poly4d const *p, float t, float derivs[PP_N_DERIVS][4]);
+
 // evaluate a single polynomial piece
 struct traj_eval poly4d_eval(struct poly4d const *p, float t);
 
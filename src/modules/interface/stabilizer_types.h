@@ -127,6 +127,7 @@ typedef struct positionMeasurement_s {
   };
   float stdDev;
   measurementSource_t source;
+  uint32_t timestamp;  // Time when the measurement was taken (ms), 0 if unknown
 } positionMeasurement_t;
 
 typedef struct poseMeasurement_s {
@@ -141,6 +142,7 @@ typedef struct poseMeasurement_s {
   quaternion_t quat;
   float stdDevPos;
   float stdDevQuat;
+  uint32_t timestamp;  // Time when the measurement was taken (ms), 0 if unknown
 } poseMeasurement_t;
 
 typedef struct distanceMeasurement_s {
@@ -339,6 +341,33 @@ typedef struct {
   lighthouseCalibrationMeasurementModel_t calibrationMeasurementModel;
 } sweepAngleMeasurement_t;
 
+#define SWEEP_ANGLE_BATCH_N_SENSORS 4
+#define SWEEP_ANGLE_BATCH_N_SWEEPS 2
+
+/** Data that is the same for all sweep angles from a base station, shared by the batches */
+typedef struct {
+  const vec3d* sensorPos;    // Sensor positions in the CF reference frame, indexed by sensor id
+  const vec3d* rotorPos;     // Pos of rotor origin in global reference frame
+  const mat3d* rotorRot;     // Rotor rotation matrix
+  const mat3d* rotorRotInv;  // Inverted rotor rotation matrix
+  const lighthouseCalibrationSweep_t* calib;  // Calibration data, indexed by sweep id
+  lighthouseCalibrationMeasurementModel_t calibrationMeasurementModel;
+  float t[SWEEP_ANGLE_BATCH_N_SWEEPS];  // Tilt angles of the light planes, indexed by sweep id
+  float stdDev;
+} sweepAngleBatchContext_t;
+
+/** Sweep angles from all sensors for one rotation of a base station.
+ * The context is referenced, not copied, to keep the batch (and measurement_t) no larger than a sweepAngleMeasurement_t */
+typedef struct {
+  uint32_t timestamp;
+  const sweepAngleBatchContext_t* context;
+  uint8_t baseStationId;
+  uint8_t validMap;          // Bit (sensorId * SWEEP_ANGLE_BATCH_N_SWEEPS + sweepId) is set if the angle is valid
+  float measuredSweepAngles[SWEEP_ANGLE_BATCH_N_SENSORS][SWEEP_ANGLE_BATCH_N_SWEEPS];
+} sweepAngleBatchMeasurement_t;
+
+_Static_assert(sizeof(sweepAngleBatchMeasurement_t) <= sizeof(sweepAngleMeasurement_t), "A batch must not grow measurement_t");
+
 /** gyroscope measurement */
 typedef struct
 {
@@ -372,6 +401,13 @@ typedef struct
 #define RATE_HL_COMMANDER RATE_100_HZ
 #define RATE_SUPERVISOR RATE_25_HZ
 
+// Phase offsets, in ticks of the main loop, for work that runs at a lower rate. Work that does not have to
+// be aligned with the controller runs on another tick than phase 0, to avoid that it lands on the same tick
+// as the 100 Hz position controller and high level commander. The work still runs in the stabilizer task.
+#define RATE_PHASE_SUPERVISOR 5
+#define RATE_PHASE_USD_LOGGING 7
+
 #define RATE_DO_EXECUTE(RATE_HZ, TICK) ((TICK % (RATE_MAIN_LOOP / RATE_HZ)) == 0)
+#define RATE_DO_EXECUTE_PHASE(RATE_HZ, PHASE, TICK) ((TICK % (RATE_MAIN_LOOP / RATE_HZ)) == ((PHASE) % (RATE_MAIN_LOOP / RATE_HZ)))
 
 #endif
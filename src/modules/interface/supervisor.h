@@ -35,9 +35,11 @@
  *   - collecting data from the system (conditions)
  *   - possibly change state, based on the conditions
  *
+ * Called by the stabilizer at RATE_SUPERVISOR, the stabilizer loop does the rate control.
+ *
  * @param sensors        Latest sensor data
  * @param setpoint       Current setpoint
- * @param stabilizerStep Stabilizer step for rate control
+ * @param stabilizerStep Stabilizer step
  */
 void supervisorUpdate(const sensorData_t *sensors, const setpoint_t* setpoint, stabilizerStep_t stabilizerStep);
 
@@ -0,0 +1,56 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * swarm_state.h - Time synchronized state broadcast in a swarm
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "radiolink.h"
+#include "swarm_state_core.h"
+
+// P2P port used for the swarm state packets
+#define SWARM_STATE_P2P_PORT 14
+
+void swarmStateInit(void);
+bool swarmStateTest(void);
+
+/**
+ * @brief Handle a received swarm state packet. Called by the radio link for
+ * P2P packets on SWARM_STATE_P2P_PORT.
+ *
+ * @param p The P2P packet
+ */
+void swarmStateReceive(const P2PPacket* p);
+
+/**
+ * @brief Get the latest known state of a peer
+ *
+ * @param id The radio id of the peer
+ * @param state The state is written here
+ * @return true if the state of the peer is known
+ */
+bool swarmStateGetPeer(const uint8_t id, swarmPeerState_t* state);
@@ -0,0 +1,193 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * swarm_state_core.h - Slot schedule, packet format and peer table of the swarm state broadcast
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "stabilizer_types.h"
+
+#define SWARM_STATE_VERSION 1
+
+// Max number of peers in the peer table
+#ifdef CONFIG_PEER_LOCALIZATION_MAX_NEIGHBORS
+#define SWARM_STATE_MAX_PEERS CONFIG_PEER_LOCALIZATION_MAX_NEIGHBORS
+#else
+#define SWARM_STATE_MAX_PEERS 10
+#endif
+
+// A peer is used as clock reference as long as it has been heard within this time
+#define SWARM_STATE_SYNC_TIMEOUT_MS 1000
+// Peers heard directly within this time are relayed to others
+#define SWARM_STATE_RELAY_MAX_AGE_MS 500
+// A peer that has not been updated for this long may be replaced by a new one
+#define SWARM_STATE_STALE_AGE_MS 1000
+// Resolution of the age of a state in a packet
+#define SWARM_STATE_AGE_UNIT_MS 10
+// Resolution of the frame phase in a packet
+#define SWARM_STATE_PHASE_UNIT_US 100
+// The longest frame period with a phase that fits in the packet
+#define SWARM_STATE_MAX_PERIOD_MS (UINT16_MAX * SWARM_STATE_PHASE_UNIT_US / 1000)
+
+// Status flags
+#define SWARM_STATE_STATUS_ARMED    0x01
+#define SWARM_STATE_STATUS_FLYING   0x02
+#define SWARM_STATE_STATUS_TUMBLED  0x04
+#define SWARM_STATE_STATUS_LOCKED   0x08
+
+typedef struct {
+  uint8_t id;
+  // SWARM_STATE_STATUS_... flags
+  uint8_t status;
+  // Position, timestamp is the time of the state [ms]
+  point_t pos;
+  velocity_t vel;
+  // Yaw [rad]
+  float yaw;
+} swarmPeerState_t;
+
+// State of one Crazyflie in a packet
+typedef struct {
+  uint8_t id;
+  uint8_t status;
+  // Age of the state when the packet was sent [SWARM_STATE_AGE_UNIT_MS]
+  uint8_t age;
+  // [mm]
+  int16_t pos[3];
+  // [mm/s]
+  int16_t vel[3];
+  // [1/10000 rad]
+  int16_t yaw;
+} __attribute__((packed)) swarmStateEntry_t;
+
+typedef struct {
+  uint8_t version;
+  uint8_t seq;
+  // Phase of the frame clock of the sender when the packet was sent [SWARM_STATE_PHASE_UNIT_US]
+  uint16_t phase;
+  uint8_t count;
+} __attribute__((packed)) swarmStateHeader_t;
+
+// The first entry is the sender, the rest are peers that the sender relays
+#define SWARM_STATE_MAX_ENTRIES 3
+
+typedef struct {
+  swarmStateHeader_t header;
+  swarmStateEntry_t entries[SWARM_STATE_MAX_ENTRIES];
+} __attribute__((packed)) swarmStatePacket_t;
+
+typedef struct {
+  // id 0 means that the entry is free
+  swarmPeerState_t state;
+  // Latest time a packet was received from the peer itself [ms], 0 if never
+  uint32_t heardMs;
+  // Sequence number of the latest packet from the peer
+  uint8_t seq;
+} swarmStateCorePeer_t;
+
+typedef struct {
+  uint8_t ownId;
+  uint8_t txSeq;
+
+  // Frame clock, phase = (now + clockOffsetUs) % period
+  uint32_t clockOffsetUs;
+  // The peer with the lowest id that has been heard, 0 if we are the reference
+  uint8_t referenceId;
+  uint32_t referenceHeardMs;
+  int32_t latestSyncErrorUs;
+
+  swarmStateCorePeer_t peers[SWARM_STATE_MAX_PEERS];
+  uint8_t nextRelayIndex;
+
+  // Packets received from peers and packets that were lost, based on the sequence numbers
+  uint32_t receivedCount;
+  uint32_t lostCount;
+} swarmStateCore_t;
+
+void swarmStateCoreInit(swarmStateCore_t* this, const uint8_t ownId);
+
+/**
+ * @brief Phase of the shared frame clock
+ *
+ * @param nowUs The current time [us]
+ * @param periodUs The frame period [us]
+ * @return The time since the start of the frame [us]
+ */
+uint32_t swarmStateCoreFramePhaseUs(const swarmStateCore_t* this, const uint64_t nowUs, const uint32_t periodUs);
+
+/**
+ * @brief Time until it is our turn to send. A packet is sent in the first
+ * half of the slot, the second half is a guard for clock errors.
+ *
+ * @param nowUs The current time [us]
+ * @param periodUs The frame period [us]
+ * @param slotCount The number of slots in a frame
+ * @return 0 if a packet should be sent now, otherwise the time to wait [us]
+ */
+uint32_t swarmStateCoreTimeToSlotUs(const swarmStateCore_t* this, const uint64_t nowUs, const uint32_t periodUs, const uint8_t slotCount);
+
+/**
+ * @brief Build the packet to send in our slot, with our own state and peers to relay
+ *
+ * @param own Our own state, the id is ignored
+ * @param nowUs The current time [us]
+ * @param nowMs The current time [ms]
+ * @param periodUs The frame period [us]
+ * @param packet The packet is written here
+ * @return The size of the packet [bytes]
+ */
+size_t swarmStateCoreBuildPacket(swarmStateCore_t* this, const swarmPeerState_t* own, const uint64_t nowUs, const uint32_t nowMs, const uint32_t periodUs, swarmStatePacket_t* packet);
+
+/**
+ * @brief Handle a received packet. Synchronizes the frame clock, updates the
+ * peer table and the loss statistics and tells peer localization about the
+ * positions of the peers.
+ *
+ * @param data The packet
+ * @param size The size of the packet [bytes]
+ * @param rxTimeUs The time the packet was received [us]
+ * @param nowMs The current time [ms]
+ * @param periodUs The frame period [us]
+ * @return true if the packet was valid
+ */
+bool swarmStateCoreHandlePacket(swarmStateCore_t* this, const void* data, const size_t size, const uint64_t rxTimeUs, const uint32_t nowMs, const uint32_t periodUs);
+
+/**
+ * @brief Get the latest known state of a peer
+ *
+ * @return true if the state of the peer is known
+ */
+bool swarmStateCoreGetPeer(const swarmStateCore_t* this, const uint8_t id, swarmPeerState_t* state);
+
+/**
+ * @brief Time on air of a P2P packet at 2 Mbit/s, including the radio overhead
+ *
+ * @param size Size of the P2P data [bytes]
+ * @return [us]
+ */
+uint32_t swarmStateCoreAirtimeUs(const size_t size);
@@ -27,6 +27,8 @@
 #define __WORKER_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include "worker_queue.h"
 
 void workerInit();
 
@@ -42,8 +44,23 @@ void workerLoop();
 
 /**
  * Schedule a function for execution by the worker loop
- * The function will be executed as soon as possible by the worker loop.
- * Scheduled functions are stacked in a FIFO queue.
+ * Due jobs are run in priority order, first in first out within a priority.
+ * If the same function with the same argument is already pending, the jobs
+ * are merged into one that keeps the highest priority and the earliest due
+ * time.
+ *
+ * @param function Function to be executed
+ * @param arg      Argument that will be passed to the function when executed
+ * @param priority Priority of the job
+ * @param delayMs  The function is executed at the earliest this long from now
+ * @return         0 in case of success. Anything else on failure.
+ */
+int workerScheduleJob(void (*function)(void*), void *arg, const workerPriority_t priority, const uint32_t delayMs);
+
+/**
+ * Schedule a function for execution by the worker loop
+ * The function will be executed as soon as possible by the worker loop, with
+ * normal priority. Same as workerScheduleJob(function, arg, workerPriorityNormal, 0).
  *
  * @param function Function to be executed
  * @param arg      Argument that will be passed to the function when executed
@@ -0,0 +1,101 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * worker_queue.h - Pending jobs of the worker, by priority and due time
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Max number of pending jobs
+#define WORKER_QUEUE_LENGTH 16
+
+#define WORKER_QUEUE_WAIT_FOREVER UINT32_MAX
+
+typedef enum {
+  workerPriorityHigh = 0,
+  workerPriorityNormal,
+  workerPriorityLow,
+  workerPriorityCount,
+} workerPriority_t;
+
+typedef void (*workerFunction_t)(void*);
+
+typedef struct {
+  workerFunction_t function;
+  void* arg;
+  workerPriority_t priority;
+  // The job is run at this time or later [ms]
+  uint32_t dueMs;
+  // The time the job was scheduled [ms]
+  uint32_t scheduledMs;
+  // Order of the jobs with the same priority, first in first out
+  uint32_t seq;
+} workerJob_t;
+
+typedef struct {
+  // Function NULL means that the entry is free
+  workerJob_t jobs[WORKER_QUEUE_LENGTH];
+  uint32_t nextSeq;
+
+  // Jobs that were merged with an identical pending job
+  uint32_t coalescedCount;
+  // Jobs that were dropped because the queue was full
+  uint32_t droppedCount;
+} workerQueue_t;
+
+void workerQueueInit(workerQueue_t* this);
+
+/**
+ * @brief Add a job to the queue. If the same function with the same argument
+ * is already pending, the jobs are merged into one that keeps the highest
+ * priority and the earliest due time.
+ *
+ * @param function The function to run
+ * @param arg The argument passed to the function
+ * @param priority The priority of the job
+ * @param delayMs The job is run at the earliest this long after nowMs
+ * @param nowMs The current time [ms]
+ * @return 0 on success, ENOMEM if the queue is full
+ */
+int workerQueueAdd(workerQueue_t* this, workerFunction_t function, void* arg, const workerPriority_t priority, const uint32_t delayMs, const uint32_t nowMs);
+
+/**
+ * @brief Take the next job to run from the queue. This is the due job with
+ * the highest priority, the job scheduled first if there are several.
+ *
+ * @param nowMs The current time [ms]
+ * @param job The job is written here
+ * @return true if there was a due job
+ */
+bool workerQueueTake(workerQueue_t* this, const uint32_t nowMs, workerJob_t* job);
+
+/**
+ * @brief Time until the next job is due
+ *
+ * @param nowMs The current time [ms]
+ * @return [ms], 0 if a job is due, WORKER_QUEUE_WAIT_FOREVER if the queue is empty
+ */
+uint32_t workerQueueTimeToNextMs(const workerQueue_t* this, const uint32_t nowMs);
@@ -48,6 +48,39 @@ static struct vec3_s svec2vec(struct vec v)
   return vv;
 }
 
+// Rows whose constraint is satisfied with less slack than this (meters) at
+// the final setpoint are remembered as the active set for the next cycle.
+#define ACTIVE_SET_MARGIN 0.05f
+
+// Projects v onto the polytope, trying the reduced polytope made of the first
+// nReducedRows rows first. If the projection onto this superset of our cell
+// happens to satisfy all the remaining rows, it is also the projection onto
+// the full cell and we skip running Dykstra's algorithm over every neighbor.
+static struct vec projectWithActiveSet(
+  collision_avoidance_params_t const *params,
+  struct vec v,
+  float const A[], float const B[], float projectionWorkspace[],
+  int nRows, int nReducedRows)
+{
+  if (nReducedRows < nRows) {
+    struct vec const reduced = vprojectpolytope(
+      v,
+      A, B, projectionWorkspace, nReducedRows,
+      params->voronoiProjectionTolerance,
+      params->voronoiProjectionMaxIters
+    );
+    if (vinpolytope(reduced, A, B, nRows, 10.0f * params->voronoiProjectionTolerance)) {
+      return reduced;
+    }
+  }
+  return vprojectpolytope(
+    v,
+    A, B, projectionWorkspace, nRows,
+    params->voronoiProjectionTolerance,
+    params->voronoiProjectionMaxIters
+  );
+}
+
 // Computes a new goal position inside our buffered Voronoi cell.
 //
 // "Sidestep" dentoes a behavior to avoid deadlock when two robots are
@@ -67,12 +100,14 @@ static struct vec3_s svec2vec(struct vec v)
 //   B: RHS vector for polytope inequality Ax <= B. Dimension [nRows].
 //   projectionWorkspace: Additional scratch area. Dimension [nRows * 3].
 //   nRows: Number of rows in our cell polytope inequality.
+//   nReducedRows: Number of leading rows (box faces and previously active
+//     neighbors) to try projecting onto first.
 //
 static struct vec sidestepGoal(
   collision_avoidance_params_t const *params,
   struct vec goal,
   bool modifyIfInside,
-  float const A[], float const B[], float projectionWorkspace[], int nRows)
+  float const A[], float const B[], float projectionWorkspace[], int nRows, int nReducedRows)
 {
   float const rayScale = rayintersectpolytope(vzero(), goal, A, B, nRows, NULL);
   if (rayScale >= 1.0f && !modifyIfInside) {
@@ -86,12 +121,58 @@ static struct vec sidestepGoal(
     goal = vadd(goal, vscl(sidestepAmount, sidestepDir));
   }
   // Otherwise no sidestep, but still project
-  return vprojectpolytope(
-    goal,
-    A, B, projectionWorkspace, nRows,
-    params->voronoiProjectionTolerance,
-    params->voronoiProjectionMaxIters
-  );
+  return projectWithActiveSet(params, goal, A, B, projectionWorkspace, nRows, nReducedRows);
+}
+
+static void swapRows(float A[], float B[], float rowPeer[], int i, int j)
+{
+  if (i == j) {
+    return;
+  }
+  for (int k = 0; k < 3; ++k) {
+    float const tmp = A[3 * i + k];
+    A[3 * i + k] = A[3 * j + k];
+    A[3 * j + k] = tmp;
+  }
+  float tmp = B[i];
+  B[i] = B[j];
+  B[j] = tmp;
+  tmp = rowPeer[i];
+  rowPeer[i] = rowPeer[j];
+  rowPeer[j] = tmp;
+}
+
+// Records the neighbors whose cell walls are (nearly) binding at the point x
+// so that the next cycle can try them first. Rows 0-5 are the bounding box.
+static void updateActiveSet(
+  collision_avoidance_state_t *collisionState,
+  struct vec x,
+  float const A[], float const B[], float const rowPeer[], int nRows)
+{
+  int nActive = 0;
+  for (int row = 6; row < nRows; ++row) {
+    struct vec const a = vloadf(A + 3 * row);
+    if (vdot(a, x) < B[row] - ACTIVE_SET_MARGIN) {
+      continue;
+    }
+
+    // Keep the list sorted by peer index, the row construction relies on it.
+    int const peer = (int)rowPeer[row];
+    int pos = nActive;
+    while (pos > 0 && collisionState->activePeers[pos - 1] > peer) {
+      if (pos < COLLISION_AVOIDANCE_MAX_ACTIVE_PEERS) {
+        collisionState->activePeers[pos] = collisionState->activePeers[pos - 1];
+      }
+      --pos;
+    }
+    if (pos < COLLISION_AVOIDANCE_MAX_ACTIVE_PEERS) {
+      collisionState->activePeers[pos] = peer;
+      if (nActive < COLLISION_AVOIDANCE_MAX_ACTIVE_PEERS) {
+        ++nActive;
+      }
+    }
+  }
+  collisionState->nActivePeers = nActive;
 }
 
 void collisionAvoidanceUpdateSetpointCore(
@@ -106,46 +187,107 @@ void collisionAvoidanceUpdateSetpointCore(
   // Part 1: Construct the polytope inequalities in A, b.
   //
 
-  int const nRows = nOthers + 6;
+  int const maxRows = nOthers + 6;
   float *A = workspace;
-  float *B = workspace + 3 * nRows;
-  float *projectionWorkspace = workspace + 4 * nRows;
+  float *B = workspace + 3 * maxRows;
+  float *projectionWorkspace = workspace + 4 * maxRows;
+  float *rowPeer = workspace + 7 * maxRows;
 
   // Compute the cell in a stretched coordinate system for downwash awareness.
   // See header for details.
   struct vec const radiiInv = veltrecip(params->ellipsoidRadii);
   struct vec const ourPos = vec2svec(state->position);
 
-  // We could do some optimizations here to reduce the number of rows, like
-  // leave out very far away neighbors. It would help the average case
-  // complexity, but not the worst case - so we skip it for now.
-  for (int i = 0; i < nOthers; ++i) {
+  // The bounding box polytope faces. We also use the box faces to enforce
+  // max speed in the infinity-norm. The cell is always contained in this box.
+  float const maxDist = params->horizonSecs * params->maxSpeed;
+  float boxUpper[3];
+  float boxLower[3];
+  for (int dim = 0; dim < 3; ++dim) {
+    boxUpper[dim] = fminf(maxDist, vindex(params->bboxMax, dim) - vindex(ourPos, dim));
+    boxLower[dim] = -fmaxf(-maxDist, vindex(params->bboxMin, dim) - vindex(ourPos, dim));
+  }
+
+  // Neighbors are added from the last to the first, filling the rows from the
+  // end of the row area. Row r is always written after all inputs at or above
+  // index r - 6 have been read, so otherPositions may alias the workspace.
+  //
+  // A neighbor whose half-space contains the whole box cannot cut our cell
+  // within the planning horizon, so it is left out. This is exact: the cell
+  // is the same with or without it, only cheaper to project onto.
+  int hintRow[COLLISION_AVOIDANCE_MAX_ACTIVE_PEERS];
+  int hint = collisionState->nActivePeers - 1;
+  for (int h = 0; h <= hint; ++h) {
+    hintRow[h] = -1;
+  }
+
+  int row = maxRows;
+  for (int i = nOthers - 1; i >= 0; --i) {
     struct vec peerPos = vloadf(otherPositions + 3 * i);
     struct vec const toPeerStretched = veltmul(vsub(peerPos, ourPos), radiiInv);
     float const dist = vmag(toPeerStretched);
     struct vec const a = vdiv(veltmul(toPeerStretched, radiiInv), dist);
     float const b = dist / 2.0f - 1.0f;
     float scale = 1.0f / vmag(a);
-    vstoref(vscl(scale, a), A + 3 * i);
-    B[i] = scale * b;
-  }
+    struct vec const aNorm = vscl(scale, a);
+    float const bNorm = scale * b;
+
+    float boxReach = 0.0f;
+    for (int dim = 0; dim < 3; ++dim) {
+      float const ad = vindex(aNorm, dim);
+      if (ad > 0.0f) {
+        boxReach += ad * boxUpper[dim];
+      } else if (ad < 0.0f) {
+        boxReach -= ad * boxLower[dim];
+      }
+    }
+    if (bNorm >= boxReach) {
+      continue;
+    }
 
-  // Add the bounding box polytope faces. We also use the box faces to enforce
-  // max speed in the infinity-norm.
-  float const maxDist = params->horizonSecs * params->maxSpeed;
+    --row;
+    vstoref(aNorm, A + 3 * row);
+    B[row] = bNorm;
+    rowPeer[row] = (float)i;
 
-  memset(A + 3 * nOthers, 0, 18 * sizeof(float));
+    while (hint >= 0 && collisionState->activePeers[hint] > i) {
+      --hint;
+    }
+    if (hint >= 0 && collisionState->activePeers[hint] == i) {
+      hintRow[hint] = row;
+    }
+  }
+
+  int const nPeerRows = maxRows - row;
+  int const first = row - 6;
 
+  memset(A + 3 * first, 0, 18 * sizeof(float));
   for (int dim = 0; dim < 3; ++dim) {
-    float boxMax = vindex(params->bboxMax, dim) - vindex(ourPos, dim);
-    A[3 * (nOthers + dim) + dim] = 1.0f;
-    B[nOthers + dim] = fminf(maxDist, boxMax);
+    A[3 * (first + dim) + dim] = 1.0f;
+    B[first + dim] = boxUpper[dim];
+
+    A[3 * (first + dim + 3) + dim] = -1.0f;
+    B[first + dim + 3] = boxLower[dim];
+  }
 
-    float boxMin = vindex(params->bboxMin, dim) - vindex(ourPos, dim);
-    A[3 * (nOthers + dim + 3) + dim] = -1.0f;
-    B[nOthers + dim + 3] = -fmaxf(-maxDist, boxMin);
+  A += 3 * first;
+  B += first;
+  rowPeer += first;
+  int const nRows = nPeerRows + 6;
+
+  // Move the neighbors that were active last cycle right after the box rows.
+  // Both lists are ordered by peer index, so a swap never displaces a row that
+  // is still to be moved.
+  int nReducedRows = 6;
+  for (int h = 0; h < collisionState->nActivePeers; ++h) {
+    if (hintRow[h] >= 0) {
+      swapRows(A, B, rowPeer, nReducedRows, hintRow[h] - first);
+      ++nReducedRows;
+    }
   }
 
+  collisionState->nCellRows = nRows;
+
   //
   // Part 2: Use the constructed polytope to modify the setpoint.
   //
@@ -161,7 +303,8 @@ void collisionAvoidanceUpdateSetpointCore(
     if (vinpolytope(vzero(), A, B, nRows, inPolytopeTolerance)) {
       // Typical case - our current position is within our cell.
       struct vec pseudoGoal = vscl(params->horizonSecs, setVel);
-      pseudoGoal = sidestepGoal(params, pseudoGoal, true, A, B, projectionWorkspace, nRows);
+      pseudoGoal = sidestepGoal(params, pseudoGoal, true, A, B, projectionWorkspace, nRows, nReducedRows);
+      updateActiveSet(collisionState, pseudoGoal, A, B, rowPeer, nRows);
       if (vinpolytope(pseudoGoal, A, B, nRows, inPolytopeTolerance)) {
         setVel = vdiv(pseudoGoal, params->horizonSecs);
       }
@@ -173,12 +316,9 @@ void collisionAvoidanceUpdateSetpointCore(
     else {
       // Atypical case - our current position is not within our cell. Forget
       // about the original goal velocity and try to move towards our cell.
-      struct vec nearestInCell = vprojectpolytope(
-        vzero(),
-        A, B, projectionWorkspace, nRows,
-        params->voronoiProjectionTolerance,
-        params->voronoiProjectionMaxIters
-      );
+      struct vec nearestInCell = projectWithActiveSet(
+        params, vzero(), A, B, projectionWorkspace, nRows, nReducedRows);
+      updateActiveSet(collisionState, nearestInCell, A, B, rowPeer, nRows);
       if (vinpolytope(nearestInCell, A, B, nRows, inPolytopeTolerance)) {
         setVel = vclampnorm(nearestInCell, params->maxSpeed);
       }
@@ -193,7 +333,8 @@ void collisionAvoidanceUpdateSetpointCore(
 
     struct vec const setPosRelative = vsub(setPos, ourPos);
     struct vec const setPosRelativeNew = sidestepGoal(
-      params, setPosRelative, false, A, B, projectionWorkspace, nRows);
+      params, setPosRelative, false, A, B, projectionWorkspace, nRows, nReducedRows);
+    updateActiveSet(collisionState, setPosRelativeNew, A, B, rowPeer, nRows);
 
     if (!vinpolytope(setPosRelativeNew, A, B, nRows, inPolytopeTolerance)) {
       // If the projection algorithm failed to converge, then either
@@ -295,15 +436,30 @@ bool collisionAvoidanceTest()
   return true;
 }
 
+// Only the closest neighbors are considered, measured in units of the
+// collision ellipsoid since that is how the cell is shaped. With more fresh
+// peers than this in the table, the ones further away are left out and counted
+// in colAv.nDropped.
+#ifndef CONFIG_COLLISION_AVOIDANCE_MAX_NEIGHBORS
+#define CONFIG_COLLISION_AVOIDANCE_MAX_NEIGHBORS 24
+#endif
+#define MAX_NEIGHBORS (PEER_LOCALIZATION_MAX_NEIGHBORS < CONFIG_COLLISION_AVOIDANCE_MAX_NEIGHBORS ? PEER_LOCALIZATION_MAX_NEIGHBORS : CONFIG_COLLISION_AVOIDANCE_MAX_NEIGHBORS)
+
 // Each face of the Voronoi cell is defined by a linear inequality a^T x <= b.
 // The algorithm for projecting a point into a convex polytope requires 3 more
-// floats of working space per face. The six extra faces come from the overall
+// floats of working space per face, and one more float keeps track of which
+// neighbor the face belongs to. The six extra faces come from the overall
 // flight area bounding box.
-#define MAX_CELL_ROWS (PEER_LOCALIZATION_MAX_NEIGHBORS + 6)
-static float workspace[7 * MAX_CELL_ROWS];
+static float workspace[COLLISION_AVOIDANCE_WORKSPACE_SIZE(MAX_NEIGHBORS)];
+static peerLocalizationOtherPosition_t const *neighbors[MAX_NEIGHBORS];
 
 // Latency counter for logging.
 static uint32_t latency = 0;
+// Number of fresh neighbors, of fresh neighbors left out because of
+// MAX_NEIGHBORS and of cell faces left after culling, for logging.
+static uint16_t nPeers = 0;
+static uint16_t nDropped = 0;
+static uint16_t nCellRows = 0;
 
 void collisionAvoidanceUpdateSetpoint(
   setpoint_t *setpoint, sensorData_t const *sensorData, state_t const *state, stabilizerStep_t stabilizerStep)
@@ -313,36 +469,36 @@ void collisionAvoidanceUpdateSetpoint(
   }
 
   TickType_t const time = xTaskGetTickCount();
-  bool doAgeFilter = params.maxPeerLocAgeMillis >= 0;
-
-  // Counts the actual number of neighbors after we filter stale measurements.
-  int nOthers = 0;
 
-  for (int i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
+  // The actual number of neighbors after we filter stale measurements. The
+  // order of the neighbors is stable between calls, which the core relies on
+  // to reuse the previous active set.
+  int nLeftOut = 0;
+  int const nOthers = peerLocalizationGetNearest(&state->position, &params.ellipsoidRadii, params.maxPeerLocAgeMillis, neighbors, MAX_NEIGHBORS, &nLeftOut);
 
-    peerLocalizationOtherPosition_t const *otherPos = peerLocalizationGetPositionByIdx(i);
-
-    if (otherPos == NULL || otherPos->id == 0) {
-      continue;
-    }
-
-    if (doAgeFilter && (time - otherPos->pos.timestamp > params.maxPeerLocAgeMillis)) {
-      continue;
-    }
-
-    workspace[3 * nOthers + 0] = otherPos->pos.x;
-    workspace[3 * nOthers + 1] = otherPos->pos.y;
-    workspace[3 * nOthers + 2] = otherPos->pos.z;
-    ++nOthers;
+  // The positions of the neighbors are extrapolated to the current time, they
+  // may have been captured tens of milliseconds ago.
+  for (int i = 0; i < nOthers; ++i) {
+    point_t position;
+    peerLocalizationGetPosition(neighbors[i], &position);
+    workspace[3 * i + 0] = position.x;
+    workspace[3 * i + 1] = position.y;
+    workspace[3 * i + 2] = position.z;
   }
 
   collisionAvoidanceUpdateSetpointCore(&params, &collisionState, nOthers, workspace, workspace, setpoint, sensorData, state);
 
   latency = xTaskGetTickCount() - time;
+  nPeers = nOthers;
+  nDropped = nLeftOut;
+  nCellRows = collisionState.nCellRows;
 }
 
 LOG_GROUP_START(colAv)
   LOG_ADD(LOG_UINT32, latency, &latency)
+  LOG_ADD(LOG_UINT16, nPeers, &nPeers)
+  LOG_ADD(LOG_UINT16, nDropped, &nDropped)
+  LOG_ADD(LOG_UINT16, nCellRows, &nCellRows)
 LOG_GROUP_STOP(colAv)
 
 
@@ -84,15 +84,16 @@ void commanderSetSetpoint(setpoint_t *setpoint, int priority)
     xQueueOverwrite(setpointQueue, setpoint);
     xQueueOverwrite(priorityQueue, &priority);
     if (priority > COMMANDER_PRIORITY_HIGHLEVEL) {
-      // Stop the high-level planner so it will forget its current state
-      crtpCommanderHighLevelStop();
+      // Stop the high-level planner so it will forget its current state. The
+      // caller may be a link task that must not block on the planner.
+      crtpCommanderHighLevelRequestStop();
     }
   }
 }
 
 void commanderRelaxPriority()
 {
-  crtpCommanderHighLevelTellState(&lastState);
+  crtpCommanderHighLevelRequestTellState(&lastState);
   int priority = COMMANDER_PRIORITY_LOWEST;
   xQueueOverwrite(priorityQueue, &priority);
 }
@@ -42,7 +42,11 @@
 #endif
 #endif
 
+// Start of the format strings of tokenized prints, defined by the linker script
+extern const char _consoleFmt_start;
+
 static CRTPPacket messageToPrint;
+static CRTPPacket tokenMessage;
 static bool messageSendingIsPending = false;
 static xSemaphoreHandle synch = NULL;
 
@@ -119,7 +123,7 @@ int consolePutchar(int ch)
 
       if (ch == '\n' || messageToPrint.size >= CRTP_MAX_DATA_SIZE)
       {
-        if (crtpGetFreeTxQueuePackets() == 1)
+        if (crtpGetFreeTxQueuePacketsForPort(CRTP_PORT_CONSOLE) == 1)
         {
           addBufferFullMarker();
         }
@@ -158,6 +162,51 @@ int consolePuts(const char *str)
   return ret;
 }
 
+int consoleTokenPrintf(const char *fmt, ...)
+{
+  bool isInInterrupt = (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) != 0;
+  int size = 0;
+
+  if (!isInit) {
+    return 0;
+  }
+
+  va_list ap;
+
+  if (isInInterrupt) {
+    // The format string is in flash with the others, print it as text
+    va_start(ap, fmt);
+    size = evprintf(consolePutcharFromISR, fmt, ap);
+    va_end(ap);
+    return size;
+  }
+
+  const uint16_t token = fmt - &_consoleFmt_start;
+
+  if (xSemaphoreTake(synch, portMAX_DELAY) == pdTRUE)
+  {
+    // Keep the order of the prints, a pending text message is sent first
+    if (messageSendingIsPending)
+    {
+      consoleSendMessage();
+    }
+
+    tokenMessage.header = CRTP_HEADER(CRTP_PORT_CONSOLE, CONSOLE_TOKEN_CH);
+    memcpy(tokenMessage.data, &token, sizeof(token));
+    va_start(ap, fmt);
+    tokenMessage.size = sizeof(token) + evprintfPack(&tokenMessage.data[sizeof(token)], CRTP_MAX_DATA_SIZE - sizeof(token), fmt, ap);
+    va_end(ap);
+
+    if (crtpSendPacket(&tokenMessage) == pdTRUE)
+    {
+      size = tokenMessage.size;
+    }
+    xSemaphoreGive(synch);
+  }
+
+  return size;
+}
+
 void consoleFlush(void)
 {
   if (xSemaphoreTake(synch, portMAX_DELAY) == pdTRUE)
@@ -36,6 +36,7 @@
 #include "config.h"
 
 #include "crtp.h"
+#include "crtp_tx_schedule.h"
 #include "info.h"
 #include "cfassert.h"
 #include "queuemonitor.h"
@@ -55,29 +56,94 @@ static struct crtpLinkOperations nopLink = {
 
 static struct crtpLinkOperations *link = &nopLink;
 
+#define CRTP_NBR_OF_PORTS 16
+
 #define STATS_INTERVAL 500
 static struct {
   uint32_t rxCount;
   uint32_t txCount;
 
+  // Packets dispatched from the link task. Only that task writes the counter,
+  // the statistics compare it with the value at the previous update.
+  volatile uint32_t rxDirectCount;
+  uint32_t rxDirectCountPrevious;
+
   uint16_t rxRate;
   uint16_t txRate;
 
+  // Time from queueing to sending, per priority class
+  uint32_t txLatencySum[CRTP_TX_PRIORITY_COUNT];
+  uint32_t txLatencyCount[CRTP_TX_PRIORITY_COUNT];
+  uint16_t txLatencyPeak[CRTP_TX_PRIORITY_COUNT];
+  uint16_t txLatency[CRTP_TX_PRIORITY_COUNT];
+  uint16_t txLatencyMax[CRTP_TX_PRIORITY_COUNT];
+
+  uint32_t txDropCount[CRTP_TX_PRIORITY_COUNT];
+
+  // Number of received packets that found the queue of their port full
+  uint32_t rxQueueFullCount[CRTP_NBR_OF_PORTS];
+
   uint32_t nextStatisticsTime;
   uint32_t previousStatisticsTime;
 } stats;
 
-static xQueueHandle  txQueue;
-
-#define CRTP_NBR_OF_PORTS 16
-#define CRTP_TX_QUEUE_SIZE 200
+#define CRTP_TX_QUEUE_SIZE_HIGH 24
+#define CRTP_TX_QUEUE_SIZE_NORMAL 48
+#define CRTP_TX_QUEUE_SIZE_LOW 128
+#define CRTP_TX_QUEUE_SIZE (CRTP_TX_QUEUE_SIZE_HIGH + CRTP_TX_QUEUE_SIZE_NORMAL + CRTP_TX_QUEUE_SIZE_LOW)
 #define CRTP_RX_QUEUE_SIZE 16
 
+// Back off when the link refuses a packet, doubling up to the max
+#define CRTP_TX_RETRY_MIN_MS 1
+#define CRTP_TX_RETRY_MAX_MS 10
+
+typedef struct {
+  CRTPPacket packet;
+  uint32_t queuedTick;
+} crtpTxItem_t;
+
+static const struct {
+  uint16_t size;
+  bool dropOldest;
+} txQueueConfig[CRTP_TX_PRIORITY_COUNT] = {
+  [CRTP_TX_PRIORITY_HIGH]   = {.size = CRTP_TX_QUEUE_SIZE_HIGH,   .dropOldest = false},
+  [CRTP_TX_PRIORITY_NORMAL] = {.size = CRTP_TX_QUEUE_SIZE_NORMAL, .dropOldest = true},
+  [CRTP_TX_PRIORITY_LOW]    = {.size = CRTP_TX_QUEUE_SIZE_LOW,    .dropOldest = false},
+};
+
+static xQueueHandle txQueues[CRTP_TX_PRIORITY_COUNT];
+static crtpTxSchedule_t txSchedule;
+static TaskHandle_t txTaskHandle;
+
+// Priority class per port
+static uint8_t portTxPriority[CRTP_NBR_OF_PORTS] = {
+  [CRTP_PORT_CONSOLE]          = CRTP_TX_PRIORITY_LOW,
+  [0x01]                       = CRTP_TX_PRIORITY_LOW,
+  [CRTP_PORT_PARAM]            = CRTP_TX_PRIORITY_LOW,
+  [CRTP_PORT_SETPOINT]         = CRTP_TX_PRIORITY_HIGH,
+  [CRTP_PORT_MEM]              = CRTP_TX_PRIORITY_LOW,
+  [CRTP_PORT_LOG]              = CRTP_TX_PRIORITY_NORMAL,
+  [CRTP_PORT_LOCALIZATION]     = CRTP_TX_PRIORITY_NORMAL,
+  [CRTP_PORT_SETPOINT_GENERIC] = CRTP_TX_PRIORITY_HIGH,
+  [CRTP_PORT_SETPOINT_HL]      = CRTP_TX_PRIORITY_HIGH,
+  [0x09]                       = CRTP_TX_PRIORITY_LOW,
+  [0x0A]                       = CRTP_TX_PRIORITY_LOW,
+  [0x0B]                       = CRTP_TX_PRIORITY_LOW,
+  [0x0C]                       = CRTP_TX_PRIORITY_LOW,
+  [CRTP_PORT_PLATFORM]         = CRTP_TX_PRIORITY_HIGH,
+  [0x0E]                       = CRTP_TX_PRIORITY_LOW,
+  [CRTP_PORT_LINK]             = CRTP_TX_PRIORITY_HIGH,
+};
+
 static void crtpTxTask(void *param);
 static void crtpRxTask(void *param);
 
 static xQueueHandle queues[CRTP_NBR_OF_PORTS];
 static volatile CrtpCallback callbacks[CRTP_NBR_OF_PORTS];
+static volatile CrtpCallback directCallbacks[CRTP_NBR_OF_PORTS];
+
+// Overflow policy per port, all ports block until a policy is set
+static uint8_t portRxOverflowPolicy[CRTP_NBR_OF_PORTS];
 static void updateStats();
 
 STATIC_MEM_TASK_ALLOC_STACK_NO_DMA_CCM_SAFE(crtpTxTask, CRTP_TX_TASK_STACKSIZE);
@@ -88,10 +154,13 @@ void crtpInit(void)
   if(isInit)
     return;
 
-  txQueue = xQueueCreate(CRTP_TX_QUEUE_SIZE, sizeof(CRTPPacket));
-  DEBUG_QUEUE_MONITOR_REGISTER(txQueue);
+  crtpTxScheduleInit(&txSchedule);
+  for (int i = 0; i < CRTP_TX_PRIORITY_COUNT; i++) {
+    txQueues[i] = xQueueCreate(txQueueConfig[i].size, sizeof(crtpTxItem_t));
+    DEBUG_QUEUE_MONITOR_REGISTER(txQueues[i]);
+  }
 
-  STATIC_MEM_TASK_CREATE(crtpTxTask, crtpTxTask, CRTP_TX_TASK_NAME, NULL, CRTP_TX_TASK_PRI);
+  txTaskHandle = STATIC_MEM_TASK_CREATE(crtpTxTask, crtpTxTask, CRTP_TX_TASK_NAME, NULL, CRTP_TX_TASK_PRI);
   STATIC_MEM_TASK_CREATE(crtpRxTask, crtpRxTask, CRTP_RX_TASK_NAME, NULL, CRTP_RX_TASK_PRI);
 
   isInit = true;
@@ -137,25 +206,77 @@ int crtpReceivePacketWait(CRTPPort portId, CRTPPacket *p, int wait)
 
 int crtpGetFreeTxQueuePackets(void)
 {
-  return (CRTP_TX_QUEUE_SIZE - uxQueueMessagesWaiting(txQueue));
+  int waiting = 0;
+  for (int i = 0; i < CRTP_TX_PRIORITY_COUNT; i++) {
+    waiting += uxQueueMessagesWaiting(txQueues[i]);
+  }
+
+  return (CRTP_TX_QUEUE_SIZE - waiting);
+}
+
+int crtpGetFreeTxQueuePacketsForPort(CRTPPort port)
+{
+  const crtpTxPriority_t priority = portTxPriority[port & 0x0F];
+  return (txQueueConfig[priority].size - uxQueueMessagesWaiting(txQueues[priority]));
+}
+
+void crtpSetPortTxPriority(CRTPPort port, crtpTxPriority_t priority)
+{
+  ASSERT(priority < CRTP_TX_PRIORITY_COUNT);
+
+  portTxPriority[port & 0x0F] = priority;
+}
+
+// Fetch the oldest packet of the class selected by the tx schedule, normally
+// the highest priority class that is not empty
+static bool txQueueReceive(crtpTxItem_t* item, crtpTxPriority_t* priority)
+{
+  bool hasPackets[CRTP_TX_PRIORITY_COUNT];
+  for (int i = 0; i < CRTP_TX_PRIORITY_COUNT; i++) {
+    hasPackets[i] = uxQueueMessagesWaiting(txQueues[i]) > 0;
+  }
+
+  const crtpTxPriority_t selected = crtpTxScheduleNext(&txSchedule, hasPackets);
+  if (selected == CRTP_TX_PRIORITY_COUNT) {
+    return false;
+  }
+
+  *priority = selected;
+  return xQueueReceive(txQueues[selected], item, 0) == pdTRUE;
 }
 
 void crtpTxTask(void *param)
 {
-  CRTPPacket p;
+  crtpTxItem_t item;
+  crtpTxPriority_t priority;
 
   while (true)
   {
     if (link != &nopLink)
     {
-      if (xQueueReceive(txQueue, &p, portMAX_DELAY) == pdTRUE)
+      // The notification value counts queued packets. It may be higher than
+      // the number of packets in the queues when old packets have been dropped.
+      if (ulTaskNotifyTake(pdFALSE, portMAX_DELAY) > 0 && txQueueReceive(&item, &priority))
       {
         // Keep testing, if the link changes to USB it will go though
-        while (link->sendPacket(&p) == false)
+        uint32_t retryDelay = CRTP_TX_RETRY_MIN_MS;
+        while (link->sendPacket(&item.packet) == false)
         {
           // Relaxation time
-          vTaskDelay(M2T(10));
+          vTaskDelay(M2T(retryDelay));
+          retryDelay = retryDelay * 2;
+          if (retryDelay > CRTP_TX_RETRY_MAX_MS) {
+            retryDelay = CRTP_TX_RETRY_MAX_MS;
+          }
         }
+
+        const uint32_t latency = T2M(xTaskGetTickCount() - item.queuedTick);
+        stats.txLatencySum[priority] += latency;
+        stats.txLatencyCount[priority]++;
+        if (latency > stats.txLatencyPeak[priority]) {
+          stats.txLatencyPeak[priority] = latency > UINT16_MAX ? UINT16_MAX : latency;
+        }
+
         stats.txCount++;
         updateStats();
       }
@@ -167,6 +288,39 @@ void crtpTxTask(void *param)
   }
 }
 
+static void rxQueueSend(CRTPPacket *p)
+{
+  xQueueHandle queue = queues[p->port];
+
+  if (xQueueSend(queue, p, 0) == pdTRUE)
+  {
+    return;
+  }
+
+  stats.rxQueueFullCount[p->port]++;
+
+  switch (portRxOverflowPolicy[p->port])
+  {
+    case CRTP_RX_OVERFLOW_DROP_NEWEST:
+      break;
+    case CRTP_RX_OVERFLOW_DROP_OLDEST:
+      {
+        CRTPPacket oldest;
+        xQueueReceive(queue, &oldest, 0);
+        xQueueSend(queue, p, 0);
+      }
+      break;
+    case CRTP_RX_OVERFLOW_COALESCE_LATEST:
+      xQueueReset(queue);
+      xQueueSend(queue, p, 0);
+      break;
+    case CRTP_RX_OVERFLOW_BLOCK:
+    default:
+      xQueueSend(queue, p, portMAX_DELAY);
+      break;
+  }
+}
+
 void crtpRxTask(void *param)
 {
   CRTPPacket p;
@@ -177,10 +331,15 @@ void crtpRxTask(void *param)
     {
       if (!link->receivePacket(&p))
       {
+        // Links that do not dispatch directly end up here
+        if (directCallbacks[p.port])
+        {
+          directCallbacks[p.port](&p);
+        }
+
         if (queues[p.port])
         {
-          // Block, since we should never drop a packet
-          xQueueSend(queues[p.port], &p, portMAX_DELAY);
+          rxQueueSend(&p);
         }
 
         if (callbacks[p.port])
@@ -207,25 +366,79 @@ void crtpRegisterPortCB(int port, CrtpCallback cb)
   callbacks[port] = cb;
 }
 
-int crtpSendPacket(CRTPPacket *p)
+void crtpRegisterPortDirectCB(int port, CrtpCallback cb)
 {
-  ASSERT(p);
-  ASSERT(p->size <= CRTP_MAX_DATA_SIZE);
+  if (port>=CRTP_NBR_OF_PORTS)
+    return;
 
-  return xQueueSend(txQueue, p, 0);
+  directCallbacks[port] = cb;
 }
 
-int crtpSendPacketBlock(CRTPPacket *p)
+void crtpSetPortRxOverflowPolicy(CRTPPort port, crtpRxOverflowPolicy_t policy)
+{
+  portRxOverflowPolicy[port & 0x0F] = policy;
+}
+
+bool crtpDispatchDirect(const struct crtpLinkOperations * lk, CRTPPacket *p)
+{
+  const CrtpCallback cb = directCallbacks[p->port];
+  if (cb == NULL || lk != link)
+  {
+    return false;
+  }
+
+  cb(p);
+  stats.rxDirectCount++;
+  return true;
+}
+
+static int txQueueSend(CRTPPacket *p, TickType_t wait)
 {
   ASSERT(p);
   ASSERT(p->size <= CRTP_MAX_DATA_SIZE);
 
-  return xQueueSend(txQueue, p, portMAX_DELAY);
+  const crtpTxPriority_t priority = portTxPriority[p->port];
+  crtpTxItem_t item;
+  item.packet = *p;
+  item.queuedTick = xTaskGetTickCount();
+
+  int result = xQueueSend(txQueues[priority], &item, wait);
+  if (result != pdTRUE)
+  {
+    stats.txDropCount[priority]++;
+
+    if (txQueueConfig[priority].dropOldest)
+    {
+      // Newer data is worth more, make room for this packet
+      crtpTxItem_t oldest;
+      xQueueReceive(txQueues[priority], &oldest, 0);
+      result = xQueueSend(txQueues[priority], &item, 0);
+    }
+  }
+
+  if (result == pdTRUE)
+  {
+    xTaskNotifyGive(txTaskHandle);
+  }
+
+  return result;
+}
+
+int crtpSendPacket(CRTPPacket *p)
+{
+  return txQueueSend(p, 0);
+}
+
+int crtpSendPacketBlock(CRTPPacket *p)
+{
+  return txQueueSend(p, portMAX_DELAY);
 }
 
 int crtpReset(void)
 {
-  xQueueReset(txQueue);
+  for (int i = 0; i < CRTP_TX_PRIORITY_COUNT; i++) {
+    xQueueReset(txQueues[i]);
+  }
   if (link->reset) {
     link->reset();
   }
@@ -262,6 +475,12 @@ static void clearStats()
 {
   stats.rxCount = 0;
   stats.txCount = 0;
+
+  for (int i = 0; i < CRTP_TX_PRIORITY_COUNT; i++) {
+    stats.txLatencySum[i] = 0;
+    stats.txLatencyCount[i] = 0;
+    stats.txLatencyPeak[i] = 0;
+  }
 }
 
 static void updateStats()
@@ -269,9 +488,20 @@ static void updateStats()
   uint32_t now = xTaskGetTickCount();
   if (now > stats.nextStatisticsTime) {
     float interval = now - stats.previousStatisticsTime;
-    stats.rxRate = (uint16_t)(1000.0f * stats.rxCount / interval);
+    const uint32_t rxDirectCount = stats.rxDirectCount;
+    stats.rxRate = (uint16_t)(1000.0f * (stats.rxCount + rxDirectCount - stats.rxDirectCountPrevious) / interval);
+    stats.rxDirectCountPrevious = rxDirectCount;
     stats.txRate = (uint16_t)(1000.0f * stats.txCount / interval);
 
+    for (int i = 0; i < CRTP_TX_PRIORITY_COUNT; i++) {
+      if (stats.txLatencyCount[i] > 0) {
+        stats.txLatency[i] = (uint16_t)(stats.txLatencySum[i] / stats.txLatencyCount[i]);
+      } else {
+        stats.txLatency[i] = 0;
+      }
+      stats.txLatencyMax[i] = stats.txLatencyPeak[i];
+    }
+
     clearStats();
     stats.previousStatisticsTime = now;
     stats.nextStatisticsTime = now + STATS_INTERVAL;
@@ -281,4 +511,20 @@ static void updateStats()
 LOG_GROUP_START(crtp)
 LOG_ADD(LOG_UINT16, rxRate, &stats.rxRate)
 LOG_ADD(LOG_UINT16, txRate, &stats.txRate)
+LOG_ADD(LOG_UINT16, txLatHigh, &stats.txLatency[CRTP_TX_PRIORITY_HIGH])
+LOG_ADD(LOG_UINT16, txLatNorm, &stats.txLatency[CRTP_TX_PRIORITY_NORMAL])
+LOG_ADD(LOG_UINT16, txLatLow, &stats.txLatency[CRTP_TX_PRIORITY_LOW])
+LOG_ADD(LOG_UINT16, txLatMaxHigh, &stats.txLatencyMax[CRTP_TX_PRIORITY_HIGH])
+LOG_ADD(LOG_UINT16, txLatMaxNorm, &stats.txLatencyMax[CRTP_TX_PRIORITY_NORMAL])
+LOG_ADD(LOG_UINT16, txLatMaxLow, &stats.txLatencyMax[CRTP_TX_PRIORITY_LOW])
+LOG_ADD(LOG_UINT32, txDropHigh, &stats.txDropCount[CRTP_TX_PRIORITY_HIGH])
+LOG_ADD(LOG_UINT32, txDropNorm, &stats.txDropCount[CRTP_TX_PRIORITY_NORMAL])
+LOG_ADD(LOG_UINT32, txDropLow, &stats.txDropCount[CRTP_TX_PRIORITY_LOW])
+LOG_ADD(LOG_UINT32, txAged, &txSchedule.agedCount)
+LOG_ADD(LOG_UINT32, rxFullParam, &stats.rxQueueFullCount[CRTP_PORT_PARAM])
+LOG_ADD(LOG_UINT32, rxFullMem, &stats.rxQueueFullCount[CRTP_PORT_MEM])
+LOG_ADD(LOG_UINT32, rxFullLog, &stats.rxQueueFullCount[CRTP_PORT_LOG])
+LOG_ADD(LOG_UINT32, rxFullHl, &stats.rxQueueFullCount[CRTP_PORT_SETPOINT_HL])
+LOG_ADD(LOG_UINT32, rxFullPlat, &stats.rxQueueFullCount[CRTP_PORT_PLATFORM])
+LOG_ADD(LOG_UINT32, rxFullLink, &stats.rxQueueFullCount[CRTP_PORT_LINK])
 LOG_GROUP_STOP(crtp)
@@ -28,6 +28,8 @@
 
 #include "crtp_commander.h"
 
+#include "autoconf.h"
+
 #include "cfassert.h"
 #include "commander.h"
 #include "crtp.h"
@@ -44,8 +46,13 @@ void crtpCommanderInit(void)
   }
 
   crtpInit();
+#ifdef CONFIG_CRTP_COMMANDER_DIRECT_DISPATCH
+  crtpRegisterPortDirectCB(CRTP_PORT_SETPOINT, commanderCrtpCB);
+  crtpRegisterPortDirectCB(CRTP_PORT_SETPOINT_GENERIC, commanderCrtpCB);
+#else
   crtpRegisterPortCB(CRTP_PORT_SETPOINT, commanderCrtpCB);
   crtpRegisterPortCB(CRTP_PORT_SETPOINT_GENERIC, commanderCrtpCB);
+#endif
   isInit = true;
 }
 
@@ -108,6 +108,17 @@ static struct piecewise_traj_compressed  compressed_trajectory;
 static xSemaphoreHandle lockTraj;
 static StaticSemaphore_t lockTrajBuffer;
 
+// Requests from setpoint sources that must not wait for lockTraj. They are
+// carried out when the trajectory is locked next, before it is used, so a
+// command that is handled before the next setpoint evaluation sees them.
+static struct {
+  bool stop;
+  bool tellState;
+  struct vec pos;
+  struct vec vel;
+  float yaw;
+} pendingRequests;
+
 // safe default settings for takeoff and landing velocity
 static float defaultTakeoffVelocity = 0.5f;
 static float defaultLandingVelocity = 0.5f;
@@ -286,6 +297,31 @@ bool isInGroup(uint8_t g) {
   return g == ALL_GROUPS || (g & group_mask) != 0;
 }
 
+// Takes lockTraj and carries out the pending requests
+static void lockTrajectory()
+{
+  xSemaphoreTake(lockTraj, portMAX_DELAY);
+
+  taskENTER_CRITICAL();
+  const bool doStop = pendingRequests.stop;
+  const bool doTellState = pendingRequests.tellState;
+  const struct vec requestedPos = pendingRequests.pos;
+  const struct vec requestedVel = pendingRequests.vel;
+  const float requestedYaw = pendingRequests.yaw;
+  pendingRequests.stop = false;
+  pendingRequests.tellState = false;
+  taskEXIT_CRITICAL();
+
+  if (doStop) {
+    plan_stop(&planner);
+  }
+  if (doTellState) {
+    pos = requestedPos;
+    vel = requestedVel;
+    yaw = requestedYaw;
+  }
+}
+
 void crtpCommanderHighLevelInit(void)
 {
   if (isInit) {
@@ -311,12 +347,27 @@ void crtpCommanderHighLevelInit(void)
 
 bool crtpCommanderHighLevelIsStopped()
 {
-  return plan_is_stopped(&planner);
+  return pendingRequests.stop || plan_is_stopped(&planner);
+}
+
+void crtpCommanderHighLevelRequestStop()
+{
+  pendingRequests.stop = true;
+}
+
+void crtpCommanderHighLevelRequestTellState(const state_t *state)
+{
+  taskENTER_CRITICAL();
+  pendingRequests.pos = state2vec(state->position);
+  pendingRequests.vel = state2vec(state->velocity);
+  pendingRequests.yaw = radians(state->attitude.yaw);
+  pendingRequests.tellState = true;
+  taskEXIT_CRITICAL();
 }
 
 void crtpCommanderHighLevelTellState(const state_t *state)
 {
-  xSemaphoreTake(lockTraj, portMAX_DELAY);
+  lockTrajectory();
   pos = state2vec(state->position);
   vel = state2vec(state->velocity);
   yaw = radians(state->attitude.yaw);
@@ -335,7 +386,7 @@ bool crtpCommanderHighLevelGetSetpoint(setpoint_t* setpoint, const state_t *stat
     return false;
   }
 
-  xSemaphoreTake(lockTraj, portMAX_DELAY);
+  lockTrajectory();
   float t = usecTimestamp() / 1e6;
   struct traj_eval ev = plan_current_goal(&planner, t);
   xSemaphoreGive(lockTraj);
@@ -484,7 +535,7 @@ int takeoff(const struct data_takeoff* data)
 
   int result = 0;
   if (isInGroup(data->groupMask)) {
-    xSemaphoreTake(lockTraj, portMAX_DELAY);
+    lockTrajectory();
     float t = usecTimestamp() / 1e6;
     result = plan_takeoff(&planner, pos, yaw, data->height, 0.0f, data->duration, t);
     xSemaphoreGive(lockTraj);
@@ -500,7 +551,7 @@ int takeoff2(const struct data_takeoff_2* data)
 
   int result = 0;
   if (isInGroup(data->groupMask)) {
-    xSemaphoreTake(lockTraj, portMAX_DELAY);
+    lockTrajectory();
     float t = usecTimestamp() / 1e6;
 
     float hover_yaw = data->yaw;
@@ -522,7 +573,7 @@ int takeoff_with_velocity(const struct data_takeoff_with_velocity* data)
 
   int result = 0;
   if (isInGroup(data->groupMask)) {
-    xSemaphoreTake(lockTraj, portMAX_DELAY);
+    lockTrajectory();
     float t = usecTimestamp() / 1e6;
 
     float hover_yaw = data->yaw;
@@ -552,7 +603,7 @@ int land(const struct data_land* data)
 
   int result = 0;
   if (isInGroup(data->groupMask)) {
-    xSemaphoreTake(lockTraj, portMAX_DELAY);
+    lockTrajectory();
     float t = usecTimestamp() / 1e6;
     result = plan_land(&planner, pos, yaw, data->height, 0.0f, data->duration, t);
     xSemaphoreGive(lockTraj);
@@ -568,7 +619,7 @@ int land2(const struct data_land_2* data)
 
   int result = 0;
   if (isInGroup(data->groupMask)) {
-    xSemaphoreTake(lockTraj, portMAX_DELAY);
+    lockTrajectory();
     float t = usecTimestamp() / 1e6;
 
     float hover_yaw = data->yaw;
@@ -590,7 +641,7 @@ int land_with_velocity(const struct data_land_with_velocity* data)
 
   int result = 0;
   if (isInGroup(data->groupMask)) {
-    xSemaphoreTake(lockTraj, portMAX_DELAY);
+    lockTrajectory();
     float t = usecTimestamp() / 1e6;
 
     float hover_yaw = data->yaw;
@@ -615,7 +666,7 @@ int stop(const struct data_stop* data)
 {
   int result = 0;
   if (isInGroup(data->groupMask)) {
-    xSemaphoreTake(lockTraj, portMAX_DELAY);
+    lockTrajectory();
     plan_stop(&planner);
     xSemaphoreGive(lockTraj);
   }
@@ -637,7 +688,7 @@ int go_to(const struct data_go_to* data)
   int result = 0;
   if (isInGroup(data->groupMask)) {
     struct vec hover_pos = mkvec(data->x, data->y, data->z);
-    xSemaphoreTake(lockTraj, portMAX_DELAY);
+    lockTrajectory();
     float t = usecTimestamp() / 1e6;
     if (plan_is_disabled(&planner) || plan_is_stopped(&planner)) {
       ev.pos = pos;
@@ -668,7 +719,7 @@ int go_to2(const struct data_go_to_2* data)
   int result = 0;
   if (isInGroup(data->groupMask)) {
     struct vec hover_pos = mkvec(data->x, data->y, data->z);
-    xSemaphoreTake(lockTraj, portMAX_DELAY);
+    lockTrajectory();
     float t = usecTimestamp() / 1e6;
     if (plan_is_disabled(&planner) || plan_is_stopped(&planner)) {
       ev.pos = pos;
@@ -698,7 +749,7 @@ int spiral(const struct data_spiral* data)
 
   int result = 0;
   if (isInGroup(data->groupMask)) {
-    xSemaphoreTake(lockTraj, portMAX_DELAY);
+    lockTrajectory();
     float t = usecTimestamp() / 1e6;
     ev.pos = pos;
     ev.vel = vel;
@@ -721,7 +772,7 @@ int start_trajectory(const struct data_start_trajectory* data)
       struct trajectoryDescription* trajDesc = &trajectory_descriptions[data->trajectoryId];
       if (   trajDesc->trajectoryLocation == TRAJECTORY_LOCATION_MEM
           && trajDesc->trajectoryType == CRTP_CHL_TRAJECTORY_TYPE_POLY4D) {
-        xSemaphoreTake(lockTraj, portMAX_DELAY);
+        lockTrajectory();
         float t = usecTimestamp() / 1e6;
         trajectory.t_begin = t;
         trajectory.timescale = data->timescale;
@@ -735,7 +786,7 @@ int start_trajectory(const struct data_start_trajectory* data)
         if (data->timescale != 1 || data->reversed) {
           result = ENOEXEC;
         } else {
-          xSemaphoreTake(lockTraj, portMAX_DELAY);
+          lockTrajectory();
           float t = usecTimestamp() / 1e6;
           piecewise_compressed_load(
             &compressed_trajectory,
@@ -877,7 +928,7 @@ int crtpCommanderBlock(bool doBlock)
       const bool isNotStopped = !plan_is_stopped(&planner);
       if (isNotDisabled && isNotStopped)
       {
-        xSemaphoreTake(lockTraj, portMAX_DELAY);
+        lockTrajectory();
         plan_stop(&planner);
         xSemaphoreGive(lockTraj);
       }
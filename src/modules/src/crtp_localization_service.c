@@ -105,6 +105,21 @@ typedef struct {
   uint32_t quat; // compressed quaternion, see quatcompress.h
 } __attribute__((packed)) extPosePackedItem;
 
+// Resolution of the velocity in extPoseVelPackedItem, in m/s
+#define EXT_POSE_PACKED_VEL_UNIT 0.04f
+
+// up to 2 items per CRTP packet, after the type and the age of the poses
+typedef struct {
+  uint8_t id; // last 8 bit of the Crazyflie address
+  int16_t x; // mm
+  int16_t y; // mm
+  int16_t z; // mm
+  uint32_t quat; // compressed quaternion, see quatcompress.h
+  int8_t vx; // EXT_POSE_PACKED_VEL_UNIT
+  int8_t vy; // EXT_POSE_PACKED_VEL_UNIT
+  int8_t vz; // EXT_POSE_PACKED_VEL_UNIT
+} __attribute__((packed)) extPoseVelPackedItem;
+
 // Struct for logging position information
 static positionMeasurement_t ext_pos;
 // Struct for logging pose information
@@ -120,6 +135,8 @@ static CRTPPacket LhAngle;
 static bool enableLighthouseAngleStream = false;
 static float extPosStdDev = 0.01;
 static float extQuatStdDev = 4.5e-3;
+// Latency of external positions and poses (ms), from when they are taken until they are received
+static uint8_t extLatency = 0;
 static bool isInit = false;
 static uint8_t my_id;
 static uint16_t tickOfLastPacket; // tick when last packet was received
@@ -163,6 +180,11 @@ static void locSrvCrtpCB(CRTPPacket* pk)
   }
 }
 
+// The time when an external measurement that is received now was taken
+static uint32_t extMeasurementTimestamp() {
+  return T2M(xTaskGetTickCount()) - extLatency;
+}
+
 static void updateLogFromExtPos()
 {
   ext_pose.x = ext_pos.x;
@@ -178,6 +200,7 @@ static void extPositionHandler(CRTPPacket* pk) {
   ext_pos.z = data->z;
   ext_pos.stdDev = extPosStdDev;
   ext_pos.source = MeasurementSourceLocationService;
+  ext_pos.timestamp = extMeasurementTimestamp();
   updateLogFromExtPos();
 
   estimatorEnqueuePosition(&ext_pos);
@@ -196,6 +219,7 @@ static void extPoseHandler(const CRTPPacket* pk) {
   ext_pose.quat.w = data->qw;
   ext_pose.stdDevPos = extPosStdDev;
   ext_pose.stdDevQuat = extQuatStdDev;
+  ext_pose.timestamp = extMeasurementTimestamp();
 
   estimatorEnqueuePose(&ext_pose);
   tickOfLastPacket = xTaskGetTickCount();
@@ -212,6 +236,7 @@ static void extPosePackedHandler(const CRTPPacket* pk) {
       quatdecompress(item->quat, (float *)&ext_pose.quat.q0);
       ext_pose.stdDevPos = extPosStdDev;
       ext_pose.stdDevQuat = extQuatStdDev;
+      ext_pose.timestamp = extMeasurementTimestamp();
       estimatorEnqueuePose(&ext_pose);
       tickOfLastPacket = xTaskGetTickCount();
     } else {
@@ -224,6 +249,42 @@ static void extPosePackedHandler(const CRTPPacket* pk) {
   }
 }
 
+// The packet starts with the type and the time from when the poses were captured until the packet
+// was sent [ms], followed by the items
+static void extPoseVelPackedHandler(const CRTPPacket* pk) {
+  if (pk->size < 2) {
+    return;
+  }
+
+  const uint32_t timestamp = T2M(xTaskGetTickCount()) - pk->data[1];
+  uint8_t numItems = (pk->size - 2) / sizeof(extPoseVelPackedItem);
+  for (uint8_t i = 0; i < numItems; ++i) {
+    const extPoseVelPackedItem* item = (const extPoseVelPackedItem*)&pk->data[2 + i * sizeof(extPoseVelPackedItem)];
+    if (item->id == my_id) {
+      ext_pose.x = item->x / 1000.0f;
+      ext_pose.y = item->y / 1000.0f;
+      ext_pose.z = item->z / 1000.0f;
+      quatdecompress(item->quat, (float *)&ext_pose.quat.q0);
+      ext_pose.stdDevPos = extPosStdDev;
+      ext_pose.stdDevQuat = extQuatStdDev;
+      ext_pose.timestamp = timestamp;
+      estimatorEnqueuePose(&ext_pose);
+      tickOfLastPacket = xTaskGetTickCount();
+    } else {
+      ext_pos.x = item->x / 1000.0f;
+      ext_pos.y = item->y / 1000.0f;
+      ext_pos.z = item->z / 1000.0f;
+      ext_pos.stdDev = extPosStdDev;
+      const velocity_t vel = {
+        .x = item->vx * EXT_POSE_PACKED_VEL_UNIT,
+        .y = item->vy * EXT_POSE_PACKED_VEL_UNIT,
+        .z = item->vz * EXT_POSE_PACKED_VEL_UNIT,
+      };
+      peerLocalizationTellStateAt(item->id, &ext_pos, &vel, M2T(timestamp));
+    }
+  }
+}
+
 static void lpsShortLppPacketHandler(CRTPPacket* pk) {
   if (pk->size >= 2) {
 #ifdef CONFIG_DECK_LOCO
@@ -282,7 +343,7 @@ static void lhPersistDataWorker(void* arg) {
 static void lhPersistDataHandler(CRTPPacket* pk) {
   if (pk->size >= (1 + sizeof(LhPersistArgs_t))) {
     LhPersistArgs_t* args = (LhPersistArgs_t*) &pk->data[1];
-    workerSchedule(lhPersistDataWorker, (void*)args->combinedField);
+    workerScheduleJob(lhPersistDataWorker, (void*)args->combinedField, workerPriorityLow, 0);
   }
 }
 
@@ -307,6 +368,9 @@ static void genericLocHandle(CRTPPacket* pk)
     case EXT_POSE_PACKED:
       extPosePackedHandler(pk);
       break;
+    case EXT_POSE_PACKED_VEL:
+      extPoseVelPackedHandler(pk);
+      break;
     case LH_PERSIST_DATA:
       lhPersistDataHandler(pk);
       break;
@@ -327,6 +391,7 @@ static void extPositionPackedHandler(CRTPPacket* pk)
     ext_pos.stdDev = extPosStdDev;
     ext_pos.source = MeasurementSourceLocationService;
     if (item->id == my_id) {
+      ext_pos.timestamp = extMeasurementTimestamp();
       updateLogFromExtPos();
       estimatorEnqueuePosition(&ext_pos);
       tickOfLastPacket = xTaskGetTickCount();
@@ -475,4 +540,9 @@ PARAM_GROUP_START(locSrv)
  * @brief Standard deviation of the quarternion data to kalman filter
  */
   PARAM_ADD_CORE(PARAM_FLOAT, extQuatStdDev, &extQuatStdDev)
+/**
+ * @brief Latency of external position and pose measurements [ms]. Used by the Kalman estimator
+ * to fuse the measurements at the time they were taken, if built with CONFIG_ESTIMATOR_KALMAN_HISTORY
+ */
+  PARAM_ADD(PARAM_UINT8, extLatency, &extLatency)
 PARAM_GROUP_STOP(locSrv)
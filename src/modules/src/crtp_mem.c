@@ -36,6 +36,7 @@
 
 #include "mem.h"
 #include "crtp.h"
+#include "crtp_mem_bulk.h"
 #include "system.h"
 
 #include "console.h"
@@ -118,7 +119,13 @@ static void memTask(void* param) {
   memBlockHandlerRegistration();
 
 	while(1) {
-		crtpReceivePacketBlock(CRTP_PORT_MEM, &packet);
+    // Stream bulk reads while waiting for packets
+    const uint32_t wait = crtpMemBulkRun(T2M(xTaskGetTickCount()));
+    if (wait == MEM_BULK_WAIT_FOREVER) {
+      crtpReceivePacketBlock(CRTP_PORT_MEM, &packet);
+    } else if (crtpReceivePacketWait(CRTP_PORT_MEM, &packet, wait) != pdTRUE) {
+      continue;
+    }
 
 		switch (packet.channel) {
       case MEM_SETTINGS_CH:
@@ -130,6 +137,9 @@ static void memTask(void* param) {
       case MEM_WRITE_CH:
         memWriteProcess(&packet);
         break;
+      case MEM_BULK_CH:
+        crtpMemBulkProcess(&packet, T2M(xTaskGetTickCount()));
+        break;
       default:
         // Do nothing
         break;
@@ -0,0 +1,412 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * crtp_mem_bulk.c - Windowed bulk transfers for the memory sub system
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "crtp_mem_bulk.h"
+#include "mem.h"
+#include "statsCnt.h"
+
+#include "log.h"
+
+#define STATUS_OK 0
+
+#define ONE_SECOND 1000
+
+static struct {
+  bool active;
+  uint8_t memId;
+  uint32_t addr;
+  uint32_t len;
+  uint16_t chunkCount;
+  uint8_t window;
+
+  // All chunks before ackedSeq are acknowledged by the client
+  uint16_t ackedSeq;
+  // The next chunk that has never been sent
+  uint16_t nextSeq;
+  // Bit i is set if chunk ackedSeq + i should be sent again
+  uint32_t resend;
+
+  uint32_t lastActivityMs;
+  uint8_t timeouts;
+} readSession;
+
+static struct {
+  bool active;
+  uint8_t memId;
+  uint32_t addr;
+  uint32_t len;
+  uint16_t chunkCount;
+
+  // All chunks before nextSeq are written
+  uint16_t nextSeq;
+  // Bit i is set if chunk nextSeq + i is written
+  uint32_t received;
+
+  bool holeReported;
+  uint16_t holeReportedSeq;
+  uint8_t chunksSinceAck;
+} writeSession;
+
+static CRTPPacket txPacket;
+
+static STATS_CNT_RATE_DEFINE(readRate, ONE_SECOND);
+static STATS_CNT_RATE_DEFINE(writeRate, ONE_SECOND);
+static uint32_t readResentCount;
+static uint32_t writeHoleCount;
+
+static bool readMemory(const uint8_t memId, const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer) {
+  const uint8_t nrOfMems = memGetNrOfMems();
+  if (memId < nrOfMems) {
+    return memRead(memId, memAddr, readLen, buffer);
+  } else {
+    return memReadOw(memId - nrOfMems, memAddr, readLen, buffer);
+  }
+}
+
+static bool writeMemory(const uint8_t memId, const uint32_t memAddr, const uint8_t writeLen, const uint8_t* buffer) {
+  const uint8_t nrOfMems = memGetNrOfMems();
+  if (memId < nrOfMems) {
+    return memWrite(memId, memAddr, writeLen, buffer);
+  } else {
+    return memWriteOw(memId - nrOfMems, memAddr, writeLen, buffer);
+  }
+}
+
+static bool isRangeValid(const uint8_t memId, const uint32_t addr, const uint32_t len) {
+  const uint8_t nrOfMems = memGetNrOfMems();
+
+  uint32_t memSize = 0;
+  if (memId < nrOfMems) {
+    memSize = memGetSize(memId);
+  } else if (memId < nrOfMems + memGetNrOfOwMems()) {
+    memSize = memGetOwSize();
+  } else {
+    return false;
+  }
+
+  if (len == 0 || len > (uint32_t)UINT16_MAX * MEM_BULK_CHUNK_SIZE) {
+    return false;
+  }
+
+  return addr <= memSize && len <= memSize - addr;
+}
+
+static uint8_t chunkLength(const uint32_t len, const uint16_t seq) {
+  const uint32_t offset = (uint32_t)seq * MEM_BULK_CHUNK_SIZE;
+  const uint32_t remaining = len - offset;
+  return remaining < MEM_BULK_CHUNK_SIZE ? remaining : MEM_BULK_CHUNK_SIZE;
+}
+
+static void sendStartResponse(const uint8_t cmd, const uint8_t memId, const uint8_t status, const uint8_t window) {
+  txPacket.header = CRTP_HEADER(CRTP_PORT_MEM, MEM_BULK_CH);
+  txPacket.data[0] = cmd;
+  txPacket.data[1] = memId;
+  txPacket.data[2] = status;
+  txPacket.data[3] = MEM_BULK_CHUNK_SIZE;
+  txPacket.data[4] = window;
+  txPacket.size = 5;
+  crtpSendPacketBlock(&txPacket);
+}
+
+static void sendReadChunk(const uint16_t seq) {
+  const uint8_t len = chunkLength(readSession.len, seq);
+  const uint32_t memAddr = readSession.addr + (uint32_t)seq * MEM_BULK_CHUNK_SIZE;
+
+  txPacket.header = CRTP_HEADER(CRTP_PORT_MEM, MEM_BULK_CH);
+  txPacket.data[0] = MEM_BULK_CMD_READ_DATA;
+  memcpy(&txPacket.data[1], &seq, 2);
+
+  if (!readMemory(readSession.memId, memAddr, len, &txPacket.data[3])) {
+    readSession.active = false;
+    sendStartResponse(MEM_BULK_CMD_READ_START, readSession.memId, EIO, readSession.window);
+    return;
+  }
+
+  txPacket.size = 3 + len;
+  crtpSendPacketBlock(&txPacket);
+  STATS_CNT_RATE_MULTI_EVENT(&readRate, len);
+}
+
+static void sendWriteAck(const uint8_t status) {
+  txPacket.header = CRTP_HEADER(CRTP_PORT_MEM, MEM_BULK_CH);
+  txPacket.data[0] = MEM_BULK_CMD_WRITE_ACK;
+  txPacket.data[1] = status;
+  memcpy(&txPacket.data[2], &writeSession.nextSeq, 2);
+  memcpy(&txPacket.data[4], &writeSession.received, 4);
+  txPacket.size = 8;
+  crtpSendPacketBlock(&txPacket);
+
+  writeSession.chunksSinceAck = 0;
+}
+
+static void startRead(const CRTPPacket* p, const uint32_t nowMs) {
+  readSession.active = false;
+  if (p->size < 11) {
+    sendStartResponse(MEM_BULK_CMD_READ_START, 0, EINVAL, MEM_BULK_MAX_WINDOW);
+    return;
+  }
+
+  const uint8_t memId = p->data[1];
+  uint32_t addr;
+  uint32_t len;
+  memcpy(&addr, &p->data[2], 4);
+  memcpy(&len, &p->data[6], 4);
+  uint8_t window = p->data[10];
+  if (window == 0 || window > MEM_BULK_MAX_WINDOW) {
+    window = MEM_BULK_MAX_WINDOW;
+  }
+
+  if (!isRangeValid(memId, addr, len)) {
+    sendStartResponse(MEM_BULK_CMD_READ_START, memId, EINVAL, window);
+    return;
+  }
+
+  readSession.memId = memId;
+  readSession.addr = addr;
+  readSession.len = len;
+  readSession.chunkCount = (len + MEM_BULK_CHUNK_SIZE - 1) / MEM_BULK_CHUNK_SIZE;
+  readSession.window = window;
+  readSession.ackedSeq = 0;
+  readSession.nextSeq = 0;
+  readSession.resend = 0;
+  readSession.lastActivityMs = nowMs;
+  readSession.timeouts = 0;
+  readSession.active = true;
+
+  sendStartResponse(MEM_BULK_CMD_READ_START, memId, STATUS_OK, window);
+}
+
+static void handleReadAck(const CRTPPacket* p, const uint32_t nowMs) {
+  if (!readSession.active || p->size < 7) {
+    return;
+  }
+
+  uint16_t ackedSeq;
+  uint32_t received;
+  memcpy(&ackedSeq, &p->data[1], 2);
+  memcpy(&received, &p->data[3], 4);
+
+  // Stale or invalid ACK
+  if (ackedSeq < readSession.ackedSeq || ackedSeq > readSession.nextSeq) {
+    return;
+  }
+
+  const uint16_t advance = ackedSeq - readSession.ackedSeq;
+  readSession.resend = advance >= 32 ? 0 : readSession.resend >> advance;
+  readSession.resend &= ~received;
+  readSession.ackedSeq = ackedSeq;
+  readSession.lastActivityMs = nowMs;
+  readSession.timeouts = 0;
+
+  if (readSession.ackedSeq == readSession.chunkCount) {
+    readSession.active = false;
+    return;
+  }
+
+  // Chunks are delivered in order, holes below the highest received chunk are lost
+  if (received != 0) {
+    const int highest = 31 - __builtin_clz(received);
+    uint32_t holes = ~received & ((1u << highest) - 1);
+    const uint16_t inFlight = readSession.nextSeq - readSession.ackedSeq;
+    if (inFlight < 32) {
+      holes &= (1u << inFlight) - 1;
+    }
+    readSession.resend |= holes;
+  }
+}
+
+static void startWrite(const CRTPPacket* p) {
+  writeSession.active = false;
+  if (p->size < 10) {
+    sendStartResponse(MEM_BULK_CMD_WRITE_START, 0, EINVAL, MEM_BULK_MAX_WINDOW);
+    return;
+  }
+
+  const uint8_t memId = p->data[1];
+  uint32_t addr;
+  uint32_t len;
+  memcpy(&addr, &p->data[2], 4);
+  memcpy(&len, &p->data[6], 4);
+
+  if (!isRangeValid(memId, addr, len)) {
+    sendStartResponse(MEM_BULK_CMD_WRITE_START, memId, EINVAL, MEM_BULK_MAX_WINDOW);
+    return;
+  }
+
+  writeSession.memId = memId;
+  writeSession.addr = addr;
+  writeSession.len = len;
+  writeSession.chunkCount = (len + MEM_BULK_CHUNK_SIZE - 1) / MEM_BULK_CHUNK_SIZE;
+  writeSession.nextSeq = 0;
+  writeSession.received = 0;
+  writeSession.holeReported = false;
+  writeSession.chunksSinceAck = 0;
+  writeSession.active = true;
+
+  sendStartResponse(MEM_BULK_CMD_WRITE_START, memId, STATUS_OK, MEM_BULK_MAX_WINDOW);
+}
+
+static void handleWriteData(const CRTPPacket* p) {
+  if (!writeSession.active || p->size < 3) {
+    return;
+  }
+
+  uint16_t seq;
+  memcpy(&seq, &p->data[1], 2);
+  const uint8_t len = p->size - 3;
+
+  if (seq >= writeSession.chunkCount || len != chunkLength(writeSession.len, seq)) {
+    return;
+  }
+
+  // Duplicates and chunks outside of the window tell us that the client has
+  // not seen our latest state
+  const uint16_t offset = seq - writeSession.nextSeq;
+  if (seq < writeSession.nextSeq || offset >= MEM_BULK_MAX_WINDOW || (writeSession.received & (1u << offset))) {
+    sendWriteAck(STATUS_OK);
+    return;
+  }
+
+  const uint32_t memAddr = writeSession.addr + (uint32_t)seq * MEM_BULK_CHUNK_SIZE;
+  if (!writeMemory(writeSession.memId, memAddr, len, &p->data[3])) {
+    writeSession.active = false;
+    sendWriteAck(EIO);
+    return;
+  }
+  STATS_CNT_RATE_MULTI_EVENT(&writeRate, len);
+
+  writeSession.received |= (1u << offset);
+  writeSession.chunksSinceAck++;
+  while (writeSession.received & 1) {
+    writeSession.received >>= 1;
+    writeSession.nextSeq++;
+  }
+
+  if (writeSession.nextSeq == writeSession.chunkCount) {
+    writeSession.active = false;
+    sendWriteAck(STATUS_OK);
+  } else if (writeSession.received != 0 && !(writeSession.holeReported && writeSession.holeReportedSeq == writeSession.nextSeq)) {
+    writeSession.holeReported = true;
+    writeSession.holeReportedSeq = writeSession.nextSeq;
+    writeHoleCount++;
+    sendWriteAck(STATUS_OK);
+  } else if (writeSession.chunksSinceAck >= MEM_BULK_MAX_WINDOW / 2) {
+    sendWriteAck(STATUS_OK);
+  }
+}
+
+void crtpMemBulkProcess(CRTPPacket* p, const uint32_t nowMs) {
+  if (p->size < 1) {
+    return;
+  }
+
+  switch (p->data[0]) {
+    case MEM_BULK_CMD_READ_START:
+      startRead(p, nowMs);
+      break;
+    case MEM_BULK_CMD_READ_ACK:
+      handleReadAck(p, nowMs);
+      break;
+    case MEM_BULK_CMD_WRITE_START:
+      startWrite(p);
+      break;
+    case MEM_BULK_CMD_WRITE_DATA:
+      handleWriteData(p);
+      break;
+    case MEM_BULK_CMD_ABORT:
+      readSession.active = false;
+      writeSession.active = false;
+      p->size = 1;
+      crtpSendPacketBlock(p);
+      break;
+    default:
+      // Do nothing
+      break;
+  }
+}
+
+uint32_t crtpMemBulkRun(const uint32_t nowMs) {
+  if (!readSession.active) {
+    return MEM_BULK_WAIT_FOREVER;
+  }
+
+  if (readSession.resend) {
+    const int i = __builtin_ctz(readSession.resend);
+    readSession.resend &= ~(1u << i);
+    readSession.lastActivityMs = nowMs;
+    readResentCount++;
+    sendReadChunk(readSession.ackedSeq + i);
+    return 0;
+  }
+
+  if (readSession.nextSeq < readSession.chunkCount && (readSession.nextSeq - readSession.ackedSeq) < readSession.window) {
+    readSession.lastActivityMs = nowMs;
+    sendReadChunk(readSession.nextSeq);
+    readSession.nextSeq++;
+    return 0;
+  }
+
+  const uint32_t elapsed = nowMs - readSession.lastActivityMs;
+  if (elapsed < MEM_BULK_READ_TIMEOUT_MS) {
+    return MEM_BULK_READ_TIMEOUT_MS - elapsed;
+  }
+
+  readSession.timeouts++;
+  if (readSession.timeouts > MEM_BULK_READ_MAX_TIMEOUTS) {
+    readSession.active = false;
+    return MEM_BULK_WAIT_FOREVER;
+  }
+
+  // No ACK, send the oldest chunk that is not acknowledged again
+  readSession.resend |= 1;
+  readSession.lastActivityMs = nowMs;
+  return 0;
+}
+
+/**
+ * Throughput of bulk memory transfers
+ */
+LOG_GROUP_START(memBulk)
+/**
+ * @brief Bytes per second read from memories in bulk reads
+ */
+STATS_CNT_RATE_LOG_ADD(readRt, &readRate)
+/**
+ * @brief Bytes per second written to memories in bulk writes
+ */
+STATS_CNT_RATE_LOG_ADD(writeRt, &writeRate)
+/**
+ * @brief Number of chunks sent again in bulk reads
+ */
+LOG_ADD(LOG_UINT32, readResent, &readResentCount)
+/**
+ * @brief Number of holes detected in bulk writes
+ */
+LOG_ADD(LOG_UINT32, writeHoles, &writeHoleCount)
+LOG_GROUP_STOP(memBulk)
@@ -0,0 +1,68 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * crtp_tx_schedule.c - Selects the CRTP transmit priority class to send from
+ */
+
+#include <string.h>
+
+#include "crtp_tx_schedule.h"
+
+void crtpTxScheduleInit(crtpTxSchedule_t* this) {
+  memset(this, 0, sizeof(*this));
+}
+
+crtpTxPriority_t crtpTxScheduleNext(crtpTxSchedule_t* this, const bool hasPackets[CRTP_TX_PRIORITY_COUNT]) {
+  crtpTxPriority_t highest = CRTP_TX_PRIORITY_COUNT;
+  crtpTxPriority_t aged = CRTP_TX_PRIORITY_COUNT;
+
+  for (int i = 0; i < CRTP_TX_PRIORITY_COUNT; i++) {
+    if (!hasPackets[i]) {
+      this->skipped[i] = 0;
+      continue;
+    }
+
+    if (highest == CRTP_TX_PRIORITY_COUNT) {
+      highest = i;
+    } else if (aged == CRTP_TX_PRIORITY_COUNT && this->skipped[i] >= CRTP_TX_MAX_SKIPPED) {
+      aged = i;
+    }
+  }
+
+  crtpTxPriority_t selected = highest;
+  if (aged != CRTP_TX_PRIORITY_COUNT) {
+    selected = aged;
+    this->agedCount++;
+  }
+
+  // All classes with packets waiting that are not served this time are skipped
+  for (int i = 0; i < CRTP_TX_PRIORITY_COUNT; i++) {
+    if (i == (int)selected) {
+      this->skipped[i] = 0;
+    } else if (hasPackets[i] && this->skipped[i] < UINT16_MAX) {
+      this->skipped[i]++;
+    }
+  }
+
+  return selected;
+}
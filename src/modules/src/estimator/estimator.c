@@ -238,6 +238,20 @@ void estimatorEnqueue(const measurement_t *measurement) {
       eventTrigger_estSweepAngle_payload.sweepAngle = measurement->data.sweepAngle.measuredSweepAngle;
       eventTrigger(&eventTrigger_estSweepAngle);
       break;
+    case MeasurementTypeSweepAngleBatch:
+      for (int sensor = 0; sensor < SWEEP_ANGLE_BATCH_N_SENSORS; sensor++) {
+        for (int sweep = 0; sweep < SWEEP_ANGLE_BATCH_N_SWEEPS; sweep++) {
+          if (measurement->data.sweepAngleBatch.validMap & (1 << (sensor * SWEEP_ANGLE_BATCH_N_SWEEPS + sweep))) {
+            eventTrigger_estSweepAngle_payload.sensorId = sensor;
+            eventTrigger_estSweepAngle_payload.baseStationId = measurement->data.sweepAngleBatch.baseStationId;
+            eventTrigger_estSweepAngle_payload.sweepId = sweep;
+            eventTrigger_estSweepAngle_payload.t = measurement->data.sweepAngleBatch.context->t[sweep];
+            eventTrigger_estSweepAngle_payload.sweepAngle = measurement->data.sweepAngleBatch.measuredSweepAngles[sensor][sweep];
+            eventTrigger(&eventTrigger_estSweepAngle);
+          }
+        }
+      }
+      break;
     case MeasurementTypeGyroscope:
       // no payload needed, see gyro.{x,y,z}
       eventTrigger(&eventTrigger_estGyroscope);
@@ -58,6 +58,7 @@
 
 #include "kalman_core.h"
 #include "kalman_supervisor.h"
+#include "kalman_core_history.h"
 
 #include "FreeRTOS.h"
 #include "queue.h"
@@ -77,6 +78,8 @@
 
 #include "statsCnt.h"
 #include "rateSupervisor.h"
+#include "measurement_scheduler.h"
+#include "usec_time.h"
 
 // Measurement models
 #include "mm_distance.h"
@@ -124,6 +127,26 @@ const uint32_t PREDICTION_UPDATE_INTERVAL_MS = 1000 / PREDICT_RATE;
 static bool robustTwr = false;
 static bool robustTdoa = false;
 
+// Time budget for measurement updates in each cycle, 0 for no limit. Measurements that do not fit
+// in the budget are deferred to the next cycle, or dropped if too many are pending.
+static uint16_t updateBudgetUs = 0;
+
+// Scheduler priorities of the measurements that come in bursts, set through parameters. The defaults are the
+// same as in measurementSchedulerInit(), and the values are kept when the estimator is reset.
+static struct {
+  uint8_t tdoa;
+  uint8_t distance;
+  uint8_t sweepAngle;
+  uint8_t barometer;
+} schedulerPriorities = {
+  .tdoa = measurementPriorityNormal,
+  .distance = measurementPriorityNormal,
+  .sweepAngle = measurementPriorityNormal,
+  .barometer = measurementPriorityLow,
+};
+
+static void schedulerPrioritiesChanged(void);
+
 /**
  * Quadrocopter State
  *
@@ -151,6 +174,15 @@ static Axis3f gyroLatest;
 static OutlierFilterTdoaState_t outlierFilterTdoaState;
 static OutlierFilterLhState_t sweepOutlierFilterState;
 
+NO_DMA_CCM_SAFE_ZERO_INIT static measurementScheduler_t measurementScheduler;
+
+#ifdef CONFIG_ESTIMATOR_KALMAN_HISTORY
+// Recent states, used to fuse delayed measurements at the time they were taken
+NO_DMA_CCM_SAFE_ZERO_INIT static kalmanCoreHistory_t history;
+static const uint16_t historyBytes = sizeof(history);
+static uint16_t historyUpdateUs;
+#endif
+
 
 // Indicates that the internal state is corrupt and should be reset
 bool resetEstimation = false;
@@ -165,6 +197,9 @@ static state_t taskEstimatorState; // The estimator state produced by the task,
 static STATS_CNT_RATE_DEFINE(updateCounter, ONE_SECOND);
 static STATS_CNT_RATE_DEFINE(predictionCounter, ONE_SECOND);
 static STATS_CNT_RATE_DEFINE(finalizeCounter, ONE_SECOND);
+#ifdef CONFIG_ESTIMATOR_KALMAN_HISTORY
+static STATS_CNT_RATE_DEFINE(historyCounter, ONE_SECOND);
+#endif
 // static STATS_CNT_RATE_DEFINE(measurementAppendedCounter, ONE_SECOND);
 // static STATS_CNT_RATE_DEFINE(measurementNotAppendedCounter, ONE_SECOND);
 
@@ -181,6 +216,9 @@ static const bool useBaroUpdate = false;
 
 static void kalmanTask(void* parameters);
 static void updateQueuedMeasurements(const uint32_t nowMs, const bool quadIsFlying);
+static bool updateScheduledMeasurements(const uint32_t nowMs, const bool quadIsFlying, const uint64_t startUs);
+static void updateWithMeasurement(measurement_t* m, const uint32_t nowMs, const bool quadIsFlying);
+static void updateStateWithMeasurement(kalmanCoreData_t* data, measurement_t* m, const uint32_t nowMs, const bool quadIsFlying);
 
 STATIC_MEM_TASK_ALLOC_STACK_NO_DMA_CCM_SAFE(kalmanTask, KALMAN_TASK_STACKSIZE);
 
@@ -234,6 +272,9 @@ static void kalmanTask(void* parameters) {
       axis3fSubSamplerFinalize(&accSubSampler);
       axis3fSubSamplerFinalize(&gyroSubSampler);
 
+    #ifdef CONFIG_ESTIMATOR_KALMAN_HISTORY
+      kalmanCoreHistoryRecord(&history, &coreData, &accSubSampler.subSample, &gyroSubSampler.subSample, quadIsFlying);
+    #endif
       kalmanCorePredict(&coreData, &accSubSampler.subSample, &gyroSubSampler.subSample, nowMs, quadIsFlying);
       nextPredictionMs = nowMs + PREDICTION_UPDATE_INTERVAL_MS;
 
@@ -290,52 +331,17 @@ void estimatorKalman(state_t *state, const stabilizerStep_t stabilizerStep) {
 static void updateQueuedMeasurements(const uint32_t nowMs, const bool quadIsFlying) {
   /**
    * Sensor measurements can come in sporadically and faster than the stabilizer loop frequency,
-   * we therefore consume all measurements since the last loop, rather than accumulating
+   * we therefore consume all measurements since the last loop, rather than accumulating.
+   * The IMU samples are used right away, other measurements go through the scheduler and are
+   * used by priority as long as there is time left in the budget of the cycle.
    */
+  const uint64_t startUs = usecTimestamp();
+  bool isWithinBudget = true;
 
   // Pull the latest sensors values of interest; discard the rest
   measurement_t m;
   while (estimatorDequeue(&m)) {
     switch (m.type) {
-      case MeasurementTypeTDOA:
-        if(robustTdoa){
-          // robust KF update with TDOA measurements
-          kalmanCoreRobustUpdateWithTdoa(&coreData, &m.data.tdoa, &outlierFilterTdoaState);
-        }else{
-          // standard KF update
-          kalmanCoreUpdateWithTdoa(&coreData, &m.data.tdoa, nowMs, &outlierFilterTdoaState);
-        }
-        break;
-      case MeasurementTypePosition:
-        kalmanCoreUpdateWithPosition(&coreData, &m.data.position);
-        break;
-      case MeasurementTypePose:
-        kalmanCoreUpdateWithPose(&coreData, &m.data.pose);
-        break;
-      case MeasurementTypeDistance:
-        if(robustTwr){
-            // robust KF update with UWB TWR measurements
-            kalmanCoreRobustUpdateWithDistance(&coreData, &m.data.distance);
-        }else{
-            // standard KF update
-            kalmanCoreUpdateWithDistance(&coreData, &m.data.distance);
-        }
-        break;
-      case MeasurementTypeTOF:
-        kalmanCoreUpdateWithTof(&coreData, &m.data.tof);
-        break;
-      case MeasurementTypeAbsoluteHeight:
-        kalmanCoreUpdateWithAbsoluteHeight(&coreData, &m.data.height);
-        break;
-      case MeasurementTypeFlow:
-        kalmanCoreUpdateWithFlow(&coreData, &m.data.flow, &gyroLatest);
-        break;
-      case MeasurementTypeYawError:
-        kalmanCoreUpdateWithYawError(&coreData, &m.data.yawError);
-        break;
-      case MeasurementTypeSweepAngle:
-        kalmanCoreUpdateWithSweepAngles(&coreData, &m.data.sweepAngle, nowMs, &sweepOutlierFilterState);
-        break;
       case MeasurementTypeGyroscope:
         axis3fSubSamplerAccumulate(&gyroSubSampler, &m.data.gyroscope.gyro);
         gyroLatest = m.data.gyroscope.gyro;
@@ -344,15 +350,123 @@ static void updateQueuedMeasurements(const uint32_t nowMs, const bool quadIsFlyi
         axis3fSubSamplerAccumulate(&accSubSampler, &m.data.acceleration.acc);
         accLatest = m.data.acceleration.acc;
         break;
-      case MeasurementTypeBarometer:
-        if (useBaroUpdate) {
-          kalmanCoreUpdateWithBaro(&coreData, &coreParams, m.data.barometer.baro.asl, quadIsFlying);
-        }
-        break;
       default:
+        measurementSchedulerAdd(&measurementScheduler, &m);
+        if (isWithinBudget) {
+          isWithinBudget = updateScheduledMeasurements(nowMs, quadIsFlying, startUs);
+        }
         break;
     }
   }
+
+  // Measurements deferred from the previous cycle
+  if (isWithinBudget) {
+    updateScheduledMeasurements(nowMs, quadIsFlying, startUs);
+  }
+
+  measurementSchedulerDefer(&measurementScheduler);
+}
+
+// @return false if the time budget of the cycle is spent
+static bool updateScheduledMeasurements(const uint32_t nowMs, const bool quadIsFlying, const uint64_t startUs) {
+  measurement_t m;
+
+  while (true) {
+    if (updateBudgetUs > 0 && usecTimestamp() - startUs >= updateBudgetUs) {
+      return false;
+    }
+
+    if (!measurementSchedulerTake(&measurementScheduler, &m)) {
+      return true;
+    }
+
+    updateWithMeasurement(&m, nowMs, quadIsFlying);
+  }
+}
+
+#ifdef CONFIG_ESTIMATOR_KALMAN_HISTORY
+// The time when a measurement was taken, 0 if unknown
+static uint32_t measurementTimestamp(const measurement_t* m) {
+  switch (m->type) {
+    case MeasurementTypePosition:
+      return m->data.position.timestamp;
+    case MeasurementTypePose:
+      return m->data.pose.timestamp;
+    default:
+      return 0;
+  }
+}
+#endif
+
+static void updateWithMeasurement(measurement_t* m, const uint32_t nowMs, const bool quadIsFlying) {
+#ifdef CONFIG_ESTIMATOR_KALMAN_HISTORY
+  // Delayed measurements are fused at the time they were taken
+  kalmanCoreData_t* pastData = kalmanCoreHistoryRewind(&history, &coreData, measurementTimestamp(m));
+  if (pastData) {
+    const uint64_t startUs = usecTimestamp();
+    updateStateWithMeasurement(pastData, m, nowMs, quadIsFlying);
+    kalmanCoreHistoryApply(&history, &coreData);
+    historyUpdateUs = usecTimestamp() - startUs;
+    STATS_CNT_RATE_EVENT(&historyCounter);
+    return;
+  }
+#endif
+
+  updateStateWithMeasurement(&coreData, m, nowMs, quadIsFlying);
+}
+
+static void updateStateWithMeasurement(kalmanCoreData_t* data, measurement_t* m, const uint32_t nowMs, const bool quadIsFlying) {
+  switch (m->type) {
+    case MeasurementTypeTDOA:
+      if(robustTdoa){
+        // robust KF update with TDOA measurements
+        kalmanCoreRobustUpdateWithTdoa(data, &m->data.tdoa, &outlierFilterTdoaState);
+      }else{
+        // standard KF update
+        kalmanCoreUpdateWithTdoa(data, &m->data.tdoa, nowMs, &outlierFilterTdoaState);
+      }
+      break;
+    case MeasurementTypePosition:
+      kalmanCoreUpdateWithPosition(data, &m->data.position);
+      break;
+    case MeasurementTypePose:
+      kalmanCoreUpdateWithPose(data, &m->data.pose);
+      break;
+    case MeasurementTypeDistance:
+      if(robustTwr){
+          // robust KF update with UWB TWR measurements
+          kalmanCoreRobustUpdateWithDistance(data, &m->data.distance);
+      }else{
+          // standard KF update
+          kalmanCoreUpdateWithDistance(data, &m->data.distance);
+      }
+      break;
+    case MeasurementTypeTOF:
+      kalmanCoreUpdateWithTof(data, &m->data.tof);
+      break;
+    case MeasurementTypeAbsoluteHeight:
+      kalmanCoreUpdateWithAbsoluteHeight(data, &m->data.height);
+      break;
+    case MeasurementTypeFlow:
+      kalmanCoreUpdateWithFlow(data, &m->data.flow, &gyroLatest);
+      break;
+    case MeasurementTypeYawError:
+      kalmanCoreUpdateWithYawError(data, &m->data.yawError);
+      break;
+    case MeasurementTypeSweepAngle:
+      kalmanCoreUpdateWithSweepAngles(data, &m->data.sweepAngle, nowMs, &sweepOutlierFilterState);
+      break;
+    case MeasurementTypeSweepAngleBatch:
+      kalmanCoreUpdateWithSweepAngleBatch(data, &m->data.sweepAngleBatch, nowMs, &sweepOutlierFilterState);
+      break;
+    case MeasurementTypeBarometer:
+      if (useBaroUpdate) {
+        kalmanCoreUpdateWithBaro(data, &coreParams, m->data.barometer.baro.asl, quadIsFlying);
+      }
+      break;
+    default:
+      break;
+  }
 }
 
 // Called when this estimator is activated
@@ -363,6 +477,11 @@ void estimatorKalmanInit(void)
 
   outlierFilterTdoaReset(&outlierFilterTdoaState);
   outlierFilterLighthouseReset(&sweepOutlierFilterState, 0);
+  measurementSchedulerInit(&measurementScheduler);
+  schedulerPrioritiesChanged();
+#ifdef CONFIG_ESTIMATOR_KALMAN_HISTORY
+  kalmanCoreHistoryInit(&history);
+#endif
 
   uint32_t nowMs = T2M(xTaskGetTickCount());
   kalmanCoreInit(&coreData, &coreParams, nowMs);
@@ -383,6 +502,14 @@ void estimatorKalmanGetEstimatedRot(float * rotationMatrix) {
   memcpy(rotationMatrix, coreData.R, 9*sizeof(float));
 }
 
+void estimatorKalmanGetEstimatedPosCovariance(float covariance[3][3]) {
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      covariance[i][j] = coreData.P[KC_STATE_X + i][KC_STATE_X + j];
+    }
+  }
+}
+
 /**
  * Variables and results from the Extended Kalman Filter
  */
@@ -499,6 +626,160 @@ LOG_GROUP_START(kalman)
   * @brief Statistics rate full estimation step
   */
   STATS_CNT_RATE_LOG_ADD(rtFinal, &finalizeCounter)
+  /**
+  * @brief Number of TDoA measurements used, wraps around
+  */
+  LOG_ADD(LOG_UINT16, tdoaDone, &measurementScheduler.processedCount[MeasurementTypeTDOA])
+  /**
+  * @brief Number of times a TDoA measurement was deferred to the next cycle, wraps around
+  */
+  LOG_ADD(LOG_UINT16, tdoaDefer, &measurementScheduler.deferredCount[MeasurementTypeTDOA])
+  /**
+  * @brief Number of TDoA measurements dropped, wraps around
+  */
+  LOG_ADD(LOG_UINT16, tdoaDrop, &measurementScheduler.droppedCount[MeasurementTypeTDOA])
+  /**
+  * @brief Number of position measurements used, wraps around
+  */
+  LOG_ADD(LOG_UINT16, posDone, &measurementScheduler.processedCount[MeasurementTypePosition])
+  /**
+  * @brief Number of times a position measurement was deferred to the next cycle, wraps around
+  */
+  LOG_ADD(LOG_UINT16, posDefer, &measurementScheduler.deferredCount[MeasurementTypePosition])
+  /**
+  * @brief Number of position measurements dropped, wraps around
+  */
+  LOG_ADD(LOG_UINT16, posDrop, &measurementScheduler.droppedCount[MeasurementTypePosition])
+  /**
+  * @brief Number of pose measurements used, wraps around
+  */
+  LOG_ADD(LOG_UINT16, poseDone, &measurementScheduler.processedCount[MeasurementTypePose])
+  /**
+  * @brief Number of times a pose measurement was deferred to the next cycle, wraps around
+  */
+  LOG_ADD(LOG_UINT16, poseDefer, &measurementScheduler.deferredCount[MeasurementTypePose])
+  /**
+  * @brief Number of pose measurements dropped, wraps around
+  */
+  LOG_ADD(LOG_UINT16, poseDrop, &measurementScheduler.droppedCount[MeasurementTypePose])
+  /**
+  * @brief Number of distance measurements used, wraps around
+  */
+  LOG_ADD(LOG_UINT16, distDone, &measurementScheduler.processedCount[MeasurementTypeDistance])
+  /**
+  * @brief Number of times a distance measurement was deferred to the next cycle, wraps around
+  */
+  LOG_ADD(LOG_UINT16, distDefer, &measurementScheduler.deferredCount[MeasurementTypeDistance])
+  /**
+  * @brief Number of distance measurements dropped, wraps around
+  */
+  LOG_ADD(LOG_UINT16, distDrop, &measurementScheduler.droppedCount[MeasurementTypeDistance])
+  /**
+  * @brief Number of ToF measurements used, wraps around
+  */
+  LOG_ADD(LOG_UINT16, tofDone, &measurementScheduler.processedCount[MeasurementTypeTOF])
+  /**
+  * @brief Number of times a ToF measurement was deferred to the next cycle, wraps around
+  */
+  LOG_ADD(LOG_UINT16, tofDefer, &measurementScheduler.deferredCount[MeasurementTypeTOF])
+  /**
+  * @brief Number of ToF measurements dropped, wraps around
+  */
+  LOG_ADD(LOG_UINT16, tofDrop, &measurementScheduler.droppedCount[MeasurementTypeTOF])
+  /**
+  * @brief Number of absolute height measurements used, wraps around
+  */
+  LOG_ADD(LOG_UINT16, heightDone, &measurementScheduler.processedCount[MeasurementTypeAbsoluteHeight])
+  /**
+  * @brief Number of times a absolute height measurement was deferred to the next cycle, wraps around
+  */
+  LOG_ADD(LOG_UINT16, heightDefer, &measurementScheduler.deferredCount[MeasurementTypeAbsoluteHeight])
+  /**
+  * @brief Number of absolute height measurements dropped, wraps around
+  */
+  LOG_ADD(LOG_UINT16, heightDrop, &measurementScheduler.droppedCount[MeasurementTypeAbsoluteHeight])
+  /**
+  * @brief Number of flow measurements used, wraps around
+  */
+  LOG_ADD(LOG_UINT16, flowDone, &measurementScheduler.processedCount[MeasurementTypeFlow])
+  /**
+  * @brief Number of times a flow measurement was deferred to the next cycle, wraps around
+  */
+  LOG_ADD(LOG_UINT16, flowDefer, &measurementScheduler.deferredCount[MeasurementTypeFlow])
+  /**
+  * @brief Number of flow measurements dropped, wraps around
+  */
+  LOG_ADD(LOG_UINT16, flowDrop, &measurementScheduler.droppedCount[MeasurementTypeFlow])
+  /**
+  * @brief Number of yaw error measurements used, wraps around
+  */
+  LOG_ADD(LOG_UINT16, yawDone, &measurementScheduler.processedCount[MeasurementTypeYawError])
+  /**
+  * @brief Number of times a yaw error measurement was deferred to the next cycle, wraps around
+  */
+  LOG_ADD(LOG_UINT16, yawDefer, &measurementScheduler.deferredCount[MeasurementTypeYawError])
+  /**
+  * @brief Number of yaw error measurements dropped, wraps around
+  */
+  LOG_ADD(LOG_UINT16, yawDrop, &measurementScheduler.droppedCount[MeasurementTypeYawError])
+  /**
+  * @brief Number of sweep angle measurements used, wraps around
+  */
+  LOG_ADD(LOG_UINT16, sweepDone, &measurementScheduler.processedCount[MeasurementTypeSweepAngle])
+  /**
+  * @brief Number of times a sweep angle measurement was deferred to the next cycle, wraps around
+  */
+  LOG_ADD(LOG_UINT16, sweepDefer, &measurementScheduler.deferredCount[MeasurementTypeSweepAngle])
+  /**
+  * @brief Number of sweep angle measurements dropped, wraps around
+  */
+  LOG_ADD(LOG_UINT16, sweepDrop, &measurementScheduler.droppedCount[MeasurementTypeSweepAngle])
+  /**
+  * @brief Number of sweep angle batch measurements used, wraps around
+  */
+  LOG_ADD(LOG_UINT16, sweepBDone, &measurementScheduler.processedCount[MeasurementTypeSweepAngleBatch])
+  /**
+  * @brief Number of times a sweep angle batch measurement was deferred to the next cycle, wraps around
+  */
+  LOG_ADD(LOG_UINT16, sweepBDefer, &measurementScheduler.deferredCount[MeasurementTypeSweepAngleBatch])
+  /**
+  * @brief Number of sweep angle batch measurements dropped, wraps around
+  */
+  LOG_ADD(LOG_UINT16, sweepBDrop, &measurementScheduler.droppedCount[MeasurementTypeSweepAngleBatch])
+  /**
+  * @brief Number of barometer measurements used, wraps around
+  */
+  LOG_ADD(LOG_UINT16, baroDone, &measurementScheduler.processedCount[MeasurementTypeBarometer])
+  /**
+  * @brief Number of times a barometer measurement was deferred to the next cycle, wraps around
+  */
+  LOG_ADD(LOG_UINT16, baroDefer, &measurementScheduler.deferredCount[MeasurementTypeBarometer])
+  /**
+  * @brief Number of barometer measurements dropped, wraps around
+  */
+  LOG_ADD(LOG_UINT16, baroDrop, &measurementScheduler.droppedCount[MeasurementTypeBarometer])
+#ifdef CONFIG_ESTIMATOR_KALMAN_HISTORY
+  /**
+  * @brief Statistics rate of delayed measurements fused at the time they were taken
+  */
+  STATS_CNT_RATE_LOG_ADD(rtHist, &historyCounter)
+  /**
+  * @brief Number of delayed measurements older than the history, fused as current measurements, wraps around
+  */
+  LOG_ADD(LOG_UINT16, histOld, &history.tooOldCount)
+  /**
+  * @brief Number of prediction steps repeated for the latest delayed measurement
+  */
+  LOG_ADD(LOG_UINT8, histSteps, &history.latestSteps)
+  /**
+  * @brief Time used for the latest delayed measurement [us]
+  */
+  LOG_ADD(LOG_UINT16, histUs, &historyUpdateUs)
+  /**
+  * @brief Memory used by the history [bytes]
+  */
+  LOG_ADD(LOG_UINT16, histBytes, &historyBytes)
+#endif
 LOG_GROUP_STOP(kalman)
 
 LOG_GROUP_START(outlierf)
@@ -509,6 +790,21 @@ LOG_GROUP_STOP(outlierf)
  * Tuning parameters for the Extended Kalman Filter (EKF)
  *     estimator
  */
+static void setSchedulerPriority(const MeasurementType type, uint8_t* priority) {
+  if (*priority >= measurementPriorityCount) {
+    *priority = measurementPriorityLow;
+  }
+  measurementSchedulerSetPriority(&measurementScheduler, type, *priority);
+}
+
+static void schedulerPrioritiesChanged(void) {
+  setSchedulerPriority(MeasurementTypeTDOA, &schedulerPriorities.tdoa);
+  setSchedulerPriority(MeasurementTypeDistance, &schedulerPriorities.distance);
+  setSchedulerPriority(MeasurementTypeSweepAngle, &schedulerPriorities.sweepAngle);
+  setSchedulerPriority(MeasurementTypeSweepAngleBatch, &schedulerPriorities.sweepAngle);
+  setSchedulerPriority(MeasurementTypeBarometer, &schedulerPriorities.barometer);
+}
+
 PARAM_GROUP_START(kalman)
 /**
  * @brief Reset the kalman estimator
@@ -522,6 +818,31 @@ PARAM_GROUP_START(kalman)
  * @brief Nonzero to use robust TWR method (default: 0)
  */
   PARAM_ADD_CORE(PARAM_UINT8, robustTwr, &robustTwr)
+/**
+ * @brief Time budget for measurement updates in each cycle [us], 0 for no limit (default: 0).
+ * Measurements are used by priority, the ones that do not fit are deferred or dropped.
+ */
+  PARAM_ADD(PARAM_UINT16, updateBudgetUs, &updateBudgetUs)
+/**
+ * @brief Scheduler priority of TDoA measurements, 0 (high), 1 (normal) or 2 (low) (default: 1).
+ * Kept when the estimator is reset.
+ */
+  PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, prioTdoa, &schedulerPriorities.tdoa, schedulerPrioritiesChanged)
+/**
+ * @brief Scheduler priority of distance (TWR) measurements, 0 (high), 1 (normal) or 2 (low) (default: 1).
+ * Kept when the estimator is reset.
+ */
+  PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, prioDist, &schedulerPriorities.distance, schedulerPrioritiesChanged)
+/**
+ * @brief Scheduler priority of Lighthouse sweep angles, 0 (high), 1 (normal) or 2 (low) (default: 1).
+ * Kept when the estimator is reset.
+ */
+  PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, prioSweep, &schedulerPriorities.sweepAngle, schedulerPrioritiesChanged)
+/**
+ * @brief Scheduler priority of barometer measurements, 0 (high), 1 (normal) or 2 (low) (default: 2).
+ * Kept when the estimator is reset.
+ */
+  PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, prioBaro, &schedulerPriorities.barometer, schedulerPrioritiesChanged)
 /**
  * @brief Process noise for x and y acceleration
  */
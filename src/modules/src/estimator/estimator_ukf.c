@@ -50,7 +50,10 @@
  *
  */
 
+#include <string.h>
+
 #include "estimator_ukf.h"
+#include "estimator_ukf_kernels.h"
 #include "estimator.h"
 #include "kalman_supervisor.h"
 
@@ -62,6 +65,7 @@
 #include "semphr.h"
 #include "sensors.h"
 #include "static_mem.h"
+#include "autoconf.h"
 
 #include "system.h"
 #include "log.h"
@@ -84,7 +88,7 @@ static SemaphoreHandle_t runTaskSemaphore;
 static SemaphoreHandle_t dataMutex;
 static StaticSemaphore_t dataMutexBuffer;
 
-#define PREDICT_RATE RATE_100_HZ // this is slower than the IMU update rate of 500Hz
+#define PREDICT_RATE CONFIG_ESTIMATOR_UKF_PREDICT_RATE // up to the IMU update rate of 1000Hz
 #define BARO_RATE RATE_25_HZ
 
 #define MAX_COVARIANCE (100)
@@ -119,7 +123,7 @@ static STATS_CNT_RATE_DEFINE(measurementAppendedCounter, ONE_SECOND);
 static STATS_CNT_RATE_DEFINE(measurementNotAppendedCounter, ONE_SECOND);
 
 // for error filter version
-#define DIM_FILTER 9
+#define DIM_FILTER UKF_DIM_FILTER
 #define DIM_STRAPDOWN 10
 
 static float weight0 = 0.6f;
@@ -138,9 +142,24 @@ static uint8_t receivedAnchor;
 static float covNavFilter[DIM_FILTER][DIM_FILTER];
 
 static float xEst[DIM_FILTER] = {0.0f};
-static float sigmaPointsTempl[DIM_FILTER][DIM_FILTER + 2] = {0};
-static float sigmaPoints[DIM_FILTER][DIM_FILTER + 2] = {0};
-static float weights[DIM_FILTER + 2] = {0.0f};
+static float sigmaScales[DIM_FILTER] = {0};
+static float sigmaPoints[UKF_SIGMA_POINTS][DIM_FILTER] = {0};
+static float weights[UKF_SIGMA_POINTS] = {0.0f};
+// The sigma points are computed when needed and reused until the covariance or xEst change
+static bool sigmaPointsValid = false;
+
+// Scratch memory of the filter, only used by the UKF task
+typedef struct {
+  float factor[DIM_FILTER][DIM_FILTER];
+  float errorTransMat[DIM_FILTER][DIM_FILTER];
+  float outputs[UKF_SIGMA_POINTS];
+
+  // Scalar measurements of the same type, fused in one update
+  ukfBatch_t batch;
+  MeasurementType batchType;
+} ukfWorkspace_t;
+
+NO_DMA_CCM_SAFE_ZERO_INIT static ukfWorkspace_t workspace;
 
 
 static float accNed[3];
@@ -224,9 +243,9 @@ static void computeOutputBaro(float *output, float *state);
 
 static void computeOutputSweep(float *output, float *state, sweepAngleMeasurement_t *sweepInfo, float *xy);
 
-static bool ukfUpdate(float *Pxy, float *Pyy, float innovation);
+static bool prepareBatch(const MeasurementType type, const uint8_t count);
+static bool fuseBatch(void);
 static void computeSigmaPoints(void);
-static uint8_t cholesky(float *A, float *L, uint8_t n);
 static void quatToEuler(float *quat, float *eulerAngles);
 static void quatFromAtt(float *attVec, float *quat);
 static void directionCosineMatrix(float *quat, float *dcm);
@@ -327,6 +346,7 @@ static void errorUkfTask(void *parameters)
       covNavFilter[6][6] = stdDevInitialAtt * stdDevInitialAtt;
       covNavFilter[7][7] = stdDevInitialAtt * stdDevInitialAtt;
       covNavFilter[8][8] = stdDevInitialAtt * stdDevInitialAtt;
+      sigmaPointsValid = false;
 
       lastPrediction = xTaskGetTickCount();
     }
@@ -613,32 +633,10 @@ static void navigationInit(void)
   covNavFilter[8][8] = stdDevInitialAtt * stdDevInitialAtt;
 
   //______________________________________________________________________
-  //compute weights
-  for (jj = 0; jj < (DIM_FILTER+2); jj++)	{
-    for (ii = 0; ii < DIM_FILTER; ii++){
-      sigmaPointsTempl[ii][jj] = 0.0f;
-    }
-  }
-
-  //compute template sigma points normalized to mean 0 and covariance I
-  float tmp;
-  float weight1 = (1.0f-weight0)/((float)DIM_FILTER+1.0f);
-  weights[0] = weight0;
-  for (ii = 1; ii < (DIM_FILTER + 2); ii++)
-  {
-    weights[ii] = weight1;
-
-  }
-
-  for (ii = 0; ii < DIM_FILTER; ii++)
-  {
-    tmp = 1.0f/sqrtf(((float)ii+1.0f)*((float)ii+2.0f)*weight1);
-    for (jj = 1; jj < (ii + 2); jj++)
-    {
-      sigmaPointsTempl[ii][jj] = -tmp;
-    }
-    sigmaPointsTempl[ii][(ii+2)] = tmp*((float)ii+1.0f);
-  }
+  //compute weights of the sigma points, normalized to mean 0 and covariance I
+  ukfSigmaPointWeights(weight0, weights, sigmaScales);
+  sigmaPointsValid = false;
+  workspace.batch.count = 0;
 
   DEBUG_PRINT("Sigma Points chosen\n");
 }
@@ -648,19 +646,10 @@ static void predictNavigationFilter(float *stateNav, Axis3f *acc, Axis3f *gyro,
 {
   float accTs[3] = {acc->x * dt, acc->y * dt, acc->z * dt};
   float omegaTs[3] = {gyro->x * dt, gyro->y * dt, gyro->z * dt};
-  float covNew[DIM_FILTER][DIM_FILTER] = {0};
-  float errorTransMat[DIM_FILTER][DIM_FILTER] = {0};
-  float sigmaPointsTmp[DIM_FILTER][DIM_FILTER + 2] = {0};
+  float (*errorTransMat)[DIM_FILTER] = workspace.errorTransMat;
 
   // compute error State transition matrix
-  uint8_t ii, jj, kk;
-  for (ii = 0; ii < DIM_FILTER; ii++)
-  {
-    for (jj = 0; jj < DIM_FILTER; jj++)
-    {
-      errorTransMat[ii][jj] = 0.0f;
-    }
-  }
+  memset(workspace.errorTransMat, 0, sizeof(workspace.errorTransMat));
 
   //_________________________________________________________
   //Compute transition matrix for error state
@@ -698,93 +687,49 @@ static void predictNavigationFilter(float *stateNav, Axis3f *acc, Axis3f *gyro,
   errorTransMat[8][7] = -omegaTs[0];
   errorTransMat[8][8] = 1.0f;
 
-  // compute sigma points of UKF
+  // compute sigma points of UKF, reused if there was no update since the last prediction
   computeSigmaPoints();
 
-  // Predict Sigma Points
-  for (jj = 0; jj < (DIM_FILTER + 2); jj++)
-  {
-    for (ii = 0; ii < DIM_FILTER; ii++)
-    {
-      sigmaPointsTmp[ii][jj] = 0.0f;
-      for (kk = 0; kk < DIM_FILTER; kk++)
-      {
-        sigmaPointsTmp[ii][jj] = sigmaPointsTmp[ii][jj] + errorTransMat[ii][kk] * sigmaPoints[kk][jj];
-      }
-    }
-  }
-
-  // copy results to sigma points
-  for (jj = 0; jj < (DIM_FILTER+2); jj++)
-  {
-    for (ii = 0; ii < DIM_FILTER; ii++)
-    {
-      sigmaPoints[ii][jj] = sigmaPointsTmp[ii][jj];
-    }
-  }
-
-  for (ii = 0; ii < DIM_FILTER; ii++)
-  {
-    for (jj = 0; jj < DIM_FILTER; jj++)
-    {
-      covNew[ii][jj] = 0.0f;
-    }
-  }
+  // Predict Sigma Points and the covariance
   // initial error state is zero and we have a linear transition operation, e.g. state0 and xEst are zero so
   // diffsigma equals sigmapoints
-  for (kk = 0; kk < (DIM_FILTER + 2); kk++)
-  {
-    for (ii = 0; ii < DIM_FILTER; ii++)
-    {
-      for (jj = 0; jj < DIM_FILTER; jj++)
-      {
-        covNew[ii][jj] = covNew[ii][jj] + weights[kk] * (sigmaPoints[ii][kk] * sigmaPoints[jj][kk]);
-      }
-    }
-  }
+  ukfPropagate(workspace.errorTransMat, weights, sigmaPoints, covNavFilter);
 
   // account for process noise covariance Qk
-  covNew[0][0] += procA_h * dt * dt * dt * 0.33f;
-  covNew[1][1] += procA_h * dt * dt * dt * 0.33f;
-  covNew[2][2] += procA_z * dt * dt * dt * 0.33f;
-
-  covNew[0][3] += procA_h * dt * dt * 0.5f;
-  covNew[3][0] += procA_h * dt * dt * 0.5f;
-  covNew[1][4] += procA_h * dt * dt * 0.5f;
-  covNew[4][1] += procA_h * dt * dt * 0.5f;
-  covNew[2][5] += procA_z * dt * dt * 0.5f;
-  covNew[5][2] += procA_z * dt * dt * 0.5f;
-
-  covNew[3][3] += procA_h * dt;
-  covNew[4][4] += procA_h * dt;
-  covNew[5][5] += procA_z * dt;
-
-  covNew[6][6] += procRate_h * dt;
-  covNew[7][7] += procRate_h * dt;
-  covNew[8][8] += procRate_z * dt;
-
-  for (ii = 0; ii < DIM_FILTER; ii++)
-  {
-    for (jj = 0; jj < DIM_FILTER; jj++)
-    {
-      covNavFilter[ii][jj] = 0.5f * (covNew[ii][jj] + covNew[jj][ii]);
-    }
-  }
-
-  computeSigmaPoints();
+  covNavFilter[0][0] += procA_h * dt * dt * dt * 0.33f;
+  covNavFilter[1][1] += procA_h * dt * dt * dt * 0.33f;
+  covNavFilter[2][2] += procA_z * dt * dt * dt * 0.33f;
+
+  covNavFilter[0][3] += procA_h * dt * dt * 0.5f;
+  covNavFilter[3][0] += procA_h * dt * dt * 0.5f;
+  covNavFilter[1][4] += procA_h * dt * dt * 0.5f;
+  covNavFilter[4][1] += procA_h * dt * dt * 0.5f;
+  covNavFilter[2][5] += procA_z * dt * dt * 0.5f;
+  covNavFilter[5][2] += procA_z * dt * dt * 0.5f;
+
+  covNavFilter[3][3] += procA_h * dt;
+  covNavFilter[4][4] += procA_h * dt;
+  covNavFilter[5][5] += procA_z * dt;
+
+  covNavFilter[6][6] += procRate_h * dt;
+  covNavFilter[7][7] += procRate_h * dt;
+  covNavFilter[8][8] += procRate_z * dt;
+
+  // the sigma points are computed again when needed
+  sigmaPointsValid = false;
 }
 
 static bool updateQueuedMeasurements(const uint32_t tick, Axis3f *gyroAverage)
 {
-  uint8_t ii, jj, kk;
+  uint8_t jj;
 
   float Pyy = 0.0f;
-  float Pxy[DIM_FILTER] = {0};
 
   float xyz[3];
 
   float observation = 0.0f;
-  float outTmp, tmpSigmaVec[DIM_FILTER];
+  float outTmp;
+  float *outputs = workspace.outputs;
   float innovation, innoCheck;
   bool doneUpdate = false;
   float zeroState[DIM_FILTER] = {0};
@@ -827,40 +772,14 @@ static bool updateQueuedMeasurements(const uint32_t tick, Axis3f *gyroAverage)
           //_________________________________________________________________________________
           // UKF update - TDOA
           //_________________________________________________________________________________
-          // compute mean tdoa observation
-          observation = 0.0f;
-          for (jj = 0; jj < (DIM_FILTER + 2); jj++)
-          {
-            for (ii = 0; ii < DIM_FILTER; ii++)
-            {
-              tmpSigmaVec[ii] = sigmaPoints[ii][jj];
-            }
-            computeOutputTdoa(&outTmp, &tmpSigmaVec[0], &m.data.tdoa);
-            observation = observation + weights[jj] * outTmp;
-          }
+          doneUpdate |= prepareBatch(m.type, 1);
 
-          // initialize measurement and cross covariance
-          Pyy = 0.0f;
-          for (jj = 0; jj < DIM_FILTER; jj++)
+          // predicted tdoa observation of each sigma point, mean and covariance
+          for (jj = 0; jj < UKF_SIGMA_POINTS; jj++)
           {
-            Pxy[jj] = 0.0f;
-          }
-
-          // loop over all sigma points
-          for (jj = 0; jj < (DIM_FILTER + 2); jj++)
-          {
-            for (ii = 0; ii < DIM_FILTER; ii++)
-            {
-              tmpSigmaVec[ii] = sigmaPoints[ii][jj];
-            }
-            computeOutputTdoa(&outTmp, &tmpSigmaVec[0], &m.data.tdoa);
-            Pyy = Pyy + weights[jj] * (outTmp - observation) * (outTmp - observation);
-
-            for (kk = 0; kk < DIM_FILTER; kk++)
-            {
-              Pxy[kk] = Pxy[kk] + weights[jj] * (tmpSigmaVec[kk] - xEst[kk]) * (outTmp - observation);
-            }
+            computeOutputTdoa(&outputs[jj], sigmaPoints[jj], &m.data.tdoa);
           }
+          ukfOutputStatistics(outputs, weights, &observation, &Pyy);
 
           // Add TDOA Noise R
           Pyy = Pyy + m.data.tdoa.stdDev * m.data.tdoa.stdDev;
@@ -870,7 +789,7 @@ static bool updateQueuedMeasurements(const uint32_t tick, Axis3f *gyroAverage)
           if (outlierFilterTdoaValidateIntegrator(&outlierFilterTdoaState, &m.data.tdoa, innovation, nowMs))
           {
             //	if(innoCheck<qualGateTdoa){ // TdoA outlier rejection
-            ukfUpdate(&Pxy[0], &Pyy, innovation);
+            ukfBatchAdd(&workspace.batch, outputs, observation, innovation, m.data.tdoa.stdDev * m.data.tdoa.stdDev);
             //	}
           }
           break;
@@ -881,40 +800,14 @@ static bool updateQueuedMeasurements(const uint32_t tick, Axis3f *gyroAverage)
           //_________________________________________________________________________________
           if ((fabs(dcm[2][2]) > 0.1) && (dcm[2][2] > 0.0f))
           {
-            // compute mean tdoa observation
-            observation = 0.0f;
-            for (jj = 0; jj < (DIM_FILTER + 2); jj++)
-            {
-              for (ii = 0; ii < DIM_FILTER; ii++)
-              {
-                tmpSigmaVec[ii] = sigmaPoints[ii][jj];
-              }
-              computeOutputTof(&outTmp, &tmpSigmaVec[0]);
-              observation = observation + weights[jj] * outTmp;
-            }
+            doneUpdate |= prepareBatch(m.type, 1);
 
-            // initialize measurement and cross covariance
-            Pyy = 0.0f;
-            for (jj = 0; jj < DIM_FILTER; jj++)
+            // predicted tof observation of each sigma point, mean and covariance
+            for (jj = 0; jj < UKF_SIGMA_POINTS; jj++)
             {
-              Pxy[jj] = 0.0f;
-            }
-
-            // loop over all sigma points
-            for (jj = 0; jj < (DIM_FILTER + 2); jj++)
-            {
-              for (ii = 0; ii < DIM_FILTER; ii++)
-              {
-                tmpSigmaVec[ii] = sigmaPoints[ii][jj];
-              }
-              computeOutputTof(&outTmp, &tmpSigmaVec[0]);
-              Pyy = Pyy + weights[jj] * (outTmp - observation) * (outTmp - observation);
-
-              for (kk = 0; kk < DIM_FILTER; kk++)
-              {
-                Pxy[kk] = Pxy[kk] + weights[jj] * (tmpSigmaVec[kk] - xEst[kk]) * (outTmp - observation);
-              }
+              computeOutputTof(&outputs[jj], sigmaPoints[jj]);
             }
+            ukfOutputStatistics(outputs, weights, &observation, &Pyy);
 
             if (m.data.tof.distance < 0.03f)
             {
@@ -935,7 +828,7 @@ static bool updateQueuedMeasurements(const uint32_t tick, Axis3f *gyroAverage)
             // if an outlier is detected, flowActive flag prevents fusing optical flow too
             if (innoCheck < qualGateTof)
             {
-              ukfUpdate(&Pxy[0], &Pyy, innovation);
+              ukfBatchAdd(&workspace.batch, outputs, observation, innovation, (m.data.tof.stdDev) * (m.data.tof.stdDev));
               flowActive = true;
             }
             else
@@ -949,142 +842,54 @@ static bool updateQueuedMeasurements(const uint32_t tick, Axis3f *gyroAverage)
 
           if (flowActive)
           {
+            // body x and body y are fused together, from the same sigma points
+            doneUpdate |= prepareBatch(m.type, 2);
+
             //_________________________________________________________________________________
             // UKF update - Flow - body x
             //_________________________________________________________________________________
-            // compute mean tdoa observation
-            observation = 0.0f;
-            for (jj = 0; jj < (DIM_FILTER + 2); jj++)
-            {
-              for (ii = 0; ii < DIM_FILTER; ii++)
-              {
-                tmpSigmaVec[ii] = sigmaPoints[ii][jj];
-              }
-              computeOutputFlow_x(&outTmp, &tmpSigmaVec[0], &m.data.flow, gyroAverage);
-              observation = observation + weights[jj] * outTmp;
-            }
-
-            // initialize measurement and cross covariance
-            Pyy = 0.0f;
-            for (jj = 0; jj < DIM_FILTER; jj++)
+            for (jj = 0; jj < UKF_SIGMA_POINTS; jj++)
             {
-              Pxy[jj] = 0.0f;
+              computeOutputFlow_x(&outputs[jj], sigmaPoints[jj], &m.data.flow, gyroAverage);
             }
-
-            // loop over all sigma points
-            for (jj = 0; jj < (DIM_FILTER + 2); jj++)
-            {
-              for (ii = 0; ii < DIM_FILTER; ii++)
-              {
-                tmpSigmaVec[ii] = sigmaPoints[ii][jj];
-              }
-              computeOutputFlow_x(&outTmp, &tmpSigmaVec[0], &m.data.flow, gyroAverage);
-              Pyy = Pyy + weights[jj] * (outTmp - observation) * (outTmp - observation);
-
-              for (kk = 0; kk < DIM_FILTER; kk++)
-              {
-                Pxy[kk] = Pxy[kk] + weights[jj] * (tmpSigmaVec[kk] - xEst[kk]) * (outTmp - observation);
-              }
-            }
-
-            Pyy = Pyy + (m.data.flow.stdDevX) * (m.data.flow.stdDevX);
+            ukfOutputStatistics(outputs, weights, &observation, &Pyy);
 
             innovation = m.data.flow.dpixelx - observation;
             meas_NX = m.data.flow.dpixelx;
             pred_NX = observation;
 
-            ukfUpdate(&Pxy[0], &Pyy, innovation);
-
-            // compute sigma points of UKF after previous update in x Direction
-            computeSigmaPoints();
+            ukfBatchAdd(&workspace.batch, outputs, observation, innovation, (m.data.flow.stdDevX) * (m.data.flow.stdDevX));
 
             //_________________________________________________________________________________
             // UKF update - Flow - body y
             //_________________________________________________________________________________
-            // compute mean tdoa observation
-            observation = 0.0f;
-            for (jj = 0; jj < (DIM_FILTER + 2); jj++)
+            for (jj = 0; jj < UKF_SIGMA_POINTS; jj++)
             {
-              for (ii = 0; ii < DIM_FILTER; ii++)
-              {
-                tmpSigmaVec[ii] = sigmaPoints[ii][jj];
-              }
-              computeOutputFlow_y(&outTmp, &tmpSigmaVec[0], &m.data.flow, gyroAverage);
-              observation = observation + weights[jj] * outTmp;
+              computeOutputFlow_y(&outputs[jj], sigmaPoints[jj], &m.data.flow, gyroAverage);
             }
-
-            // initialize measurement and cross covariance
-            Pyy = 0.0f;
-            for (jj = 0; jj < DIM_FILTER; jj++)
-            {
-              Pxy[jj] = 0.0f;
-            }
-
-            // loop over all sigma points
-            for (jj = 0; jj < (DIM_FILTER + 2); jj++)
-            {
-              for (ii = 0; ii < DIM_FILTER; ii++)
-              {
-                tmpSigmaVec[ii] = sigmaPoints[ii][jj];
-              }
-              computeOutputFlow_y(&outTmp, &tmpSigmaVec[0], &m.data.flow, gyroAverage);
-              Pyy = Pyy + weights[jj] * (outTmp - observation) * (outTmp - observation);
-
-              for (kk = 0; kk < DIM_FILTER; kk++)
-              {
-                Pxy[kk] = Pxy[kk] + weights[jj] * (tmpSigmaVec[kk] - xEst[kk]) * (outTmp - observation);
-              }
-            }
-            // Add TOF Noise R
-            Pyy = Pyy + (m.data.flow.stdDevY) * (m.data.flow.stdDevY);
+            ukfOutputStatistics(outputs, weights, &observation, &Pyy);
 
             innovation = m.data.flow.dpixely - observation;
             meas_NY = m.data.flow.dpixely;
             pred_NY = observation;
 
-            ukfUpdate(&Pxy[0], &Pyy, innovation);
+            ukfBatchAdd(&workspace.batch, outputs, observation, innovation, (m.data.flow.stdDevY) * (m.data.flow.stdDevY));
           }
           break;
         case MeasurementTypeBarometer:
           //_________________________________________________________________________________
           // UKF update - Baro
           //_________________________________________________________________________________
-          // compute mean tdoa observation
           if (initializedNav)
           {
-            observation = 0.0f;
-            for (jj = 0; jj < (DIM_FILTER + 2); jj++)
-            {
-              for (ii = 0; ii < DIM_FILTER; ii++)
-              {
-                tmpSigmaVec[ii] = sigmaPoints[ii][jj];
-              }
-              computeOutputBaro(&outTmp, &tmpSigmaVec[0]);
-              observation = observation + weights[jj] * outTmp;
-            }
-
-            // initialize measurement and cross covariance
-            Pyy = 0.0f;
-            for (jj = 0; jj < DIM_FILTER; jj++)
-            {
-              Pxy[jj] = 0.0f;
-            }
+            doneUpdate |= prepareBatch(m.type, 1);
 
-            // loop over all sigma points
-            for (jj = 0; jj < (DIM_FILTER + 2); jj++)
+            // predicted baro observation of each sigma point, mean and covariance
+            for (jj = 0; jj < UKF_SIGMA_POINTS; jj++)
             {
-              for (ii = 0; ii < DIM_FILTER; ii++)
-              {
-                tmpSigmaVec[ii] = sigmaPoints[ii][jj];
-              }
-              computeOutputBaro(&outTmp, &tmpSigmaVec[0]);
-              Pyy = Pyy + weights[jj] * (outTmp - observation) * (outTmp - observation);
-
-              for (kk = 0; kk < DIM_FILTER; kk++)
-              {
-                Pxy[kk] = Pxy[kk] + weights[jj] * (tmpSigmaVec[kk] - xEst[kk]) * (outTmp - observation);
-              }
+              computeOutputBaro(&outputs[jj], sigmaPoints[jj]);
             }
+            ukfOutputStatistics(outputs, weights, &observation, &Pyy);
 
             // Add Baronoise R
             Pyy = Pyy + measNoiseBaro;
@@ -1094,7 +899,7 @@ static bool updateQueuedMeasurements(const uint32_t tick, Axis3f *gyroAverage)
 
             if (innoCheck < qualGateBaro)
             {
-              ukfUpdate(&Pxy[0], &Pyy, innovation);
+              ukfBatchAdd(&workspace.batch, outputs, observation, innovation, measNoiseBaro);
             }
           }
           break;
@@ -1111,40 +916,15 @@ static bool updateQueuedMeasurements(const uint32_t tick, Axis3f *gyroAverage)
           // Avoid singularity
           if (qNum > 0.0001f)
           {
-            // compute mean tdoa observation
-            observation = 0.0f;
-            for (jj = 0; jj < (DIM_FILTER + 2); jj++)
-            {
-              for (ii = 0; ii < DIM_FILTER; ii++)
-              {
-                tmpSigmaVec[ii] = sigmaPoints[ii][jj];
-              }
-              computeOutputSweep(&outTmp, &tmpSigmaVec[0], &m.data.sweepAngle, &xyz[0]);
-              observation = observation + weights[jj] * outTmp;
-            }
+            doneUpdate |= prepareBatch(m.type, 1);
 
-            // initialize measurement and cross covariance
-            Pyy = 0.0f;
-            for (jj = 0; jj < DIM_FILTER; jj++)
+            // predicted sweep angle of each sigma point, mean and covariance
+            for (jj = 0; jj < UKF_SIGMA_POINTS; jj++)
             {
-              Pxy[jj] = 0.0f;
+              computeOutputSweep(&outputs[jj], sigmaPoints[jj], &m.data.sweepAngle, &xyz[0]);
             }
+            ukfOutputStatistics(outputs, weights, &observation, &Pyy);
 
-            // loop over all sigma points
-            for (jj = 0; jj < (DIM_FILTER + 2); jj++)
-            {
-              for (ii = 0; ii < DIM_FILTER; ii++)
-              {
-                tmpSigmaVec[ii] = sigmaPoints[ii][jj];
-              }
-              computeOutputSweep(&outTmp, &tmpSigmaVec[0], &m.data.sweepAngle, &xyz[0]);
-              Pyy = Pyy + weights[jj] * (outTmp - observation) * (outTmp - observation);
-
-              for (kk = 0; kk < DIM_FILTER; kk++)
-              {
-                Pxy[kk] = Pxy[kk] + weights[jj] * (tmpSigmaVec[kk] - xEst[kk]) * (outTmp - observation);
-              }
-            }
             // Add Sweep angle Noise R
             Pyy = Pyy + m.data.sweepAngle.stdDev * m.data.sweepAngle.stdDev;
             innovation = m.data.sweepAngle.measuredSweepAngle - observation;
@@ -1153,7 +933,7 @@ static bool updateQueuedMeasurements(const uint32_t tick, Axis3f *gyroAverage)
             if (outlierFilterLighthouseValidateSweep(&sweepOutlierFilterState, r, innovation, tick))
             {
               //if(innoCheck<qualGateSweep){
-              ukfUpdate(&Pxy[0], &Pyy, innovation);
+              ukfBatchAdd(&workspace.batch, outputs, observation, innovation, m.data.sweepAngle.stdDev * m.data.sweepAngle.stdDev);
               //	}
             }
           }
@@ -1165,6 +945,44 @@ static bool updateQueuedMeasurements(const uint32_t tick, Axis3f *gyroAverage)
     }
   }
 
+  // The next prediction starts from a fully updated state
+  doneUpdate |= fuseBatch();
+
+  return doneUpdate;
+}
+
+// Make room for count measurements of a type in the batch. A batch of another
+// type is fused first. The sigma points are brought up to date for the new
+// measurements.
+static bool prepareBatch(const MeasurementType type, const uint8_t count)
+{
+  bool doneUpdate = false;
+
+  if ((workspace.batch.count > 0) && ((workspace.batchType != type) || (workspace.batch.count + count > UKF_MAX_BATCH)))
+  {
+    doneUpdate = fuseBatch();
+  }
+
+  workspace.batchType = type;
+  computeSigmaPoints();
+
+  return doneUpdate;
+}
+
+static bool fuseBatch(void)
+{
+  bool doneUpdate = false;
+
+  if (ukfBatchUpdate(&workspace.batch, sigmaPoints, weights, xEst, covNavFilter))
+  {
+    sigmaPointsValid = false;
+    if (useNavigationFilter)
+    {
+      resetNavigationStates();
+      doneUpdate = true;
+    }
+  }
+
   return doneUpdate;
 }
 
@@ -1290,78 +1108,26 @@ static void computeOutputSweep(float *output, float *state, sweepAngleMeasuremen
   output[0] = base - (sweepInfo->calib->phase + compGib);
 }
 
+// compute the sigma points from the covariance, unless they are up to date
 static void computeSigmaPoints(void)
 {
-  uint8_t ii, jj, kk;
-  float L[DIM_FILTER][DIM_FILTER] = {0};
-
-  cholesky(&covNavFilter[0][0], &L[0][0], DIM_FILTER);
-
-  for (jj = 0; jj < (DIM_FILTER + 2); jj++)
-  {
-    for (ii = 0; ii < DIM_FILTER; ii++)
-    {
-      sigmaPoints[ii][jj] = 0.0f;
-    }
-  }
-  // Compute actual sigma points taking into account current estimate and covariance
-  for (jj = 0; jj < (DIM_FILTER + 2); jj++)
-  {
-    for (ii = 0; ii < DIM_FILTER; ii++)
-    {
-
-      for (kk = 0; kk < DIM_FILTER; kk++)
-      {
-        sigmaPoints[ii][jj] = sigmaPoints[ii][jj] + L[ii][kk] * sigmaPointsTempl[kk][jj];
-      }
-      sigmaPoints[ii][jj] = sigmaPoints[ii][jj] + xEst[ii];
-    }
-  }
-}
-
-static bool ukfUpdate(float *Pxy, float *Pyy, float innovation)
-{
-  uint8_t ii, jj;
-  float Kk[DIM_FILTER] = {0};
-  float covNew[DIM_FILTER][DIM_FILTER] = {0};
-  float KkRKkTp[DIM_FILTER][DIM_FILTER] = {0};
-  bool doneUpdate = false;
-
-  for (ii = 0; ii < DIM_FILTER; ii++)
+  if (sigmaPointsValid)
   {
-    for (jj = 0; jj < DIM_FILTER; jj++)
-    {
-      covNew[ii][jj] = covNavFilter[ii][jj];
-    }
+    return;
   }
 
-  for (ii = 0; ii < DIM_FILTER; ii++)
+  memcpy(workspace.factor, covNavFilter, sizeof(workspace.factor));
+  if (ukfCholeskyInPlace(&workspace.factor[0][0], DIM_FILTER))
   {
-    Kk[ii] = Pxy[ii] / Pyy[0];
-    xEst[ii] = xEst[ii] + Kk[ii] * innovation;
+    ukfSigmaPoints(workspace.factor, sigmaScales, xEst, sigmaPoints);
   }
-  for (ii = 0; ii < DIM_FILTER; ii++)
-  {
-    for (jj = 0; jj < DIM_FILTER; jj++)
-    {
-      KkRKkTp[ii][jj] = Kk[ii] * Kk[jj] * Pyy[0];
-      covNew[ii][jj] = covNew[ii][jj] - KkRKkTp[ii][jj];
-    }
-  }
-  for (ii = 0; ii < DIM_FILTER; ii++)
+  else
   {
-    for (jj = 0; jj < DIM_FILTER; jj++)
-    {
-      covNavFilter[ii][jj] = 0.5f * covNew[ii][jj] + 0.5f * covNew[jj][ii];
-    }
+    // the covariance is not positive definite, keep the previous sigma points
+    nanCounterFilter++;
   }
 
-  if (useNavigationFilter)
-  {
-    resetNavigationStates();
-    doneUpdate = true;
-  }
-  return doneUpdate;
+  sigmaPointsValid = true;
 }
 
 // reset strapdown navigation after filter update step if measurements were obtained
@@ -1408,23 +1174,7 @@ static void resetNavigationStates()
 
     directionCosineMatrix(&quatRes[0], &dcm[0][0]);
     transposeMatrix(&dcm[0][0], &dcmTp[0][0]);
-    computeSigmaPoints();
-  }
-}
-
-static uint8_t cholesky(float *A, float *L, uint8_t n)
-{
-  for (uint8_t i = 0; i < n; i++)
-  {
-    for (uint8_t j = 0; j < (i + 1); j++)
-    {
-      float s = 0.0f;
-      for (uint8_t k = 0; k < j; k++)
-        s += L[i * n + k] * L[j * n + k];
-      L[i * n + j] = (i == j) ? sqrtf(A[i * n + i] - s) : (1.0f / L[j * n + j] * (A[i * n + j] - s));
-    }
   }
-  return 1;
 }
 
 static void transposeMatrix(float *mat, float *matTp)
@@ -0,0 +1,240 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * estimator_ukf_kernels.c - Numerical kernels of the error-state UKF
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "estimator_ukf_kernels.h"
+
+#define N UKF_DIM_FILTER
+#define S UKF_SIGMA_POINTS
+
+void ukfSigmaPointWeights(const float weight0, float weights[S], float scales[N]) {
+  const float weight1 = (1.0f - weight0) / ((float)N + 1.0f);
+
+  weights[0] = weight0;
+  for (int j = 1; j < S; j++) {
+    weights[j] = weight1;
+  }
+
+  // Normalized point j of dimension i is -scales[i] for 1 <= j <= i + 1,
+  // (i + 1) * scales[i] for j = i + 2 and zero otherwise
+  for (int i = 0; i < N; i++) {
+    scales[i] = 1.0f / sqrtf(((float)i + 1.0f) * ((float)i + 2.0f) * weight1);
+  }
+}
+
+bool ukfCholeskyInPlace(float* A, const uint8_t n) {
+  for (int j = 0; j < n; j++) {
+    float* rowJ = &A[j * n];
+
+    float diagonal = rowJ[j];
+    for (int k = 0; k < j; k++) {
+      diagonal -= rowJ[k] * rowJ[k];
+    }
+    if (!(diagonal > 0.0f)) {
+      return false;
+    }
+
+    const float l = sqrtf(diagonal);
+    const float inverse = 1.0f / l;
+    rowJ[j] = l;
+
+    for (int i = j + 1; i < n; i++) {
+      float* rowI = &A[i * n];
+      float sum = rowI[j];
+      for (int k = 0; k < j; k++) {
+        sum -= rowI[k] * rowJ[k];
+      }
+      rowI[j] = sum * inverse;
+      rowJ[i] = 0.0f;
+    }
+  }
+
+  return true;
+}
+
+void ukfSigmaPoints(const float L[N][N], const float scales[N], const float x[N], float sigma[S][N]) {
+  for (int i = 0; i < N; i++) {
+    sigma[0][i] = x[i];
+  }
+
+  // sigma[j][i] = x[i] - sum(L[i][k] * scales[k], k = j - 1..i) + (j - 1) * L[i][j - 2] * scales[j - 2],
+  // the sum is accumulated from the last sigma point and down
+  for (int i = 0; i < N; i++) {
+    const float* l = L[i];
+    float suffix = 0.0f;
+    for (int j = S - 1; j >= 1; j--) {
+      const int k = j - 1;
+      if (k <= i) {
+        suffix += l[k] * scales[k];
+      }
+
+      float value = x[i] - suffix;
+      if (j >= 2 && j - 2 <= i) {
+        value += (float)(j - 1) * l[j - 2] * scales[j - 2];
+      }
+      sigma[j][i] = value;
+    }
+  }
+}
+
+void ukfPropagate(const float F[N][N], const float weights[S], float sigma[S][N], float P[N][N]) {
+  for (int j = 0; j < S; j++) {
+    float* s = sigma[j];
+    float propagated[N];
+    for (int i = 0; i < N; i++) {
+      float sum = 0.0f;
+      for (int k = 0; k < N; k++) {
+        sum += F[i][k] * s[k];
+      }
+      propagated[i] = sum;
+    }
+    memcpy(s, propagated, sizeof(propagated));
+  }
+
+  for (int i = 0; i < N; i++) {
+    for (int k = i; k < N; k++) {
+      float sum = 0.0f;
+      for (int j = 0; j < S; j++) {
+        sum += weights[j] * sigma[j][i] * sigma[j][k];
+      }
+      P[i][k] = sum;
+      P[k][i] = sum;
+    }
+  }
+}
+
+void ukfOutputStatistics(const float outputs[S], const float weights[S], float* mean, float* variance) {
+  float m = 0.0f;
+  for (int j = 0; j < S; j++) {
+    m += weights[j] * outputs[j];
+  }
+
+  float v = 0.0f;
+  for (int j = 0; j < S; j++) {
+    const float d = outputs[j] - m;
+    v += weights[j] * d * d;
+  }
+
+  *mean = m;
+  *variance = v;
+}
+
+bool ukfBatchAdd(ukfBatch_t* batch, const float outputs[S], const float mean, const float innovation, const float noiseVariance) {
+  if (batch->count >= UKF_MAX_BATCH) {
+    return false;
+  }
+
+  float* y = batch->outputs[batch->count];
+  for (int j = 0; j < S; j++) {
+    y[j] = outputs[j] - mean;
+  }
+  batch->innovations[batch->count] = innovation;
+  batch->noiseVariances[batch->count] = noiseVariance;
+  batch->count++;
+
+  return true;
+}
+
+bool ukfBatchUpdate(ukfBatch_t* batch, const float sigma[S][N], const float weights[S], float x[N], float P[N][N]) {
+  const int m = batch->count;
+  batch->count = 0;
+  if (m == 0) {
+    return false;
+  }
+
+  // Cross covariance, one row per measurement
+  for (int r = 0; r < m; r++) {
+    const float* y = batch->outputs[r];
+    float* pxy = batch->Pxy[r];
+    for (int i = 0; i < N; i++) {
+      float sum = 0.0f;
+      for (int j = 0; j < S; j++) {
+        sum += weights[j] * (sigma[j][i] - x[i]) * y[j];
+      }
+      pxy[i] = sum;
+    }
+  }
+
+  // Innovation covariance, m x m
+  float* Pyy = batch->Pyy;
+  for (int r = 0; r < m; r++) {
+    for (int c = 0; c <= r; c++) {
+      float sum = (r == c) ? batch->noiseVariances[r] : 0.0f;
+      for (int j = 0; j < S; j++) {
+        sum += weights[j] * batch->outputs[r][j] * batch->outputs[c][j];
+      }
+      Pyy[r * m + c] = sum;
+    }
+  }
+
+  if (!ukfCholeskyInPlace(Pyy, m)) {
+    return false;
+  }
+
+  // With Pyy = L * L', U = inv(L) * Pxy' and v = inv(L) * innovation the gain
+  // is K = U' * inv(L), which gives x = x + U' * v and P = P - U' * U
+  float v[UKF_MAX_BATCH];
+  for (int r = 0; r < m; r++) {
+    float* u = batch->Pxy[r];
+    float innovation = batch->innovations[r];
+    for (int c = 0; c < r; c++) {
+      const float l = Pyy[r * m + c];
+      const float* uc = batch->Pxy[c];
+      for (int i = 0; i < N; i++) {
+        u[i] -= l * uc[i];
+      }
+      innovation -= l * v[c];
+    }
+
+    const float inverse = 1.0f / Pyy[r * m + r];
+    for (int i = 0; i < N; i++) {
+      u[i] *= inverse;
+    }
+    v[r] = innovation * inverse;
+  }
+
+  for (int r = 0; r < m; r++) {
+    const float* u = batch->Pxy[r];
+    for (int i = 0; i < N; i++) {
+      x[i] += u[i] * v[r];
+    }
+  }
+
+  for (int i = 0; i < N; i++) {
+    for (int k = i; k < N; k++) {
+      float sum = 0.5f * (P[i][k] + P[k][i]);
+      for (int r = 0; r < m; r++) {
+        sum -= batch->Pxy[r][i] * batch->Pxy[r][k];
+      }
+      P[i][k] = sum;
+      P[k][i] = sum;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,90 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * measurement_scheduler.c - Priority and time budget for estimator measurements
+ */
+
+#include <string.h>
+
+#include "measurement_scheduler.h"
+
+void measurementSchedulerInit(measurementScheduler_t* this) {
+  memset(this, 0, sizeof(*this));
+
+  for (int type = 0; type < MeasurementType_COUNT; type++) {
+    this->priorities[type] = measurementPriorityHigh;
+  }
+
+  this->priorities[MeasurementTypeTDOA] = measurementPriorityNormal;
+  this->priorities[MeasurementTypeDistance] = measurementPriorityNormal;
+  this->priorities[MeasurementTypeSweepAngle] = measurementPriorityNormal;
+  this->priorities[MeasurementTypeSweepAngleBatch] = measurementPriorityNormal;
+  this->priorities[MeasurementTypeBarometer] = measurementPriorityLow;
+}
+
+void measurementSchedulerSetPriority(measurementScheduler_t* this, const MeasurementType type, const measurementPriority_t priority) {
+  this->priorities[type] = priority;
+}
+
+bool measurementSchedulerAdd(measurementScheduler_t* this, const measurement_t* measurement) {
+  measurementRing_t* ring = &this->rings[this->priorities[measurement->type]];
+  bool isAdded = true;
+
+  if (ring->count == MEASUREMENT_SCHEDULER_LENGTH) {
+    this->droppedCount[ring->items[ring->head].type]++;
+    ring->head = (ring->head + 1) % MEASUREMENT_SCHEDULER_LENGTH;
+    ring->count--;
+    isAdded = false;
+  }
+
+  const uint8_t tail = (ring->head + ring->count) % MEASUREMENT_SCHEDULER_LENGTH;
+  ring->items[tail] = *measurement;
+  ring->count++;
+
+  return isAdded;
+}
+
+bool measurementSchedulerTake(measurementScheduler_t* this, measurement_t* measurement) {
+  for (int priority = 0; priority < measurementPriorityCount; priority++) {
+    measurementRing_t* ring = &this->rings[priority];
+    if (ring->count > 0) {
+      *measurement = ring->items[ring->head];
+      ring->head = (ring->head + 1) % MEASUREMENT_SCHEDULER_LENGTH;
+      ring->count--;
+      this->processedCount[measurement->type]++;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void measurementSchedulerDefer(measurementScheduler_t* this) {
+  for (int priority = 0; priority < measurementPriorityCount; priority++) {
+    const measurementRing_t* ring = &this->rings[priority];
+    for (int i = 0; i < ring->count; i++) {
+      const uint8_t index = (ring->head + i) % MEASUREMENT_SCHEDULER_LENGTH;
+      this->deferredCount[ring->items[index].type]++;
+    }
+  }
+}
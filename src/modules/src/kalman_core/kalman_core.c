@@ -56,6 +56,7 @@
  */
 
 #include "kalman_core.h"
+#include "kalman_core_kernels.h"
 #include "cfassert.h"
 #include "autoconf.h"
 
@@ -212,32 +213,21 @@ void kalmanCoreInit(kalmanCoreData_t *this, const kalmanCoreParams_t *params, co
 void kalmanCoreScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise)
 {
   // The Kalman gain as a column vector
-  NO_DMA_CCM_SAFE_ZERO_INIT static float K[KC_STATE_DIM];
-  static arm_matrix_instance_f32 Km = {KC_STATE_DIM, 1, (float *)K};
-
-  // Temporary matrices for the covariance updates
-  NO_DMA_CCM_SAFE_ZERO_INIT __attribute__((aligned(4))) static float tmpNN1d[KC_STATE_DIM * KC_STATE_DIM];
-  static arm_matrix_instance_f32 tmpNN1m = {KC_STATE_DIM, KC_STATE_DIM, tmpNN1d};
-
-  NO_DMA_CCM_SAFE_ZERO_INIT __attribute__((aligned(4))) static float tmpNN2d[KC_STATE_DIM * KC_STATE_DIM];
-  static arm_matrix_instance_f32 tmpNN2m = {KC_STATE_DIM, KC_STATE_DIM, tmpNN2d};
-
-  NO_DMA_CCM_SAFE_ZERO_INIT __attribute__((aligned(4))) static float tmpNN3d[KC_STATE_DIM * KC_STATE_DIM];
-  static arm_matrix_instance_f32 tmpNN3m = {KC_STATE_DIM, KC_STATE_DIM, tmpNN3d};
-
-  NO_DMA_CCM_SAFE_ZERO_INIT __attribute__((aligned(4))) static float HTd[KC_STATE_DIM * 1];
-  static arm_matrix_instance_f32 HTm = {KC_STATE_DIM, 1, HTd};
-
-  NO_DMA_CCM_SAFE_ZERO_INIT __attribute__((aligned(4))) static float PHTd[KC_STATE_DIM * 1];
-  static arm_matrix_instance_f32 PHTm = {KC_STATE_DIM, 1, PHTd};
+  float K[KC_STATE_DIM];
+  float PHTd[KC_STATE_DIM];
 
   ASSERT(Hm->numRows == 1);
   ASSERT(Hm->numCols == KC_STATE_DIM);
 
   // ====== INNOVATION COVARIANCE ======
 
-  mat_trans(Hm, &HTm);
-  mat_mult(&this->Pm, &HTm, &PHTm); // PH'
+  for (int i=0; i<KC_STATE_DIM; i++) { // PH'
+    float sum = 0;
+    for (int j=0; j<KC_STATE_DIM; j++) {
+      sum += this->P[i][j]*Hm->pData[j];
+    }
+    PHTd[i] = sum;
+  }
   float R = stdMeasNoise*stdMeasNoise;
   float HPHR = R; // HPH' + R
   for (int i=0; i<KC_STATE_DIM; i++) { // Add the element of HPH' to the above
@@ -254,11 +244,7 @@ void kalmanCoreScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm,
   assertStateNotNaN(this);
 
   // ====== COVARIANCE UPDATE ======
-  mat_mult(&Km, Hm, &tmpNN1m); // KH
-  for (int i=0; i<KC_STATE_DIM; i++) { tmpNN1d[KC_STATE_DIM*i+i] -= 1; } // KH - I
-  mat_trans(&tmpNN1m, &tmpNN2m); // (KH - I)'
-  mat_mult(&tmpNN1m, &this->Pm, &tmpNN3m); // (KH - I)*P
-  mat_mult(&tmpNN3m, &tmpNN2m, &this->Pm); // (KH - I)*P*(KH - I)'
+  kalmanCoreKernelScalarJoseph(this->P, Hm->pData, K); // (KH - I)*P*(KH - I)'
   assertStateNotNaN(this);
   // add the measurement variance and ensure boundedness and symmetry
   // TODO: Why would it hit these bounds? Needs to be investigated.
@@ -359,14 +345,6 @@ static void predictDt(kalmanCoreData_t* this, Axis3f *acc, Axis3f *gyro, float d
 
   // The linearized update matrix
   NO_DMA_CCM_SAFE_ZERO_INIT static float A[KC_STATE_DIM][KC_STATE_DIM];
-  static __attribute__((aligned(4))) arm_matrix_instance_f32 Am = { KC_STATE_DIM, KC_STATE_DIM, (float *)A}; // linearized dynamics for covariance update;
-
-  // Temporary matrices for the covariance updates
-  NO_DMA_CCM_SAFE_ZERO_INIT static float tmpNN1d[KC_STATE_DIM * KC_STATE_DIM];
-  static __attribute__((aligned(4))) arm_matrix_instance_f32 tmpNN1m = { KC_STATE_DIM, KC_STATE_DIM, tmpNN1d};
-
-  NO_DMA_CCM_SAFE_ZERO_INIT static float tmpNN2d[KC_STATE_DIM * KC_STATE_DIM];
-  static __attribute__((aligned(4))) arm_matrix_instance_f32 tmpNN2m = { KC_STATE_DIM, KC_STATE_DIM, tmpNN2d};
 
   float dt2 = dt*dt;
 
@@ -470,9 +448,7 @@ static void predictDt(kalmanCoreData_t* this, Axis3f *acc, Axis3f *gyro, float d
 
 
   // ====== COVARIANCE UPDATE ======
-  mat_mult(&Am, &this->Pm, &tmpNN1m); // A P
-  mat_trans(&Am, &tmpNN2m); // A'
-  mat_mult(&tmpNN1m, &tmpNN2m, &this->Pm); // A P A'
+  kalmanCoreKernelSandwich(A, this->P); // A P A'
   // Process noise is added after the return from the prediction step
 
   // ====== PREDICTION STEP ======
@@ -624,16 +600,9 @@ bool kalmanCoreFinalize(kalmanCoreData_t* this)
   }
 
 
-  // Matrix to rotate the attitude covariances once updated
-  NO_DMA_CCM_SAFE_ZERO_INIT static float A[KC_STATE_DIM][KC_STATE_DIM];
-  static arm_matrix_instance_f32 Am = {KC_STATE_DIM, KC_STATE_DIM, (float *)A};
-
-  // Temporary matrices for the covariance updates
-  NO_DMA_CCM_SAFE_ZERO_INIT static float tmpNN1d[KC_STATE_DIM * KC_STATE_DIM];
-  static arm_matrix_instance_f32 tmpNN1m = {KC_STATE_DIM, KC_STATE_DIM, tmpNN1d};
-
-  NO_DMA_CCM_SAFE_ZERO_INIT static float tmpNN2d[KC_STATE_DIM * KC_STATE_DIM];
-  static arm_matrix_instance_f32 tmpNN2m = {KC_STATE_DIM, KC_STATE_DIM, tmpNN2d};
+  // Matrix to rotate the attitude covariances once updated. Only the attitude
+  // error block is stored, the rest of the matrix is the identity
+  float A[3][3];
 
   // Incorporate the attitude error (Kalman filter state) with the attitude
   float v0 = this->S[KC_STATE_D0];
@@ -676,29 +645,19 @@ bool kalmanCoreFinalize(kalmanCoreData_t* this)
     float d1 = v1/2; // so we use a first order approximation to d0 = tan(|v0|/2)*v0/|v0|
     float d2 = v2/2;
 
-    A[KC_STATE_X][KC_STATE_X] = 1;
-    A[KC_STATE_Y][KC_STATE_Y] = 1;
-    A[KC_STATE_Z][KC_STATE_Z] = 1;
-
-    A[KC_STATE_PX][KC_STATE_PX] = 1;
-    A[KC_STATE_PY][KC_STATE_PY] = 1;
-    A[KC_STATE_PZ][KC_STATE_PZ] = 1;
-
-    A[KC_STATE_D0][KC_STATE_D0] =  1 - d1*d1/2 - d2*d2/2;
-    A[KC_STATE_D0][KC_STATE_D1] =  d2 + d0*d1/2;
-    A[KC_STATE_D0][KC_STATE_D2] = -d1 + d0*d2/2;
+    A[0][0] =  1 - d1*d1/2 - d2*d2/2;
+    A[0][1] =  d2 + d0*d1/2;
+    A[0][2] = -d1 + d0*d2/2;
 
-    A[KC_STATE_D1][KC_STATE_D0] = -d2 + d0*d1/2;
-    A[KC_STATE_D1][KC_STATE_D1] =  1 - d0*d0/2 - d2*d2/2;
-    A[KC_STATE_D1][KC_STATE_D2] =  d0 + d1*d2/2;
+    A[1][0] = -d2 + d0*d1/2;
+    A[1][1] =  1 - d0*d0/2 - d2*d2/2;
+    A[1][2] =  d0 + d1*d2/2;
 
-    A[KC_STATE_D2][KC_STATE_D0] =  d1 + d0*d2/2;
-    A[KC_STATE_D2][KC_STATE_D1] = -d0 + d1*d2/2;
-    A[KC_STATE_D2][KC_STATE_D2] = 1 - d0*d0/2 - d1*d1/2;
+    A[2][0] =  d1 + d0*d2/2;
+    A[2][1] = -d0 + d1*d2/2;
+    A[2][2] = 1 - d0*d0/2 - d1*d1/2;
 
-    mat_trans(&Am, &tmpNN1m); // A'
-    mat_mult(&Am, &this->Pm, &tmpNN2m); // AP
-    mat_mult(&tmpNN2m, &tmpNN1m, &this->Pm); //APA'
+    kalmanCoreKernelRotateAttitude(this->P, A); //APA'
   }
 
   // convert the new attitude to a rotation matrix, such that we can rotate body-frame velocity and acc
@@ -0,0 +1,154 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * kalman_core_history.c - Short history of the Kalman state for delayed measurements
+ */
+
+#include <string.h>
+#include "kalman_core_history.h"
+
+_Static_assert(KALMAN_CORE_HISTORY_LENGTH >= 1 && KALMAN_CORE_HISTORY_LENGTH <= UINT8_MAX, "Unsupported history length");
+
+// Handles wrap around of the time
+static bool isAtOrBefore(const uint32_t aMs, const uint32_t bMs) {
+  return (int32_t)(bMs - aMs) >= 0;
+}
+
+static void loadEntry(kalmanCoreData_t* dest, const kalmanCoreData_t* coreData, const kalmanCoreHistoryEntry_t* entry) {
+  memcpy(dest, coreData, sizeof(kalmanCoreData_t));
+  memcpy(dest->S, entry->S, sizeof(dest->S));
+  memcpy(dest->q, entry->q, sizeof(dest->q));
+  memcpy(dest->R, entry->R, sizeof(dest->R));
+  memcpy(dest->P, entry->P, sizeof(dest->P));
+  dest->Pm.pData = (float*)dest->P;
+  dest->lastPredictionMs = entry->timestampMs;
+  dest->isUpdated = false;
+}
+
+void kalmanCoreHistoryInit(kalmanCoreHistory_t* this) {
+  memset(this, 0, sizeof(kalmanCoreHistory_t));
+}
+
+void kalmanCoreHistoryRecord(kalmanCoreHistory_t* this, const kalmanCoreData_t* coreData, const Axis3f* acc, const Axis3f* gyro, const bool quadIsFlying) {
+  kalmanCoreHistoryEntry_t* entry = &this->entries[this->head];
+
+  entry->timestampMs = coreData->lastPredictionMs;
+  memcpy(entry->S, coreData->S, sizeof(entry->S));
+  memcpy(entry->q, coreData->q, sizeof(entry->q));
+  memcpy(entry->R, coreData->R, sizeof(entry->R));
+  memcpy(entry->P, coreData->P, sizeof(entry->P));
+  entry->acc = *acc;
+  entry->gyro = *gyro;
+  entry->quadIsFlying = quadIsFlying;
+
+  this->head = (this->head + 1) % KALMAN_CORE_HISTORY_LENGTH;
+  if (this->count < KALMAN_CORE_HISTORY_LENGTH) {
+    this->count++;
+  }
+}
+
+kalmanCoreData_t* kalmanCoreHistoryRewind(kalmanCoreHistory_t* this, const kalmanCoreData_t* coreData, const uint32_t timestampMs) {
+  if (timestampMs == 0 || this->count == 0 || isAtOrBefore(coreData->lastPredictionMs, timestampMs)) {
+    return 0;
+  }
+
+  // The latest entry at or before the measurement
+  for (int i = 0; i < this->count; i++) {
+    const uint8_t index = (this->head + KALMAN_CORE_HISTORY_LENGTH - 1 - i) % KALMAN_CORE_HISTORY_LENGTH;
+    if (isAtOrBefore(this->entries[index].timestampMs, timestampMs)) {
+      this->rewindIndex = index;
+      loadEntry(&this->updated, coreData, &this->entries[index]);
+      this->delayedCount++;
+      return &this->updated;
+    }
+  }
+
+  this->tooOldCount++;
+  return 0;
+}
+
+void kalmanCoreHistoryApply(kalmanCoreHistory_t* this, kalmanCoreData_t* coreData) {
+  kalmanCoreData_t* updated = &this->updated;
+  kalmanCoreData_t* reference = &this->reference;
+
+  loadEntry(reference, coreData, &this->entries[this->rewindIndex]);
+  kalmanCoreFinalize(updated);
+
+  // Predict both states to the current time with the recorded input
+  uint8_t index = this->rewindIndex;
+  uint8_t steps = 0;
+  while (true) {
+    kalmanCoreHistoryEntry_t* entry = &this->entries[index];
+    const uint8_t next = (index + 1) % KALMAN_CORE_HISTORY_LENGTH;
+    const bool isLatest = (next == this->head);
+    const uint32_t nextMs = isLatest ? coreData->lastPredictionMs : this->entries[next].timestampMs;
+
+    kalmanCorePredict(updated, &entry->acc, &entry->gyro, nextMs, entry->quadIsFlying);
+    kalmanCoreFinalize(updated);
+    kalmanCorePredict(reference, &entry->acc, &entry->gyro, nextMs, entry->quadIsFlying);
+    kalmanCoreFinalize(reference);
+    steps++;
+
+    if (isLatest) {
+      break;
+    }
+    index = next;
+  }
+  this->latestSteps = steps;
+
+  // Position in the global frame and velocity in the body frame
+  for (int i = KC_STATE_X; i <= KC_STATE_PZ; i++) {
+    coreData->S[i] += updated->S[i] - reference->S[i];
+  }
+
+  // The attitude difference as a rotation in the body frame, dq = conj(q_ref) * q_updated, added
+  // to the attitude error which is moved to the attitude when the state is finalized
+  const float* a = reference->q;
+  const float* b = updated->q;
+  const float dq0 = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+  const float dq1 = a[0] * b[1] - a[1] * b[0] - a[2] * b[3] + a[3] * b[2];
+  const float dq2 = a[0] * b[2] + a[1] * b[3] - a[2] * b[0] - a[3] * b[1];
+  const float dq3 = a[0] * b[3] - a[1] * b[2] + a[2] * b[1] - a[3] * b[0];
+  const float sign = (dq0 < 0.0f) ? -2.0f : 2.0f;
+  coreData->S[KC_STATE_D0] += sign * dq1;
+  coreData->S[KC_STATE_D1] += sign * dq2;
+  coreData->S[KC_STATE_D2] += sign * dq3;
+
+  // The covariance reduction. Measurements fused after the recorded state may
+  // already have reduced the variances of the current state, the reduction is
+  // then scaled down by the same ratio to keep the variances positive.
+  float scale = 1.0f;
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    if (coreData->P[i][i] < scale * reference->P[i][i]) {
+      scale = coreData->P[i][i] / reference->P[i][i];
+    }
+  }
+
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      coreData->P[i][j] += scale * (updated->P[i][j] - reference->P[i][j]);
+    }
+  }
+
+  coreData->isUpdated = true;
+}
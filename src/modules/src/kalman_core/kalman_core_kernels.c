@@ -0,0 +1,118 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * kalman_core_kernels.c - Covariance kernels specialized for the state dimension
+ */
+
+#include "kalman_core_kernels.h"
+#include "static_mem.h"
+
+// The unrolled products below are written for this size
+_Static_assert(KC_STATE_DIM == 9, "The Kalman kernels are specialized for 9 states");
+
+#define N KC_STATE_DIM
+
+// Inner product of two rows
+#define DOT_ROWS(a, b) \
+  ((a)[0] * (b)[0] + (a)[1] * (b)[1] + (a)[2] * (b)[2] + \
+   (a)[3] * (b)[3] + (a)[4] * (b)[4] + (a)[5] * (b)[5] + \
+   (a)[6] * (b)[6] + (a)[7] * (b)[7] + (a)[8] * (b)[8])
+
+// Inner product of a row and column j of a matrix
+#define DOT_ROW_COL(a, B, j) \
+  ((a)[0] * (B)[0][j] + (a)[1] * (B)[1][j] + (a)[2] * (B)[2][j] + \
+   (a)[3] * (B)[3][j] + (a)[4] * (B)[4][j] + (a)[5] * (B)[5][j] + \
+   (a)[6] * (B)[6][j] + (a)[7] * (B)[7][j] + (a)[8] * (B)[8][j])
+
+// Scratch memory, the kernels are only called from the estimator task
+NO_DMA_CCM_SAFE_ZERO_INIT static float tmpNN[N][N];
+
+void kalmanCoreKernelSandwich(const float A[N][N], float P[N][N]) {
+  // tmp = A * P, row by row
+  for (int i = 0; i < N; i++) {
+    const float* a = A[i];
+    float* restrict t = tmpNN[i];
+    for (int j = 0; j < N; j++) {
+      t[j] = DOT_ROW_COL(a, P, j);
+    }
+  }
+
+  // P = tmp * A', the rows of A are the columns of A'
+  for (int i = 0; i < N; i++) {
+    const float* t = tmpNN[i];
+    float* restrict p = P[i];
+    for (int j = 0; j < N; j++) {
+      p[j] = DOT_ROWS(t, A[j]);
+    }
+  }
+}
+
+void kalmanCoreKernelScalarJoseph(float P[N][N], const float h[N], const float K[N]) {
+  float hP[N];
+  float Ph[N];
+
+  for (int j = 0; j < N; j++) {
+    hP[j] = DOT_ROW_COL(h, P, j);
+  }
+
+  for (int i = 0; i < N; i++) {
+    Ph[i] = DOT_ROWS(P[i], h);
+  }
+
+  const float hPh = DOT_ROWS(h, Ph);
+
+  for (int i = 0; i < N; i++) {
+    const float Ki = K[i];
+    const float Phi = Ph[i];
+    const float hPhKi = hPh * Ki;
+    float* restrict p = P[i];
+    for (int j = 0; j < N; j++) {
+      p[j] += hPhKi * K[j] - Ki * hP[j] - Phi * K[j];
+    }
+  }
+}
+
+void kalmanCoreKernelRotateAttitude(float P[N][N], const float R[3][3]) {
+  const int d = KC_STATE_D0;
+
+  // Columns of the attitude error, P[i][d..] = P[i][d..] * R' for all rows
+  for (int i = 0; i < N; i++) {
+    float* p = &P[i][d];
+    const float p0 = p[0];
+    const float p1 = p[1];
+    const float p2 = p[2];
+    p[0] = p0 * R[0][0] + p1 * R[0][1] + p2 * R[0][2];
+    p[1] = p0 * R[1][0] + p1 * R[1][1] + p2 * R[1][2];
+    p[2] = p0 * R[2][0] + p1 * R[2][1] + p2 * R[2][2];
+  }
+
+  // Rows of the attitude error, P[d..][j] = R * P[d..][j] for all columns
+  for (int j = 0; j < N; j++) {
+    const float p0 = P[d][j];
+    const float p1 = P[d + 1][j];
+    const float p2 = P[d + 2][j];
+    P[d][j] = R[0][0] * p0 + R[0][1] * p1 + R[0][2] * p2;
+    P[d + 1][j] = R[1][0] * p0 + R[1][1] * p1 + R[1][2] * p2;
+    P[d + 2][j] = R[2][0] * p0 + R[2][1] * p1 + R[2][2] * p2;
+  }
+}
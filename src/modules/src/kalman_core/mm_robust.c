@@ -0,0 +1,225 @@
+/**
+ * This robust M-estimation-based Kalman filter was originally implemented in
+ * work by the Dynamic Systems Lab (DSL) at the University of Toronto
+ * Institute for Aerospace Studies (UTIAS) and the Vector Institute for
+ * Artificial Intelligence, Toronto, ON, Canada.
+ *
+ * It can be cited as:
+   @ARTICLE{Zhao2021Learningbased,
+    author={Zhao, Wenda and Panerati, Jacopo and Schoellig, Angela P.},
+    title={Learning-based Bias Correction for Time Difference of Arrival
+           Ultra-wideband Localization of Resource-constrained Mobile Robots},
+    journal={IEEE Robotics and Automation Letters},
+    year={2021},
+    publisher={IEEE}}
+ *
+ */
+
+/*
+Iteratively reweighted robust update
+
+In each iteration the covariance is rescaled as P_w = L * inv(W_x) * L', where
+L is the Cholesky factor of the covariance used in the previous iteration and
+W_x is a diagonal matrix of weights. Since W_x is diagonal, the Cholesky factor
+of P_w is L * inv(W_x)^(1/2), that is L with scaled columns. The covariance
+is therefore only factored once per measurement and the rescaling is tracked as
+a vector of column scales s, P_w = L0 * diag(s) * L0'.
+
+The error state is zero at the start of each update, which makes the weights of
+the first iteration equal to one.
+*/
+
+#include <string.h>
+
+#include "mm_robust.h"
+#include "test_support.h"
+
+#define MAX_ITER (2) // maximum iteration is set to 2.
+#define UPPER_BOUND (100)
+#define LOWER_BOUND (-100)
+
+// Scratch memory shared by all robust measurement models. The updates are
+// only called from the estimator task.
+static struct {
+  float L[KC_STATE_DIM][KC_STATE_DIM];
+  float Pw[KC_STATE_DIM][KC_STATE_DIM];
+  float K[KC_STATE_DIM];
+  float h[KC_STATE_DIM];
+} scratch;
+
+static arm_matrix_instance_f32 Pwm = {KC_STATE_DIM, KC_STATE_DIM, (float *)scratch.Pw};
+static arm_matrix_instance_f32 Km = {KC_STATE_DIM, 1, (float *)scratch.K};
+static arm_matrix_instance_f32 Hm = {1, KC_STATE_DIM, (float *)scratch.h};
+
+// Cholesky Decomposition for a nxn psd matrix, the result is made numerically
+// stable for the triangular solves
+static void choleskyDecomposition(const float matrix[KC_STATE_DIM][KC_STATE_DIM], float lower[KC_STATE_DIM][KC_STATE_DIM]) {
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j <= i; j++) {
+      float sum = 0.0f;
+      for (int k = 0; k < j; k++) {
+        sum += lower[i][k] * lower[j][k];
+      }
+
+      if (j == i) {
+        lower[i][i] = sqrtf(matrix[i][i] - sum);
+      } else {
+        lower[i][j] = (matrix[i][j] - sum) / lower[j][j];
+      }
+    }
+
+    for (int j = i + 1; j < KC_STATE_DIM; j++) {
+      lower[i][j] = 0.0f;
+    }
+  }
+
+  for (int col = 0; col < KC_STATE_DIM; col++) {
+    for (int row = col; row < KC_STATE_DIM; row++) {
+      if (isnan(lower[row][col]) || lower[row][col] > UPPER_BOUND) {
+        lower[row][col] = UPPER_BOUND;
+      } else if (row != col && lower[row][col] < LOWER_BOUND) {
+        lower[row][col] = LOWER_BOUND;
+      } else if (row == col && lower[row][col] < 0.0f) {
+        lower[row][col] = 0.0f;
+      }
+    }
+  }
+
+  // Add small values on the diagonal to avoid division by zero in the solves
+  for (int k = 0; k < KC_STATE_DIM; k++) {
+    lower[k][k] += 1e-9f;
+  }
+}
+
+// Solves L * x = b
+static void forwardSubstitution(const float L[KC_STATE_DIM][KC_STATE_DIM], const float b[KC_STATE_DIM], float x[KC_STATE_DIM]) {
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    float sum = b[i];
+    for (int k = 0; k < i; k++) {
+      sum -= L[i][k] * x[k];
+    }
+    x[i] = sum / L[i][i];
+  }
+}
+
+/* Weight function for GM Robust cost function
+ * General guidelines for hyperparameter tuning:
+ * For a given measurement error e, decreasing the sigma of the GM weight function will set a
+ * smaller weight to this error e. Then, the variance of this measurement will increase, indicating
+ * a large measurement uncertainty.
+ * Intuitively, a small sigma means you trust the measurements more.
+*/
+static float gmWeight(const float e, const float sigma) {
+  const float gmDn = sigma + e * e;
+  return (sigma * sigma) / (gmDn * gmDn);
+}
+
+void kalmanCoreRobustScalarUpdate(kalmanCoreData_t* this, kalmanCoreRobustMeasurementModel_t model, const void* measurement, const float measured, const float stdDev, const float measurementSigma, const float stateSigma) {
+  float* h = scratch.h;
+  float* K = scratch.K;
+  memset(h, 0, sizeof(scratch.h));
+
+  float predicted = 0.0f;
+  if (!model(this->S, measurement, &predicted, h)) {
+    return;
+  }
+
+  // Innovation based on the prior state, does not change during the iterations
+  const float errorCheck = measured - predicted;
+
+  choleskyDecomposition(this->P, scratch.L);
+
+  // Column scales of the Cholesky factor, P_w = L * diag(s) * L'
+  float s[KC_STATE_DIM];
+  // Error state of the current iteration
+  float xErr[KC_STATE_DIM];
+  float xState[KC_STATE_DIM];
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    s[i] = 1.0f;
+    xErr[i] = 0.0f;
+  }
+  memcpy(xState, this->S, sizeof(xState));
+
+  float rIter = stdDev * stdDev;
+
+  for (int iter = 0; iter < MAX_ITER; iter++) {
+    if (iter > 0) {
+      // Linearize around the iterated state
+      if (!model(xState, measurement, &predicted, h)) {
+        continue;
+      }
+    }
+
+    // Normalized measurement error
+    const float rChol = sqrtf(rIter);
+    const float errorIter = measured - predicted;
+    float eY = 0.0f;
+    if (fabsf(rChol) < 0.0001f) {
+      eY = errorIter / 0.0001f;
+    } else {
+      eY = errorIter / rChol;
+    }
+
+    // Normalized state error, e_x = inv(L * diag(s)^(1/2)) * x_err, and
+    // rescaling of the covariance by the inverse of the weights
+    float eX[KC_STATE_DIM];
+    forwardSubstitution(scratch.L, xErr, eX);
+    for (int i = 0; i < KC_STATE_DIM; i++) {
+      eX[i] /= sqrtf(s[i]);
+      s[i] /= gmWeight(eX[i], stateSigma);
+    }
+
+    // Rescale R
+    const float wY = gmWeight(eY, measurementSigma);
+    float rW = 0.0f;
+    if (fabsf(wY) < 0.0001f) {
+      rW = (rChol * rChol) / 0.0001f;
+    } else {
+      rW = (rChol * rChol) / wY;
+    }
+
+    // P_w * H' = L * diag(s) * (L' * H')
+    float v[KC_STATE_DIM];
+    for (int i = 0; i < KC_STATE_DIM; i++) {
+      float sum = 0.0f;
+      for (int k = i; k < KC_STATE_DIM; k++) {
+        sum += scratch.L[k][i] * h[k];
+      }
+      v[i] = sum;
+    }
+
+    // HPH' + R
+    float hphr = rW;
+    for (int i = 0; i < KC_STATE_DIM; i++) {
+      hphr += s[i] * v[i] * v[i];
+      v[i] *= s[i];
+    }
+
+    // Kalman gain and the error state for the next iteration
+    for (int i = 0; i < KC_STATE_DIM; i++) {
+      float pht = 0.0f;
+      for (int k = 0; k <= i; k++) {
+        pht += scratch.L[i][k] * v[k];
+      }
+      K[i] = pht / hphr;
+      xErr[i] = K[i] * errorCheck;
+      xState[i] = this->S[i] + xErr[i];
+    }
+
+    rIter = rW;
+  }
+
+  // P_w = L * diag(s) * L'
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j <= i; j++) {
+      float sum = 0.0f;
+      for (int k = 0; k <= j; k++) {
+        sum += scratch.L[i][k] * s[k] * scratch.L[j][k];
+      }
+      scratch.Pw[i][j] = sum;
+      scratch.Pw[j][i] = sum;
+    }
+  }
+
+  kalmanCoreUpdateWithPKE(this, &Hm, &Km, &Pwm, errorCheck);
+}
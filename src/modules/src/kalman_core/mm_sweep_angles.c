@@ -91,3 +91,31 @@ void kalmanCoreUpdateWithSweepAngles(kalmanCoreData_t *this, sweepAngleMeasureme
     }
   }
 }
+
+void kalmanCoreUpdateWithSweepAngleBatch(kalmanCoreData_t *this, const sweepAngleBatchMeasurement_t *batch, const uint32_t nowMs, OutlierFilterLhState_t* sweepOutlierFilterState) {
+  const sweepAngleBatchContext_t* context = batch->context;
+
+  sweepAngleMeasurement_t sweepInfo;
+  sweepInfo.timestamp = batch->timestamp;
+  sweepInfo.rotorPos = context->rotorPos;
+  sweepInfo.rotorRot = context->rotorRot;
+  sweepInfo.rotorRotInv = context->rotorRotInv;
+  sweepInfo.baseStationId = batch->baseStationId;
+  sweepInfo.stdDev = context->stdDev;
+  sweepInfo.calibrationMeasurementModel = context->calibrationMeasurementModel;
+
+  for (int sensor = 0; sensor < SWEEP_ANGLE_BATCH_N_SENSORS; sensor++) {
+    sweepInfo.sensorId = sensor;
+    sweepInfo.sensorPos = &context->sensorPos[sensor];
+
+    for (int sweep = 0; sweep < SWEEP_ANGLE_BATCH_N_SWEEPS; sweep++) {
+      if (batch->validMap & (1 << (sensor * SWEEP_ANGLE_BATCH_N_SWEEPS + sweep))) {
+        sweepInfo.sweepId = sweep;
+        sweepInfo.t = context->t[sweep];
+        sweepInfo.calib = &context->calib[sweep];
+        sweepInfo.measuredSweepAngle = batch->measuredSweepAngles[sensor][sweep];
+        kalmanCoreUpdateWithSweepAngles(this, &sweepInfo, nowMs, sweepOutlierFilterState);
+      }
+    }
+  }
+}
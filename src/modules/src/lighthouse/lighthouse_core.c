@@ -86,6 +86,7 @@ static bool uartSynchronized = false;
 
 #ifdef CONFIG_DEBUG_LOG_ENABLE
 static STATS_CNT_RATE_DEFINE(serialFrameRate, ONE_SECOND);
+static STATS_CNT_RATE_DEFINE(uartBurstRate, ONE_SECOND);
 static STATS_CNT_RATE_DEFINE(frameRate, ONE_SECOND);
 static STATS_CNT_RATE_DEFINE(cycleRate, ONE_SECOND);
 
@@ -230,29 +231,62 @@ void lighthouseCoreSetSystemType(const lighthouseBaseStationType_t type)
 }
 
 #define OPTIMIZE_UART1_ACCESS 1
-TESTABLE_STATIC bool getUartFrameRaw(lighthouseUartFrame_t *frame) {
-  static char data[UART_FRAME_LENGTH];
-  int syncCounter = 0;
 
-  #ifdef OPTIMIZE_UART1_ACCESS
-    // Wait until there is enough data available in the queue before reading
-    // to optimize the CPU usage. Locking on the queue (as is done in uart1GetDataWithTimeout()) seems to take a lot
-    // of time and the vTaskDelay() solution uses much less CPU.
-  while (uart1bytesAvailable() < UART_FRAME_LENGTH) {
+#ifdef OPTIMIZE_UART1_ACCESS
+// Frames are read from the UART in bursts of all complete frames that are available, but not more than
+// UART_FRAME_BURST_SIZE frames. This bounds the work done per burst and the burst fits in the uart1 queue.
+// The frames of a burst are then decoded one by one.
+#define UART_FRAME_BURST_SIZE 5
+static char uartBurst[UART_FRAME_LENGTH * UART_FRAME_BURST_SIZE];
+static int uartBurstFrameCount = 0;
+static int uartBurstFrameIndex = 0;
+
+static void readUartBurst() {
+  // Wait until there is enough data available in the queue before reading
+  // to optimize the CPU usage. Locking on the queue (as is done in uart1GetDataWithTimeout()) seems to take a lot
+  // of time and the vTaskDelay() solution uses much less CPU.
+  uint32_t bytesAvailable;
+  while ((bytesAvailable = uart1bytesAvailable()) < UART_FRAME_LENGTH) {
     vTaskDelay(1);
     lighthouseTransmitProcessTimeout();
   }
-  #endif
 
-  for(int i = 0; i < UART_FRAME_LENGTH; i++) {
+  int frameCount = bytesAvailable / UART_FRAME_LENGTH;
+  if (frameCount > UART_FRAME_BURST_SIZE) {
+    frameCount = UART_FRAME_BURST_SIZE;
+  }
+
+  for (int i = 0; i < frameCount * UART_FRAME_LENGTH; i++) {
+    uart1Getchar(&uartBurst[i]);
+  }
+
+  uartBurstFrameCount = frameCount;
+  uartBurstFrameIndex = 0;
+
+  STATS_CNT_RATE_EVENT_DEBUG(&uartBurstRate);
+}
+#endif
+
+TESTABLE_STATIC bool getUartFrameRaw(lighthouseUartFrame_t *frame) {
+  int syncCounter = 0;
+
   #ifdef OPTIMIZE_UART1_ACCESS
-    uart1Getchar((char*)&data[i]);
+  if (uartBurstFrameIndex >= uartBurstFrameCount) {
+    readUartBurst();
+  }
+
+  const char* data = &uartBurst[uartBurstFrameIndex * UART_FRAME_LENGTH];
+  uartBurstFrameIndex++;
   #else
+  static char data[UART_FRAME_LENGTH];
+  for(int i = 0; i < UART_FRAME_LENGTH; i++) {
     while(!uart1GetDataWithTimeout((uint8_t*)&data[i], 2)) {
       lighthouseTransmitProcessTimeout();
     }
+  }
   #endif
 
+  for(int i = 0; i < UART_FRAME_LENGTH; i++) {
     if ((unsigned char)data[i] == 0xff) {
       syncCounter += 1;
     }
@@ -279,6 +313,13 @@ TESTABLE_STATIC bool getUartFrameRaw(lighthouseUartFrame_t *frame) {
 
   STATS_CNT_RATE_EVENT_DEBUG(&serialFrameRate);
 
+  #ifdef OPTIMIZE_UART1_ACCESS
+  if (!isFrameValid) {
+    // We will re-synchronize, drop the rest of the burst
+    uartBurstFrameIndex = uartBurstFrameCount;
+  }
+  #endif
+
   return isFrameValid;
 }
 
@@ -417,7 +458,7 @@ static void usePulseResult(pulseProcessor_t *appState, pulseProcessorResult_t* a
         STATS_CNT_RATE_EVENT_DEBUG(&preThrottleRate);
         bool useSample = true;
         if (lighthouseBsTypeV2 == angles->measurementType) {
-          useSample = throttleLh2Samples(now_ms);
+          useSample = throttleLh2SamplesFromBaseStation(now_ms, baseStation, angles, &appState->bsGeometry[baseStation]);
         }
 
         if (useSample) {
@@ -842,6 +883,11 @@ LOG_ADD(LOG_FLOAT, angle1y_0lh2, &angles.baseStationMeasurementsLh2[1].sensorMea
  */
 STATS_CNT_RATE_LOG_ADD_DEBUG(serRt, &serialFrameRate)
 
+/**
+ * @brief Rate of bursts of frames read from the serial buss [1/s]
+ */
+STATS_CNT_RATE_LOG_ADD_DEBUG(burstRt, &uartBurstRate)
+
 /**
  * @brief Rate of frames from the Lighthouse deck that contains sweep data [1/s]
  */
@@ -330,7 +330,63 @@ static void estimatePositionSweepsLh1(const pulseProcessor_t* appState, pulsePro
   }
 }
 
+// All angles of a base station rotation are sent as one measurement to the kalman estimator, which saves queue
+// operations in both tasks. Other estimators only handle single sweep angles.
+_Static_assert(SWEEP_ANGLE_BATCH_N_SENSORS == PULSE_PROCESSOR_N_SENSORS, "The batch must hold all sensors");
+_Static_assert(SWEEP_ANGLE_BATCH_N_SWEEPS == PULSE_PROCESSOR_N_SWEEPS, "The batch must hold all sweeps");
+
+// The batches reference the context of the base station. It is refilled for every batch, the only value that
+// can change while the estimator is using it is the (word sized) std dev.
+static sweepAngleBatchContext_t sweepBatchContexts[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
+
+static void estimatePositionSweepBatchLh2(const pulseProcessor_t* appState, pulseProcessorResult_t* angles, int baseStation) {
+  sweepAngleBatchContext_t* context = &sweepBatchContexts[baseStation];
+  context->stdDev = sweepStdLh2;
+  context->sensorPos = sensorDeckPositions;
+  context->rotorPos = &appState->bsGeometry[baseStation].origin;
+  context->rotorRot = &appState->bsGeometry[baseStation].mat;
+  context->rotorRotInv = &appState->bsGeoCache[baseStation].baseStationInvertedRotationMatrixes;
+  context->calib = appState->bsCalibration[baseStation].sweep;
+  context->calibrationMeasurementModel = lighthouseCalibrationMeasurementModelLh2;
+  context->t[0] = -t30;
+  context->t[1] = t30;
+
+  sweepAngleBatchMeasurement_t batch;
+  batch.timestamp = 0;
+  batch.context = context;
+  batch.baseStationId = baseStation;
+  batch.validMap = 0;
+
+  int count = 0;
+  for (size_t sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
+    pulseProcessorSensorMeasurement_t* measurement = &angles->baseStationMeasurementsLh2[baseStation].sensorMeasurements[sensor];
+    if (measurement->validCount == PULSE_PROCESSOR_N_SWEEPS) {
+      for (int sweep = 0; sweep < PULSE_PROCESSOR_N_SWEEPS; sweep++) {
+        batch.measuredSweepAngles[sensor][sweep] = measurement->angles[sweep];
+        if (measurement->angles[sweep] != 0) {
+          batch.validMap |= 1 << (sensor * SWEEP_ANGLE_BATCH_N_SWEEPS + sweep);
+          count++;
+        }
+      }
+    }
+  }
+
+  if (count > 0) {
+    #ifndef CONFIG_DECK_LIGHTHOUSE_AS_GROUNDTRUTH
+      estimatorEnqueueSweepAngleBatch(&batch);
+
+      STATS_CNT_RATE_MULTI_EVENT(bsEstRates[baseStation], count);
+      STATS_CNT_RATE_MULTI_EVENT(&positionRate, count);
+    #endif
+  }
+}
+
 static void estimatePositionSweepsLh2(const pulseProcessor_t* appState, pulseProcessorResult_t* angles, int baseStation) {
+  if (stateEstimatorGetType() == StateEstimatorTypeKalman) {
+    estimatePositionSweepBatchLh2(appState, angles, baseStation);
+    return;
+  }
+
   const lighthouseCalibration_t* bsCalib = &appState->bsCalibration[baseStation];
   sweepAngleMeasurement_t sweepInfo;
   sweepInfo.stdDev = sweepStdLh2;
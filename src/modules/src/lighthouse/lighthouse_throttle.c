@@ -25,7 +25,9 @@
  */
 
 #include <stdlib.h>
+#include <math.h>
 #include "lighthouse_throttle.h"
+#include "estimator_kalman.h"
 #include "param.h"
 
 // Uncomment next line to add extra debug log variables
@@ -34,14 +36,88 @@
 
 static const uint32_t evaluationIntervalMs = 100;
 static uint16_t maxRate = 50;  // Samples / second
+static uint8_t throttleMode = lh2ThrottleModeInformationGain;
 static float discardProbability = 0.0f;
 
-bool throttleLh2Samples(const uint32_t nowMs) {
-    static uint32_t previousEvaluationTime = 0;
-    static uint32_t nextEvaluationTime = 0;
-    static uint32_t eventCounter = 0;
-    static int discardThreshold = 0;
+static uint32_t previousEvaluationTime = 0;
+static uint32_t nextEvaluationTime = 0;
+static uint32_t eventCounter = 0;
+static int discardThreshold = 0;
+
+// Information gain --------------------------------
+
+// Approximate standard deviation of one sweep angle (rad)
+static const float sweepStd = 0.001f;
+// Decay of the recent usage of the base stations, per evaluation interval
+static const float usageDecay = 0.8f;
+
+// Samples with a score below the threshold are discarded. The threshold is adjusted at each evaluation to use
+// as much of the budget as possible, with the best samples.
+static float scoreThreshold = 0.0f;
+static float scoreSum = 0.0f;
+static uint32_t scoreCount = 0;
+static uint32_t usedCount = 0;
+static uint32_t overBudgetCount = 0;
+
+// Snapshot of the estimated position and its covariance, refreshed at each evaluation
+static float posCovariance[3][3];
+static point_t cfPos;
+static bool isCovarianceValid = false;
+
+// Token bucket that limits the rate of used samples to maxRate
+static const float budgetWindowS = 0.1f;
+static float budgetTokens = 0.0f;
+static uint32_t budgetUpdateMs = 0;
+
+// Recent number of received and used samples per base station
+static float receivedRecently[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
+static float usedRecently[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
+
+static void updateBudget(const uint32_t nowMs) {
+    const float capacity = maxRate * budgetWindowS;
+    budgetTokens += (nowMs - budgetUpdateMs) * maxRate / 1000.0f;
+    if (budgetTokens > capacity) {
+        budgetTokens = capacity;
+    }
+    budgetUpdateMs = nowMs;
+}
+
+static void updateScoreThreshold(const uint32_t intervalMs) {
+    if (discardProbability <= 0.0f || scoreCount == 0) {
+        scoreThreshold = 0.0f;
+    } else if (scoreThreshold <= 0.0f) {
+        // Start from the mean score
+        scoreThreshold = scoreSum / scoreCount;
+    } else if (overBudgetCount > 0) {
+        // Good samples were discarded because of the budget, be more selective
+        scoreThreshold *= 1.25f;
+    } else if (usedCount < maxRate * intervalMs / 1000) {
+        // Budget left, use more samples
+        scoreThreshold *= 0.8f;
+    }
+
+    scoreSum = 0.0f;
+    scoreCount = 0;
+    usedCount = 0;
+    overBudgetCount = 0;
+}
+
+static void updateEstimatorSnapshot() {
+    estimatorKalmanGetEstimatedPosCovariance(posCovariance);
+    estimatorKalmanGetEstimatedPos(&cfPos);
 
+    const float trace = posCovariance[0][0] + posCovariance[1][1] + posCovariance[2][2];
+    isCovarianceValid = isfinite(trace) && trace > 0.0f;
+}
+
+static void decayUsage() {
+    for (int bs = 0; bs < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; bs++) {
+        receivedRecently[bs] *= usageDecay;
+        usedRecently[bs] *= usageDecay;
+    }
+}
+
+static void evaluateRate(const uint32_t nowMs) {
     eventCounter++;
 
     if (nowMs > nextEvaluationTime) {
@@ -53,14 +129,119 @@ bool throttleLh2Samples(const uint32_t nowMs) {
         }
         discardThreshold = RAND_MAX * discardProbability;
 
+        if (throttleMode == lh2ThrottleModeInformationGain) {
+            updateScoreThreshold(nowMs - previousEvaluationTime);
+            updateEstimatorSnapshot();
+            decayUsage();
+        }
+
         previousEvaluationTime = nowMs;
         eventCounter = 0;
         nextEvaluationTime = nowMs + evaluationIntervalMs;
     }
+}
 
+bool throttleLh2Samples(const uint32_t nowMs) {
+    evaluateRate(nowMs);
     return (rand() > discardThreshold);
 }
 
+// Expected reduction of the trace of the position covariance, summed over the sweeps of the sample. A scalar update
+// with the measurement vector H reduces the trace by H * P * P * H' / (H * P * H' + R). The sweep angles of a base
+// station measure the position perpendicular to the ray from the base station, with |H| = 1 / distance. The two
+// directions perpendicular to the ray are approximated by their mean.
+static float informationGain(const pulseProcessorResult_t* angles, const int baseStation, const baseStationGeometry_t* geometry) {
+    int sweepCount = 0;
+    for (int sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
+        sweepCount += angles->baseStationMeasurementsLh2[baseStation].sensorMeasurements[sensor].validCount;
+    }
+
+    const float u[3] = {cfPos.x - geometry->origin[0], cfPos.y - geometry->origin[1], cfPos.z - geometry->origin[2]};
+    const float dist2 = u[0] * u[0] + u[1] * u[1] + u[2] * u[2];
+    if (dist2 < 0.01f) {
+        return 0.0f;
+    }
+
+    float trace = 0.0f;
+    float trace2 = 0.0f;
+    float uPu = 0.0f;
+    float uPPu = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        float Pu = 0.0f;
+        for (int j = 0; j < 3; j++) {
+            Pu += posCovariance[i][j] * u[j];
+            trace2 += posCovariance[i][j] * posCovariance[j][i];
+        }
+        trace += posCovariance[i][i];
+        uPu += u[i] * Pu;
+        uPPu += Pu * Pu;
+    }
+
+    // Mean of e' * P * e and e' * P * P * e for unit vectors e perpendicular to the ray
+    const float perpendicularP = (trace - uPu / dist2) / 2.0f;
+    const float perpendicularPP = (trace2 - uPPu / dist2) / 2.0f;
+
+    const float hph = perpendicularP / dist2;
+    const float r = sweepStd * sweepStd;
+    return sweepCount * (perpendicularPP / dist2) / (hph + r);
+}
+
+// Favors base stations that have been used less than their fair share recently
+static float diversity(const int baseStation) {
+    float usedTotal = 0.0f;
+    int activeCount = 0;
+    for (int bs = 0; bs < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; bs++) {
+        usedTotal += usedRecently[bs];
+        if (receivedRecently[bs] > 0.5f) {
+            activeCount++;
+        }
+    }
+
+    if (usedTotal < 1.0f || activeCount == 0) {
+        return 1.0f;
+    }
+
+    const float shareRatio = activeCount * usedRecently[baseStation] / usedTotal;
+    return 2.0f / (1.0f + shareRatio);
+}
+
+bool throttleLh2SamplesFromBaseStation(const uint32_t nowMs, const int baseStation, const pulseProcessorResult_t* angles, const baseStationGeometry_t* geometry) {
+    if (throttleMode != lh2ThrottleModeInformationGain) {
+        return throttleLh2Samples(nowMs);
+    }
+
+    evaluateRate(nowMs);
+
+    if (!isCovarianceValid) {
+        return (rand() > discardThreshold);
+    }
+
+    const float score = informationGain(angles, baseStation, geometry) * diversity(baseStation);
+    scoreSum += score;
+    scoreCount++;
+    receivedRecently[baseStation] += 1.0f;
+
+    updateBudget(nowMs);
+    bool useSample = false;
+    if (discardProbability <= 0.0f) {
+        useSample = true;
+    } else if (score >= scoreThreshold) {
+        if (budgetTokens >= 1.0f) {
+            useSample = true;
+        } else {
+            overBudgetCount++;
+        }
+    }
+
+    if (useSample) {
+        budgetTokens = fmaxf(budgetTokens - 1.0f, 0.0f);
+        usedCount++;
+        usedRecently[baseStation] += 1.0f;
+    }
+
+    return useSample;
+}
+
 PARAM_GROUP_START(lighthouse)
 
 /**
@@ -71,8 +252,17 @@ PARAM_GROUP_START(lighthouse)
  */
 PARAM_ADD(PARAM_UINT16, lh2maxRate, &maxRate)
 
+/**
+ * @brief How LH V2 samples are selected when the rate is above lh2maxRate (0 = random, 1 = information gain)
+ *
+ * In the information gain mode the samples that are expected to reduce the uncertainty of the position estimate the
+ * most are used, with a preference for base stations that have been used less recently. 1 By default.
+ */
+PARAM_ADD(PARAM_UINT8, lh2ThrMode, &throttleMode)
+
 PARAM_GROUP_STOP(lighthouse)
 
 LOG_GROUP_START(lighthouse)
 LOG_ADD_DEBUG(LOG_FLOAT, disProb, &discardProbability)
+LOG_ADD_DEBUG(LOG_FLOAT, thrScore, &scoreThreshold)
 LOG_GROUP_STOP(lighthouse)
@@ -37,10 +37,12 @@
 #include "task.h"
 #include "timers.h"
 #include "semphr.h"
+#include "queue.h"
 
 #include "config.h"
 #include "crtp.h"
 #include "log.h"
+#include "log_plan.h"
 #include "crc32.h"
 #include "worker.h"
 #include "num.h"
@@ -49,6 +51,7 @@
 #include "cfassert.h"
 #include "debug.h"
 #include "static_mem.h"
+#include "test_support.h"
 
 #if 0
 #define LOG_DEBUG(fmt, ...) DEBUG_PRINT("D/log " fmt, ## __VA_ARGS__)
@@ -58,55 +61,52 @@
 #define LOG_ERROR(...)
 #endif
 
-/**
- * Verify that log function is initialized.
- * This can happen if stats counter is used, STATS_CNT_RATE_INIT() might not
- * have been called.
- */
-#define ASSERT_LOG_FUNCTION_INITIALIZED(function) ASSERT(function)
-
-
-static const uint8_t typeLength[] = {
-  [LOG_UINT8]  = 1,
-  [LOG_UINT16] = 2,
-  [LOG_UINT32] = 4,
-  [LOG_INT8]   = 1,
-  [LOG_INT16]  = 2,
-  [LOG_INT32]  = 4,
-  [LOG_FLOAT]  = 4,
-  [LOG_FP16]   = 2,
-};
-
 #define LOG_TYPE_MASK (0x0f)
 
-typedef enum {
-  acqType_memory = 0,
-  acqType_function = 1,
-} acquisitionType_t;
-
 // Maximum log payload length (4 bytes are used for block id and timestamp)
 #define LOG_MAX_LEN 26
 
 /* Log packet parameters storage */
 #define LOG_MAX_OPS 128
 #define LOG_MAX_BLOCKS 16
-struct log_ops {
-  struct log_ops * next;
-  uint8_t storageType : 4;
-  uint8_t logType     : 4;
-  void * variable;
-  acquisitionType_t acquisitionType;
-};
 
+/* The variables of all blocks are kept in a pool, the variables of a block are
+ * contiguous. The copy plan of a block is compiled when variables are appended
+ * and is stored at the same index in the plan pool. */
 struct log_block {
   int id;
   xTimerHandle timer;
   StaticTimer_t timerBuffer;
   uint32_t droppedPackets;
-  struct log_ops * ops;
+  uint8_t opsStart;
+  uint8_t opsCount;
+  uint8_t stepCount;
+  // Synchronous blocks are sampled by the stabilizer loop every syncDivider
+  // tick, 0 for blocks sampled by the timer
+  uint8_t syncPhase;
+  uint16_t syncDivider;
 };
 
-NO_DMA_CCM_SAFE_ZERO_INIT static struct log_ops logOps[LOG_MAX_OPS];
+// A synchronous block sampled in the stabilizer loop, waiting to be sent
+typedef struct {
+  uint32_t tick;
+  uint8_t blockId;
+  uint8_t size;
+  uint8_t data[LOG_MAX_LEN];
+} logSnapshot_t;
+
+#define LOG_SNAPSHOT_RING_SIZE 16
+STATIC_MEM_QUEUE_ALLOC(logSnapshotQueue, LOG_SNAPSHOT_RING_SIZE, sizeof(logSnapshot_t));
+static xQueueHandle logSnapshotQueue;
+
+// Bit n is set if there are synchronous blocks for phase n, read by the
+// stabilizer without taking the lock
+static volatile uint8_t logSyncPhases;
+static uint32_t logSyncDroppedPackets;
+
+NO_DMA_CCM_SAFE_ZERO_INIT static logPlanOp_t logOps[LOG_MAX_OPS];
+NO_DMA_CCM_SAFE_ZERO_INIT static logPlanStep_t logPlans[LOG_MAX_OPS];
+static int logOpsUsed;
 NO_DMA_CCM_SAFE_ZERO_INIT static struct log_block logBlocks[LOG_MAX_BLOCKS];
 static xSemaphoreHandle logLock;
 static StaticSemaphore_t logLockBuffer;
@@ -125,6 +125,11 @@ struct control_start_block_v2 {
   uint16_t period_in_ms;
 } __attribute__((packed));
 
+struct control_start_block_sync {
+  uint8_t phase;
+  uint16_t divider;
+} __attribute__((packed));
+
 #define TOC_CH      0
 #define CONTROL_CH  1
 #define LOG_CH      2
@@ -143,6 +148,7 @@ struct control_start_block_v2 {
 #define CONTROL_CREATE_BLOCK_V2 6
 #define CONTROL_APPEND_BLOCK_V2 7
 #define CONTROL_START_BLOCK_V2  8
+#define CONTROL_START_BLOCK_SYNC 9
 
 #define BLOCK_ID_FREE -1
 
@@ -152,11 +158,18 @@ static void logTOCProcess(int command);
 static void logControlProcess(void);
 
 void logRunBlock(void * arg);
+static void logSendSnapshots(void * arg);
 void logBlockTimed(xTimerHandle timer);
 
+#ifndef UNIT_TEST_MODE
 //These are set by the Linker
 extern struct log_s _log_start;
 extern struct log_s _log_stop;
+#else
+//When placed in ram for testing
+extern struct log_s *_log_start;
+extern struct log_s *_log_stop;
+#endif
 
 //Pointer to the logeters list and length of it
 static struct log_s * logs;
@@ -172,12 +185,14 @@ static bool isInit = false;
 static int logAppendBlock(int id, struct ops_setting * settings, int len);
 static int logAppendBlockV2(int id, struct ops_setting_v2 * settings, int len);
 static int logCreateBlock(unsigned char id, struct ops_setting * settings, int len);
-static int logCreateBlockV2(unsigned char id, struct ops_setting_v2 * settings, int len);
+TESTABLE_STATIC int logCreateBlockV2(unsigned char id, struct ops_setting_v2 * settings, int len);
 static int logDeleteBlock(int id);
 static int logStartBlock(int id, unsigned int period);
+static int logStartBlockSync(int id, uint8_t phase, uint16_t divider);
 static int logStopBlock(int id);
 static void logReset();
-static acquisitionType_t acquisitionTypeFromLogType(uint8_t logType);
+static bool sendLogPacket(CRTPPacket * pk);
+static void updateSyncPhases(void);
 
 STATIC_MEM_TASK_ALLOC_STACK_NO_DMA_CCM_SAFE(logTask, LOG_TASK_STACKSIZE);
 
@@ -190,8 +205,13 @@ void logInit(void)
   if(isInit)
     return;
 
+#ifndef UNIT_TEST_MODE
   logs = &_log_start;
   logsLen = &_log_stop - &_log_start;
+#else
+  logs = _log_start;
+  logsLen = _log_stop - _log_start;
+#endif
 
   // Calculate a hash of the toc by chaining description of each elements
   // Using the CRTP packet as temporary buffer
@@ -222,6 +242,7 @@ void logInit(void)
 
   // Big lock that protects the log datastructures
   logLock = xSemaphoreCreateMutexStatic(&logLockBuffer);
+  logSnapshotQueue = STATIC_MEM_QUEUE_CREATE(logSnapshotQueue);
 
   for (i=0; i<logsLen; i++)
   {
@@ -430,6 +451,12 @@ void logControlProcess()
         ret = logStartBlock(p.data[1], args->period_in_ms);
       }
       break;
+    case CONTROL_START_BLOCK_SYNC:
+      {
+        struct control_start_block_sync* args = (struct control_start_block_sync *)&p.data[2];
+        ret = logStartBlockSync(p.data[1], args->phase, args->divider);
+      }
+      break;
   }
 
   //Commands answer
@@ -454,7 +481,10 @@ static int logCreateBlock(unsigned char id, struct ops_setting * settings, int l
   logBlocks[i].id = id;
   logBlocks[i].timer = xTimerCreateStatic("logTimer", M2T(1000), pdTRUE,
     &logBlocks[i], logBlockTimed, &logBlocks[i].timerBuffer);
-  logBlocks[i].ops = NULL;
+  logBlocks[i].opsStart = logOpsUsed;
+  logBlocks[i].opsCount = 0;
+  logBlocks[i].stepCount = 0;
+  logBlocks[i].syncDivider = 0;
 
   if (logBlocks[i].timer == NULL)
   {
@@ -467,7 +497,7 @@ static int logCreateBlock(unsigned char id, struct ops_setting * settings, int l
   return logAppendBlock(id, settings, len);
 }
 
-static int logCreateBlockV2(unsigned char id, struct ops_setting_v2 * settings, int len)
+TESTABLE_STATIC int logCreateBlockV2(unsigned char id, struct ops_setting_v2 * settings, int len)
 {
   int i;
 
@@ -483,7 +513,10 @@ static int logCreateBlockV2(unsigned char id, struct ops_setting_v2 * settings,
   logBlocks[i].id = id;
   logBlocks[i].timer = xTimerCreateStatic("logTimer", M2T(1000), pdTRUE,
     &logBlocks[i], logBlockTimed, &logBlocks[i].timerBuffer);
-  logBlocks[i].ops = NULL;
+  logBlocks[i].opsStart = logOpsUsed;
+  logBlocks[i].opsCount = 0;
+  logBlocks[i].stepCount = 0;
+  logBlocks[i].syncDivider = 0;
 
   if (logBlocks[i].timer == NULL)
   {
@@ -497,9 +530,9 @@ static int logCreateBlockV2(unsigned char id, struct ops_setting_v2 * settings,
 }
 
 static int blockCalcLength(struct log_block * block);
-static struct log_ops * opsMalloc();
-static void opsFree(struct log_ops * ops);
-static void blockAppendOps(struct log_block * block, struct log_ops * ops);
+static logPlanOp_t * blockAllocOp(struct log_block * block);
+static void blockFreeOps(struct log_block * block);
+static void blockCompile(struct log_block * block);
 static int variableGetIndex(int id);
 
 static int logAppendBlock(int id, struct ops_setting * settings, int len)
@@ -519,22 +552,17 @@ static int logAppendBlock(int id, struct ops_setting * settings, int len)
 
   block = &logBlocks[i];
 
+  int result = 0;
   for (i=0; i<len; i++)
   {
     int currentLength = blockCalcLength(block);
-    struct log_ops * ops;
-    int varId;
+    logPlanOp_t * ops;
+    int varId = -1;
 
-    if ((currentLength + typeLength[settings[i].logType & LOG_TYPE_MASK])>LOG_MAX_LEN) {
+    if ((currentLength + logPlanTypeLength(settings[i].logType & LOG_TYPE_MASK))>LOG_MAX_LEN) {
       LOG_ERROR("Trying to append a full block. Block id %d.\n", id);
-      return E2BIG;
-    }
-
-    ops = opsMalloc();
-
-    if(!ops) {
-      LOG_ERROR("No more ops memory free!\n");
-      return ENOMEM;
+      result = E2BIG;
+      break;
     }
 
     if (settings[i].id != 255)  //TOC variable
@@ -543,13 +571,25 @@ static int logAppendBlock(int id, struct ops_setting * settings, int len)
 
       if (varId<0) {
         LOG_ERROR("Trying to add variable Id %d that does not exists.", settings[i].id);
-        return ENOENT;
+        result = ENOENT;
+        break;
       }
+    }
+
+    ops = blockAllocOp(block);
 
+    if(!ops) {
+      LOG_ERROR("No more ops memory free!\n");
+      result = ENOMEM;
+      break;
+    }
+
+    if (varId >= 0)  //TOC variable
+    {
       ops->variable    = logs[varId].address;
       ops->storageType = logGetType(varId);
       ops->logType     = settings[i].logType & LOG_TYPE_MASK;
-      ops->acquisitionType = acquisitionTypeFromLogType(logs[varId].type);
+      ops->byFunction  = (logs[varId].type & LOG_BY_FUNCTION) != 0;
 
       LOG_DEBUG("Appended variable %d to block %d\n", settings[i].id, id);
     } else {                     //Memory variable
@@ -557,17 +597,18 @@ static int logAppendBlock(int id, struct ops_setting * settings, int len)
       ops->variable    = (void*)(&settings[i]+1);
       ops->storageType = (settings[i].logType>>4) & LOG_TYPE_MASK;
       ops->logType     = settings[i].logType & LOG_TYPE_MASK;
-      ops->acquisitionType = acqType_memory;
+      ops->byFunction  = false;
       i += 2;
 
       LOG_DEBUG("Appended var addr 0x%x to block %d\n", (int)ops->variable, id);
     }
-    blockAppendOps(block, ops);
 
     LOG_DEBUG("   Now lenght %d\n", blockCalcLength(block));
   }
 
-  return 0;
+  blockCompile(block);
+
+  return result;
 }
 
 static int logAppendBlockV2(int id, struct ops_setting_v2 * settings, int len)
@@ -587,22 +628,17 @@ static int logAppendBlockV2(int id, struct ops_setting_v2 * settings, int len)
 
   block = &logBlocks[i];
 
+  int result = 0;
   for (i=0; i<len; i++)
   {
     int currentLength = blockCalcLength(block);
-    struct log_ops * ops;
-    int varId;
+    logPlanOp_t * ops;
+    int varId = -1;
 
-    if ((currentLength + typeLength[settings[i].logType & LOG_TYPE_MASK])>LOG_MAX_LEN) {
+    if ((currentLength + logPlanTypeLength(settings[i].logType & LOG_TYPE_MASK))>LOG_MAX_LEN) {
       LOG_ERROR("Trying to append a full block. Block id %d.\n", id);
-      return E2BIG;
-    }
-
-    ops = opsMalloc();
-
-    if(!ops) {
-      LOG_ERROR("No more ops memory free!\n");
-      return ENOMEM;
+      result = E2BIG;
+      break;
     }
 
     if (settings[i].id != 0xFFFFul)  //TOC variable
@@ -611,13 +647,25 @@ static int logAppendBlockV2(int id, struct ops_setting_v2 * settings, int len)
 
       if (varId<0) {
         LOG_ERROR("Trying to add variable Id %d that does not exists.", settings[i].id);
-        return ENOENT;
+        result = ENOENT;
+        break;
       }
+    }
 
+    ops = blockAllocOp(block);
+
+    if(!ops) {
+      LOG_ERROR("No more ops memory free!\n");
+      result = ENOMEM;
+      break;
+    }
+
+    if (varId >= 0)  //TOC variable
+    {
       ops->variable    = logs[varId].address;
       ops->storageType = logGetType(varId);
       ops->logType     = settings[i].logType & LOG_TYPE_MASK;
-      ops->acquisitionType = acquisitionTypeFromLogType(logs[varId].type);
+      ops->byFunction  = (logs[varId].type & LOG_BY_FUNCTION) != 0;
 
       LOG_DEBUG("Appended variable %d to block %d\n", settings[i].id, id);
     } else {                     //Memory variable
@@ -625,24 +673,23 @@ static int logAppendBlockV2(int id, struct ops_setting_v2 * settings, int len)
       ops->variable    = (void*)(&settings[i]+1);
       ops->storageType = (settings[i].logType>>4) & LOG_TYPE_MASK;
       ops->logType     = settings[i].logType & LOG_TYPE_MASK;
-      ops->acquisitionType = acqType_memory;
+      ops->byFunction  = false;
       i += 2;
 
       LOG_DEBUG("Appended var addr 0x%x to block %d\n", (int)ops->variable, id);
     }
-    blockAppendOps(block, ops);
 
     LOG_DEBUG("   Now lenght %d\n", blockCalcLength(block));
   }
 
-  return 0;
+  blockCompile(block);
+
+  return result;
 }
 
 static int logDeleteBlock(int id)
 {
   int i;
-  struct log_ops * ops;
-  struct log_ops * opsNext;
 
   for (i=0; i<LOG_MAX_BLOCKS; i++)
     if (logBlocks[i].id == id) break;
@@ -652,13 +699,9 @@ static int logDeleteBlock(int id)
     return ENOENT;
   }
 
-  ops = logBlocks[i].ops;
-  while (ops)
-  {
-    opsNext = ops->next;
-    opsFree(ops);
-    ops = opsNext;
-  }
+  blockFreeOps(&logBlocks[i]);
+  logBlocks[i].syncDivider = 0;
+  updateSyncPhases();
 
   if (logBlocks[i].timer != 0) {
     xTimerStop(logBlocks[i].timer, portMAX_DELAY);
@@ -684,6 +727,10 @@ static int logStartBlock(int id, unsigned int period)
 
   LOG_DEBUG("Starting block %d with period %dms\n", id, period);
 
+  blockCompile(&logBlocks[i]);
+  logBlocks[i].syncDivider = 0;
+  updateSyncPhases();
+
   if (period>0)
   {
     xTimerChangePeriod(logBlocks[i].timer, M2T(period), 100);
@@ -696,6 +743,33 @@ static int logStartBlock(int id, unsigned int period)
   return 0;
 }
 
+static int logStartBlockSync(int id, uint8_t phase, uint16_t divider)
+{
+  int i;
+
+  for (i=0; i<LOG_MAX_BLOCKS; i++)
+    if (logBlocks[i].id == id) break;
+
+  if (i >= LOG_MAX_BLOCKS) {
+    LOG_ERROR("Trying to start block id %d that doesn't exist.", id);
+    return ENOENT;
+  }
+
+  if (phase >= logSyncPhaseCount || divider == 0) {
+    return EINVAL;
+  }
+
+  LOG_DEBUG("Starting block %d in phase %d every %d ticks\n", id, phase, divider);
+
+  xTimerStop(logBlocks[i].timer, portMAX_DELAY);
+  blockCompile(&logBlocks[i]);
+  logBlocks[i].syncPhase = phase;
+  logBlocks[i].syncDivider = divider;
+  updateSyncPhases();
+
+  return 0;
+}
+
 static int logStopBlock(int id)
 {
   int i;
@@ -709,6 +783,8 @@ static int logStopBlock(int id)
   }
 
   xTimerStop(logBlocks[i].timer, portMAX_DELAY);
+  logBlocks[i].syncDivider = 0;
+  updateSyncPhases();
 
   return 0;
 }
@@ -719,22 +795,10 @@ void logBlockTimed(xTimerHandle timer)
   workerSchedule(logRunBlock, pvTimerGetTimerID(timer));
 }
 
-/* Appends data to a packet if space is available; returns false on failure. */
-static bool appendToPacket(CRTPPacket * pk, const void * data, size_t n) {
-  if (pk->size <= CRTP_MAX_DATA_SIZE - n)
-  {
-    memcpy(&pk->data[pk->size], data, n);
-    pk->size += n;
-    return true;
-  }
-  else return false;
-}
-
 /* This function is usually called by the worker subsystem */
 void logRunBlock(void * arg)
 {
   struct log_block *blk = arg;
-  struct log_ops *ops = blk->ops;
   static CRTPPacket pk;
   unsigned int timestamp;
 
@@ -743,163 +807,116 @@ void logRunBlock(void * arg)
   timestamp = ((long long)xTaskGetTickCount())/portTICK_RATE_MS;
 
   pk.header = CRTP_HEADER(CRTP_PORT_LOG, LOG_CH);
-  pk.size = 4;
   pk.data[0] = blk->id;
   pk.data[1] = timestamp&0x0ff;
   pk.data[2] = (timestamp>>8)&0x0ff;
   pk.data[3] = (timestamp>>16)&0x0ff;
 
-  while (ops)
-  {
-    int valuei = 0;
-    float valuef = 0;
+  // The length of a block is limited to LOG_MAX_LEN when variables are appended
+  pk.size = 4 + logPlanRun(&logPlans[blk->opsStart], blk->stepCount, &pk.data[4], timestamp);
+
+  xSemaphoreGive(logLock);
 
-    // FPU instructions must run on aligned data.
-    // We first copy the data to an (aligned) local variable, before assigning it
-    switch(ops->storageType)
+  if (!sendLogPacket(&pk))
+  {
+    if (blk->droppedPackets++ % 100 == 0)
     {
-      case LOG_UINT8:
-      {
-        uint8_t v;
-        if (ops->acquisitionType == acqType_function) {
-          logByFunction_t* logByFunction = (logByFunction_t*)ops->variable;
-          ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireUInt8);
-          v = logByFunction->acquireUInt8(timestamp, logByFunction->data);
-        } else {
-          memcpy(&v, ops->variable, sizeof(v));
-        }
-        valuei = v;
-        break;
-      }
-      case LOG_INT8:
-      {
-        int8_t v;
-        if (ops->acquisitionType == acqType_function) {
-          logByFunction_t* logByFunction = (logByFunction_t*)ops->variable;
-          ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireInt8);
-          v = logByFunction->acquireInt8(timestamp, logByFunction->data);
-        } else {
-          memcpy(&v, ops->variable, sizeof(v));
-        }
-        valuei = v;
-        break;
-      }
-      case LOG_UINT16:
-      {
-        uint16_t v;
-        if (ops->acquisitionType == acqType_function) {
-          logByFunction_t* logByFunction = (logByFunction_t*)ops->variable;
-          ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireUInt16);
-          v = logByFunction->acquireUInt16(timestamp, logByFunction->data);
-        } else {
-          memcpy(&v, ops->variable, sizeof(v));
-        }
-        valuei = v;
-        break;
-      }
-      case LOG_INT16:
-      {
-        int16_t v;
-        if (ops->acquisitionType == acqType_function) {
-          logByFunction_t* logByFunction = (logByFunction_t*)ops->variable;
-          ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireInt16);
-          v = logByFunction->acquireInt16(timestamp, logByFunction->data);
-        } else {
-          memcpy(&v, ops->variable, sizeof(v));
-        }
-        valuei = v;
-        break;
-      }
-      case LOG_UINT32:
-      {
-        uint32_t v;
-        if (ops->acquisitionType == acqType_function) {
-          logByFunction_t* logByFunction = (logByFunction_t*)ops->variable;
-          ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireUInt32);
-          v = logByFunction->acquireUInt32(timestamp, logByFunction->data);
-        } else {
-          memcpy(&v, ops->variable, sizeof(v));
-        }
-        valuei = v;
-        break;
-      }
-      case LOG_INT32:
-      {
-        int32_t v;
-        if (ops->acquisitionType == acqType_function) {
-          logByFunction_t* logByFunction = (logByFunction_t*)ops->variable;
-          ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireInt32);
-          v = logByFunction->acquireInt32(timestamp, logByFunction->data);
-        } else {
-          memcpy(&v, ops->variable, sizeof(v));
-        }
-        valuei = v;
-        break;
-      }
-      case LOG_FLOAT:
-      {
-        float v;
-        if (ops->acquisitionType == acqType_function) {
-          logByFunction_t* logByFunction = (logByFunction_t*)ops->variable;
-          ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->aquireFloat);
-          v = logByFunction->aquireFloat(timestamp, logByFunction->data);
-        } else {
-          memcpy(&v, ops->variable, sizeof(valuef));
-        }
-        valuei = v;
-        valuef = v;
-        break;
-      }
+      DEBUG_PRINT("WARNING: LOG packets drop detected (%lu packets lost)\n",
+                  blk->droppedPackets);
     }
+  }
+}
 
-    if (ops->logType == LOG_FLOAT || ops->logType == LOG_FP16)
-    {
-      if (ops->storageType != LOG_FLOAT)
-      {
-        valuef = valuei;
-      }
+void logSyncCapture(const logSyncPhase_t phase, const uint32_t tick)
+{
+  if ((logSyncPhases & (1 << phase)) == 0)
+    return;
 
-      // Try to append the next item to the packet.  If we run out of space,
-      // drop this and subsequent items.
-      if (ops->logType == LOG_FLOAT)
-      {
-        if (!appendToPacket(&pk, &valuef, 4)) break;
-      }
-      else
-      {
-        valuei = single2half(valuef);
-        if (!appendToPacket(&pk, &valuei, 2)) break;
-      }
-    }
-    else  //logType is an integer
-    {
-      if (!appendToPacket(&pk, &valuei, typeLength[ops->logType])) break;
-    }
+  // Never block the stabilizer loop, the sample is dropped if the log system
+  // is busy with a control packet
+  if (xSemaphoreTake(logLock, 0) != pdTRUE)
+  {
+    logSyncDroppedPackets++;
+    return;
+  }
 
-    ops = ops->next;
+  const uint32_t timestamp = T2M(xTaskGetTickCount());
+  bool isQueued = false;
+
+  for (int i=0; i<LOG_MAX_BLOCKS; i++)
+  {
+    struct log_block *blk = &logBlocks[i];
+    if (blk->id == BLOCK_ID_FREE || !logPlanIsSyncDue(blk->syncPhase, blk->syncDivider, phase, tick))
+      continue;
+
+    logSnapshot_t snapshot;
+    snapshot.tick = tick;
+    snapshot.blockId = blk->id;
+    snapshot.size = logPlanRun(&logPlans[blk->opsStart], blk->stepCount, snapshot.data, timestamp);
+
+    if (xQueueSend(logSnapshotQueue, &snapshot, 0) == pdTRUE)
+      isQueued = true;
+    else
+      logSyncDroppedPackets++;
   }
 
   xSemaphoreGive(logLock);
 
+  if (isQueued)
+    workerSchedule(logSendSnapshots, NULL);
+}
+
+/* Sends the synchronous blocks sampled by the stabilizer, called by the worker */
+static void logSendSnapshots(void * arg)
+{
+  static CRTPPacket pk;
+  logSnapshot_t snapshot;
+
+  while (xQueueReceive(logSnapshotQueue, &snapshot, 0) == pdTRUE)
+  {
+    // The timestamp is the stabilizer tick the block was sampled in
+    pk.header = CRTP_HEADER(CRTP_PORT_LOG, LOG_CH);
+    const int headerLength = logPlanWriteSyncHeader(pk.data, snapshot.blockId, snapshot.tick);
+    memcpy(&pk.data[headerLength], snapshot.data, snapshot.size);
+    pk.size = headerLength + snapshot.size;
+
+    if (!sendLogPacket(&pk))
+    {
+      if (logSyncDroppedPackets++ % 100 == 0)
+      {
+        DEBUG_PRINT("WARNING: LOG sync packets drop detected (%lu packets lost)\n",
+                    logSyncDroppedPackets);
+      }
+    }
+  }
+}
+
+/* Sends a log packet, returns false if it was dropped */
+static bool sendLogPacket(CRTPPacket * pk)
+{
   // Check if the connection is still up, oherwise disable
   // all the logging and flush all the CRTP queues.
   if (!crtpIsConnected())
   {
     logReset();
     crtpReset();
+    return true;
   }
-  else
-  {
-    // No need to block here, since logging is not guaranteed
-    if (!crtpSendPacket(&pk))
-    {
-      if (blk->droppedPackets++ % 100 == 0)
-      {
-        DEBUG_PRINT("WARNING: LOG packets drop detected (%lu packets lost)\n",
-                    blk->droppedPackets);
-      }
-    }
-  }
+
+  // No need to block here, since logging is not guaranteed
+  return crtpSendPacket(pk);
+}
+
+// Called with the lock taken when the synchronous blocks change
+static void updateSyncPhases(void)
+{
+  uint8_t phases = 0;
+
+  for (int i=0; i<LOG_MAX_BLOCKS; i++)
+    if (logBlocks[i].id != BLOCK_ID_FREE && logBlocks[i].syncDivider != 0)
+      phases |= 1 << logBlocks[i].syncPhase;
+
+  logSyncPhases = phases;
 }
 
 static int variableGetIndex(int id)
@@ -923,49 +940,61 @@ static int variableGetIndex(int id)
   return i;
 }
 
-static struct log_ops * opsMalloc()
+// Adds a variable at the end of a block, the variables of the following blocks
+// are moved to make room
+static logPlanOp_t * blockAllocOp(struct log_block * block)
 {
-  int i;
+  if (logOpsUsed >= LOG_MAX_OPS)
+    return NULL;
 
-  for (i=0;i<LOG_MAX_OPS; i++)
-      if (logOps[i].variable == NULL) break;
+  const int index = block->opsStart + block->opsCount;
+  const int toMove = logOpsUsed - index;
+  memmove(&logOps[index + 1], &logOps[index], toMove * sizeof(logOps[0]));
+  memmove(&logPlans[index + 1], &logPlans[index], toMove * sizeof(logPlans[0]));
 
-  if (i >= LOG_MAX_OPS)
-      return NULL;
+  for (int i=0; i<LOG_MAX_BLOCKS; i++)
+    if (&logBlocks[i] != block && logBlocks[i].id != BLOCK_ID_FREE && logBlocks[i].opsStart >= index)
+      logBlocks[i].opsStart++;
 
-  return &logOps[i];
+  logOpsUsed++;
+  block->opsCount++;
+
+  memset(&logOps[index], 0, sizeof(logOps[0]));
+  return &logOps[index];
 }
 
-static void opsFree(struct log_ops * ops)
+// Removes all variables of a block, the variables of the following blocks are
+// moved to fill the gap
+static void blockFreeOps(struct log_block * block)
 {
-  ops->variable = NULL;
+  const int index = block->opsStart;
+  const int count = block->opsCount;
+  const int toMove = logOpsUsed - index - count;
+  memmove(&logOps[index], &logOps[index + count], toMove * sizeof(logOps[0]));
+  memmove(&logPlans[index], &logPlans[index + count], toMove * sizeof(logPlans[0]));
+
+  for (int i=0; i<LOG_MAX_BLOCKS; i++)
+    if (&logBlocks[i] != block && logBlocks[i].id != BLOCK_ID_FREE && logBlocks[i].opsStart > index)
+      logBlocks[i].opsStart -= count;
+
+  logOpsUsed -= count;
+  block->opsCount = 0;
+  block->stepCount = 0;
 }
 
-static int blockCalcLength(struct log_block * block)
+static void blockCompile(struct log_block * block)
 {
-  struct log_ops * ops;
-  int len = 0;
-
-  for (ops = block->ops; ops; ops = ops->next)
-    len += typeLength[ops->logType];
-
-  return len;
+  block->stepCount = logPlanCompile(&logOps[block->opsStart], block->opsCount, &logPlans[block->opsStart]);
 }
 
-void blockAppendOps(struct log_block * block, struct log_ops * ops)
+static int blockCalcLength(struct log_block * block)
 {
-  struct log_ops * o;
-
-  ops->next = NULL;
+  int len = 0;
 
-  if (block->ops == NULL)
-    block->ops = ops;
-  else
-  {
-    for (o = block->ops; o->next; o = o->next);
+  for (int i = 0; i < block->opsCount; i++)
+    len += logPlanTypeLength(logOps[block->opsStart + i].logType);
 
-    o->next = ops;
-  }
+  return len;
 }
 
 static void logReset(void)
@@ -988,8 +1017,10 @@ static void logReset(void)
     logBlocks[i].id = BLOCK_ID_FREE;
 
   //Force free the log ops
-  for (i=0; i<LOG_MAX_OPS; i++)
-    logOps[i].variable = NULL;
+  logOpsUsed = 0;
+
+  logSyncPhases = 0;
+  xQueueReset(logSnapshotQueue);
 }
 
 /* Public API to access log TOC from within the copter */
@@ -1049,7 +1080,7 @@ void* logGetAddress(logVarId_t varid)
 
 uint8_t logVarSize(int type)
 {
-  return typeLength[type];
+  return logPlanTypeLength(type);
 }
 
 int logGetInt(logVarId_t varid)
@@ -1100,11 +1131,3 @@ unsigned int logGetUint(logVarId_t varid)
 {
   return (unsigned int)logGetInt(varid);
 }
-
-static acquisitionType_t acquisitionTypeFromLogType(uint8_t logType) {
-  if (logType & LOG_BY_FUNCTION) {
-    return acqType_function;
-  }
-
-  return acqType_memory;
-}
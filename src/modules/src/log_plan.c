@@ -0,0 +1,245 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * log_plan.c - Copy plans for log blocks
+ *
+ * A log block is compiled into a flat array of steps when it is set up, instead
+ * of dispatching on the types of each variable every time the block is sent.
+ * Each step is a raw copy or a conversion that is specialized for the pair of
+ * storage and log types. The conversions give the same result as converting
+ * through an int (or a float), as the log system has always done.
+ */
+
+#include <string.h>
+
+#include "log_plan.h"
+#include "num.h"
+#include "cfassert.h"
+
+static const uint8_t typeLength[] = {
+  [LOG_UINT8]  = 1,
+  [LOG_UINT16] = 2,
+  [LOG_UINT32] = 4,
+  [LOG_INT8]   = 1,
+  [LOG_INT16]  = 2,
+  [LOG_INT32]  = 4,
+  [LOG_FLOAT]  = 4,
+  [LOG_FP16]   = 2,
+};
+
+/**
+ * Verify that log function is initialized.
+ * This can happen if stats counter is used, STATS_CNT_RATE_INIT() might not
+ * have been called.
+ */
+#define ASSERT_LOG_FUNCTION_INITIALIZED(function) ASSERT(function)
+
+// Used for variables with an unknown storage type, logged as zero
+static const uint32_t zeroValue = 0;
+
+#define INT_TO_FLOAT(v) ((float)(int)(v))
+#define FLOAT_TO_FLOAT(v) (v)
+
+// Conversions from one storage type to all log types. Integers are written as
+// the low bytes of the value, signed and unsigned types of the same size give
+// the same bytes.
+#define DEFINE_CONVERTERS(NAME, STYPE, TO_FLOAT) \
+  static void convert##NAME##To8(uint8_t* dst, const void* src) { \
+    STYPE v; memcpy(&v, src, sizeof(v)); \
+    dst[0] = (uint8_t)(int)v; \
+  } \
+  static void convert##NAME##To16(uint8_t* dst, const void* src) { \
+    STYPE v; memcpy(&v, src, sizeof(v)); \
+    const uint16_t out = (uint16_t)(int)v; memcpy(dst, &out, sizeof(out)); \
+  } \
+  static void convert##NAME##To32(uint8_t* dst, const void* src) { \
+    STYPE v; memcpy(&v, src, sizeof(v)); \
+    const uint32_t out = (uint32_t)(int)v; memcpy(dst, &out, sizeof(out)); \
+  } \
+  static void convert##NAME##ToFloat(uint8_t* dst, const void* src) { \
+    STYPE v; memcpy(&v, src, sizeof(v)); \
+    const float out = TO_FLOAT(v); memcpy(dst, &out, sizeof(out)); \
+  } \
+  static void convert##NAME##ToFp16(uint8_t* dst, const void* src) { \
+    STYPE v; memcpy(&v, src, sizeof(v)); \
+    const uint16_t out = single2half(TO_FLOAT(v)); memcpy(dst, &out, sizeof(out)); \
+  }
+
+DEFINE_CONVERTERS(UInt8, uint8_t, INT_TO_FLOAT)
+DEFINE_CONVERTERS(UInt16, uint16_t, INT_TO_FLOAT)
+DEFINE_CONVERTERS(UInt32, uint32_t, INT_TO_FLOAT)
+DEFINE_CONVERTERS(Int8, int8_t, INT_TO_FLOAT)
+DEFINE_CONVERTERS(Int16, int16_t, INT_TO_FLOAT)
+DEFINE_CONVERTERS(Int32, int32_t, INT_TO_FLOAT)
+DEFINE_CONVERTERS(Float, float, FLOAT_TO_FLOAT)
+
+#define CONVERTER_ROW(NAME) { \
+    [LOG_UINT8] = convert##NAME##To8, \
+    [LOG_UINT16] = convert##NAME##To16, \
+    [LOG_UINT32] = convert##NAME##To32, \
+    [LOG_INT8] = convert##NAME##To8, \
+    [LOG_INT16] = convert##NAME##To16, \
+    [LOG_INT32] = convert##NAME##To32, \
+    [LOG_FLOAT] = convert##NAME##ToFloat, \
+    [LOG_FP16] = convert##NAME##ToFp16, \
+  }
+
+// Indexed by storage type and log type
+static const logPlanConvert_t converters[LOG_FLOAT + 1][LOG_FP16 + 1] = {
+  [LOG_UINT8] = CONVERTER_ROW(UInt8),
+  [LOG_UINT16] = CONVERTER_ROW(UInt16),
+  [LOG_UINT32] = CONVERTER_ROW(UInt32),
+  [LOG_INT8] = CONVERTER_ROW(Int8),
+  [LOG_INT16] = CONVERTER_ROW(Int16),
+  [LOG_INT32] = CONVERTER_ROW(Int32),
+  [LOG_FLOAT] = CONVERTER_ROW(Float),
+};
+
+#define DEFINE_FETCHER(NAME, STYPE, MEMBER) \
+  static void fetch##NAME(void* dst, const void* function, uint32_t timestamp) { \
+    const logByFunction_t* logByFunction = function; \
+    ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->MEMBER); \
+    const STYPE v = logByFunction->MEMBER(timestamp, logByFunction->data); \
+    memcpy(dst, &v, sizeof(v)); \
+  }
+
+DEFINE_FETCHER(UInt8, uint8_t, acquireUInt8)
+DEFINE_FETCHER(UInt16, uint16_t, acquireUInt16)
+DEFINE_FETCHER(UInt32, uint32_t, acquireUInt32)
+DEFINE_FETCHER(Int8, int8_t, acquireInt8)
+DEFINE_FETCHER(Int16, int16_t, acquireInt16)
+DEFINE_FETCHER(Int32, int32_t, acquireInt32)
+DEFINE_FETCHER(Float, float, aquireFloat)
+
+// Indexed by storage type
+static const logPlanFetch_t fetchers[LOG_FLOAT + 1] = {
+  [LOG_UINT8] = fetchUInt8,
+  [LOG_UINT16] = fetchUInt16,
+  [LOG_UINT32] = fetchUInt32,
+  [LOG_INT8] = fetchInt8,
+  [LOG_INT16] = fetchInt16,
+  [LOG_INT32] = fetchInt32,
+  [LOG_FLOAT] = fetchFloat,
+};
+
+static bool isIntegerType(const uint8_t type) {
+  return type >= LOG_UINT8 && type <= LOG_INT32;
+}
+
+// The value can be copied to the packet as it is
+static bool isRawCopy(const uint8_t storageType, const uint8_t logType) {
+  if (storageType == logType) {
+    return true;
+  }
+
+  return isIntegerType(storageType) && isIntegerType(logType) && typeLength[storageType] == typeLength[logType];
+}
+
+uint8_t logPlanTypeLength(const uint8_t logType) {
+  if (logType > LOG_FP16) {
+    return 0;
+  }
+
+  return typeLength[logType];
+}
+
+int logPlanCompile(const logPlanOp_t* ops, const int opCount, logPlanStep_t* steps) {
+  int stepCount = 0;
+
+  for (int i = 0; i < opCount; i++) {
+    const logPlanOp_t* op = &ops[i];
+    const uint8_t logType = op->logType;
+    const uint8_t length = logPlanTypeLength(logType);
+    if (length == 0) {
+      continue;
+    }
+
+    uint8_t storageType = op->storageType;
+    const void* src = op->variable;
+    bool byFunction = op->byFunction;
+    if (storageType < LOG_UINT8 || storageType > LOG_FLOAT) {
+      storageType = LOG_UINT32;
+      src = &zeroValue;
+      byFunction = false;
+    }
+
+    const bool isRaw = isRawCopy(storageType, logType);
+
+    // Merge with the previous step if the variables are next to each other in memory
+    if (isRaw && !byFunction && stepCount > 0) {
+      logPlanStep_t* previous = &steps[stepCount - 1];
+      const bool isPreviousRawMemory = previous->fetch == NULL && previous->convert == NULL;
+      if (isPreviousRawMemory && (const uint8_t*)previous->src + previous->length == src) {
+        previous->length += length;
+        continue;
+      }
+    }
+
+    logPlanStep_t* step = &steps[stepCount];
+    step->src = src;
+    step->fetch = byFunction ? fetchers[storageType] : NULL;
+    step->convert = isRaw ? NULL : converters[storageType][logType];
+    step->length = length;
+    stepCount++;
+  }
+
+  return stepCount;
+}
+
+int logPlanRun(const logPlanStep_t* steps, const int stepCount, uint8_t* dst, const uint32_t timestamp) {
+  uint8_t* out = dst;
+
+  for (int i = 0; i < stepCount; i++) {
+    const logPlanStep_t* step = &steps[i];
+    const void* src = step->src;
+
+    uint32_t fetched;
+    if (step->fetch) {
+      step->fetch(&fetched, src, timestamp);
+      src = &fetched;
+    }
+
+    if (step->convert) {
+      step->convert(out, src);
+    } else {
+      memcpy(out, src, step->length);
+    }
+
+    out += step->length;
+  }
+
+  return out - dst;
+}
+
+bool logPlanIsSyncDue(const uint8_t syncPhase, const uint16_t syncDivider, const logSyncPhase_t phase, const uint32_t tick) {
+  return syncDivider != 0 && syncPhase == phase && (tick % syncDivider) == 0;
+}
+
+int logPlanWriteSyncHeader(uint8_t* dst, const uint8_t blockId, const uint32_t tick) {
+  dst[0] = blockId;
+  dst[1] = tick & 0x0ff;
+  dst[2] = (tick >> 8) & 0x0ff;
+  dst[3] = (tick >> 16) & 0x0ff;
+
+  return LOG_PLAN_SYNC_HEADER_LENGTH;
+}
@@ -45,11 +45,12 @@ void dtrSendP2Ppacket(const dtrPacket* packet) {
     radiolinkSendP2PPacketBroadcast(&p2p_TXpacket);
 }
 
-static void dtrFeedPacketToProtocol(dtrPacket *incoming_DTR) {
+static void dtrFeedPacketToProtocol(const dtrPacket *incoming_DTR) {
 
      bool same_packet_received =  incoming_DTR->messageType == prev_received.messageType && 
                         incoming_DTR->targetId == prev_received.targetId &&
-                        incoming_DTR->sourceId == prev_received.sourceId;
+                        incoming_DTR->sourceId == prev_received.sourceId &&
+                        incoming_DTR->seq == prev_received.seq;
 
     // if there are packets in the queue and the new packet is the same as the previous one, ignore it
     DTR_DEBUG_PRINT("Packets in RX_SRV queue: %d\n", dtrGetNumberOfPacketsInQueue(RX_SRV_Q) );
@@ -61,11 +62,24 @@ static void dtrFeedPacketToProtocol(dtrPacket *incoming_DTR) {
         return;
     }
 
+    // The packet is copied once into a packet from the pool, the protocol
+    // passes it on by reference
+    dtrPacket* packet = dtrAllocPacket();
+    if (packet == NULL) {
+        DTR_DEBUG_PRINT("No free DTR packet\n");
+        return;
+    }
+
+    memcpy(packet, incoming_DTR, incoming_DTR->packetSize);
+    if (!dtrInsertPacketToQueue(packet, RX_SRV_Q)) {
+        dtrFreePacket(packet);
+        return;
+    }
+
     prev_received.messageType = incoming_DTR->messageType;
     prev_received.targetId = incoming_DTR->targetId;
     prev_received.sourceId = incoming_DTR->sourceId;
-
-    dtrInsertPacketToQueue(incoming_DTR, RX_SRV_Q);
+    prev_received.seq = incoming_DTR->seq;
 }
 
 bool dtrP2PIncomingHandler(P2PPacket *p){
@@ -73,12 +87,16 @@ bool dtrP2PIncomingHandler(P2PPacket *p){
         return false;
     }
 
-    dtrPacket incoming_DTR;	
+    const dtrPacket* incoming_DTR = (const dtrPacket*)&(p->data[0]);
 
-    uint8_t DTRpacket_size = p->data[0];
+    // Drop malformed packets
+    uint8_t DTRpacket_size = incoming_DTR->packetSize;
+    if (DTRpacket_size < DTR_PACKET_HEADER_SIZE || DTRpacket_size > sizeof(dtrPacket) ||
+        DTRpacket_size != DTR_PACKET_HEADER_SIZE + incoming_DTR->dataSize) {
+        return true;
+    }
 
-	memcpy(&incoming_DTR, &(p->data[0]), DTRpacket_size);
-    dtrFeedPacketToProtocol(&incoming_DTR);
+    dtrFeedPacketToProtocol(incoming_DTR);
 
     return true;
 }
@@ -0,0 +1,254 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 Christos Zosimidis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * DTR_window.c
+ *
+ *  Windowed mode of the DTR protocol, see DTR_window.h
+ */
+
+#include "DTR_window.h"
+#include "string.h"
+
+static int getIndex(const dtrWindow* window, const uint8_t id) {
+	for (int i = 0; i < window->topology.size; i++) {
+		if (window->topology.devices_ids[i] == id) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void releaseSlot(dtrWindow* window, dtrWindowSlot* slot, const bool isAcked) {
+	if (isAcked) {
+		window->ackedPackets++;
+	} else {
+		window->droppedPackets++;
+	}
+
+	dtrPacket* packet = slot->packet;
+	slot->packet = NULL;
+	window->release(packet, isAcked);
+}
+
+// true if seq is covered by an ack with lastSeq and mask
+static bool isAcked(const uint8_t seq, const uint8_t lastSeq, const uint8_t mask) {
+	const int8_t back = (int8_t)(lastSeq - seq);
+	if (back < 0 || back >= 8) {
+		return false;
+	}
+	return (mask & (1 << back)) != 0;
+}
+
+void dtrWindowInit(dtrWindow* window, const dtrTopology* topology, const uint8_t selfId, const uint8_t windowSize, dtrWindowReleaseFn release) {
+	memset(window, 0, sizeof(dtrWindow));
+	window->topology = *topology;
+	window->selfId = selfId;
+	window->windowSize = windowSize > DTR_MAX_WINDOW_SIZE ? DTR_MAX_WINDOW_SIZE : windowSize;
+	window->release = release;
+}
+
+uint8_t dtrWindowFreeSlots(const dtrWindow* window) {
+	// The acks cover the 8 latest sequence numbers, the window can not span
+	// more than that from the oldest packet that is not acked
+	uint8_t span = 0;
+	for (int i = 0; i < window->windowSize; i++) {
+		const dtrWindowSlot* slot = &window->slots[i];
+		if (slot->packet != NULL) {
+			const uint8_t slotSpan = window->nextSeq - slot->packet->seq;
+			if (slotSpan > span) {
+				span = slotSpan;
+			}
+		}
+	}
+
+	return span >= window->windowSize ? 0 : window->windowSize - span;
+}
+
+bool dtrWindowAdd(dtrWindow* window, dtrPacket* packet) {
+	uint32_t pendingMask = 0;
+	if (packet->targetId == DTR_BROADCAST_ID) {
+		for (int i = 0; i < window->topology.size; i++) {
+			if (window->topology.devices_ids[i] != window->selfId) {
+				pendingMask |= 1 << i;
+			}
+		}
+	} else {
+		const int index = getIndex(window, packet->targetId);
+		if (index < 0 || packet->targetId == window->selfId) {
+			return false;
+		}
+		pendingMask = 1 << index;
+	}
+
+	if (dtrWindowFreeSlots(window) == 0) {
+		return false;
+	}
+
+	for (int i = 0; i < window->windowSize; i++) {
+		dtrWindowSlot* slot = &window->slots[i];
+		if (slot->packet == NULL) {
+			packet->seq = window->nextSeq++;
+			slot->packet = packet;
+			slot->pendingMask = pendingMask;
+			slot->sendCount = 0;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint8_t dtrWindowGetFramesToSend(dtrWindow* window, dtrPacket* packets[DTR_MAX_WINDOW_SIZE]) {
+	uint8_t count = 0;
+	for (int i = 0; i < window->windowSize; i++) {
+		dtrWindowSlot* slot = &window->slots[i];
+		if (slot->packet == NULL) {
+			continue;
+		}
+
+		if (slot->sendCount >= DTR_WINDOW_MAX_SENDS) {
+			releaseSlot(window, slot, false);
+			continue;
+		}
+
+		if (slot->sendCount > 0) {
+			window->retransmissions++;
+		}
+		slot->sendCount++;
+		window->sentFrames++;
+		packets[count++] = slot->packet;
+	}
+	return count;
+}
+
+bool dtrWindowReceive(dtrWindow* window, const dtrPacket* packet) {
+	if (packet->targetId != window->selfId && packet->targetId != DTR_BROADCAST_ID) {
+		return false;
+	}
+
+	const int index = getIndex(window, packet->sourceId);
+	if (index < 0 || packet->sourceId == window->selfId) {
+		return false;
+	}
+
+	dtrWindowRxState* rx = &window->rx[index];
+	if (!rx->isActive) {
+		return true;
+	}
+
+	const int8_t diff = (int8_t)(packet->seq - rx->lastSeq);
+	if (diff > 0) {
+		return true;
+	}
+
+	// An old packet, the sender did not get our ack. It will be acked again.
+	const int back = -diff;
+	if (back >= 8 || (rx->mask & (1 << back))) {
+		rx->hasNews = true;
+		window->duplicatePackets++;
+		return false;
+	}
+
+	return true;
+}
+
+void dtrWindowAccept(dtrWindow* window, const dtrPacket* packet) {
+	const int index = getIndex(window, packet->sourceId);
+	if (index < 0) {
+		return;
+	}
+
+	dtrWindowRxState* rx = &window->rx[index];
+	rx->hasNews = true;
+	window->deliveredPackets++;
+
+	if (!rx->isActive) {
+		rx->isActive = true;
+		rx->lastSeq = packet->seq;
+		rx->mask = 1;
+		return;
+	}
+
+	const int8_t diff = (int8_t)(packet->seq - rx->lastSeq);
+	if (diff > 0) {
+		rx->mask = diff >= 8 ? 0 : rx->mask << diff;
+		rx->mask |= 1;
+		rx->lastSeq = packet->seq;
+	} else if (-diff < 8) {
+		rx->mask |= 1 << -diff;
+	}
+}
+
+void dtrWindowWriteAcks(dtrWindow* window, dtrPacket* token) {
+	dtrWindowAck* acks = (dtrWindowAck*)token->data;
+	uint8_t count = 0;
+
+	const uint8_t firstIndex = window->nextAckIndex;
+	for (int i = 0; i < window->topology.size && count < DTR_WINDOW_MAX_ACKS; i++) {
+		const int index = (firstIndex + i) % window->topology.size;
+		dtrWindowRxState* rx = &window->rx[index];
+		if (!rx->hasNews) {
+			continue;
+		}
+
+		acks[count].sourceId = window->topology.devices_ids[index];
+		acks[count].lastSeq = rx->lastSeq;
+		acks[count].mask = rx->mask;
+		count++;
+
+		rx->hasNews = false;
+		window->nextAckIndex = (index + 1) % window->topology.size;
+	}
+
+	token->dataSize = count * sizeof(dtrWindowAck);
+	token->packetSize = DTR_PACKET_HEADER_SIZE + token->dataSize;
+}
+
+void dtrWindowHandleAcks(dtrWindow* window, const dtrPacket* token) {
+	const int senderIndex = getIndex(window, token->sourceId);
+	if (senderIndex < 0) {
+		return;
+	}
+
+	const dtrWindowAck* acks = (const dtrWindowAck*)token->data;
+	const int count = token->dataSize / sizeof(dtrWindowAck);
+
+	for (int i = 0; i < count; i++) {
+		if (acks[i].sourceId != window->selfId) {
+			continue;
+		}
+
+		for (int j = 0; j < window->windowSize; j++) {
+			dtrWindowSlot* slot = &window->slots[j];
+			if (slot->packet == NULL || !isAcked(slot->packet->seq, acks[i].lastSeq, acks[i].mask)) {
+				continue;
+			}
+
+			slot->pendingMask &= ~(1 << senderIndex);
+			if (slot->pendingMask == 0) {
+				releaseSlot(window, slot, true);
+			}
+		}
+	}
+}
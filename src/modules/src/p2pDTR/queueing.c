@@ -36,6 +36,11 @@
 
 #include "debug.h"
 
+static dtrPacket packetPool[DTR_PACKET_POOL_SIZE];
+
+// Packets in the pool that are not in use
+static xQueueHandle FREE_queue;
+
 // TX SRV packet queue
 static xQueueHandle TX_DATA_queue;
 
@@ -64,23 +69,42 @@ static xQueueHandle *getQueueHandler(DTRQueue_Names qName){
 
 
 void dtrQueueingInit(){
+	// Packet pool
+	STATIC_MEM_QUEUE_ALLOC(FREE_queue, DTR_PACKET_POOL_SIZE, sizeof(dtrPacket*));
+	FREE_queue = STATIC_MEM_QUEUE_CREATE(FREE_queue);
+	for (int i = 0; i < DTR_PACKET_POOL_SIZE; i++) {
+		dtrFreePacket(&packetPool[i]);
+	}
+
 	// TX SRV queue
-	STATIC_MEM_QUEUE_ALLOC(TX_DATA_queue, TX_DATA_QUEUE_SIZE, sizeof(dtrPacket));
+	STATIC_MEM_QUEUE_ALLOC(TX_DATA_queue, TX_DATA_QUEUE_SIZE, sizeof(dtrPacket*));
 	TX_DATA_queue = STATIC_MEM_QUEUE_CREATE(TX_DATA_queue);
 	DEBUG_QUEUE_MONITOR_REGISTER(TX_DATA_queue);
 
 	// RX SRV queue
-	STATIC_MEM_QUEUE_ALLOC(RX_SRV_queue, RX_SRV_QUEUE_SIZE, sizeof(dtrPacket));
+	STATIC_MEM_QUEUE_ALLOC(RX_SRV_queue, RX_SRV_QUEUE_SIZE, sizeof(dtrPacket*));
 	RX_SRV_queue = STATIC_MEM_QUEUE_CREATE(RX_SRV_queue);
 	DEBUG_QUEUE_MONITOR_REGISTER(RX_SRV_queue);
 
 	// RX DATA queue
-	STATIC_MEM_QUEUE_ALLOC(RX_DATA_queue, RX_DATA_QUEUE_SIZE, sizeof(dtrPacket));
+	STATIC_MEM_QUEUE_ALLOC(RX_DATA_queue, RX_DATA_QUEUE_SIZE, sizeof(dtrPacket*));
 	RX_DATA_queue = STATIC_MEM_QUEUE_CREATE(RX_DATA_queue);
 	DEBUG_QUEUE_MONITOR_REGISTER(RX_DATA_queue);
 
 }
 
+dtrPacket* dtrAllocPacket(void) {
+	dtrPacket* packet;
+	if (xQueueReceive(FREE_queue, &packet, 0) != pdTRUE) {
+		return NULL;
+	}
+	return packet;
+}
+
+void dtrFreePacket(dtrPacket* packet) {
+	xQueueSend(FREE_queue, &packet, 0);
+}
+
 uint8_t dtrGetNumberOfPacketsInQueue(DTRQueue_Names qName){
 	return (uint8_t) uxQueueMessagesWaiting(*getQueueHandler(qName));
 }
@@ -89,38 +113,26 @@ bool dtrIsPacketInQueueAvailable(DTRQueue_Names qName) {
 	return uxQueueMessagesWaiting(*getQueueHandler(qName)) > 0;
 }
 
-bool dtrGetPacketFromQueue(dtrPacket *packet, DTRQueue_Names qName, uint32_t timeout){
-	// notice that xQueuePeek is used instead of xQueueReceive, because the packet is not removed from the queue
-    //TODO: make a separate function for this
-	bool received_success = false;
-	switch (qName)
-	{
-	case TX_DATA_Q:
-		received_success = xQueuePeek(TX_DATA_queue, packet, timeout) == pdTRUE;
-		break;
-	
-	case RX_SRV_Q:
-		received_success = xQueueReceive(RX_SRV_queue, packet, timeout) == pdTRUE;
-		break;
-	case RX_DATA_Q:
-		received_success = xQueueReceive(RX_DATA_queue, packet, timeout) == pdTRUE;
-		break;
-
-	default:
-		DEBUG_PRINT("Invalid DTR queue name\n");
-		received_success = false;
-		break;
+bool dtrGetPacketFromQueue(dtrPacket **packet, DTRQueue_Names qName, uint32_t timeout){
+	// notice that xQueuePeek is used for the TX_DATA queue, because the packet is not removed from the queue
+	if (qName == TX_DATA_Q) {
+		return xQueuePeek(TX_DATA_queue, packet, timeout) == pdTRUE;
 	}
-	return received_success;
+
+	return dtrTakePacketFromQueue(packet, qName, timeout);
+}
+
+bool dtrTakePacketFromQueue(dtrPacket **packet, DTRQueue_Names qName, uint32_t timeout){
+	return xQueueReceive(*getQueueHandler(qName), packet, timeout) == pdTRUE;
 }
 
-bool dtrReceivePacketWaitUntil(dtrPacket *packet, DTRQueue_Names qName, uint32_t timeout_ms, bool *new_packet_received){
+bool dtrReceivePacketWaitUntil(dtrPacket **packet, DTRQueue_Names qName, uint32_t timeout_ms, bool *new_packet_received){
 	*new_packet_received = xQueueReceive(*getQueueHandler(qName), packet, M2T(timeout_ms)) == pdTRUE;
 	return true;
 }
 
 bool dtrInsertPacketToQueue(dtrPacket *packet, DTRQueue_Names qName) {
-	bool res = (xQueueSend(*getQueueHandler(qName),(void *) packet, 0) == pdTRUE);
+	bool res = (xQueueSend(*getQueueHandler(qName), &packet, 0) == pdTRUE);
 	if (!res) {
 		DEBUG_PRINT("TX_DATA queue busy\n");
 	}
@@ -129,12 +141,20 @@ bool dtrInsertPacketToQueue(dtrPacket *packet, DTRQueue_Names qName) {
 }
 
 bool dtrReleasePacketFromQueue(DTRQueue_Names qName) {
-	dtrPacket packet;
-	return xQueueReceive(*getQueueHandler(qName), &packet, M2T(TX_RECEIVED_WAIT_TIME)) == pdTRUE;
+	dtrPacket* packet;
+	if (xQueueReceive(*getQueueHandler(qName), &packet, M2T(TX_RECEIVED_WAIT_TIME)) != pdTRUE) {
+		return false;
+	}
+
+	dtrFreePacket(packet);
+	return true;
 }
 
 void dtrEmptyQueue(DTRQueue_Names qName) {
-	xQueueReset(*getQueueHandler(qName));
+	dtrPacket* packet;
+	while (xQueueReceive(*getQueueHandler(qName), &packet, 0) == pdTRUE) {
+		dtrFreePacket(packet);
+	}
 }
 
 void dtrEmptyQueues(void){
@@ -32,6 +32,8 @@
 
 
 #include "token_ring.h"
+#include "DTR_window.h"
+#include "statsCnt.h"
 
 #define DEBUG_MODULE "TOK_RING"
 #include "debug.h"
@@ -47,6 +49,9 @@ static dtrPacket* timerDTRpacket;
 
 static dtrPacket startPacket; // not sure if this is needed
 
+// The DATA frame that is sent in stop-and-wait mode, the target changes for each hop
+static dtrPacket txDataPk;
+
 static dtrPacket servicePk = {
 	.dataSize = 0,
 	.packetSize = DTR_PACKET_HEADER_SIZE,
@@ -63,6 +68,17 @@ static uint8_t my_id ;
 
 static dtrTopology networkTopology;
 
+// Windowed mode, used if the window size is larger than 1
+static uint8_t windowSize = 1;
+static dtrWindow window;
+static dtrPacket tokenPk;
+
+#define DTR_RATE_INTERVAL_MS 1000
+// Data packets that reached all targets
+static STATS_CNT_RATE_DEFINE(txRate, DTR_RATE_INTERVAL_MS);
+// Data packets delivered to the RX_DATA queue
+static STATS_CNT_RATE_DEFINE(rxRate, DTR_RATE_INTERVAL_MS);
+
 
 // DEBUGGING FUNCTIONS
 #ifdef DEBUG_DTR_PROTOCOL
@@ -80,6 +96,8 @@ static const char* getMessageType(uint8_t messageType){
 		return "RTS";
 	case DATA_ACK_FRAME:
 		return "DATA_ACK";
+	case WINDOW_DATA_FRAME:
+		return "WINDOW_DATA";
 	default:
 		return "UNKNOWN";
 	}
@@ -168,12 +186,34 @@ static void setNodeIds(dtrTopology topology, uint8_t device_id) {
 	DTR_DEBUG_PRINT("prev node_id: %d\n", prev_node_id);
 }
 
+static bool isWindowed(void) {
+	return windowSize > 1;
+}
+
+static void releaseWindowPacket(dtrPacket* packet, bool isAcked) {
+	if (isAcked) {
+		STATS_CNT_RATE_EVENT(&txRate);
+	} else {
+		DEBUG_PRINT("Dropping DTR packet to %d, not acknowledged\n", packet->targetId);
+		radioMetaInfo.droppedPackets++;
+	}
+
+	dtrFreePacket(packet);
+}
+
 static void initTokenRing(dtrTopology topology, uint8_t device_id) {
 	my_id = dtrGetSelfId();
 
 	/* Network node configuration*/
 	setNodeIds(topology, my_id);
 
+	if (isWindowed()) {
+		dtrWindowInit(&window, &topology, my_id, windowSize, releaseWindowPacket);
+		tokenPk.sourceId = my_id;
+		tokenPk.targetId = 254;
+		tokenPk.messageType = TOKEN_FRAME;
+	}
+
 	rx_state = RX_IDLE;
 }
 
@@ -246,17 +286,278 @@ static void resetProtocol(void){
 // static uint8_t send_data_to_peer_counter = 0;
 static uint8_t next_sender_id = 255;
 
+// Hands over a received data packet to the RX_DATA queue
+// @return true if the packet is in the queue, false if the caller still owns it
+static bool deliverPacket(dtrPacket* rxPk) {
+	if (!dtrInsertPacketToQueue(rxPk, RX_DATA_Q)) {
+		radioMetaInfo.failedRxQueueFull++;
+		return false;
+	}
+
+	STATS_CNT_RATE_EVENT(&rxRate);
+	return true;
+}
+
+// Copies the first packet in the TX_DATA queue to the stop-and-wait DATA frame,
+// the packet stays in the queue until it has been sent to all targets.
+static bool getDataPacket(void) {
+	dtrPacket* packet;
+	if (!dtrGetPacketFromQueue(&packet, TX_DATA_Q, M2T(TX_RECEIVED_WAIT_TIME))) {
+		return false;
+	}
+
+	memcpy(&txDataPk, packet, packet->packetSize);
+	return true;
+}
+
+static bool isStartPacket(const dtrPacket* packet) {
+	return packet->dataSize >= 2 && (packet->data[0] == (uint8_t) (START_PACKET >> 8))
+		&& (packet->data[1] == (uint8_t) START_PACKET);
+}
+
+// Sends the DATA frames of the window and forwards the token, with acks for
+// the frames received from the other nodes
+static void sendWindow(void) {
+	dtrPacket* txPk;
+	while (dtrWindowFreeSlots(&window) > 0 && dtrTakePacketFromQueue(&txPk, TX_DATA_Q, 0)) {
+		txPk->messageType = WINDOW_DATA_FRAME;
+		if (!dtrWindowAdd(&window, txPk)) {
+			DEBUG_PRINT("Releasing DTR TX packet,target is not in topology.\n");
+			dtrFreePacket(txPk);
+		}
+	}
+
+	dtrPacket* frames[DTR_MAX_WINDOW_SIZE];
+	const uint32_t retransmissions = window.retransmissions;
+	const uint8_t frameCount = dtrWindowGetFramesToSend(&window, frames);
+	radioMetaInfo.retransmissions += window.retransmissions - retransmissions;
+
+	DTR_DEBUG_PRINT("Sending %d DATA frames\n", frameCount);
+	for (int i = 0; i < frameCount; i++) {
+		dtrSendP2Ppacket(frames[i]);
+		radioMetaInfo.sendPackets++;
+	}
+
+	dtrWindowWriteAcks(&window, &tokenPk);
+	setupRadioTx(&tokenPk, TX_TOKEN);
+}
+
+// Handles a received packet
+// @return true if the packet has been handed over to a queue, false if it can be freed
+static bool handlePacket(dtrPacket* rxPk) {
+	dtrPacket* txPk;
+
+	if (isWindowed()) {
+		/* DATA frames and acks are handled in all states in windowed mode */
+		if (rxPk->messageType == WINDOW_DATA_FRAME) {
+			if (!dtrWindowReceive(&window, rxPk)) {
+				return false;
+			}
+			if (isStartPacket(rxPk)) {
+				dtrWindowAccept(&window, rxPk);
+				return false;
+			}
+			/* Only ack the frame once it is in the queue, the sender will
+			* send it again if the queue is full. */
+			if (!deliverPacket(rxPk)) {
+				return false;
+			}
+			dtrWindowAccept(&window, rxPk);
+			return true;
+		}
+
+		if (rxPk->messageType == TOKEN_FRAME) {
+			dtrWindowHandleAcks(&window, rxPk);
+		}
+	}
+
+	switch (rx_state) {
+
+		case RX_IDLE:
+			/* if packet is DATA packet and received from previous node,
+			* then it can be handled. */
+			if (rxPk->messageType == DATA_FRAME && rxPk->targetId == node_id) {
+				DTR_DEBUG_PRINT("\nReceived DATA packet from prev\n");
+				bool received_starting_packet = (rxPk->data[0] == (uint8_t) (START_PACKET >> 8)) 
+											 && (rxPk->data[1] == (uint8_t) START_PACKET) ;
+				const uint8_t sourceId = rxPk->sourceId;
+				bool handedOver = false;
+				if (sourceId != last_packet_source_id  && !received_starting_packet) {
+					/* if packet is relevant and receiver queue is not full, then
+					* push packet in the queue and prepare queue for next packet. */
+					handedOver = deliverPacket(rxPk);
+					if (!handedOver) {
+						/* Do not ack, the sender will send it again */
+						return false;
+					}
+					last_packet_source_id = sourceId;
+				}
+					/* Acknowledge the data */
+					DTR_DEBUG_PRINT("\nSending ACK packet\n");
+					servicePk.messageType = DATA_ACK_FRAME;
+					servicePk.targetId = sourceId;
+					setupRadioTx(&servicePk, TX_DATA_ACK);
+					return handedOver;
+				}
+
+			/* if packet is TOKEN packet and received from previous node, then
+			* send a TOKEN_ACK packet and prepare the packet for the timer. */
+			if (rxPk->messageType == TOKEN_FRAME && rxPk->sourceId == prev_node_id) {
+				DTR_DEBUG_PRINT("\nReceived TOKEN from prev\n");
+				servicePk.messageType = RTS_FRAME;
+				setupRadioTx(&servicePk, TX_RTS);
+				return false;
+			}
+
+			/* if packet is RTS packet and received from next node, then send
+			* a CTS packet to next node. */
+			if (rxPk->messageType == RTS_FRAME && rxPk->sourceId == next_node_id) {
+				DTR_DEBUG_PRINT("\nReceived RTS from next -> CTS to next\n");
+				servicePk.messageType = CTS_FRAME;
+				setupRadioTx(&servicePk, TX_CTS);
+				return false;
+			}
+			
+			DTR_DEBUG_PRINT("\nRECEIVED PACKET NOT HANDLED\n");
+			/* drop all other packets and restart receiver */
+			break;
+
+		case RX_WAIT_CTS:
+
+			/* if packet is CTS and received from previous node, then node can
+			 * send its next DATA packet. */
+			if (rxPk->messageType == CTS_FRAME && rxPk->sourceId == prev_node_id) {
+				dtrShutdownSenderTimer();
+				last_packet_source_id = node_id;
+
+				if (isWindowed()) {
+					sendWindow();
+					return false;
+				}
+
+				DTR_DEBUG_PRINT("\nRcvd CTS from prev,send DATA to next\n");
+				/* check if there is a DATA packet. If yes, prepare it and
+				 * send it, otherwise forward the token to the next node. */
+				
+				if (getDataPacket()) {
+					txPk = &txDataPk;
+					DTR_DEBUG_PRINT("TX DATA Packet exists (dataSize: %d), sending it\n",txPk->dataSize);
+					if(txPk->targetId == 0xFF) {
+						txPk->targetId = next_node_id;
+					}
+					if (!IdExistsInTopology(txPk->targetId)) {
+						DEBUG_PRINT("Releasing DTR TX packet,target is not in topology.\n");
+						DTR_DEBUG_PRINT("Is Queue Empty: %d\n", !dtrIsPacketInQueueAvailable(TX_DATA_Q));
+						
+						dtrReleasePacketFromQueue(TX_DATA_Q);
+						txPk = &servicePk;
+						txPk->messageType = TOKEN_FRAME;
+						tx_state = TX_TOKEN;
+					} else {
+						txPk->packetSize = DTR_PACKET_HEADER_SIZE + txPk->dataSize;
+						txPk->sourceId = node_id;
+						txPk->messageType = DATA_FRAME;
+						tx_state = TX_DATA_FRAME;
+					}
+				} else {
+					DTR_DEBUG_PRINT("No TX DATA,forwarding token to next\n");
+					txPk = &servicePk;
+					txPk->messageType = TOKEN_FRAME;
+					tx_state = TX_TOKEN;
+				}
+
+				setupRadioTx(txPk, tx_state);
+				return false;
+			}
+
+			/* drop all other packets and restart receiver */
+			break;
+
+		case RX_WAIT_RTS:
+
+			/* if packet is TOKEN_ACK and received from next node, then
+			 * a CTS packet can be sent. */
+			if (rxPk->messageType == RTS_FRAME && rxPk->sourceId == next_node_id) {
+				DTR_DEBUG_PRINT("\nReceived TOKEN_ACK from next->sending CTS \n");
+				dtrShutdownSenderTimer();
+				servicePk.messageType = CTS_FRAME;
+				setupRadioTx(&servicePk, TX_CTS);
+				return false;
+			}
+
+			/* drop all other packets and restart receiver */
+			break;
+
+		case RX_WAIT_DATA_ACK:
+			if (rxPk->messageType == DATA_ACK_FRAME && rxPk->targetId == node_id) {
+				dtrShutdownSenderTimer();
+
+				getDataPacket();
+				txPk = &txDataPk;
+				
+				if (next_sender_id == 255){
+					next_target_id = getNextNodeId(node_id);
+				}
+				else {
+					next_target_id = getNextNodeId(next_sender_id);
+				}
+
+				DTR_DEBUG_PRINT("next_target_id: %d\n", next_target_id);
+
+				bool not_in_broadcast_mode = !(txPk->targetId == 0xFF);
+				bool reached_desired_node = not_in_broadcast_mode && (txPk->targetId == next_target_id)  ; 
+				
+				bool reached_self = (next_target_id == node_id);
+
+				if ( reached_desired_node || reached_self ) {
+					DTR_DEBUG_PRINT("Releasing TX DATA:\n");
+					// dtrPrintPacket(txPk);
+					
+					if (reached_desired_node){
+						DTR_DEBUG_PRINT("Reached desired node (%d), stop data sending earlier...\n", txPk->targetId);
+					}
+					DTR_DEBUG_PRINT("Is Q Empty: %d\n", !dtrIsPacketInQueueAvailable(TX_DATA_Q));
+
+					dtrReleasePacketFromQueue(TX_DATA_Q);
+					STATS_CNT_RATE_EVENT(&txRate);
+					txPk = &servicePk;
+					txPk->messageType = TOKEN_FRAME;
+					tx_state = TX_TOKEN;
+					next_sender_id = 255;
+				} else {							
+					txPk->targetId = next_target_id;
+					next_sender_id = next_target_id;
+					DTR_DEBUG_PRINT("Sending DATA to next peer..");
+					DTR_DEBUG_PRINT("with target id: %d\n", txPk->targetId);
+					tx_state = TX_DATA_FRAME;
+				}
+				setupRadioTx(txPk, tx_state);
+				return false;
+			}
+
+			/* drop all other packets and restart receiver */
+			break;
+
+		default:
+			DEBUG_PRINT("\nRadio receiver state not set correctly!!\n");
+			return false;
+		}
+
+	// TODO: There are cases that the packet received from queue
+	// is the same to the one that was previously received and already processed.
+	// Maybe when releasing the packet, also release the ones that are similar to it in the queue.
+	return false;
+}
+
 void dtrTaskHandler(void *param) {
 
-	dtrPacket* rxPk, *txPk;
+	dtrPacket* rxPk;
 
-	//TODO: bad implementation, should be fixed
-	dtrPacket _rxPk ;
 	protocol_timeout_ms = T2M(xTaskGetTickCount()) + PROTOCOL_TIMEOUT_MS;
 	bool new_packet_received;
 
 	DTR_DEBUG_PRINT("\nDTRInterruptHandler Task called...\n");
-	while ( dtrReceivePacketWaitUntil(&_rxPk, 	RX_SRV_Q, PROTOCOL_TIMEOUT_MS, &new_packet_received) ){
+	while ( dtrReceivePacketWaitUntil(&rxPk, 	RX_SRV_Q, PROTOCOL_TIMEOUT_MS, &new_packet_received) ){
 			if (!new_packet_received) {
 				DTR_DEBUG_PRINT("\nPROTOCOL TIMEOUT!\n");
 				if (my_id != networkTopology.devices_ids[0]) {
@@ -266,8 +567,6 @@ void dtrTaskHandler(void *param) {
 				continue;
 			}
 
-			rxPk = &_rxPk;	
-			
 			radioMetaInfo.receivedPackets++;
 
 			DTR_DEBUG_PRINT("===============================================================\n");
@@ -282,181 +581,9 @@ void dtrTaskHandler(void *param) {
 			DTR_DEBUG_PRINT("Received packet target id: %d\n", rxPk->targetId);
 			DTR_DEBUG_PRINT("my_id: %d\n", node_id);
 
-			switch (rx_state) {
-
-				case RX_IDLE:
-					/* if packet is DATA packet and received from previous node,
-					* then it can be handled. */
-					if (rxPk->messageType == DATA_FRAME && rxPk->targetId == node_id) {
-						DTR_DEBUG_PRINT("\nReceived DATA packet from prev\n");
-						bool received_starting_packet = (rxPk->data[0] == (uint8_t) (START_PACKET >> 8)) 
-													 && (rxPk->data[1] == (uint8_t) START_PACKET) ;
-						if (rxPk->sourceId != last_packet_source_id  && !received_starting_packet) {
-							last_packet_source_id = rxPk->sourceId;
-							/* if packet is relevant and receiver queue is not full, then
-							* push packet in the queue and prepare queue for next packet. */
-							bool queueFull = !dtrInsertPacketToQueue(rxPk, RX_DATA_Q);
-							if (queueFull){
-								radioMetaInfo.failedRxQueueFull++;
-							}
-						}
-							/* Acknowledge the data */
-							DTR_DEBUG_PRINT("Received DATA %d\n", rxPk->data[0]);
-							DTR_DEBUG_PRINT("\nSending ACK packet\n");
-							servicePk.messageType = DATA_ACK_FRAME;
-							servicePk.targetId = rxPk->sourceId;
-							setupRadioTx(&servicePk, TX_DATA_ACK);
-							continue;
-						}
-
-					/* if packet is TOKEN packet and received from previous node, then
-					* send a TOKEN_ACK packet and prepare the packet for the timer. */
-					if (rxPk->messageType == TOKEN_FRAME && rxPk->sourceId == prev_node_id) {
-						DTR_DEBUG_PRINT("\nReceived TOKEN from prev\n");
-						servicePk.messageType = RTS_FRAME;
-						setupRadioTx(&servicePk, TX_RTS);
-						continue;
-					}
-
-					/* if packet is RTS packet and received from next node, then send
-					* a CTS packet to next node. */
-					if (rxPk->messageType == RTS_FRAME && rxPk->sourceId == next_node_id) {
-						DTR_DEBUG_PRINT("\nReceived RTS from next -> CTS to next\n");
-						servicePk.messageType = CTS_FRAME;
-						setupRadioTx(&servicePk, TX_CTS);
-						continue;
-					}
-					
-					DTR_DEBUG_PRINT("\nRECEIVED PACKET NOT HANDLED\n");
-					/* drop all other packets and restart receiver */
-					break;
-
-				case RX_WAIT_CTS:
-
-					/* if packet is CTS and received from previous node, then node can
-					 * send its next DATA packet. */
-					if (rxPk->messageType == CTS_FRAME && rxPk->sourceId == prev_node_id) {
-						dtrShutdownSenderTimer();
-						last_packet_source_id = node_id;
-						DTR_DEBUG_PRINT("\nRcvd CTS from prev,send DATA to next\n");
-						/* check if there is a DATA packet. If yes, prepare it and
-						 * send it, otherwise forward the token to the next node. */
-						
-						dtrPacket _txPk;//TODO: bad implementation, should be fixed
-						if (dtrGetPacketFromQueue(&_txPk, TX_DATA_Q, M2T(TX_RECEIVED_WAIT_TIME))) {
-							txPk = &_txPk;
-							DTR_DEBUG_PRINT("TX DATA Packet exists (dataSize: %d), sending it\n",txPk->dataSize);
-							if(txPk->targetId == 0xFF) {
-								txPk->targetId = next_node_id;
-							}
-							if (!IdExistsInTopology(txPk->targetId)) {
-								DEBUG_PRINT("Releasing DTR TX packet,target is not in topology.\n");
-								DTR_DEBUG_PRINT("Is Queue Empty: %d\n", !dtrIsPacketInQueueAvailable(TX_DATA_Q));
-								
-								dtrReleasePacketFromQueue(TX_DATA_Q);
-								txPk = &servicePk;
-								txPk->messageType = TOKEN_FRAME;
-								tx_state = TX_TOKEN;
-							} else {
-								txPk->packetSize = DTR_PACKET_HEADER_SIZE + txPk->dataSize;
-								txPk->sourceId = node_id;
-								txPk->messageType = DATA_FRAME;
-								tx_state = TX_DATA_FRAME;
-							}
-						} else {
-							DTR_DEBUG_PRINT("No TX DATA,forwarding token to next\n");
-							txPk = &servicePk;
-							txPk->messageType = TOKEN_FRAME;
-							tx_state = TX_TOKEN;
-						}
-
-						setupRadioTx(txPk, tx_state);
-						continue;
-					}
-
-					/* drop all other packets and restart receiver */
-					break;
-
-				case RX_WAIT_RTS:
-
-					/* if packet is TOKEN_ACK and received from next node, then
-					 * a CTS packet can be sent. */
-					if (rxPk->messageType == RTS_FRAME && rxPk->sourceId == next_node_id) {
-						DTR_DEBUG_PRINT("\nReceived TOKEN_ACK from next->sending CTS \n");
-						dtrShutdownSenderTimer();
-						servicePk.messageType = CTS_FRAME;
-						setupRadioTx(&servicePk, TX_CTS);
-						continue;
-					}
-
-					/* drop all other packets and restart receiver */
-					break;
-
-				case RX_WAIT_DATA_ACK:
-					if (rxPk->messageType == DATA_ACK_FRAME && rxPk->targetId == node_id) {
-						dtrShutdownSenderTimer();
-
-						//TODO: bad implementation, should be fixed
-						dtrPacket _txPk;
-						dtrGetPacketFromQueue(&_txPk, TX_DATA_Q, M2T(TX_RECEIVED_WAIT_TIME));
-						txPk = &_txPk;
-						
-						if (next_sender_id == 255){
-							next_target_id = getNextNodeId(node_id);
-						}
-						else {
-							next_target_id = getNextNodeId(next_sender_id);
-						}
-
-						DTR_DEBUG_PRINT("next_target_id: %d\n", next_target_id);
-
-						bool not_in_broadcast_mode = !(txPk->targetId == 0xFF);
-						bool reached_desired_node = not_in_broadcast_mode && (txPk->targetId == next_target_id)  ; 
-						
-						bool reached_self = (next_target_id == node_id);
-
-						if ( reached_desired_node || reached_self ) {
-							DTR_DEBUG_PRINT("Releasing TX DATA:\n");
-							// dtrPrintPacket(txPk);
-							
-							if (reached_desired_node){
-								DTR_DEBUG_PRINT("Reached desired node (%d), stop data sending earlier...\n", txPk->targetId);
-							}
-							DTR_DEBUG_PRINT("Is Q Empty: %d\n", !dtrIsPacketInQueueAvailable(TX_DATA_Q));
-
-							dtrReleasePacketFromQueue(TX_DATA_Q);
-							txPk = &servicePk;
-							txPk->messageType = TOKEN_FRAME;
-							tx_state = TX_TOKEN;
-							next_sender_id = 255;
-						} else {							
-							txPk->targetId = next_target_id;
-							next_sender_id = next_target_id;
-							DTR_DEBUG_PRINT("Sending DATA to next peer..");
-							DTR_DEBUG_PRINT("with target id: %d\n", txPk->targetId);
-							tx_state = TX_DATA_FRAME;
-						}
-						setupRadioTx(txPk, tx_state);
-						continue;
-					}
-
-					/* drop all other packets and restart receiver */
-					break;
-
-				default:
-					DEBUG_PRINT("\nRadio receiver state not set correctly!!\n");
-					continue;
-				}
-
-			// TODO: There are cases that the packet received from queue
-			// is the same to the one that was previously received and already processed.
-			// Maybe when releasing the packet, also release the ones that are similar to it in the queue.
-
-			// DEBUG_PRINT("Packet Received cannot be processed\n");
-			// DEBUG_PRINT("State: %d\n", rx_state);
-			// DEBUG_PRINT("Packet type: %d\n", rxPk->messageType);
-
-			// resetProtocol(); //TODO: test if it makes sense
+			if (!handlePacket(rxPk)) {
+				dtrFreePacket(rxPk);
+			}
 		}
 	
 }
@@ -489,6 +616,7 @@ void dtrTimeOutCallBack(xTimerHandle timer) {
 			break;
 		case TX_DATA_FRAME:
 			radioMetaInfo.timeOutDATA++;
+			radioMetaInfo.retransmissions++;
 			break;
 		default:
 			break;
@@ -584,19 +712,52 @@ void DisableDTRProtocol(void){
 
 
 bool dtrSendPacket(dtrPacket* packet){
+	if (packet->dataSize > MAXIMUM_DTR_PACKET_DATA_SIZE) {
+		return false;
+	}
+
 	packet->messageType = DATA_FRAME;
 	packet->sourceId = node_id;
 	packet->packetSize = DTR_PACKET_HEADER_SIZE + packet->dataSize;
-	return  dtrInsertPacketToQueue(packet,TX_DATA_Q);
+
+	dtrPacket* txPk = dtrAllocPacket();
+	if (txPk == NULL) {
+		radioMetaInfo.failedTxQueueFull++;
+		return false;
+	}
+
+	memcpy(txPk, packet, packet->packetSize);
+	if (!dtrInsertPacketToQueue(txPk, TX_DATA_Q)) {
+		radioMetaInfo.failedTxQueueFull++;
+		dtrFreePacket(txPk);
+		return false;
+	}
+
+	return true;
 }
 
 
 bool dtrGetPacket(dtrPacket* packet, uint32_t timeout){
-	return  dtrGetPacketFromQueue(packet,RX_DATA_Q,timeout);
+	dtrPacket* rxPk;
+	if (!dtrTakePacketFromQueue(&rxPk, RX_DATA_Q, timeout)) {
+		return false;
+	}
+
+	memcpy(packet, rxPk, rxPk->packetSize);
+	dtrFreePacket(rxPk);
+	return true;
+}
+
+void dtrSetWindowSize(uint8_t size) {
+	windowSize = size > DTR_MAX_WINDOW_SIZE ? DTR_MAX_WINDOW_SIZE : size;
 }
 
 
 LOG_GROUP_START(DTR_P2P)
 	LOG_ADD(LOG_UINT8, rx_state, &rx_state)
 	LOG_ADD(LOG_UINT8, tx_state, &tx_state)
+	STATS_CNT_RATE_LOG_ADD(txRate, &txRate)
+	STATS_CNT_RATE_LOG_ADD(rxRate, &rxRate)
+	LOG_ADD(LOG_UINT32, retransmit, &radioMetaInfo.retransmissions)
+	LOG_ADD(LOG_UINT32, dropped, &radioMetaInfo.droppedPackets)
 LOG_GROUP_STOP(DTR_P2P)
@@ -3,12 +3,38 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "peer_localization.h"
+#include "param.h"
+#include "log.h"
+#include "statsCnt.h"
 
 
+// array of other's position
+static peerLocalizationOtherPosition_t other_positions[PEER_LOCALIZATION_MAX_NEIGHBORS];
+
+// Maps a radio id to (slot index + 1) in other_positions, 0 means no slot.
+static uint8_t slotById[PEER_LOCALIZATION_ID_COUNT];
+
+static uint8_t nrOfPeers = 0;
+
+// A peer that has not been heard from for this long may be replaced by a new
+// one when the table is full.
+static uint32_t staleAgeMs = 1000;
+
+// Peer positions are extrapolated with the velocity of the peer for at most
+// this long.
+static uint32_t maxExtrapolationMs = PEER_LOCALIZATION_MAX_EXTRAPOLATION_MS;
+
+// Stats
+static uint32_t evictedCount = 0;
+static uint32_t rejectedCount = 0;
+static STATS_CNT_RATE_DEFINE(insertRate, 1000);
+static STATS_CNT_RATE_DEFINE(lookupRate, 1000);
+
 void peerLocalizationInit()
 {
-  // All other_positions[in].id will be set to zero due to static initialization.
-  // If we ever switch to dynamic allocation, we need to set them to zero explicitly.
+  // All other_positions[in].id and slotById[] will be set to zero due to static
+  // initialization. If we ever switch to dynamic allocation, we need to set
+  // them to zero explicitly.
 }
 
 bool peerLocalizationTest()
@@ -16,42 +42,99 @@ bool peerLocalizationTest()
   return true;
 }
 
-// array of other's position
-static peerLocalizationOtherPosition_t other_positions[PEER_LOCALIZATION_MAX_NEIGHBORS];
+static int findSlotForNewPeer(uint32_t now)
+{
+  if (nrOfPeers < PEER_LOCALIZATION_MAX_NEIGHBORS) {
+    for (int i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
+      if (other_positions[i].id == 0) {
+        nrOfPeers++;
+        return i;
+      }
+    }
+  }
+
+  // The table is full, replace the peer we have not heard from for the longest
+  // time, but only if it is stale.
+  int oldest = 0;
+  for (int i = 1; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
+    if ((int32_t)(other_positions[i].pos.timestamp - other_positions[oldest].pos.timestamp) < 0) {
+      oldest = i;
+    }
+  }
+  if (now - other_positions[oldest].pos.timestamp < staleAgeMs) {
+    return -1;
+  }
+
+  slotById[other_positions[oldest].id] = 0;
+  other_positions[oldest].id = 0;
+  evictedCount++;
+  return oldest;
+}
 
 bool peerLocalizationTellPosition(int cfid, positionMeasurement_t const *pos)
 {
-  for (uint8_t i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
-    if (other_positions[i].id == 0 || other_positions[i].id == cfid) {
-      other_positions[i].id = cfid;
-      other_positions[i].pos.x = pos->x;
-      other_positions[i].pos.y = pos->y;
-      other_positions[i].pos.z = pos->z;
-      other_positions[i].pos.timestamp = xTaskGetTickCount();
-      return true;
+  return peerLocalizationTellPositionAt(cfid, pos, xTaskGetTickCount());
+}
+
+bool peerLocalizationTellPositionAt(int cfid, positionMeasurement_t const *pos, uint32_t timestamp)
+{
+  velocity_t const vel = {0};
+  return peerLocalizationTellStateAt(cfid, pos, &vel, timestamp);
+}
+
+bool peerLocalizationTellStateAt(int cfid, positionMeasurement_t const *pos, velocity_t const *vel, uint32_t timestamp)
+{
+  if (cfid <= 0 || cfid >= PEER_LOCALIZATION_ID_COUNT) {
+    return false;
+  }
+
+  uint32_t const now = xTaskGetTickCount();
+  STATS_CNT_RATE_EVENT(&insertRate);
+
+  int slot = slotById[cfid] - 1;
+  if (slot >= 0 && (int32_t)(timestamp - other_positions[slot].pos.timestamp) < 0) {
+    // We already have a more recent position
+    return true;
+  }
+
+  if (slot < 0) {
+    slot = findSlotForNewPeer(now);
+    if (slot < 0) {
+      rejectedCount++;
+      return false;
     }
+    other_positions[slot].id = cfid;
+    slotById[cfid] = slot + 1;
   }
-  return false;
+
+  other_positions[slot].pos.x = pos->x;
+  other_positions[slot].pos.y = pos->y;
+  other_positions[slot].pos.z = pos->z;
+  other_positions[slot].pos.timestamp = timestamp;
+  other_positions[slot].vel.x = vel->x;
+  other_positions[slot].vel.y = vel->y;
+  other_positions[slot].vel.z = vel->z;
+  other_positions[slot].vel.timestamp = timestamp;
+  return true;
 }
 
 bool peerLocalizationIsIDActive(uint8_t cfid)
 {
-  for (uint8_t i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
-    if (other_positions[i].id == cfid) {
-      return true;
-    }
-  }
-  return false;
+  return peerLocalizationGetPositionByID(cfid) != NULL;
 }
 
 peerLocalizationOtherPosition_t *peerLocalizationGetPositionByID(uint8_t cfid)
 {
-  for (uint8_t i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
-    if (other_positions[i].id == cfid) {
-      return &other_positions[i];
-    }
+  STATS_CNT_RATE_EVENT(&lookupRate);
+  if (cfid == 0) {
+    return NULL;
   }
-  return NULL;
+
+  int const slot = slotById[cfid] - 1;
+  if (slot < 0) {
+    return NULL;
+  }
+  return &other_positions[slot];
 }
 
 peerLocalizationOtherPosition_t *peerLocalizationGetPositionByIdx(uint8_t idx)
@@ -62,3 +145,131 @@ peerLocalizationOtherPosition_t *peerLocalizationGetPositionByIdx(uint8_t idx)
   }
   return NULL;
 }
+
+void peerLocalizationGetPosition(peerLocalizationOtherPosition_t const *other, point_t *result)
+{
+  peerLocalizationExtrapolate(other, xTaskGetTickCount(), maxExtrapolationMs, result);
+}
+
+// Scratch for peerLocalizationGetNearest(), static to keep it off the stack of
+// the caller, the stabilizer task. The function is only called from one task.
+static float nearestDist2[PEER_LOCALIZATION_MAX_NEIGHBORS];
+
+int peerLocalizationGetNearest(point_t const *center, struct vec const *scale, int maxAgeMillis, peerLocalizationOtherPosition_t const *result[], int k, int *nDropped)
+{
+  STATS_CNT_RATE_EVENT(&lookupRate);
+  if (nDropped) {
+    *nDropped = 0;
+  }
+  if (k > PEER_LOCALIZATION_MAX_NEIGHBORS) {
+    k = PEER_LOCALIZATION_MAX_NEIGHBORS;
+  }
+  if (k <= 0) {
+    return 0;
+  }
+
+  uint32_t const now = xTaskGetTickCount();
+  struct vec const scaleInv = scale ? veltrecip(*scale) : vrepeat(1.0f);
+  int dropped = 0;
+
+  // Keep the k closest peers found so far, sorted by increasing distance.
+  float* dist2 = nearestDist2;
+  int count = 0;
+
+  for (int i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
+    peerLocalizationOtherPosition_t const *other = &other_positions[i];
+    if (other->id == 0) {
+      continue;
+    }
+    if (maxAgeMillis >= 0 && now - other->pos.timestamp > (uint32_t)maxAgeMillis) {
+      continue;
+    }
+
+    point_t position;
+    peerLocalizationExtrapolate(other, now, maxExtrapolationMs, &position);
+    float const dx = (position.x - center->x) * scaleInv.x;
+    float const dy = (position.y - center->y) * scaleInv.y;
+    float const dz = (position.z - center->z) * scaleInv.z;
+    float const d2 = dx * dx + dy * dy + dz * dz;
+
+    if (count == k) {
+      dropped++;
+      if (d2 >= dist2[k - 1]) {
+        continue;
+      }
+    }
+
+    int pos = (count < k) ? count++ : k - 1;
+    while (pos > 0 && dist2[pos - 1] > d2) {
+      dist2[pos] = dist2[pos - 1];
+      result[pos] = result[pos - 1];
+      pos--;
+    }
+    dist2[pos] = d2;
+    result[pos] = other;
+  }
+
+  // Return the peers in table order, it stays the same from call to call as
+  // long as the set of peers does not change.
+  for (int i = 1; i < count; ++i) {
+    peerLocalizationOtherPosition_t const *other = result[i];
+    int pos = i;
+    while (pos > 0 && result[pos - 1] > other) {
+      result[pos] = result[pos - 1];
+      pos--;
+    }
+    result[pos] = other;
+  }
+
+  if (nDropped) {
+    *nDropped = dropped;
+  }
+  return count;
+}
+
+/**
+ * Peer localization table, holding the latest known positions of other
+ * Crazyflies.
+ */
+LOG_GROUP_START(peerLoc)
+  /**
+   * @brief Number of peers in the table
+   */
+  LOG_ADD(LOG_UINT8, nPeers, &nrOfPeers)
+
+  /**
+   * @brief Rate of position updates for peers [1/s]
+   */
+  STATS_CNT_RATE_LOG_ADD(insertRate, &insertRate)
+
+  /**
+   * @brief Rate of lookups by id and nearest neighbor queries [1/s]
+   */
+  STATS_CNT_RATE_LOG_ADD(lookupRate, &lookupRate)
+
+  /**
+   * @brief Number of stale peers replaced by new peers when the table was full
+   */
+  LOG_ADD(LOG_UINT32, evicted, &evictedCount)
+
+  /**
+   * @brief Number of new peers dropped because the table was full of fresh peers
+   */
+  LOG_ADD(LOG_UINT32, rejected, &rejectedCount)
+LOG_GROUP_STOP(peerLoc)
+
+/**
+ * Peer localization table, holding the latest known positions of other
+ * Crazyflies.
+ */
+PARAM_GROUP_START(peerLoc)
+  /**
+   * @brief Time [ms] after which a peer may be replaced by a new peer when the table is full (default 1000)
+   */
+  PARAM_ADD(PARAM_UINT32, staleAge, &staleAgeMs)
+
+  /**
+   * @brief Max time [ms] that peer positions are extrapolated with the velocity of the peer (default 100)
+   */
+  PARAM_ADD(PARAM_UINT32, maxExtrap, &maxExtrapolationMs)
+PARAM_GROUP_STOP(peerLoc)
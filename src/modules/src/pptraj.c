@@ -239,11 +239,6 @@ static struct vec polyval_xyz(struct poly4d const *p, float t)
 	return mkvec(polyval(p->p[0], t), polyval(p->p[1], t), polyval(p->p[2], t));
 }
 
-static float polyval_yaw(struct poly4d const *p, float t)
-{
-	return polyval(p->p[3], t);
-}
-
 // compute loose maximum of acceleration -
 // uses L1 norm instead of Euclidean, evaluates polynomial instead of root-finding
 float poly4d_max_accel_approx(struct poly4d const *p)
@@ -289,27 +284,65 @@ bool is_traj_eval_valid(struct traj_eval const *ev)
 	return !visnan(ev->pos);
 }
 
+// evaluate the 4 dimensions and their derivatives up to jerk in one pass over
+// the coefficients. The derivative coefficients are computed the same way as
+// in polyder() and the Horner steps are done in the same order as in polyval(),
+// so the result is identical to differentiating and evaluating each dimension.
+// The inner loops run over the dimensions to allow vectorization.
+void poly4d_eval_derivs(struct poly4d const *p, float t, float derivs[PP_N_DERIVS][4])
+{
+	float x0[4] = {0, 0, 0, 0};
+	float x1[4] = {0, 0, 0, 0};
+	float x2[4] = {0, 0, 0, 0};
+	float x3[4] = {0, 0, 0, 0};
+
+	for (int i = PP_DEGREE; i >= 0; --i) {
+		for (int d = 0; d < 4; ++d) {
+			const float c0 = p->p[d][i];
+			const float c1 = i * c0;
+			const float c2 = (i - 1) * c1;
+			const float c3 = (i - 2) * c2;
+
+			x0[d] = x0[d] * t + c0;
+			if (i >= 1) {
+				x1[d] = x1[d] * t + c1;
+			}
+			if (i >= 2) {
+				x2[d] = x2[d] * t + c2;
+			}
+			if (i >= 3) {
+				x3[d] = x3[d] * t + c3;
+			}
+		}
+	}
+
+	for (int d = 0; d < 4; ++d) {
+		derivs[0][d] = x0[d];
+		derivs[1][d] = x1[d];
+		derivs[2][d] = x2[d];
+		derivs[3][d] = x3[d];
+	}
+}
+
 struct traj_eval poly4d_eval(struct poly4d const *p, float t)
 {
+	float derivs[PP_N_DERIVS][4];
+	poly4d_eval_derivs(p, t, derivs);
+
 	// flat variables
 	struct traj_eval out;
-	out.pos = polyval_xyz(p, t);
-	out.yaw = polyval_yaw(p, t);
+	out.pos = mkvec(derivs[0][0], derivs[0][1], derivs[0][2]);
+	out.yaw = derivs[0][3];
 
 	// 1st derivative
-	struct poly4d* deriv = &poly4d_tmp;
-	*deriv = *p;
-	polyder4d(deriv);
-	out.vel = polyval_xyz(deriv, t);
-	float dyaw = polyval_yaw(deriv, t);
+	out.vel = mkvec(derivs[1][0], derivs[1][1], derivs[1][2]);
+	float dyaw = derivs[1][3];
 
 	// 2nd derivative
-	polyder4d(deriv);
-	out.acc = polyval_xyz(deriv, t);
+	out.acc = mkvec(derivs[2][0], derivs[2][1], derivs[2][2]);
 
 	// 3rd derivative
-	polyder4d(deriv);
-	out.jerk = polyval_xyz(deriv, t);
+	out.jerk = mkvec(derivs[3][0], derivs[3][1], derivs[3][2]);
 
 	struct vec thrust = vadd(out.acc, mkvec(0, 0, GRAV));
 	// float thrust_mag = mass * vmag(thrust);
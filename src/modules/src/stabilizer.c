@@ -56,6 +56,7 @@
 #include "statsCnt.h"
 #include "static_mem.h"
 #include "rateSupervisor.h"
+#include "usec_time.h"
 
 static bool isInit;
 
@@ -82,6 +83,51 @@ static rateSupervisor_t rateSupervisorContext;
 static bool rateWarningDisplayed = false;
 SemaphoreHandle_t xRateSupervisorSemaphore;
 
+// The work done in the stabilizer loop is divided into slots. Each slot runs at
+// a rate and a phase offset (in ticks) within its period, and the execution
+// time of each slot is measured. Lower rate slots are given different phases
+// to spread the work over the ticks, see RATE_PHASE_xxx. All slots run in the
+// stabilizer task, the slots only decide on which ticks the work is done.
+typedef enum {
+  slotEstimator = 0,
+  slotCommander,
+  slotSupervisor,
+  slotCollisionAvoidance,
+  slotController,
+  slotMotors,
+  slotUsdLogging,
+  slotCount,
+} stabilizerSlotId_t;
+
+typedef struct {
+  uint16_t rateHz;
+  uint16_t phase;
+  rateSupervisorTiming_t timing;
+} stabilizerSlot_t;
+
+// Budgets are rough expectations of the execution time of a slot, in us.
+// Exceeding the budget is counted as an overrun.
+static stabilizerSlot_t slots[slotCount] = {
+  [slotEstimator] =          {.rateHz = RATE_MAIN_LOOP, .timing = {.budgetUs = 400}},
+  [slotCommander] =          {.rateHz = RATE_MAIN_LOOP, .timing = {.budgetUs = 100}},
+  [slotSupervisor] =         {.rateHz = RATE_SUPERVISOR, .phase = RATE_PHASE_SUPERVISOR, .timing = {.budgetUs = 100}},
+  [slotCollisionAvoidance] = {.rateHz = RATE_MAIN_LOOP, .timing = {.budgetUs = 200}},
+  [slotController] =         {.rateHz = RATE_MAIN_LOOP, .timing = {.budgetUs = 200}},
+  [slotMotors] =             {.rateHz = RATE_MAIN_LOOP, .timing = {.budgetUs = 50}},
+  // The rate of the uSD logging is set at run time
+  [slotUsdLogging] =         {.rateHz = 0, .phase = RATE_PHASE_USD_LOGGING, .timing = {.budgetUs = 100}},
+};
+
+// The phase pattern of all slots repeats with the period of the slowest slot
+#define STABILIZER_HYPERPERIOD (RATE_MAIN_LOOP / RATE_SUPERVISOR)
+// Length of the window in which the max execution times are measured, in ticks
+#define STABILIZER_TIMING_WINDOW RATE_MAIN_LOOP
+
+static rateSupervisorTiming_t loopTiming = {.budgetUs = 1000};
+static uint16_t loopMaxPhase;
+static uint16_t loopMaxPhaseWindow;
+static uint32_t slotOverrunCount;
+
 static struct {
   // position - mm
   int16_t x;
@@ -257,6 +303,42 @@ static void controlMotors(const control_t* control) {
   setMotorRatios(&motorPwm);
 }
 
+static bool slotIsDue(const stabilizerSlotId_t id, const stabilizerStep_t stabilizerStep)
+{
+  const stabilizerSlot_t* slot = &slots[id];
+  return slot->rateHz > 0 && RATE_DO_EXECUTE_PHASE(slot->rateHz, slot->phase, stabilizerStep);
+}
+
+static void slotStart(const stabilizerSlotId_t id)
+{
+  rateSupervisorTimingStart(&slots[id].timing, (uint32_t)usecTimestamp());
+}
+
+static void slotStop(const stabilizerSlotId_t id)
+{
+  if (!rateSupervisorTimingStop(&slots[id].timing, (uint32_t)usecTimestamp())) {
+    slotOverrunCount++;
+  }
+}
+
+static void updateLoopTiming(const stabilizerStep_t stabilizerStep)
+{
+  if (!rateSupervisorTimingStop(&loopTiming, (uint32_t)usecTimestamp())) {
+    slotOverrunCount++;
+  }
+  if (loopTiming.latestUs == loopTiming.windowMaxUs) {
+    loopMaxPhaseWindow = stabilizerStep % STABILIZER_HYPERPERIOD;
+  }
+
+  if (stabilizerStep % STABILIZER_TIMING_WINDOW == 0) {
+    rateSupervisorTimingNewWindow(&loopTiming);
+    loopMaxPhase = loopMaxPhaseWindow;
+    for (int i = 0; i < slotCount; i++) {
+      rateSupervisorTimingNewWindow(&slots[i].timing);
+    }
+  }
+}
+
 void rateSupervisorTask(void *pvParameters) {
   while (1) {
     // Wait for the semaphore to be given by the stabilizerTask
@@ -318,12 +400,18 @@ static void stabilizerTask(void* param)
     if (healthShallWeRunTest()) {
       healthRunTests(&sensorData);
     } else {
+      rateSupervisorTimingStart(&loopTiming, (uint32_t)usecTimestamp());
+
       updateStateEstimatorAndControllerTypes();
 
+      slotStart(slotEstimator);
       stateEstimator(&state, stabilizerStep);
+      slotStop(slotEstimator);
+      logSyncCapture(logSyncPhaseEstimator, stabilizerStep);
 
       const bool areMotorsAllowedToRun = supervisorAreMotorsAllowedToRun();
 
+      slotStart(slotCommander);
       // Critical for safety, be careful if you modify this code!
       crtpCommanderBlock(! areMotorsAllowedToRun);
 
@@ -331,41 +419,57 @@ static void stabilizerTask(void* param)
         commanderSetSetpoint(&tempSetpoint, COMMANDER_PRIORITY_HIGHLEVEL);
       }
       commanderGetSetpoint(&setpoint, &state);
+      slotStop(slotCommander);
 
       // Critical for safety, be careful if you modify this code!
       // Let the supervisor update it's view of the current situation
-      supervisorUpdate(&sensorData, &setpoint, stabilizerStep);
+      if (slotIsDue(slotSupervisor, stabilizerStep)) {
+        slotStart(slotSupervisor);
+        supervisorUpdate(&sensorData, &setpoint, stabilizerStep);
+        slotStop(slotSupervisor);
+      }
 
       // Let the collision avoidance module modify the setpoint, if needed
+      slotStart(slotCollisionAvoidance);
       collisionAvoidanceUpdateSetpoint(&setpoint, &sensorData, &state, stabilizerStep);
+      slotStop(slotCollisionAvoidance);
 
       // Critical for safety, be careful if you modify this code!
       // Let the supervisor modify the setpoint to handle exceptional conditions
       supervisorOverrideSetpoint(&setpoint);
 
+      slotStart(slotController);
       controller(&control, &setpoint, &sensorData, &state, stabilizerStep);
+      slotStop(slotController);
+      logSyncCapture(logSyncPhaseController, stabilizerStep);
 
       // Critical for safety, be careful if you modify this code!
       // The supervisor will already set thrust to 0 in the setpoint if needed, but to be extra sure prevent motors from running.
+      slotStart(slotMotors);
       if (areMotorsAllowedToRun) {
         controlMotors(&control);
       } else {
         motorsStop();
       }
+      slotStop(slotMotors);
 
       // Compute compressed log formats
       compressState();
       compressSetpoint();
+      logSyncCapture(logSyncPhaseMotors, stabilizerStep);
 
 #ifdef CONFIG_DECK_USD
       // Log data to uSD card if configured
-      if (usddeckLoggingEnabled()
-          && usddeckLoggingMode() == usddeckLoggingMode_SynchronousStabilizer
-          && RATE_DO_EXECUTE(usddeckFrequency(), stabilizerStep)) {
+      const bool isUsdLoggingSynchronous = usddeckLoggingEnabled() && usddeckLoggingMode() == usddeckLoggingMode_SynchronousStabilizer;
+      slots[slotUsdLogging].rateHz = usddeckFrequency();
+      if (isUsdLoggingSynchronous && slotIsDue(slotUsdLogging, stabilizerStep)) {
+        slotStart(slotUsdLogging);
         usddeckTriggerLogging();
+        slotStop(slotUsdLogging);
       }
 #endif
       calcSensorToOutputLatency(&sensorData);
+      updateLoopTiming(stabilizerStep);
       stabilizerStep++;
       STATS_CNT_RATE_EVENT(&stabilizerRate);
     }
@@ -553,6 +657,50 @@ STATS_CNT_RATE_LOG_ADD(rtStab, &stabilizerRate)
  *    Note: Used for debugging but could also be used as a system test
  */
 LOG_ADD(LOG_UINT32, intToOut, &inToOutLatency)
+/**
+ * @brief Max execution time of the stabilizer loop during the last second [us]
+ */
+LOG_ADD(LOG_UINT32, tLoop, &loopTiming.latestMaxUs)
+/**
+ * @brief Tick within the slot phase pattern (0-39) where the max loop execution time occurred during the last second
+ */
+LOG_ADD(LOG_UINT16, tLoopPh, &loopMaxPhase)
+/**
+ * @brief Number of stabilizer loops that took longer than 1 ms
+ */
+LOG_ADD(LOG_UINT32, ovrLoop, &loopTiming.overrunCount)
+/**
+ * @brief Number of slots that took longer than their budget, including the loop itself
+ */
+LOG_ADD(LOG_UINT32, ovrSlot, &slotOverrunCount)
+/**
+ * @brief Max execution time of the estimator slot during the last second [us]
+ */
+LOG_ADD(LOG_UINT32, tEst, &slots[slotEstimator].timing.latestMaxUs)
+/**
+ * @brief Max execution time of the commander slot during the last second [us]
+ */
+LOG_ADD(LOG_UINT32, tCmd, &slots[slotCommander].timing.latestMaxUs)
+/**
+ * @brief Max execution time of the supervisor slot during the last second [us]
+ */
+LOG_ADD(LOG_UINT32, tSup, &slots[slotSupervisor].timing.latestMaxUs)
+/**
+ * @brief Max execution time of the collision avoidance slot during the last second [us]
+ */
+LOG_ADD(LOG_UINT32, tColAv, &slots[slotCollisionAvoidance].timing.latestMaxUs)
+/**
+ * @brief Max execution time of the controller slot during the last second [us]
+ */
+LOG_ADD(LOG_UINT32, tCtrl, &slots[slotController].timing.latestMaxUs)
+/**
+ * @brief Max execution time of the motor slot during the last second [us]
+ */
+LOG_ADD(LOG_UINT32, tMotors, &slots[slotMotors].timing.latestMaxUs)
+/**
+ * @brief Max execution time of the uSD logging slot during the last second [us]
+ */
+LOG_ADD(LOG_UINT32, tUsd, &slots[slotUsdLogging].timing.latestMaxUs)
 LOG_GROUP_STOP(stabilizer)
 
 /**
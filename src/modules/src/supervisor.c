@@ -402,10 +402,6 @@ static void updateLogData(SupervisorMem_t* this, const supervisorConditionBits_t
 }
 
 void supervisorUpdate(const sensorData_t *sensors, const setpoint_t* setpoint, stabilizerStep_t stabilizerStep) {
-  if (!RATE_DO_EXECUTE(RATE_SUPERVISOR, stabilizerStep)) {
-    return;
-  }
-
   SupervisorMem_t* this = &supervisorMem;
   const uint32_t currentTick = xTaskGetTickCount();
 
@@ -0,0 +1,352 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * swarm_state.c - Time synchronized state broadcast in a swarm
+ */
+
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "swarm_state.h"
+#include "config.h"
+#include "configblock.h"
+#include "system.h"
+#include "supervisor.h"
+#include "usec_time.h"
+#include "static_mem.h"
+#include "statsCnt.h"
+#include "param.h"
+#include "log.h"
+#include "cfassert.h"
+#include "math3d.h"
+
+#define DEBUG_MODULE "SWARM"
+#include "debug.h"
+
+_Static_assert(sizeof(swarmStatePacket_t) <= P2P_MAX_DATA_SIZE, "Swarm state packet does not fit in a P2P packet");
+
+#define RX_QUEUE_LENGTH 5
+#define STATS_INTERVAL_MS 1000
+
+typedef struct {
+  P2PPacket packet;
+  uint64_t rxTimeUs;
+} rxItem_t;
+
+static bool isInit = false;
+// Only used by the swarm state task
+static swarmStateCore_t core;
+
+// Copies of the peer table for other tasks. The task fills the one that is not
+// published and then publishes it, readers look up a peer in a critical section.
+static swarmStateCorePeer_t peerTables[2][SWARM_STATE_MAX_PEERS];
+static swarmStateCorePeer_t* publishedPeers = peerTables[0];
+
+static QueueHandle_t rxQueue;
+STATIC_MEM_QUEUE_ALLOC(rxQueue, RX_QUEUE_LENGTH, sizeof(rxItem_t));
+
+STATIC_MEM_TASK_ALLOC(swarmStateTask, SWARM_STATE_TASK_STACKSIZE);
+
+// Log ids of our own state
+static struct {
+  logVarId_t x, y, z;
+  logVarId_t vx, vy, vz;
+  logVarId_t yaw;
+} stateIds;
+
+// Parameters
+static uint16_t periodMs = 100;
+static uint8_t slotCount = 10;
+
+// Stats
+static STATS_CNT_RATE_DEFINE(txRate, STATS_INTERVAL_MS);
+static STATS_CNT_RATE_DEFINE(rxRate, STATS_INTERVAL_MS);
+static STATS_CNT_RATE_DEFINE(airtime, STATS_INTERVAL_MS);
+static STATS_CNT_RATE_DEFINE(channelAirtime, STATS_INTERVAL_MS);
+static float lossRatio;
+static uint8_t referenceId;
+static int32_t syncErrorUs;
+
+static void swarmStateTask(void* param);
+
+void swarmStateInit(void) {
+  if (isInit) {
+    return;
+  }
+
+  swarmStateCoreInit(&core, configblockGetRadioAddress() & 0xff);
+
+  rxQueue = STATIC_MEM_QUEUE_CREATE(rxQueue);
+  ASSERT(rxQueue);
+
+  STATIC_MEM_TASK_CREATE(swarmStateTask, swarmStateTask, SWARM_STATE_TASK_NAME, NULL, SWARM_STATE_TASK_PRI);
+
+  isInit = true;
+}
+
+bool swarmStateTest(void) {
+  return isInit;
+}
+
+void swarmStateReceive(const P2PPacket* p) {
+  if (!isInit) {
+    return;
+  }
+
+  rxItem_t item;
+  item.rxTimeUs = usecTimestamp();
+  memcpy(&item.packet, p, sizeof(item.packet));
+
+  // Called from the radio link, do not block it
+  xQueueSend(rxQueue, &item, 0);
+}
+
+bool swarmStateGetPeer(const uint8_t id, swarmPeerState_t* state) {
+  if (id == 0) {
+    return false;
+  }
+
+  bool isKnown = false;
+  taskENTER_CRITICAL();
+  for (int i = 0; i < SWARM_STATE_MAX_PEERS; i++) {
+    if (publishedPeers[i].state.id == id) {
+      *state = publishedPeers[i].state;
+      isKnown = true;
+      break;
+    }
+  }
+  taskEXIT_CRITICAL();
+
+  return isKnown;
+}
+
+static void publishPeers(void) {
+  swarmStateCorePeer_t* next = (publishedPeers == peerTables[0]) ? peerTables[1] : peerTables[0];
+  memcpy(next, core.peers, sizeof(core.peers));
+
+  taskENTER_CRITICAL();
+  publishedPeers = next;
+  taskEXIT_CRITICAL();
+}
+
+static uint32_t getPeriodUs(void) {
+  return (uint32_t)periodMs * 1000;
+}
+
+static uint8_t getStatus(void) {
+  uint8_t status = 0;
+  if (supervisorIsArmed()) {
+    status |= SWARM_STATE_STATUS_ARMED;
+  }
+  if (supervisorIsFlying()) {
+    status |= SWARM_STATE_STATUS_FLYING;
+  }
+  if (supervisorIsTumbled()) {
+    status |= SWARM_STATE_STATUS_TUMBLED;
+  }
+  if (supervisorIsLocked()) {
+    status |= SWARM_STATE_STATUS_LOCKED;
+  }
+  return status;
+}
+
+static void getOwnState(const uint32_t nowMs, swarmPeerState_t* own) {
+  own->status = getStatus();
+  own->pos.x = logGetFloat(stateIds.x);
+  own->pos.y = logGetFloat(stateIds.y);
+  own->pos.z = logGetFloat(stateIds.z);
+  own->pos.timestamp = nowMs;
+  own->vel.x = logGetFloat(stateIds.vx);
+  own->vel.y = logGetFloat(stateIds.vy);
+  own->vel.z = logGetFloat(stateIds.vz);
+  own->vel.timestamp = nowMs;
+  // The state estimate log has yaw in degrees
+  own->yaw = radians(logGetFloat(stateIds.yaw));
+}
+
+static void sendState(void) {
+  const uint32_t nowMs = T2M(xTaskGetTickCount());
+  const uint64_t nowUs = usecTimestamp();
+
+  swarmPeerState_t own;
+  getOwnState(nowMs, &own);
+
+  static P2PPacket p;
+  p.port = SWARM_STATE_P2P_PORT;
+  p.size = swarmStateCoreBuildPacket(&core, &own, nowUs, nowMs, getPeriodUs(), (swarmStatePacket_t*)p.data);
+  radiolinkSendP2PPacketBroadcast(&p);
+
+  STATS_CNT_RATE_EVENT(&txRate);
+  STATS_CNT_RATE_MULTI_EVENT(&airtime, swarmStateCoreAirtimeUs(p.size));
+}
+
+static void handleReceived(const rxItem_t* item) {
+  const uint32_t nowMs = T2M(xTaskGetTickCount());
+  if (swarmStateCoreHandlePacket(&core, item->packet.data, item->packet.size, item->rxTimeUs, nowMs, getPeriodUs())) {
+    publishPeers();
+    STATS_CNT_RATE_EVENT(&rxRate);
+    STATS_CNT_RATE_MULTI_EVENT(&channelAirtime, swarmStateCoreAirtimeUs(item->packet.size));
+  }
+}
+
+static void updateStats(void) {
+  const uint32_t total = core.receivedCount + core.lostCount;
+  if (total > 0) {
+    lossRatio = (float)core.lostCount / total;
+  }
+  core.receivedCount = 0;
+  core.lostCount = 0;
+
+  const uint32_t nowMs = T2M(xTaskGetTickCount());
+  const bool isReferenceHeard = (nowMs - core.referenceHeardMs) <= SWARM_STATE_SYNC_TIMEOUT_MS;
+  referenceId = isReferenceHeard ? core.referenceId : 0;
+  syncErrorUs = core.latestSyncErrorUs;
+}
+
+static void swarmStateTask(void* param) {
+  systemWaitStart();
+
+  stateIds.x = logGetVarId("stateEstimate", "x");
+  stateIds.y = logGetVarId("stateEstimate", "y");
+  stateIds.z = logGetVarId("stateEstimate", "z");
+  stateIds.vx = logGetVarId("stateEstimate", "vx");
+  stateIds.vy = logGetVarId("stateEstimate", "vy");
+  stateIds.vz = logGetVarId("stateEstimate", "vz");
+  stateIds.yaw = logGetVarId("stateEstimate", "yaw");
+
+  uint32_t nextStatsMs = T2M(xTaskGetTickCount()) + STATS_INTERVAL_MS;
+  uint32_t latestTxFrame = UINT32_MAX;
+
+  while (true) {
+    if (periodMs == 0 || slotCount == 0) {
+      vTaskDelay(M2T(STATS_INTERVAL_MS));
+      continue;
+    }
+
+    const uint32_t periodUs = getPeriodUs();
+    const uint64_t nowUs = usecTimestamp();
+    const uint32_t waitUs = swarmStateCoreTimeToSlotUs(&core, nowUs, periodUs, slotCount);
+
+    if (waitUs == 0) {
+      // Only one packet per frame, also if the clock is moved back
+      const uint32_t frame = (nowUs + core.clockOffsetUs) / periodUs;
+      if (frame != latestTxFrame) {
+        sendState();
+        latestTxFrame = frame;
+      }
+    }
+
+    // Handle received packets until the next slot, at least one tick
+    uint32_t waitMs = waitUs / 1000;
+    if (waitUs == 0) {
+      waitMs = periodMs / slotCount / 2;
+    }
+    if (waitMs == 0) {
+      waitMs = 1;
+    }
+
+    rxItem_t item;
+    if (xQueueReceive(rxQueue, &item, M2T(waitMs)) == pdTRUE) {
+      handleReceived(&item);
+    }
+
+    const uint32_t nowMs = T2M(xTaskGetTickCount());
+    if ((int32_t)(nowMs - nextStatsMs) >= 0) {
+      updateStats();
+      nextStatsMs = nowMs + STATS_INTERVAL_MS;
+    }
+  }
+}
+
+// The phase of the frame clock is sent in a uint16
+static void periodChanged(void) {
+  if (periodMs > SWARM_STATE_MAX_PERIOD_MS) {
+    periodMs = SWARM_STATE_MAX_PERIOD_MS;
+  }
+}
+
+/**
+ * Time synchronized broadcast of the state of the Crazyflies in a swarm over
+ * P2P. Each Crazyflie sends its position, velocity, yaw and status once per
+ * frame in its own slot, together with the state of some of its peers.
+ * Received positions are handed to peer localization.
+ */
+PARAM_GROUP_START(swarm)
+
+/**
+ * @brief Frame period [ms], each Crazyflie sends one packet per frame. Must be the same in the swarm. Max 6553 ms.
+ */
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT16, period, &periodMs, periodChanged)
+
+/**
+ * @brief Number of slots in a frame, a Crazyflie sends in slot (radio id % slots). Must be the same in the swarm.
+ */
+PARAM_ADD(PARAM_UINT8, slots, &slotCount)
+
+PARAM_GROUP_STOP(swarm)
+
+/**
+ * Swarm state broadcast statistics
+ */
+LOG_GROUP_START(swarm)
+
+/**
+ * @brief Rate of sent packets [packets/s]
+ */
+STATS_CNT_RATE_LOG_ADD(txRate, &txRate)
+
+/**
+ * @brief Rate of received packets [packets/s]
+ */
+STATS_CNT_RATE_LOG_ADD(rxRate, &rxRate)
+
+/**
+ * @brief Time on air of the packets sent by this Crazyflie [us/s]
+ */
+STATS_CNT_RATE_LOG_ADD(airtime, &airtime)
+
+/**
+ * @brief Time on air of the packets received from peers [us/s]
+ */
+STATS_CNT_RATE_LOG_ADD(chAirtime, &channelAirtime)
+
+/**
+ * @brief Ratio of the packets from peers that were lost during the last second, based on sequence numbers
+ */
+LOG_ADD(LOG_FLOAT, loss, &lossRatio)
+
+/**
+ * @brief Id of the peer used as clock reference, 0 if this Crazyflie is the reference
+ */
+LOG_ADD(LOG_UINT8, refId, &referenceId)
+
+/**
+ * @brief Latest correction of the frame clock [us]
+ */
+LOG_ADD(LOG_INT32, syncErr, &syncErrorUs)
+
+LOG_GROUP_STOP(swarm)
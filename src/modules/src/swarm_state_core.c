@@ -0,0 +1,300 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * swarm_state_core.c - Slot schedule, packet format and peer table of the swarm state broadcast
+ */
+
+
+/*
+Time is divided in frames of swarm.period ms, a frame is divided in swarm.slots
+slots and a Crazyflie sends one packet in slot (radio id % swarm.slots). All
+Crazyflies follow the frame clock of the Crazyflie with the lowest id that they
+have heard from recently. A packet carries the phase of the frame clock of the
+sender and receivers with a higher id adjust their own clock to it. The radio
+latency delays the clock of all followers by about the same amount, packets
+are sent in the first half of the slot and the second half is a guard.
+
+Each packet holds the state of the sender, followed by the latest state of a
+few peers that the sender has heard directly, in turns. A Crazyflie that is
+out of range of a peer gets its state through the others.
+*/
+
+#include <string.h>
+#include <math.h>
+
+#include "swarm_state_core.h"
+#include "peer_localization.h"
+#include "FreeRTOS.h"
+
+// Radio overhead of a P2P packet: preamble, address, packet control field, CRC and the port byte
+#define AIR_OVERHEAD_BYTES 11
+// At 2 Mbit/s
+#define AIR_US_PER_BYTE 4
+
+static int16_t quantize(const float value, const float scale) {
+  const float scaled = roundf(value * scale);
+  if (scaled > INT16_MAX) {
+    return INT16_MAX;
+  }
+  if (scaled < INT16_MIN) {
+    return INT16_MIN;
+  }
+  return (int16_t)scaled;
+}
+
+static void packEntry(const swarmPeerState_t* state, const uint8_t id, const uint32_t nowMs, swarmStateEntry_t* entry) {
+  uint32_t age = (nowMs - state->pos.timestamp) / SWARM_STATE_AGE_UNIT_MS;
+  if (age > UINT8_MAX) {
+    age = UINT8_MAX;
+  }
+
+  entry->id = id;
+  entry->status = state->status;
+  entry->age = age;
+  entry->pos[0] = quantize(state->pos.x, 1000.0f);
+  entry->pos[1] = quantize(state->pos.y, 1000.0f);
+  entry->pos[2] = quantize(state->pos.z, 1000.0f);
+  entry->vel[0] = quantize(state->vel.x, 1000.0f);
+  entry->vel[1] = quantize(state->vel.y, 1000.0f);
+  entry->vel[2] = quantize(state->vel.z, 1000.0f);
+  entry->yaw = quantize(state->yaw, 10000.0f);
+}
+
+static void unpackEntry(const swarmStateEntry_t* entry, const uint32_t nowMs, swarmPeerState_t* state) {
+  state->id = entry->id;
+  state->status = entry->status;
+  state->pos.x = entry->pos[0] / 1000.0f;
+  state->pos.y = entry->pos[1] / 1000.0f;
+  state->pos.z = entry->pos[2] / 1000.0f;
+  state->pos.timestamp = nowMs - (uint32_t)entry->age * SWARM_STATE_AGE_UNIT_MS;
+  state->vel.x = entry->vel[0] / 1000.0f;
+  state->vel.y = entry->vel[1] / 1000.0f;
+  state->vel.z = entry->vel[2] / 1000.0f;
+  state->vel.timestamp = state->pos.timestamp;
+  state->yaw = entry->yaw / 10000.0f;
+}
+
+static swarmStateCorePeer_t* findPeer(swarmStateCore_t* this, const uint8_t id) {
+  for (int i = 0; i < SWARM_STATE_MAX_PEERS; i++) {
+    if (this->peers[i].state.id == id) {
+      return &this->peers[i];
+    }
+  }
+  return 0;
+}
+
+// Finds a free entry, or replaces the peer that has been updated least
+// recently if it is stale
+static swarmStateCorePeer_t* addPeer(swarmStateCore_t* this, const uint8_t id, const uint32_t nowMs) {
+  swarmStateCorePeer_t* oldest = &this->peers[0];
+  for (int i = 0; i < SWARM_STATE_MAX_PEERS; i++) {
+    swarmStateCorePeer_t* peer = &this->peers[i];
+    if (peer->state.id == 0) {
+      oldest = peer;
+      break;
+    }
+    if ((int32_t)(peer->state.pos.timestamp - oldest->state.pos.timestamp) < 0) {
+      oldest = peer;
+    }
+  }
+
+  if (oldest->state.id != 0 && (nowMs - oldest->state.pos.timestamp) < SWARM_STATE_STALE_AGE_MS) {
+    return 0;
+  }
+
+  memset(oldest, 0, sizeof(*oldest));
+  oldest->state.id = id;
+  return oldest;
+}
+
+static void synchronizeClock(swarmStateCore_t* this, const uint8_t senderId, const uint16_t senderPhase, const uint64_t rxTimeUs, const uint32_t nowMs, const uint32_t periodUs) {
+  if (senderId > this->ownId) {
+    return;
+  }
+
+  const bool isReferenceLost = (nowMs - this->referenceHeardMs) > SWARM_STATE_SYNC_TIMEOUT_MS;
+  if (this->referenceId != 0 && senderId > this->referenceId && !isReferenceLost) {
+    return;
+  }
+
+  this->referenceId = senderId;
+  this->referenceHeardMs = nowMs;
+
+  const uint32_t localPhaseUs = swarmStateCoreFramePhaseUs(this, rxTimeUs, periodUs);
+  const uint32_t senderPhaseUs = ((uint32_t)senderPhase * SWARM_STATE_PHASE_UNIT_US) % periodUs;
+
+  // Shortest way around the frame
+  int32_t errorUs = (int32_t)senderPhaseUs - (int32_t)localPhaseUs;
+  if (errorUs > (int32_t)(periodUs / 2)) {
+    errorUs -= periodUs;
+  } else if (errorUs <= -(int32_t)(periodUs / 2)) {
+    errorUs += periodUs;
+  }
+
+  this->clockOffsetUs = (this->clockOffsetUs % periodUs + periodUs + errorUs) % periodUs;
+  this->latestSyncErrorUs = errorUs;
+}
+
+static void updateLossStats(swarmStateCore_t* this, swarmStateCorePeer_t* peer, const uint8_t seq, const uint32_t nowMs) {
+  // Only count lost packets if the peer was heard recently, it might have been
+  // out of range or restarted
+  if (peer->heardMs != 0 && (nowMs - peer->heardMs) < SWARM_STATE_STALE_AGE_MS) {
+    const uint8_t gap = seq - peer->seq - 1;
+    if (gap < 128) {
+      this->lostCount += gap;
+    }
+  }
+
+  this->receivedCount++;
+  peer->seq = seq;
+  peer->heardMs = nowMs;
+}
+
+static void updatePeer(swarmStateCore_t* this, const swarmStateEntry_t* entry, const bool isSender, const uint8_t seq, const uint32_t nowMs) {
+  swarmPeerState_t state;
+  unpackEntry(entry, nowMs, &state);
+
+  swarmStateCorePeer_t* peer = findPeer(this, entry->id);
+  if (!peer) {
+    peer = addPeer(this, entry->id, nowMs);
+    if (!peer) {
+      return;
+    }
+  }
+
+  if (isSender) {
+    updateLossStats(this, peer, seq, nowMs);
+  }
+
+  if (peer->state.pos.timestamp != 0 && (int32_t)(state.pos.timestamp - peer->state.pos.timestamp) <= 0 && !isSender) {
+    // We already have a more recent state
+    return;
+  }
+
+  peer->state = state;
+
+  positionMeasurement_t position = {
+    .x = state.pos.x,
+    .y = state.pos.y,
+    .z = state.pos.z,
+  };
+  peerLocalizationTellStateAt(state.id, &position, &state.vel, M2T(state.pos.timestamp));
+}
+
+void swarmStateCoreInit(swarmStateCore_t* this, const uint8_t ownId) {
+  memset(this, 0, sizeof(*this));
+  this->ownId = ownId;
+}
+
+uint32_t swarmStateCoreFramePhaseUs(const swarmStateCore_t* this, const uint64_t nowUs, const uint32_t periodUs) {
+  return (uint32_t)((nowUs + this->clockOffsetUs) % periodUs);
+}
+
+uint32_t swarmStateCoreTimeToSlotUs(const swarmStateCore_t* this, const uint64_t nowUs, const uint32_t periodUs, const uint8_t slotCount) {
+  const uint32_t slotUs = periodUs / slotCount;
+  const uint32_t slotStartUs = (this->ownId % slotCount) * slotUs;
+  const uint32_t phaseUs = swarmStateCoreFramePhaseUs(this, nowUs, periodUs);
+
+  const uint32_t timeInSlotUs = (phaseUs + periodUs - slotStartUs) % periodUs;
+  if (timeInSlotUs < slotUs / 2) {
+    return 0;
+  }
+
+  return periodUs - timeInSlotUs;
+}
+
+size_t swarmStateCoreBuildPacket(swarmStateCore_t* this, const swarmPeerState_t* own, const uint64_t nowUs, const uint32_t nowMs, const uint32_t periodUs, swarmStatePacket_t* packet) {
+  packet->header.version = SWARM_STATE_VERSION;
+  packet->header.seq = this->txSeq++;
+  packet->header.phase = swarmStateCoreFramePhaseUs(this, nowUs, periodUs) / SWARM_STATE_PHASE_UNIT_US;
+
+  packEntry(own, this->ownId, nowMs, &packet->entries[0]);
+  int count = 1;
+
+  // Relay the peers we hear directly, in turns
+  const int firstIndex = this->nextRelayIndex;
+  for (int i = 0; i < SWARM_STATE_MAX_PEERS && count < SWARM_STATE_MAX_ENTRIES; i++) {
+    const int index = (firstIndex + i) % SWARM_STATE_MAX_PEERS;
+    const swarmStateCorePeer_t* peer = &this->peers[index];
+    if (peer->state.id == 0 || peer->heardMs == 0 || (nowMs - peer->heardMs) > SWARM_STATE_RELAY_MAX_AGE_MS) {
+      continue;
+    }
+
+    packEntry(&peer->state, peer->state.id, nowMs, &packet->entries[count]);
+    count++;
+    this->nextRelayIndex = (index + 1) % SWARM_STATE_MAX_PEERS;
+  }
+
+  packet->header.count = count;
+  return sizeof(swarmStateHeader_t) + count * sizeof(swarmStateEntry_t);
+}
+
+bool swarmStateCoreHandlePacket(swarmStateCore_t* this, const void* data, const size_t size, const uint64_t rxTimeUs, const uint32_t nowMs, const uint32_t periodUs) {
+  if (size < sizeof(swarmStateHeader_t) + sizeof(swarmStateEntry_t)) {
+    return false;
+  }
+
+  swarmStatePacket_t packet;
+  memcpy(&packet, data, size < sizeof(packet) ? size : sizeof(packet));
+
+  const int count = packet.header.count;
+  if (packet.header.version != SWARM_STATE_VERSION || count < 1 || count > SWARM_STATE_MAX_ENTRIES ||
+      size < sizeof(swarmStateHeader_t) + count * sizeof(swarmStateEntry_t)) {
+    return false;
+  }
+
+  const uint8_t senderId = packet.entries[0].id;
+  if (senderId == 0 || senderId == this->ownId) {
+    return false;
+  }
+
+  synchronizeClock(this, senderId, packet.header.phase, rxTimeUs, nowMs, periodUs);
+
+  for (int i = 0; i < count; i++) {
+    const swarmStateEntry_t* entry = &packet.entries[i];
+    if (entry->id == 0 || entry->id == this->ownId) {
+      continue;
+    }
+    updatePeer(this, entry, i == 0, packet.header.seq, nowMs);
+  }
+
+  return true;
+}
+
+bool swarmStateCoreGetPeer(const swarmStateCore_t* this, const uint8_t id, swarmPeerState_t* state) {
+  if (id == 0) {
+    return false;
+  }
+
+  for (int i = 0; i < SWARM_STATE_MAX_PEERS; i++) {
+    if (this->peers[i].state.id == id) {
+      *state = this->peers[i].state;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t swarmStateCoreAirtimeUs(const size_t size) {
+  return (size + AIR_OVERHEAD_BYTES) * AIR_US_PER_BYTE;
+}
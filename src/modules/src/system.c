@@ -69,6 +69,7 @@
 #include "app.h"
 #include "static_mem.h"
 #include "peer_localization.h"
+#include "swarm_state.h"
 #include "cfassert.h"
 #include "i2cdev.h"
 #include "autoconf.h"
@@ -86,6 +87,10 @@ static char nrf_version[16];
 static uint8_t testLogParam;
 static uint8_t doAssert;
 
+// Boot phase timings, time since startup
+static uint16_t bootInitDoneMs;
+static uint16_t bootStartMs;
+
 STATIC_MEM_TASK_ALLOC(systemTask, SYSTEM_TASK_STACKSIZE);
 
 /* System wide synchronisation */
@@ -142,6 +147,9 @@ void systemInit(void)
   pmInit();
   buzzerInit();
   peerLocalizationInit();
+#ifdef CONFIG_SWARM_STATE
+  swarmStateInit();
+#endif
 
 #ifdef CONFIG_APP_ENABLE
   appInit();
@@ -219,6 +227,8 @@ void systemTask(void *arg)
 
   systemRequestNRFVersion();
 
+  bootInitDoneMs = T2M(xTaskGetTickCount());
+
   //Test the modules
   DEBUG_PRINT("About to run tests in system.c.\n");
   if (systemTest() == false) {
@@ -288,6 +298,12 @@ void systemTask(void *arg)
     pass = false;
     DEBUG_PRINT("peerLocalization [FAIL]\n");
   }
+#ifdef CONFIG_SWARM_STATE
+  if (swarmStateTest() == false) {
+    pass = false;
+    DEBUG_PRINT("swarmState [FAIL]\n");
+  }
+#endif
 
   //Start the firmware
   if(pass)
@@ -336,10 +352,15 @@ void systemTask(void *arg)
 /* Global system variables */
 void systemStart()
 {
+  bootStartMs = T2M(xTaskGetTickCount());
+  DEBUG_PRINT("Boot: init done at %d ms, started at %d ms\n", bootInitDoneMs, bootStartMs);
+
   xSemaphoreGive(canStartMutex);
 #ifndef DEBUG
   watchdogInit();
 #endif
+
+  storageReleaseBootSnapshotAfterStart();
 }
 
 void systemWaitStart(void)
@@ -481,4 +502,14 @@ LOG_GROUP_START(sys)
  */
 LOG_ADD(LOG_INT8, testLogParam, &testLogParam)
 
+/**
+ * @brief Time [ms] from startup until all modules are initialized, before the self tests
+ */
+LOG_ADD(LOG_UINT16, bootInitMs, &bootInitDoneMs)
+
+/**
+ * @brief Time [ms] from startup until the system is started, after the self tests
+ */
+LOG_ADD(LOG_UINT16, bootStartMs, &bootStartMs)
+
 LOG_GROUP_STOP(sys)
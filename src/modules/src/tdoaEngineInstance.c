@@ -113,5 +113,13 @@ PARAM_ADD_CORE(PARAM_UINT8, logOthrId, &tdoaEngineState.stats.newRemoteAnchorId)
 // This variable should not be exposed as a parameter since it is changed from inside the CF FW.
 // It only happens when the LPS system mode is changed to TDoA2 or TDoA3 though, and as this is
 // not a frequent action, we chose to expose it anyway.
+// Matching algorithm: 1 = random, 2 = youngest, 3 = best pair
 PARAM_ADD(PARAM_UINT8, matchAlgo, &tdoaEngineState.matchingAlgorithm)
+
+/**
+ * @brief Max number of TDoA measurements to generate per received packet when the best pair matching algorithm is used (1 - 4).
+ *
+ * Note that the measurements from one packet share the noise of its time stamp.
+ */
+PARAM_ADD(PARAM_UINT8, matchMulti, &tdoaEngineState.measurementsPerPacket)
 PARAM_GROUP_STOP(tdoaEngine)
@@ -29,63 +29,241 @@
 
 #include "FreeRTOS.h"
 #include "task.h"
-#include "queue.h"
-#include "queuemonitor.h"
+#include "semphr.h"
 #include "static_mem.h"
 
 #include "console.h"
+#include "log.h"
+#include "param.h"
+#include "statsCnt.h"
+#include "usec_time.h"
 
-#define WORKER_QUEUE_LENGTH 5
+#define DEBUG_MODULE "WORKER"
+#include "debug.h"
 
-struct worker_work {
-  void (*function)(void*);
-  void* arg;
-};
+// Interval of the runtime statistics
+#define WORKER_STATS_INTERVAL_MS 1000
+// Number of job functions with their own runtime statistics, the runs of
+// other functions are only counted
+#define WORKER_STATS_FUNCTIONS 16
+
+static workerQueue_t workerQueue;
+static bool isInit = false;
+
+// Given when a job is added, to wake up the worker loop
+static SemaphoreHandle_t workerWakeup;
+static StaticSemaphore_t workerWakeupBuffer;
+
+// Runtime statistics, the slowest job and the longest wait past the due time
+// during the latest interval
+static uint32_t maxRunUs;
+static uint32_t maxRunFunction;
+static uint32_t maxLateMs;
+static uint32_t latestMaxRunUs;
+static uint32_t latestMaxRunFunction;
+static uint32_t latestMaxLateMs;
+static uint32_t statsIntervalStartMs;
+
+// Runtime statistics per job function since start, in the order the
+// functions were first run
+typedef struct {
+  workerFunction_t function;
+  uint32_t runCount;
+  uint32_t maxRunUs;
+  uint64_t totalRunUs;
+} workerFunctionStats_t;
 
-static xQueueHandle workerQueue;
-STATIC_MEM_QUEUE_ALLOC(workerQueue, WORKER_QUEUE_LENGTH, sizeof(struct worker_work));
+static workerFunctionStats_t functionStats[WORKER_STATS_FUNCTIONS];
+static uint32_t otherFunctionsRunCount;
+static bool printStatsRequest;
+
+static STATS_CNT_RATE_DEFINE(highRate, WORKER_STATS_INTERVAL_MS);
+static STATS_CNT_RATE_DEFINE(normalRate, WORKER_STATS_INTERVAL_MS);
+static STATS_CNT_RATE_DEFINE(lowRate, WORKER_STATS_INTERVAL_MS);
+static statsCntRateLogger_t* const rates[workerPriorityCount] = {
+  [workerPriorityHigh] = &highRate,
+  [workerPriorityNormal] = &normalRate,
+  [workerPriorityLow] = &lowRate,
+};
 
 void workerInit()
 {
-  if (workerQueue)
+  if (isInit)
     return;
 
-  workerQueue = STATIC_MEM_QUEUE_CREATE(workerQueue);
-  DEBUG_QUEUE_MONITOR_REGISTER(workerQueue);
+  workerQueueInit(&workerQueue);
+  workerWakeup = xSemaphoreCreateBinaryStatic(&workerWakeupBuffer);
+
+  isInit = true;
 }
 
 bool workerTest()
 {
-  return (workerQueue != NULL);
+  return isInit;
+}
+
+static void updateFunctionStats(const workerFunction_t function, const uint32_t runUs)
+{
+  for (int i = 0; i < WORKER_STATS_FUNCTIONS; i++)
+  {
+    workerFunctionStats_t* stats = &functionStats[i];
+    if (stats->function != function && stats->function != 0)
+      continue;
+
+    stats->function = function;
+    stats->runCount++;
+    stats->totalRunUs += runUs;
+    if (runUs > stats->maxRunUs)
+      stats->maxRunUs = runUs;
+    return;
+  }
+
+  otherFunctionsRunCount++;
+}
+
+static void updateStats(const workerJob_t* job, const uint32_t startMs, const uint32_t runUs)
+{
+  STATS_CNT_RATE_EVENT(rates[job->priority]);
+  updateFunctionStats(job->function, runUs);
+
+  if (runUs > maxRunUs)
+  {
+    maxRunUs = runUs;
+    maxRunFunction = (uint32_t)job->function;
+  }
+
+  const uint32_t lateMs = startMs - job->dueMs;
+  if (lateMs > maxLateMs)
+    maxLateMs = lateMs;
+
+  if (startMs - statsIntervalStartMs >= WORKER_STATS_INTERVAL_MS)
+  {
+    latestMaxRunUs = maxRunUs;
+    latestMaxRunFunction = maxRunFunction;
+    latestMaxLateMs = maxLateMs;
+    maxRunUs = 0;
+    maxRunFunction = 0;
+    maxLateMs = 0;
+    statsIntervalStartMs = startMs;
+  }
 }
 
 void workerLoop()
 {
-  struct worker_work work;
+  workerJob_t job;
 
-  if (!workerQueue)
+  if (!isInit)
     return;
 
   while (1)
   {
-    xQueueReceive(workerQueue, &work, portMAX_DELAY);
+    const uint32_t nowMs = T2M(xTaskGetTickCount());
 
-    if (work.function)
-      work.function(work.arg);
+    taskENTER_CRITICAL();
+    const bool isDue = workerQueueTake(&workerQueue, nowMs, &job);
+    const uint32_t waitMs = isDue ? 0 : workerQueueTimeToNextMs(&workerQueue, nowMs);
+    taskEXIT_CRITICAL();
+
+    if (!isDue)
+    {
+      xSemaphoreTake(workerWakeup, waitMs == WORKER_QUEUE_WAIT_FOREVER ? portMAX_DELAY : M2T(waitMs));
+      continue;
+    }
+
+    const uint64_t startUs = usecTimestamp();
+    job.function(job.arg);
+    updateStats(&job, nowMs, (uint32_t)(usecTimestamp() - startUs));
   }
 }
 
-int workerSchedule(void (*function)(void*), void *arg)
+int workerScheduleJob(void (*function)(void*), void *arg, const workerPriority_t priority, const uint32_t delayMs)
 {
-  struct worker_work work;
-
-  if (!function)
+  if (!function || priority >= workerPriorityCount)
     return ENOEXEC;
 
-  work.function = function;
-  work.arg = arg;
-  if (xQueueSend(workerQueue, &work, 0) == pdFALSE)
-    return ENOMEM;
+  const uint32_t nowMs = T2M(xTaskGetTickCount());
+
+  taskENTER_CRITICAL();
+  const int result = workerQueueAdd(&workerQueue, function, arg, priority, delayMs, nowMs);
+  taskEXIT_CRITICAL();
+
+  if (result == 0)
+    xSemaphoreGive(workerWakeup);
+
+  return result;
+}
+
+int workerSchedule(void (*function)(void*), void *arg)
+{
+  return workerScheduleJob(function, arg, workerPriorityNormal, 0);
+}
 
-  return 0;
+// Run as a job, so the statistics are not updated while they are printed
+static void printFunctionStats(void* arg)
+{
+  DEBUG_PRINT("Jobs since start, function: runs, max [us], average [us]\n");
+  for (int i = 0; i < WORKER_STATS_FUNCTIONS && functionStats[i].function; i++)
+  {
+    const workerFunctionStats_t* stats = &functionStats[i];
+    DEBUG_PRINT("0x%08x: %u, %u, %u\n", (unsigned int)stats->function, (unsigned int)stats->runCount,
+                (unsigned int)stats->maxRunUs, (unsigned int)(stats->totalRunUs / stats->runCount));
+  }
+  if (otherFunctionsRunCount > 0)
+    DEBUG_PRINT("Other functions: %u runs\n", (unsigned int)otherFunctionsRunCount);
 }
+
+static void printStats(void)
+{
+  if (printStatsRequest)
+  {
+    workerScheduleJob(printFunctionStats, 0, workerPriorityLow, 0);
+    printStatsRequest = false;
+  }
+}
+
+PARAM_GROUP_START(worker)
+/**
+ * @brief Set to nonzero to print the run count, max and average runtime of
+ * each job function to the console, look the functions up in the elf file
+ */
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, printStats, &printStatsRequest, printStats)
+PARAM_GROUP_STOP(worker)
+
+/**
+ * Statistics of the jobs run by the worker
+ */
+LOG_GROUP_START(worker)
+/**
+ * @brief Rate of high priority jobs [jobs/s]
+ */
+STATS_CNT_RATE_LOG_ADD(highRate, &highRate)
+/**
+ * @brief Rate of normal priority jobs [jobs/s]
+ */
+STATS_CNT_RATE_LOG_ADD(normalRate, &normalRate)
+/**
+ * @brief Rate of low priority jobs [jobs/s]
+ */
+STATS_CNT_RATE_LOG_ADD(lowRate, &lowRate)
+/**
+ * @brief Runtime of the slowest job during the latest second [us]
+ */
+LOG_ADD(LOG_UINT32, maxRunUs, &latestMaxRunUs)
+/**
+ * @brief Address of the function of the slowest job during the latest second,
+ * look it up in the elf file
+ */
+LOG_ADD(LOG_UINT32, maxRunFn, &latestMaxRunFunction)
+/**
+ * @brief Longest time a job waited past its due time during the latest second [ms]
+ */
+LOG_ADD(LOG_UINT32, maxLateMs, &latestMaxLateMs)
+/**
+ * @brief Number of jobs merged with an identical pending job
+ */
+LOG_ADD(LOG_UINT32, coalesced, &workerQueue.coalescedCount)
+/**
+ * @brief Number of jobs dropped because the queue was full
+ */
+LOG_ADD(LOG_UINT32, dropped, &workerQueue.droppedCount)
+LOG_GROUP_STOP(worker)
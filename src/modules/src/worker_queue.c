@@ -0,0 +1,122 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * worker_queue.c - Pending jobs of the worker, by priority and due time
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "worker_queue.h"
+
+// Time comparison that handles wrap around of the ms counter
+static bool isDue(const workerJob_t* job, const uint32_t nowMs) {
+  return (int32_t)(nowMs - job->dueMs) >= 0;
+}
+
+void workerQueueInit(workerQueue_t* this) {
+  memset(this, 0, sizeof(*this));
+}
+
+int workerQueueAdd(workerQueue_t* this, workerFunction_t function, void* arg, const workerPriority_t priority, const uint32_t delayMs, const uint32_t nowMs) {
+  const uint32_t dueMs = nowMs + delayMs;
+  workerJob_t* freeJob = 0;
+
+  for (int i = 0; i < WORKER_QUEUE_LENGTH; i++) {
+    workerJob_t* job = &this->jobs[i];
+    if (job->function == function && job->arg == arg) {
+      if (priority < job->priority) {
+        job->priority = priority;
+      }
+      if ((int32_t)(dueMs - job->dueMs) < 0) {
+        job->dueMs = dueMs;
+      }
+      this->coalescedCount++;
+      return 0;
+    }
+
+    if (!job->function && !freeJob) {
+      freeJob = job;
+    }
+  }
+
+  if (!freeJob) {
+    this->droppedCount++;
+    return ENOMEM;
+  }
+
+  freeJob->function = function;
+  freeJob->arg = arg;
+  freeJob->priority = priority;
+  freeJob->dueMs = dueMs;
+  freeJob->scheduledMs = nowMs;
+  freeJob->seq = this->nextSeq++;
+
+  return 0;
+}
+
+bool workerQueueTake(workerQueue_t* this, const uint32_t nowMs, workerJob_t* job) {
+  workerJob_t* next = 0;
+
+  for (int i = 0; i < WORKER_QUEUE_LENGTH; i++) {
+    workerJob_t* candidate = &this->jobs[i];
+    if (!candidate->function || !isDue(candidate, nowMs)) {
+      continue;
+    }
+
+    if (!next || candidate->priority < next->priority ||
+        (candidate->priority == next->priority && (int32_t)(candidate->seq - next->seq) < 0)) {
+      next = candidate;
+    }
+  }
+
+  if (!next) {
+    return false;
+  }
+
+  *job = *next;
+  next->function = 0;
+  return true;
+}
+
+uint32_t workerQueueTimeToNextMs(const workerQueue_t* this, const uint32_t nowMs) {
+  uint32_t result = WORKER_QUEUE_WAIT_FOREVER;
+
+  for (int i = 0; i < WORKER_QUEUE_LENGTH; i++) {
+    const workerJob_t* job = &this->jobs[i];
+    if (!job->function) {
+      continue;
+    }
+
+    if (isDue(job, nowMs)) {
+      return 0;
+    }
+
+    const uint32_t timeToDue = job->dueMs - nowMs;
+    if (timeToDue < result) {
+      result = timeToDue;
+    }
+  }
+
+  return result;
+}
@@ -40,5 +40,6 @@ typedef struct {
 double clockCorrectionEngineGet(const clockCorrectionStorage_t* storage);
 double clockCorrectionEngineCalculate(const uint64_t new_t_in_cl_reference, const uint64_t old_t_in_cl_reference, const uint64_t new_t_in_cl_x, const uint64_t old_t_in_cl_x, const uint64_t mask);
 bool clockCorrectionEngineUpdate(clockCorrectionStorage_t* storage, const double clockCorrectionCandidate);
+float clockCorrectionEngineGetQuality(const clockCorrectionStorage_t* storage);
 
 #endif /* clockCorrectionEngine_h */
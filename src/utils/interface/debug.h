@@ -62,6 +62,16 @@ void debugInit(void);
 #elif defined(DEBUG_PRINT_ON_SEGGER_RTT)
   #define DEBUG_PRINT(fmt, ...) SEGGER_RTT_printf(0, fmt, ## __VA_ARGS__)
   #define DEBUG_PRINT_OS(fmt, ...) SEGGER_RTT_printf(0, fmt, ## __VA_ARGS__)
+#elif defined(CONFIG_DEBUG_PRINT_TOKENIZED)
+  // The format string is placed in a table that is read by the client, and
+  // by the firmware for prints from interrupts. consolePrintf() is never
+  // called but checks the format at compile time
+  #define DEBUG_PRINT(fmt, ...) do { \
+      static const char debugPrintFmt[] __attribute__((section(".consoleFmt"), used)) = DEBUG_FMT(fmt); \
+      if (0) { consolePrintf(DEBUG_FMT(fmt), ##__VA_ARGS__); } \
+      consoleTokenPrintf(debugPrintFmt, ##__VA_ARGS__); \
+    } while (0)
+  #define DEBUG_PRINT_OS(fmt, ...) DEBUG_PRINT(fmt, ##__VA_ARGS__)
 #else // Debug using radio or USB
   #define DEBUG_PRINT(fmt, ...) consolePrintf(DEBUG_FMT(fmt), ##__VA_ARGS__)
   #define DEBUG_PRINT_OS(fmt, ...) consolePrintf(DEBUG_FMT(fmt), ##__VA_ARGS__)
@@ -13,6 +13,7 @@
  */
 
 #include <stdarg.h>
+#include <stdint.h>
 
 #ifndef	__EPRINTF_H__
 #define __EPRINTF_H__
@@ -41,4 +42,17 @@ int eprintf(putc_t putcf, const char * fmt, ...)
  */
 int evprintf(putc_t putcf, const char * fmt, va_list ap);
 
+/**
+ * Pack the arguments of a format string in binary form, to be formatted by
+ * the client. Integers and floats are packed as 4 bytes (8 bytes for long long),
+ * characters as 1 byte and strings with their null termination. The
+ * arguments that do not fit in the buffer are left out.
+ * @param[out] buffer Buffer for the packed arguments
+ * @param[in] size Size of the buffer
+ * @param[in] fmt Format string
+ * @param[in] ap Parameters to pack
+ * @return the number of bytes written to the buffer
+ */
+int evprintfPack(uint8_t* buffer, int size, const char * fmt, va_list ap);
+
 #endif //__EPRINTF_H__
@@ -40,6 +40,15 @@ typedef struct {
     uint8_t skip;
 } rateSupervisor_t;
 
+typedef struct {
+    uint32_t budgetUs;
+    uint32_t startUs;
+    uint32_t latestUs;
+    uint32_t windowMaxUs;
+    uint32_t latestMaxUs;
+    uint32_t overrunCount;
+} rateSupervisorTiming_t;
+
 /**
  * @brief Initialize a rateSupervisor_t struct for rate measurements
  *
@@ -71,3 +80,38 @@ bool rateSupervisorValidate(rateSupervisor_t* context, const uint32_t osTimeMs);
  * @return uint32_t The count at the latest evaluation time
  */
 uint32_t rateSupervisorLatestCount(rateSupervisor_t* context);
+
+/**
+ * @brief Initialize a rateSupervisorTiming_t struct, used to measure the execution time of a piece of
+ * work that is executed periodically, for instance one slot in the stabilizer loop.
+ *
+ * @param timing The struct to initialize
+ * @param budgetUs The expected maximum execution time, in us. An execution that takes longer is counted as an overrun. 0 means no budget.
+ */
+void rateSupervisorTimingInit(rateSupervisorTiming_t* timing, const uint32_t budgetUs);
+
+/**
+ * @brief Mark the start of an execution.
+ *
+ * @param timing A rateSupervisorTiming_t
+ * @param nowUs The current time in us
+ */
+void rateSupervisorTimingStart(rateSupervisorTiming_t* timing, const uint32_t nowUs);
+
+/**
+ * @brief Mark the end of an execution, update the execution time and the overrun counter.
+ *
+ * @param timing A rateSupervisorTiming_t
+ * @param nowUs The current time in us
+ * @return true if the execution time was within the budget
+ * @return false if the execution time was longer than the budget
+ */
+bool rateSupervisorTimingStop(rateSupervisorTiming_t* timing, const uint32_t nowUs);
+
+/**
+ * @brief Close the current measurement window. The max execution time of the window is available in latestMaxUs
+ * until the next call.
+ *
+ * @param timing A rateSupervisorTiming_t
+ */
+void rateSupervisorTimingNewWindow(rateSupervisorTiming_t* timing);
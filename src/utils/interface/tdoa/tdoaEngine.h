@@ -17,8 +17,12 @@ typedef enum {
   TdoaEngineMatchingAlgorithmNone = 0,
   TdoaEngineMatchingAlgorithmRandom,
   TdoaEngineMatchingAlgorithmYoungest,
+  TdoaEngineMatchingAlgorithmBestPair,
 } tdoaEngineMatchingAlgorithm_t;
 
+// Max number of TDoA measurements generated from one packet, only used by the best pair algorithm
+#define TDOA_ENGINE_MAX_MEASUREMENTS_PER_PACKET 4
+
 typedef struct {
   // State
   tdaoAnchorInfoArray_t anchorInfoArray;
@@ -28,17 +32,31 @@ typedef struct {
   tdoaEngineSendTdoaToEstimator sendTdoaToEstimator;
   double locodeckTsFreq;
   tdoaEngineMatchingAlgorithm_t matchingAlgorithm;
+  uint8_t measurementsPerPacket; // Max number of measurements per packet for the best pair algorithm
 
   // Matching algorithm data
   struct {
     uint8_t seqNr[REMOTE_ANCHOR_DATA_COUNT];
     uint8_t id[REMOTE_ANCHOR_DATA_COUNT];
     uint8_t offset;
+
+    // Position estimate used for the geometry in the best pair algorithm
+    point_t position;
+    bool hasPosition;
   } matching;
 } tdoaEngineState_t;
 
 void tdoaEngineInit(tdoaEngineState_t* state, const uint32_t now_ms, tdoaEngineSendTdoaToEstimator sendTdoaToEstimator, const double locodeckTsFreq, const tdoaEngineMatchingAlgorithm_t matchingAlgorithm);
 
+/**
+ * @brief Set the current position estimate of the tag. Used by the best pair
+ * matching algorithm to rate the geometry of anchor pairs.
+ *
+ * @param engineState The engine state
+ * @param position The estimated position
+ */
+void tdoaEngineSetPositionEstimate(tdoaEngineState_t* engineState, const point_t* position);
+
 void tdoaEngineGetAnchorCtxForPacketProcessing(tdoaEngineState_t* engineState, const uint8_t anchorId, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx);
 void tdoaEngineProcessPacket(tdoaEngineState_t* engineState, tdoaAnchorContext_t* anchorCtx, const int64_t txAn_in_cl_An, const int64_t rxAn_by_T_in_cl_T);
 bool tdoaEngineProcessPacketFiltered(tdoaEngineState_t* engineState, tdoaAnchorContext_t* anchorCtx, const int64_t txAn_in_cl_An, const int64_t rxAn_by_T_in_cl_T, const bool doExcludeId, const uint8_t excludedId);
@@ -5,9 +5,22 @@
 #include "clockCorrectionEngine.h"
 #include "autoconf.h"
 
-#define ANCHOR_STORAGE_COUNT 16
-#define REMOTE_ANCHOR_DATA_COUNT 16
-#define TOF_PER_ANCHOR_COUNT 16
+#ifndef CONFIG_DECK_LOCO_TDOA_ANCHOR_STORAGE_COUNT
+#define CONFIG_DECK_LOCO_TDOA_ANCHOR_STORAGE_COUNT 16
+#endif
+
+#ifndef CONFIG_DECK_LOCO_TDOA_REMOTE_DATA_COUNT
+#define CONFIG_DECK_LOCO_TDOA_REMOTE_DATA_COUNT 16
+#endif
+
+#define ANCHOR_STORAGE_COUNT CONFIG_DECK_LOCO_TDOA_ANCHOR_STORAGE_COUNT
+#define REMOTE_ANCHOR_DATA_COUNT CONFIG_DECK_LOCO_TDOA_REMOTE_DATA_COUNT
+#define TOF_PER_ANCHOR_COUNT CONFIG_DECK_LOCO_TDOA_REMOTE_DATA_COUNT
+
+// Slots are stored as slot + 1 in uint8_t hash chains, 0 marks the end of a chain
+#if ANCHOR_STORAGE_COUNT > 255 || REMOTE_ANCHOR_DATA_COUNT > 255 || TOF_PER_ANCHOR_COUNT > 255
+  #error "Tdoa storage is too large"
+#endif
 
 #ifdef CONFIG_DECK_LOCO_TDOA3_HYBRID_MODE
 #define TWR_HISTORY_LENGTH 32
@@ -27,11 +40,32 @@ typedef struct {
   uint32_t endOfLife; // Time stamp when the tof data is outdated, local system time in ms
 } tdoaTimeOfFlight_t;
 
+// Index for id -> slot lookups in a table of remote data. Entries are
+// chained per bucket (id % size), slots are stored as slot + 1.
+// Slots are allocated in order, used is the number of allocated slots.
+typedef struct {
+  uint8_t used;
+  uint8_t bucketHead[REMOTE_ANCHOR_DATA_COUNT];
+  uint8_t next[REMOTE_ANCHOR_DATA_COUNT];
+} tdoaRemoteAnchorDataIndex_t;
+
+typedef struct {
+  uint8_t used;
+  uint8_t bucketHead[TOF_PER_ANCHOR_COUNT];
+  uint8_t next[TOF_PER_ANCHOR_COUNT];
+} tdoaTimeOfFlightIndex_t;
+
 typedef struct {
   bool isInitialized;
   uint32_t lastUpdateTime; // The time when this anchor was updated the last time
   uint8_t id; // Anchor id
 
+  // Id -> slot index for the anchor storage array. The bucket heads are spread
+  // out over the array, element i holds the head of bucket i. Slots are stored
+  // as slot + 1.
+  uint8_t anchorBucketHead;
+  uint8_t anchorNext;
+
   int64_t txTime; // Transmit time of last packet, in remote DWM clock
   int64_t rxTime; // Receive time of last packet, in local DWM clock
   uint8_t seqNr; // Sequence nr of last packet (7 bits)
@@ -41,7 +75,9 @@ typedef struct {
   point_t position; // The coordinates of the anchor
 
   tdoaTimeOfFlight_t remoteTof[TOF_PER_ANCHOR_COUNT];
+  tdoaTimeOfFlightIndex_t remoteTofIndex;
   tdoaRemoteAnchorData_t remoteAnchorData[REMOTE_ANCHOR_DATA_COUNT];
+  tdoaRemoteAnchorDataIndex_t remoteAnchorDataIndex;
 
   #ifdef CONFIG_DECK_LOCO_TDOA3_HYBRID_MODE
   uint64_t tof;
@@ -121,6 +121,14 @@ bool clockCorrectionEngineUpdate(clockCorrectionStorage_t* storage, const double
   return sampleIsReliable;
 }
 
+/**
+ Obtains a measure of how reliable the clock correction in a clockCorrectionStorage_t object is, based on how many of the latest samples that were in the accepted noise level.
+ @return A value from 0.0 (no recent reliable samples) to 1.0 (all recent samples reliable)
+ */
+float clockCorrectionEngineGetQuality(const clockCorrectionStorage_t* storage) {
+  return (float)storage->clockCorrectionBucket / CLOCK_CORRECTION_BUCKET_MAX;
+}
+
 #ifdef CLOCK_CORRECTION_ENABLE_LOGGING
 LOG_GROUP_START(CkCorrection)
 LOG_ADD(LOG_FLOAT, minNoise, &logMinAcceptedNoiseLimit)
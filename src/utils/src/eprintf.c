@@ -30,6 +30,7 @@
 #include <stdbool.h>
 #include <ctype.h>
 #include <math.h>
+#include <string.h>
 
 static const char digit[] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 
                              'A', 'B', 'C', 'D', 'E', 'F'};
@@ -329,3 +330,110 @@ int eprintf(putc_t putcf, const char * fmt, ...)
 
   return len;
 }
+
+static bool pack(uint8_t* buffer, int size, int* len, const void* data, int n)
+{
+  if (*len + n > size)
+  {
+    return false;
+  }
+
+  memcpy(&buffer[*len], data, n);
+  *len += n;
+  return true;
+}
+
+int evprintfPack(uint8_t* buffer, int size, const char * fmt, va_list ap)
+{
+  int len = 0;
+  bool isFull = false;
+
+  while (*fmt && !isFull)
+  {
+    if (*fmt++ != '%')
+    {
+      continue;
+    }
+
+    if (*fmt == '%')
+    {
+      fmt++;
+      continue;
+    }
+
+    // Flags, width and precision are used by the client when formatting
+    while (*fmt && !isalpha((unsigned)*fmt))
+    {
+      fmt++;
+    }
+
+    switch (*fmt++)
+    {
+      case 'i':
+      case 'd':
+      case 'u':
+      case 'x':
+      case 'X':
+        {
+          const uint32_t value = va_arg(ap, unsigned int);
+          isFull = !pack(buffer, size, &len, &value, sizeof(value));
+        }
+        break;
+      case 'l':
+        if (*fmt == 'l')
+        {
+          fmt++;
+          const uint64_t value = va_arg(ap, unsigned long long int);
+          isFull = !pack(buffer, size, &len, &value, sizeof(value));
+        }
+        else
+        {
+          const uint32_t value = va_arg(ap, unsigned long int);
+          isFull = !pack(buffer, size, &len, &value, sizeof(value));
+        }
+        // Skip the conversion, d, u or x
+        if (*fmt)
+        {
+          fmt++;
+        }
+        break;
+      case 'f':
+        {
+          const float value = va_arg(ap, double);
+          isFull = !pack(buffer, size, &len, &value, sizeof(value));
+        }
+        break;
+      case 's':
+        {
+          const char* str = va_arg(ap, char*);
+          const int n = strlen(str) + 1;
+          if (len + n > size)
+          {
+            // Send as much as possible of the string
+            if (len < size)
+            {
+              memcpy(&buffer[len], str, size - len - 1);
+              buffer[size - 1] = '\0';
+              len = size;
+            }
+            isFull = true;
+          }
+          else
+          {
+            pack(buffer, size, &len, str, n);
+          }
+        }
+        break;
+      case 'c':
+        {
+          const uint8_t value = va_arg(ap, int);
+          isFull = !pack(buffer, size, &len, &value, sizeof(value));
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  return len;
+}
@@ -171,8 +171,6 @@ TESTABLE_STATIC void augmentFramesInWorkspace(pulseProcessorV2PulseWorkspace_t*
 }
 
 static int processWorkspace(pulseProcessorV2PulseWorkspace_t* pulseWorkspace, pulseProcessorV2BlockWorkspace_t* blockWorkspace) {
-    augmentFramesInWorkspace(pulseWorkspace);
-
     // Handle missing channels
     // Sometimes the FPGA failes to decode the bitstream for a sensor, but we
     // can assume the timestamp is correct anyway. To know which channel it
@@ -190,6 +188,9 @@ static int processWorkspace(pulseProcessorV2PulseWorkspace_t* pulseWorkspace, pu
         return 0;
     }
 
+    // Only augment workspaces that can be accepted
+    augmentFramesInWorkspace(pulseWorkspace);
+
     // Process one block at a time in the workspace
     int blocksInWorkspace = slotsUsed / PULSE_PROCESSOR_N_SENSORS;
     for (int blockIndex = 0; blockIndex < blocksInWorkspace; blockIndex++) {
@@ -63,3 +63,36 @@ bool rateSupervisorValidate(rateSupervisor_t* context, const uint32_t osTimeMs)
 uint32_t rateSupervisorLatestCount(rateSupervisor_t* context) {
     return context->latestCount;
 }
+
+void rateSupervisorTimingInit(rateSupervisorTiming_t* timing, const uint32_t budgetUs) {
+    timing->budgetUs = budgetUs;
+    timing->startUs = 0;
+    timing->latestUs = 0;
+    timing->windowMaxUs = 0;
+    timing->latestMaxUs = 0;
+    timing->overrunCount = 0;
+}
+
+void rateSupervisorTimingStart(rateSupervisorTiming_t* timing, const uint32_t nowUs) {
+    timing->startUs = nowUs;
+}
+
+bool rateSupervisorTimingStop(rateSupervisorTiming_t* timing, const uint32_t nowUs) {
+    const uint32_t duration = nowUs - timing->startUs;
+    timing->latestUs = duration;
+    if (duration > timing->windowMaxUs) {
+        timing->windowMaxUs = duration;
+    }
+
+    if (timing->budgetUs > 0 && duration > timing->budgetUs) {
+        timing->overrunCount += 1;
+        return false;
+    }
+
+    return true;
+}
+
+void rateSupervisorTimingNewWindow(rateSupervisorTiming_t* timing) {
+    timing->latestMaxUs = timing->windowMaxUs;
+    timing->windowMaxUs = 0;
+}
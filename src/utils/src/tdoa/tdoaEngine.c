@@ -44,6 +44,7 @@ The implementation must handle
 */
 
 #include <string.h>
+#include <math.h>
 
 #define DEBUG_MODULE "TDOA_ENGINE"
 #include "debug.h"
@@ -53,14 +54,25 @@ The implementation must handle
 #include "clockCorrectionEngine.h"
 #include "physicalConstants.h"
 
+// Time constant for how fast the score of a candidate drops with the age of
+// its data in the best pair algorithm
+#define BEST_PAIR_AGE_SCALE_MS 10.0f
+
 void tdoaEngineInit(tdoaEngineState_t* engineState, const uint32_t now_ms, tdoaEngineSendTdoaToEstimator sendTdoaToEstimator, const double locodeckTsFreq, const tdoaEngineMatchingAlgorithm_t matchingAlgorithm) {
   tdoaStorageInitialize(engineState->anchorInfoArray);
   tdoaStatsInit(&engineState->stats, now_ms);
   engineState->sendTdoaToEstimator = sendTdoaToEstimator;
   engineState->locodeckTsFreq = locodeckTsFreq;
   engineState->matchingAlgorithm = matchingAlgorithm;
+  engineState->measurementsPerPacket = 1;
 
   engineState->matching.offset = 0;
+  engineState->matching.hasPosition = false;
+}
+
+void tdoaEngineSetPositionEstimate(tdoaEngineState_t* engineState, const point_t* position) {
+  engineState->matching.position = *position;
+  engineState->matching.hasPosition = true;
 }
 
 static void enqueueTDOA(const tdoaAnchorContext_t* anchorACtx, const tdoaAnchorContext_t* anchorBCtx, double distanceDiff, tdoaEngineState_t* engineState) {
@@ -190,17 +202,137 @@ static bool matchYoungestAnchor(tdoaEngineState_t* engineState, tdoaAnchorContex
     return false;
 }
 
-static bool findSuitableAnchor(tdoaEngineState_t* engineState, tdoaAnchorContext_t* otherAnchorCtx, const tdoaAnchorContext_t* anchorCtx, const bool doExcludeId, const uint8_t excludedId) {
-  bool result = false;
+// Unit vector from an anchor to the estimated position
+static void directionFromAnchor(const point_t* anchorPosition, const point_t* position, float direction[3]) {
+  direction[0] = position->x - anchorPosition->x;
+  direction[1] = position->y - anchorPosition->y;
+  direction[2] = position->z - anchorPosition->z;
+
+  const float length = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+  if (length > 0.0f) {
+    direction[0] /= length;
+    direction[1] /= length;
+    direction[2] /= length;
+  }
+}
+
+// The score of a candidate anchor is the product of
+// * geometry: the length of the gradient of the TDoA with respect to the
+//   position, 0 (no information) to 2 (anchors on opposite sides). Set to 1
+//   if there is no position estimate.
+// * clock correction quality of the candidate, 0.5 to 1
+// * data age of the candidate, 1 for fresh data, dropping with age
+static float scoreCandidate(const tdoaEngineState_t* engineState, const tdoaAnchorContext_t* candidateCtx, const float anchorDirection[3], const point_t* candidatePosition) {
+  float geometry = 1.0f;
+  if (engineState->matching.hasPosition) {
+    float candidateDirection[3];
+    directionFromAnchor(candidatePosition, &engineState->matching.position, candidateDirection);
+
+    const float dx = anchorDirection[0] - candidateDirection[0];
+    const float dy = anchorDirection[1] - candidateDirection[1];
+    const float dz = anchorDirection[2] - candidateDirection[2];
+    geometry = sqrtf(dx * dx + dy * dy + dz * dz);
+  }
+
+  const float quality = 0.5f + 0.5f * clockCorrectionEngineGetQuality(tdoaStorageGetClockCorrectionStorage(candidateCtx));
+
+  const uint32_t age_ms = candidateCtx->currentTime_ms - tdoaStorageGetLastUpdateTime(candidateCtx);
+  const float freshness = 1.0f / (1.0f + age_ms / BEST_PAIR_AGE_SCALE_MS);
+
+  return geometry * quality * freshness;
+}
+
+static int matchBestPairs(tdoaEngineState_t* engineState, tdoaAnchorContext_t otherAnchorCtx[], const int maxCount, const tdoaAnchorContext_t* anchorCtx, const bool doExcludeId, const uint8_t excludedId) {
+  int remoteCount = 0;
+  tdoaStorageGetRemoteSeqNrList(anchorCtx, &remoteCount, engineState->matching.seqNr, engineState->matching.id);
+
+  // Pairs without anchor positions are dropped before they reach the estimator, skip them
+  point_t anchorPosition;
+  if (!tdoaStorageGetAnchorPosition(anchorCtx, &anchorPosition)) {
+    return 0;
+  }
+
+  float anchorDirection[3] = {0.0f, 0.0f, 0.0f};
+  if (engineState->matching.hasPosition) {
+    directionFromAnchor(&anchorPosition, &engineState->matching.position, anchorDirection);
+  }
+
+  uint32_t now_ms = anchorCtx->currentTime_ms;
+  float scores[TDOA_ENGINE_MAX_MEASUREMENTS_PER_PACKET];
+  int count = 0;
+
+  for (int index = 0; index < remoteCount; index++) {
+    const uint8_t candidateAnchorId = engineState->matching.id[index];
+    if (doExcludeId && (excludedId == candidateAnchorId)) {
+      continue;
+    }
+
+    if (!tdoaStorageGetRemoteTimeOfFlight(anchorCtx, candidateAnchorId)) {
+      continue;
+    }
+
+    tdoaAnchorContext_t candidateCtx;
+    if (!tdoaStorageGetAnchorCtx(engineState->anchorInfoArray, candidateAnchorId, now_ms, &candidateCtx)) {
+      continue;
+    }
+
+    if (engineState->matching.seqNr[index] != tdoaStorageGetSeqNr(&candidateCtx)) {
+      continue;
+    }
+
+    point_t candidatePosition;
+    if (!tdoaStorageGetAnchorPosition(&candidateCtx, &candidatePosition)) {
+      continue;
+    }
+
+    const float score = scoreCandidate(engineState, &candidateCtx, anchorDirection, &candidatePosition);
+
+    // Keep the best candidates, sorted by score
+    int pos = count;
+    if (count < maxCount) {
+      count++;
+    } else if (score <= scores[maxCount - 1]) {
+      continue;
+    } else {
+      pos = maxCount - 1;
+    }
+
+    while (pos > 0 && scores[pos - 1] < score) {
+      scores[pos] = scores[pos - 1];
+      otherAnchorCtx[pos] = otherAnchorCtx[pos - 1];
+      pos--;
+    }
+    scores[pos] = score;
+    otherAnchorCtx[pos] = candidateCtx;
+  }
+
+  return count;
+}
+
+static int findSuitableAnchors(tdoaEngineState_t* engineState, tdoaAnchorContext_t otherAnchorCtx[], const tdoaAnchorContext_t* anchorCtx, const bool doExcludeId, const uint8_t excludedId) {
+  int result = 0;
 
   if (tdoaStorageGetClockCorrection(anchorCtx) > 0.0) {
     switch(engineState->matchingAlgorithm) {
       case TdoaEngineMatchingAlgorithmRandom:
-        result = matchRandomAnchor(engineState, otherAnchorCtx, anchorCtx, doExcludeId, excludedId);
+        result = matchRandomAnchor(engineState, &otherAnchorCtx[0], anchorCtx, doExcludeId, excludedId) ? 1 : 0;
         break;
 
       case TdoaEngineMatchingAlgorithmYoungest:
-        result = matchYoungestAnchor(engineState, otherAnchorCtx, anchorCtx, doExcludeId, excludedId);
+        result = matchYoungestAnchor(engineState, &otherAnchorCtx[0], anchorCtx, doExcludeId, excludedId) ? 1 : 0;
+        break;
+
+      case TdoaEngineMatchingAlgorithmBestPair:
+        {
+          int maxCount = engineState->measurementsPerPacket;
+          if (maxCount < 1) {
+            maxCount = 1;
+          }
+          if (maxCount > TDOA_ENGINE_MAX_MEASUREMENTS_PER_PACKET) {
+            maxCount = TDOA_ENGINE_MAX_MEASUREMENTS_PER_PACKET;
+          }
+          result = matchBestPairs(engineState, otherAnchorCtx, maxCount, anchorCtx, doExcludeId, excludedId);
+        }
         break;
 
       default:
@@ -229,11 +361,15 @@ bool tdoaEngineProcessPacketFiltered(tdoaEngineState_t* engineState, tdoaAnchorC
   if (timeIsGood) {
     STATS_CNT_RATE_EVENT(&engineState->stats.timeIsGood);
 
-    tdoaAnchorContext_t otherAnchorCtx;
-    if (findSuitableAnchor(engineState, &otherAnchorCtx, anchorCtx, doExcludeId, excludedId)) {
+    tdoaAnchorContext_t otherAnchorCtx[TDOA_ENGINE_MAX_MEASUREMENTS_PER_PACKET];
+    const int count = findSuitableAnchors(engineState, otherAnchorCtx, anchorCtx, doExcludeId, excludedId);
+    if (count > 0) {
       STATS_CNT_RATE_EVENT(&engineState->stats.suitableDataFound);
-      double tdoaDistDiff = calcDistanceDiff(&otherAnchorCtx, anchorCtx, txAn_in_cl_An, rxAn_by_T_in_cl_T, engineState->locodeckTsFreq);
-      enqueueTDOA(&otherAnchorCtx, anchorCtx, tdoaDistDiff, engineState);
+    }
+
+    for (int i = 0; i < count; i++) {
+      double tdoaDistDiff = calcDistanceDiff(&otherAnchorCtx[i], anchorCtx, txAn_in_cl_An, rxAn_by_T_in_cl_T, engineState->locodeckTsFreq);
+      enqueueTDOA(&otherAnchorCtx[i], anchorCtx, tdoaDistDiff, engineState);
     }
   }
   return timeIsGood;
@@ -43,6 +43,10 @@ Data storage encapsulation for the TDoA engine
 
 
 static tdoaAnchorInfo_t* initializeSlot(tdoaAnchorInfo_t anchorStorage[], const uint8_t slot, const uint8_t anchor);
+static int findAnchorSlot(const tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor);
+static int indexFind(const uint8_t bucketHead[], const uint8_t next[], const int size, const uint8_t* firstId, const size_t entrySize, const uint8_t id);
+static void indexLink(uint8_t bucketHead[], uint8_t next[], const int size, const int slot, const uint8_t id);
+static void indexUnlink(uint8_t bucketHead[], uint8_t next[], const int size, const int slot, const uint8_t id);
 
 void tdoaStorageInitialize(tdoaAnchorInfo_t anchorStorage[]) {
   memset(anchorStorage, 0, sizeof(tdoaAnchorInfo_t) * ANCHOR_STORAGE_COUNT);
@@ -50,29 +54,31 @@ void tdoaStorageInitialize(tdoaAnchorInfo_t anchorStorage[]) {
 
 bool tdoaStorageGetCreateAnchorCtx(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
   anchorCtx->currentTime_ms = currentTime_ms;
+
+  const int slot = findAnchorSlot(anchorStorage, anchor);
+  if (slot >= 0) {
+    anchorCtx->anchorInfo = &anchorStorage[slot];
+    return true;
+  }
+
+  // The anchor was not found in storage, use the first free slot or replace
+  // the anchor that was updated longest ago
   uint32_t oldestUpdateTime = currentTime_ms;
   int firstUninitializedSlot = -1;
   int oldestSlot = 0;
 
   for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {
     if (anchorStorage[i].isInitialized) {
-      if (anchor == anchorStorage[i].id) {
-        anchorCtx->anchorInfo = &anchorStorage[i];
-        return true;
-      }
-
       if (anchorStorage[i].lastUpdateTime < oldestUpdateTime) {
         oldestUpdateTime = anchorStorage[i].lastUpdateTime;
         oldestSlot = i;
       }
     } else {
-      if (firstUninitializedSlot == -1) {
-        firstUninitializedSlot = i;
-      }
+      firstUninitializedSlot = i;
+      break;
     }
   }
 
-  // The anchor was not found in storage
   tdoaAnchorInfo_t* newAnchorInfo = 0;
   if (firstUninitializedSlot != -1) {
     newAnchorInfo = initializeSlot(anchorStorage, firstUninitializedSlot, anchor);
@@ -87,13 +93,10 @@ bool tdoaStorageGetCreateAnchorCtx(tdoaAnchorInfo_t anchorStorage[], const uint8
 bool tdoaStorageGetAnchorCtx(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
   anchorCtx->currentTime_ms = currentTime_ms;
 
-  for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {
-    if (anchorStorage[i].isInitialized) {
-      if (anchor == anchorStorage[i].id) {
-        anchorCtx->anchorInfo = &anchorStorage[i];
-        return true;
-      }
-    }
+  const int slot = findAnchorSlot(anchorStorage, anchor);
+  if (slot >= 0) {
+    anchorCtx->anchorInfo = &anchorStorage[slot];
+    return true;
   }
 
   anchorCtx->anchorInfo = 0;
@@ -221,17 +224,16 @@ int64_t tdoaStorageGetRemoteRxTime(const tdoaAnchorContext_t* anchorCtx, const u
 
 bool tdoaStorageGetRemoteRxTimeSeqNr(const tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, int64_t* rxTime, uint8_t* seqNr) {
   const tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
+  const tdoaRemoteAnchorDataIndex_t* index = &anchorInfo->remoteAnchorDataIndex;
   bool result = false;
 
-  for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {
-    if (remoteAnchor == anchorInfo->remoteAnchorData[i].id) {
-      uint32_t now = anchorCtx->currentTime_ms;
-      if (anchorInfo->remoteAnchorData[i].endOfLife > now) {
-        *rxTime = anchorInfo->remoteAnchorData[i].rxTime;
-        *seqNr = anchorInfo->remoteAnchorData[i].seqNr;
-        result = true;
-      }
-      break;
+  const int i = indexFind(index->bucketHead, index->next, REMOTE_ANCHOR_DATA_COUNT, &anchorInfo->remoteAnchorData[0].id, sizeof(tdoaRemoteAnchorData_t), remoteAnchor);
+  if (i >= 0) {
+    uint32_t now = anchorCtx->currentTime_ms;
+    if (anchorInfo->remoteAnchorData[i].endOfLife > now) {
+      *rxTime = anchorInfo->remoteAnchorData[i].rxTime;
+      *seqNr = anchorInfo->remoteAnchorData[i].seqNr;
+      result = true;
     }
   }
 
@@ -240,21 +242,28 @@ bool tdoaStorageGetRemoteRxTimeSeqNr(const tdoaAnchorContext_t* anchorCtx, const
 
 void tdoaStorageSetRemoteRxTime(tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, const int64_t remoteRxTime, const uint8_t remoteSeqNr) {
   tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
-
-  int indexToUpdate = 0;
+  tdoaRemoteAnchorDataIndex_t* index = &anchorInfo->remoteAnchorDataIndex;
   uint32_t now = anchorCtx->currentTime_ms;
-  uint32_t oldestTime = 0xFFFFFFFF;
 
-  for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {
-    if (remoteAnchor == anchorInfo->remoteAnchorData[i].id) {
-      indexToUpdate = i;
-      break;
-    }
+  int indexToUpdate = indexFind(index->bucketHead, index->next, REMOTE_ANCHOR_DATA_COUNT, &anchorInfo->remoteAnchorData[0].id, sizeof(tdoaRemoteAnchorData_t), remoteAnchor);
+  if (indexToUpdate < 0) {
+    if (index->used < REMOTE_ANCHOR_DATA_COUNT) {
+      indexToUpdate = index->used;
+      index->used++;
+    } else {
+      // Replace the oldest entry
+      uint32_t oldestTime = 0xFFFFFFFF;
+      for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {
+        if (anchorInfo->remoteAnchorData[i].endOfLife < oldestTime) {
+          oldestTime = anchorInfo->remoteAnchorData[i].endOfLife;
+          indexToUpdate = i;
+        }
+      }
 
-    if (anchorInfo->remoteAnchorData[i].endOfLife < oldestTime) {
-      oldestTime = anchorInfo->remoteAnchorData[i].endOfLife;
-      indexToUpdate = i;
+      indexUnlink(index->bucketHead, index->next, REMOTE_ANCHOR_DATA_COUNT, indexToUpdate, anchorInfo->remoteAnchorData[indexToUpdate].id);
     }
+
+    indexLink(index->bucketHead, index->next, REMOTE_ANCHOR_DATA_COUNT, indexToUpdate, remoteAnchor);
   }
 
   anchorInfo->remoteAnchorData[indexToUpdate].id = remoteAnchor;
@@ -269,7 +278,7 @@ void tdoaStorageGetRemoteSeqNrList(const tdoaAnchorContext_t* anchorCtx, int* re
 
   int count = 0;
 
-  for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {
+  for (int i = 0; i < anchorInfo->remoteAnchorDataIndex.used; i++) {
     if (anchorInfo->remoteAnchorData[i].endOfLife > now) {
       id[count] = anchorInfo->remoteAnchorData[i].id;
       seqNr[count] = anchorInfo->remoteAnchorData[i].seqNr;
@@ -282,14 +291,13 @@ void tdoaStorageGetRemoteSeqNrList(const tdoaAnchorContext_t* anchorCtx, int* re
 
 int64_t tdoaStorageGetRemoteTimeOfFlight(const tdoaAnchorContext_t* anchorCtx, const uint8_t otherAnchor) {
   const tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
+  const tdoaTimeOfFlightIndex_t* index = &anchorInfo->remoteTofIndex;
 
-  for (int i = 0; i < TOF_PER_ANCHOR_COUNT; i++) {
-    if (otherAnchor == anchorInfo->remoteTof[i].id) {
-      uint32_t now = anchorCtx->currentTime_ms;
-      if (anchorInfo->remoteTof[i].endOfLife > now) {
-        return anchorInfo->remoteTof[i].tof;
-      }
-      break;
+  const int i = indexFind(index->bucketHead, index->next, TOF_PER_ANCHOR_COUNT, &anchorInfo->remoteTof[0].id, sizeof(tdoaTimeOfFlight_t), otherAnchor);
+  if (i >= 0) {
+    uint32_t now = anchorCtx->currentTime_ms;
+    if (anchorInfo->remoteTof[i].endOfLife > now) {
+      return anchorInfo->remoteTof[i].tof;
     }
   }
 
@@ -298,21 +306,28 @@ int64_t tdoaStorageGetRemoteTimeOfFlight(const tdoaAnchorContext_t* anchorCtx, c
 
 void tdoaStorageSetRemoteTimeOfFlight(tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, const int64_t tof) {
   tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
-
-  int indexToUpdate = 0;
+  tdoaTimeOfFlightIndex_t* index = &anchorInfo->remoteTofIndex;
   uint32_t now = anchorCtx->currentTime_ms;
-  uint32_t oldestTime = 0xFFFFFFFF;
 
-  for (int i = 0; i < TOF_PER_ANCHOR_COUNT; i++) {
-    if (remoteAnchor == anchorInfo->remoteTof[i].id) {
-      indexToUpdate = i;
-      break;
-    }
+  int indexToUpdate = indexFind(index->bucketHead, index->next, TOF_PER_ANCHOR_COUNT, &anchorInfo->remoteTof[0].id, sizeof(tdoaTimeOfFlight_t), remoteAnchor);
+  if (indexToUpdate < 0) {
+    if (index->used < TOF_PER_ANCHOR_COUNT) {
+      indexToUpdate = index->used;
+      index->used++;
+    } else {
+      // Replace the oldest entry
+      uint32_t oldestTime = 0xFFFFFFFF;
+      for (int i = 0; i < TOF_PER_ANCHOR_COUNT; i++) {
+        if (anchorInfo->remoteTof[i].endOfLife < oldestTime) {
+          oldestTime = anchorInfo->remoteTof[i].endOfLife;
+          indexToUpdate = i;
+        }
+      }
 
-    if (anchorInfo->remoteTof[i].endOfLife < oldestTime) {
-      oldestTime = anchorInfo->remoteTof[i].endOfLife;
-      indexToUpdate = i;
+      indexUnlink(index->bucketHead, index->next, TOF_PER_ANCHOR_COUNT, indexToUpdate, anchorInfo->remoteTof[indexToUpdate].id);
     }
+
+    indexLink(index->bucketHead, index->next, TOF_PER_ANCHOR_COUNT, indexToUpdate, remoteAnchor);
   }
 
   anchorInfo->remoteTof[indexToUpdate].id = remoteAnchor;
@@ -321,21 +336,75 @@ void tdoaStorageSetRemoteTimeOfFlight(tdoaAnchorContext_t* anchorCtx, const uint
 }
 
 bool tdoaStorageIsAnchorInStorage(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor) {
-  for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {
-    if (anchorStorage[i].isInitialized) {
-      if (anchor == anchorStorage[i].id) {
-        return true;
-      }
-    }
-  }
-
-  return false;
+  return findAnchorSlot(anchorStorage, anchor) >= 0;
 }
 
 static tdoaAnchorInfo_t* initializeSlot(tdoaAnchorInfo_t anchorStorage[], const uint8_t slot, const uint8_t anchor) {
+  if (anchorStorage[slot].isInitialized) {
+    // Remove the replaced anchor from the index
+    uint8_t* link = &anchorStorage[anchorStorage[slot].id % ANCHOR_STORAGE_COUNT].anchorBucketHead;
+    while (*link != slot + 1) {
+      link = &anchorStorage[*link - 1].anchorNext;
+    }
+    *link = anchorStorage[slot].anchorNext;
+  }
+
+  // The bucket head stored in this slot belongs to the index, keep it
+  const uint8_t bucketHead = anchorStorage[slot].anchorBucketHead;
   memset(&anchorStorage[slot], 0, sizeof(tdoaAnchorInfo_t));
+  anchorStorage[slot].anchorBucketHead = bucketHead;
+
   anchorStorage[slot].id = anchor;
   anchorStorage[slot].isInitialized = true;
 
+  tdoaAnchorInfo_t* bucket = &anchorStorage[anchor % ANCHOR_STORAGE_COUNT];
+  anchorStorage[slot].anchorNext = bucket->anchorBucketHead;
+  bucket->anchorBucketHead = slot + 1;
+
   return &anchorStorage[slot];
 }
+
+static int findAnchorSlot(const tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor) {
+  uint8_t link = anchorStorage[anchor % ANCHOR_STORAGE_COUNT].anchorBucketHead;
+  while (link != 0) {
+    const int slot = link - 1;
+    if (anchorStorage[slot].id == anchor) {
+      return slot;
+    }
+    link = anchorStorage[slot].anchorNext;
+  }
+
+  return -1;
+}
+
+// Index helpers for the remote data tables. The ids are read from the table
+// entries, firstId points to the id of the first entry.
+static int indexFind(const uint8_t bucketHead[], const uint8_t next[], const int size, const uint8_t* firstId, const size_t entrySize, const uint8_t id) {
+  uint8_t link = bucketHead[id % size];
+  while (link != 0) {
+    const int slot = link - 1;
+    if (firstId[slot * entrySize] == id) {
+      return slot;
+    }
+    link = next[slot];
+  }
+
+  return -1;
+}
+
+static void indexLink(uint8_t bucketHead[], uint8_t next[], const int size, const int slot, const uint8_t id) {
+  const int bucket = id % size;
+  next[slot] = bucketHead[bucket];
+  bucketHead[bucket] = slot + 1;
+}
+
+static void indexUnlink(uint8_t bucketHead[], uint8_t next[], const int size, const int slot, const uint8_t id) {
+  uint8_t* link = &bucketHead[id % size];
+  while (*link != 0) {
+    if (*link == slot + 1) {
+      *link = next[slot];
+      return;
+    }
+    link = &next[*link - 1];
+  }
+}
@@ -0,0 +1,201 @@
+// File under test storage.c
+#include "storage.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "freertosMocks.h"
+#include "mock_eeprom.h"
+#include "mock_worker.h"
+#include "kve/kve.h"
+#include "kve/kve_storage.h"
+
+// Covers the storage partition, which starts at 1024
+#define EEPROM_IMAGE_SIZE (8 * 1024)
+
+static uint8_t eeprom[EEPROM_IMAGE_SIZE];
+static int eepromReadCount;
+static bool isEepromWriteOk;
+
+// The job scheduled to release the boot snapshot
+static void (*scheduledJob)(void*);
+static void* scheduledJobArg;
+
+static const uint32_t storedValue = 0x12345678;
+static const uint32_t newValue = 0xcafebabe;
+
+static void releaseSnapshotNow();
+static bool eepromReadBufferMock(uint8_t* buffer, uint16_t readAddr, uint16_t len, int cmock_num_calls);
+static bool eepromWriteBufferMock(const uint8_t* buffer, uint16_t writeAddr, uint16_t len, int cmock_num_calls);
+static int workerScheduleJobMock(void (*function)(void*), void* arg, const workerPriority_t priority, const uint32_t delayMs, int cmock_num_calls);
+
+void setUp(void) {
+  memset(eeprom, 0xff, sizeof(eeprom));
+  isEepromWriteOk = true;
+  scheduledJob = 0;
+
+  eepromReadBuffer_StubWithCallback(eepromReadBufferMock);
+  eepromWriteBuffer_StubWithCallback(eepromWriteBufferMock);
+  workerScheduleJob_StubWithCallback(workerScheduleJobMock);
+
+  // A partition with one item, loaded to the snapshot by the second init
+  storageInit();
+  storageReformat();
+  storageStore("key", &storedValue, sizeof(storedValue));
+  releaseSnapshotNow();
+  storageInit();
+
+  eepromReadCount = 0;
+}
+
+void tearDown(void) {
+  releaseSnapshotNow();
+}
+
+void testThatFetchAfterInitIsReadFromTheSnapshot() {
+  // Fixture
+  uint32_t actual = 0;
+
+  // Test
+  size_t length = storageFetch("key", &actual, sizeof(actual));
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(sizeof(actual), length);
+  TEST_ASSERT_EQUAL_UINT32(storedValue, actual);
+  TEST_ASSERT_EQUAL_INT(0, eepromReadCount);
+}
+
+void testThatFetchAfterStoreReturnsTheNewValueFromTheSnapshot() {
+  // Fixture
+  uint32_t actual = 0;
+  storageStore("key", &newValue, sizeof(newValue));
+  eepromReadCount = 0;
+
+  // Test
+  size_t length = storageFetch("key", &actual, sizeof(actual));
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(sizeof(actual), length);
+  TEST_ASSERT_EQUAL_UINT32(newValue, actual);
+  TEST_ASSERT_EQUAL_INT(0, eepromReadCount);
+}
+
+void testThatTheSnapshotIsKeptUntilTheReleaseJobRuns() {
+  // Fixture
+  uint32_t actual = 0;
+
+  // Test
+  storageReleaseBootSnapshotAfterStart();
+  size_t length = storageFetch("key", &actual, sizeof(actual));
+
+  // Assert
+  TEST_ASSERT_NOT_NULL(scheduledJob);
+  TEST_ASSERT_EQUAL_UINT32(sizeof(actual), length);
+  TEST_ASSERT_EQUAL_UINT32(storedValue, actual);
+  TEST_ASSERT_EQUAL_INT(0, eepromReadCount);
+}
+
+void testThatFetchAfterReleaseIsReadFromTheEeprom() {
+  // Fixture
+  uint32_t actual = 0;
+  storageReleaseBootSnapshotAfterStart();
+
+  // Test
+  scheduledJob(scheduledJobArg);
+  size_t length = storageFetch("key", &actual, sizeof(actual));
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(sizeof(actual), length);
+  TEST_ASSERT_EQUAL_UINT32(storedValue, actual);
+  TEST_ASSERT_GREATER_THAN_INT(0, eepromReadCount);
+}
+
+void testThatFetchAfterStoreAndReleaseReadsTheNewValueFromTheEeprom() {
+  // Fixture
+  uint32_t actual = 0;
+  storageStore("key", &newValue, sizeof(newValue));
+  releaseSnapshotNow();
+  eepromReadCount = 0;
+
+  // Test
+  size_t length = storageFetch("key", &actual, sizeof(actual));
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(sizeof(actual), length);
+  TEST_ASSERT_EQUAL_UINT32(newValue, actual);
+  TEST_ASSERT_GREATER_THAN_INT(0, eepromReadCount);
+}
+
+void testThatFailedWriteReleasesTheSnapshot() {
+  // Fixture
+  uint32_t actual = 0;
+  isEepromWriteOk = false;
+  storageStore("other", &newValue, sizeof(newValue));
+
+  // Test
+  size_t length = storageFetch("key", &actual, sizeof(actual));
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(sizeof(actual), length);
+  TEST_ASSERT_EQUAL_UINT32(storedValue, actual);
+  TEST_ASSERT_GREATER_THAN_INT(0, eepromReadCount);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void releaseSnapshotNow() {
+  scheduledJob = 0;
+  storageReleaseBootSnapshotAfterStart();
+  if (scheduledJob) {
+    scheduledJob(scheduledJobArg);
+  }
+}
+
+static bool eepromReadBufferMock(uint8_t* buffer, uint16_t readAddr, uint16_t len, int cmock_num_calls) {
+  TEST_ASSERT_TRUE(readAddr + len <= EEPROM_IMAGE_SIZE);
+  memcpy(buffer, &eeprom[readAddr], len);
+  eepromReadCount++;
+  return true;
+}
+
+static bool eepromWriteBufferMock(const uint8_t* buffer, uint16_t writeAddr, uint16_t len, int cmock_num_calls) {
+  TEST_ASSERT_TRUE(writeAddr + len <= EEPROM_IMAGE_SIZE);
+  if (!isEepromWriteOk) {
+    return false;
+  }
+
+  memcpy(&eeprom[writeAddr], buffer, len);
+  return true;
+}
+
+static int workerScheduleJobMock(void (*function)(void*), void* arg, const workerPriority_t priority, const uint32_t delayMs, int cmock_num_calls) {
+  scheduledJob = function;
+  scheduledJobArg = arg;
+  return 0;
+}
+
+// FreeRTOS glue used by storage.c, there is no other task to wait for
+
+QueueHandle_t xQueueCreateMutex(const uint8_t ucQueueType) {
+  static StaticQueue_t mutex;
+  return (QueueHandle_t)&mutex;
+}
+
+BaseType_t xQueueSemaphoreTake(QueueHandle_t xQueue, TickType_t xTicksToWait) {
+  return pdTRUE;
+}
+
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition) {
+  return pdTRUE;
+}
+
+void* pvPortMalloc(size_t xWantedSize) {
+  return malloc(xWantedSize);
+}
+
+void vPortFree(void* pv) {
+  free(pv);
+}
@@ -0,0 +1,87 @@
+// File under benchmark collision_avoidance.c
+#include "collision_avoidance.h"
+
+#include <math.h>
+#include <string.h>
+#include "unity.h"
+#include "bench.h"
+
+#define PEER_COUNT 50
+#define SPACING 0.8f
+
+static collision_avoidance_params_t params;
+static collision_avoidance_state_t collisionState;
+static float workspace[COLLISION_AVOIDANCE_WORKSPACE_SIZE(PEER_COUNT)];
+static setpoint_t setpoint;
+static sensorData_t sensorData;
+static state_t state;
+
+static void placePeers(void* context);
+static void updateSetpoint(void* context);
+
+void setUp(void) {
+  memset(&params, 0, sizeof(params));
+  params.ellipsoidRadii = mkvec(0.3f, 0.3f, 0.9f);
+  params.bboxMin = mkvec(-INFINITY, -INFINITY, -INFINITY);
+  params.bboxMax = mkvec(INFINITY, INFINITY, INFINITY);
+  params.horizonSecs = 1.0f;
+  params.maxSpeed = 0.5f;
+  params.sidestepThreshold = 0.25f;
+  params.maxPeerLocAgeMillis = 5000;
+  params.voronoiProjectionTolerance = 1e-5f;
+  params.voronoiProjectionMaxIters = 100;
+
+  memset(&collisionState, 0, sizeof(collisionState));
+  collisionState.lastFeasibleSetPosition = mkvec(NAN, NAN, NAN);
+
+  memset(&sensorData, 0, sizeof(sensorData));
+  memset(&state, 0, sizeof(state));
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testBenchmarkUpdateSetpointCore() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("collisionAvoidanceUpdateSetpointCore", placePeers, updateSetpoint, 0, BENCH_DEFAULT_SAMPLES, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  TEST_ASSERT_TRUE(collisionState.nActivePeers > 0);
+  TEST_ASSERT_TRUE(setpoint.velocity.x <= 0.5f * SPACING - 0.3f + 1e-3f);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+// The peers in a grid around us, flying in a velocity mode towards a close
+// neighbor. The positions are set for every call since the workspace
+// overwrites them.
+static void placePeers(void* context) {
+  const int side = (int)ceilf(sqrtf(PEER_COUNT + 1));
+  int peer = 0;
+  for (int cell = 0; peer < PEER_COUNT; cell++) {
+    const float x = (cell % side - side / 2) * SPACING;
+    const float y = (cell / side - side / 2) * SPACING;
+    if (x == 0.0f && y == 0.0f) {
+      // Our own spot in the grid
+      continue;
+    }
+    workspace[3 * peer + 0] = x;
+    workspace[3 * peer + 1] = y;
+    workspace[3 * peer + 2] = 0.0f;
+    peer++;
+  }
+
+  memset(&setpoint, 0, sizeof(setpoint));
+  setpoint.mode.x = modeVelocity;
+  setpoint.mode.y = modeVelocity;
+  setpoint.mode.z = modeVelocity;
+  setpoint.velocity.x = 0.5f;
+  setpoint.velocity.y = 0.0f;
+}
+
+static void updateSetpoint(void* context) {
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, PEER_COUNT, workspace, workspace, &setpoint, &sensorData, &state);
+}
@@ -0,0 +1,174 @@
+// File under benchmark log.c
+#include "log.h"
+
+#include <string.h>
+#include "unity.h"
+#include "bench.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "semphr.h"
+#include "queue.h"
+#include "freertosMocks.h"
+#include "mock_crtp.h"
+#include "mock_worker.h"
+#include "crc32.h"
+#include "log_plan.h"
+#include "num.h"
+
+#define BLOCKS_PER_SAMPLE 100
+#define BLOCK_ID 1
+
+// The variable format of a CONTROL_CREATE_BLOCK_V2 request
+struct ops_setting_v2 {
+  uint8_t logType;
+  uint16_t id;
+} __attribute__((packed));
+
+// Not in the header
+void logRunBlock(void * arg);
+int logCreateBlockV2(unsigned char id, struct ops_setting_v2 * settings, int len);
+
+// linker symbols mock
+struct log_s *_log_start;
+struct log_s *_log_stop;
+
+// A typical block: a state vector of floats and a few compressed values
+static struct {
+  float pos[3];
+  float vel[3];
+  uint16_t thrust;
+  int16_t rate[3];
+} variables;
+
+static struct log_s toc[] = {
+  {.type = LOG_GROUP | LOG_START, .name = "bench"},
+  {.type = LOG_FLOAT, .name = "x", .address = &variables.pos[0]},
+  {.type = LOG_FLOAT, .name = "y", .address = &variables.pos[1]},
+  {.type = LOG_FLOAT, .name = "z", .address = &variables.pos[2]},
+  {.type = LOG_FLOAT, .name = "vx", .address = &variables.vel[0]},
+  {.type = LOG_FLOAT, .name = "vy", .address = &variables.vel[1]},
+  {.type = LOG_FLOAT, .name = "vz", .address = &variables.vel[2]},
+  {.type = LOG_UINT16, .name = "thrust", .address = &variables.thrust},
+  {.type = LOG_INT16, .name = "rateRoll", .address = &variables.rate[0]},
+  {.type = LOG_INT16, .name = "ratePitch", .address = &variables.rate[1]},
+  {.type = LOG_INT16, .name = "rateYaw", .address = &variables.rate[2]},
+  {.type = LOG_GROUP | LOG_STOP, .name = "stop_bench"},
+};
+
+// The log block, the timer id of the block is the block itself
+static void* block;
+static int sentCount;
+static uint8_t sentSize;
+
+static void runBlock(void* context);
+static int crtpSendPacketMock(CRTPPacket* pk, int cmock_num_calls);
+
+void setUp(void) {
+  variables.pos[0] = 1.0f;
+  variables.pos[1] = 2.0f;
+  variables.pos[2] = 3.0f;
+  variables.vel[0] = 4.0f;
+  variables.vel[1] = 5.0f;
+  variables.vel[2] = 6.0f;
+  variables.thrust = 1000;
+  variables.rate[0] = -1;
+  variables.rate[1] = 2;
+  variables.rate[2] = -3;
+
+  crtpIsConnected_IgnoreAndReturn(true);
+  crtpSendPacket_StubWithCallback(crtpSendPacketMock);
+  sentCount = 0;
+  sentSize = 0;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+// A timed block as set up by a client, the time includes the lock and the
+// packet handling around the packing of the block
+void testBenchmarkRunBlock() {
+  // Fixture
+  _log_start = toc;
+  _log_stop = toc + sizeof(toc) / sizeof(toc[0]);
+  logInit();
+
+  struct ops_setting_v2 settings[] = {
+    {.logType = LOG_FLOAT, .id = 0},
+    {.logType = LOG_FLOAT, .id = 1},
+    {.logType = LOG_FLOAT, .id = 2},
+    {.logType = LOG_FP16, .id = 3},
+    {.logType = LOG_FP16, .id = 4},
+    {.logType = LOG_FP16, .id = 5},
+    {.logType = LOG_UINT16, .id = 6},
+    {.logType = LOG_INT8, .id = 7},
+    {.logType = LOG_INT8, .id = 8},
+    {.logType = LOG_INT8, .id = 9},
+  };
+  TEST_ASSERT_EQUAL_INT(0, logCreateBlockV2(BLOCK_ID, settings, sizeof(settings) / sizeof(settings[0])));
+
+  // Test
+  benchResult_t actual = benchRun("logRunBlock", 0, runBlock, 0, BENCH_DEFAULT_SAMPLES, BLOCKS_PER_SAMPLE);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  TEST_ASSERT_TRUE(sentCount > 0);
+  TEST_ASSERT_EQUAL_UINT8(4 + 3 * 4 + 3 * 2 + 2 + 3 * 1, sentSize);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void runBlock(void* context) {
+  logRunBlock(block);
+}
+
+static int crtpSendPacketMock(CRTPPacket* pk, int cmock_num_calls) {
+  sentCount++;
+  sentSize = pk->size;
+  return true;
+}
+
+// FreeRTOS glue used by log.c, there is no other task to wait for
+
+BaseType_t xQueueSemaphoreTake(QueueHandle_t xQueue, TickType_t xTicksToWait) {
+  return pdTRUE;
+}
+
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition) {
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait) {
+  return pdFALSE;
+}
+
+BaseType_t xQueueGenericReset(QueueHandle_t xQueue, BaseType_t xNewQueue) {
+  return pdPASS;
+}
+
+QueueHandle_t xQueueCreateMutexStatic(const uint8_t ucQueueType, StaticQueue_t *pxStaticQueue) {
+  return (QueueHandle_t)pxStaticQueue;
+}
+
+QueueHandle_t xQueueGenericCreateStatic(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, uint8_t *pucQueueStorage, StaticQueue_t *pxStaticQueue, const uint8_t ucQueueType) {
+  return (QueueHandle_t)pxStaticQueue;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t ulStackDepth, void * const pvParameters, UBaseType_t uxPriority, StackType_t * const puxStackBuffer, StaticTask_t * const pxTaskBuffer) {
+  return (TaskHandle_t)pxTaskBuffer;
+}
+
+TimerHandle_t xTimerCreateStatic(const char * const pcTimerName, const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload, void * const pvTimerID, TimerCallbackFunction_t pxCallbackFunction, StaticTimer_t *pxTimerBuffer) {
+  block = pvTimerID;
+  return (TimerHandle_t)pxTimerBuffer;
+}
+
+BaseType_t xTimerGenericCommand(TimerHandle_t xTimer, const BaseType_t xCommandID, const TickType_t xOptionalValue, BaseType_t * const pxHigherPriorityTaskWoken, const TickType_t xTicksToWait) {
+  return pdPASS;
+}
+
+void *pvTimerGetTimerID(const TimerHandle_t xTimer) {
+  return block;
+}
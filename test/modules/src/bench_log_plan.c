@@ -0,0 +1,81 @@
+// File under benchmark log_plan.c
+#include "log_plan.h"
+
+#include <string.h>
+#include "unity.h"
+#include "bench.h"
+#include "num.h"
+
+#define MAX_OP_COUNT 16
+#define MAX_BLOCK_LEN 26
+#define BLOCKS_PER_SAMPLE 100
+
+// A typical block: a state vector of floats and a few compressed values
+static struct {
+  float pos[3];
+  float vel[3];
+  uint16_t thrust;
+  int16_t rate[3];
+} variables;
+
+static logPlanOp_t ops[MAX_OP_COUNT];
+static logPlanStep_t steps[MAX_OP_COUNT];
+static int stepCount;
+static uint8_t out[MAX_BLOCK_LEN];
+static uint32_t timestamp;
+static int outLength;
+
+static void runBlock(void* context);
+
+void setUp(void) {
+  variables.pos[0] = 1.0f;
+  variables.pos[1] = 2.0f;
+  variables.pos[2] = 3.0f;
+  variables.vel[0] = 4.0f;
+  variables.vel[1] = 5.0f;
+  variables.vel[2] = 6.0f;
+  variables.thrust = 1000;
+  variables.rate[0] = -1;
+  variables.rate[1] = 2;
+  variables.rate[2] = -3;
+
+  int opCount = 0;
+  for (int i = 0; i < 3; i++) {
+    ops[opCount++] = (logPlanOp_t){.variable = &variables.pos[i], .storageType = LOG_FLOAT, .logType = LOG_FLOAT};
+  }
+  for (int i = 0; i < 3; i++) {
+    ops[opCount++] = (logPlanOp_t){.variable = &variables.vel[i], .storageType = LOG_FLOAT, .logType = LOG_FP16};
+  }
+  ops[opCount++] = (logPlanOp_t){.variable = &variables.thrust, .storageType = LOG_UINT16, .logType = LOG_UINT16};
+  for (int i = 0; i < 3; i++) {
+    ops[opCount++] = (logPlanOp_t){.variable = &variables.rate[i], .storageType = LOG_INT16, .logType = LOG_INT8};
+  }
+  stepCount = logPlanCompile(ops, opCount, steps);
+
+  timestamp = 0;
+  outLength = 0;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+// The packing of the block, bench_log.c times all of logRunBlock() for the same
+// block
+void testBenchmarkPlanRun() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("logPlanRun", 0, runBlock, 0, BENCH_DEFAULT_SAMPLES, BLOCKS_PER_SAMPLE);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  TEST_ASSERT_EQUAL_INT(3 * 4 + 3 * 2 + 2 + 3 * 1, outLength);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void runBlock(void* context) {
+  variables.pos[0] = (float)timestamp;
+  outLength = logPlanRun(steps, stepCount, out, timestamp);
+  timestamp++;
+}
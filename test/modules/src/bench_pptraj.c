@@ -0,0 +1,84 @@
+// File under benchmark pptraj.c
+#include "pptraj.h"
+
+#include <math.h>
+#include "unity.h"
+#include "bench.h"
+
+#define PIECE_COUNT 10
+#define EVALUATIONS_PER_SAMPLE 100
+
+static struct poly4d pieces[PIECE_COUNT];
+static struct piecewise_traj traj;
+static float t;
+static float sink;
+
+static int pieceNr;
+
+static void evaluate(void* context);
+static void evaluatePiece(void* context);
+
+void setUp(void) {
+  // A flight through the corners of a square, one piece per side
+  for (int i = 0; i < PIECE_COUNT; i++) {
+    struct piecewise_traj piece = {.pieces = &pieces[i]};
+    const struct vec from = mkvec(i % 4 < 2 ? 0.0f : 1.0f, (i + 1) % 4 < 2 ? 0.0f : 1.0f, 1.0f);
+    const struct vec to = mkvec((i + 1) % 4 < 2 ? 0.0f : 1.0f, (i + 2) % 4 < 2 ? 0.0f : 1.0f, 1.0f);
+    piecewise_plan_7th_order_no_jerk(&piece, 1.0f, from, 0.0f, vzero(), 0.0f, vzero(), to, 0.0f, vzero(), 0.0f, vzero());
+  }
+
+  traj.t_begin = 0.0f;
+  traj.timescale = 1.0f;
+  traj.shift = mkvec(0.5f, -0.5f, 0.0f);
+  traj.n_pieces = PIECE_COUNT;
+  traj.pieces = pieces;
+
+  t = 0.0f;
+  sink = 0.0f;
+  pieceNr = 0;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testBenchmarkPiecewiseEval() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("piecewise_eval", 0, evaluate, 0, BENCH_DEFAULT_SAMPLES, EVALUATIONS_PER_SAMPLE);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  TEST_ASSERT_TRUE(isfinite(sink));
+}
+
+void testBenchmarkPoly4dEval() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("poly4d_eval", 0, evaluatePiece, 0, BENCH_DEFAULT_SAMPLES, EVALUATIONS_PER_SAMPLE);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  TEST_ASSERT_TRUE(isfinite(sink));
+}
+
+// Helpers ////////////////////////////////////////////////
+
+// Sweeps the whole trajectory, as the high level commander does in flight
+static void evaluate(void* context) {
+  const struct traj_eval ev = piecewise_eval(&traj, t);
+  sink += ev.pos.x;
+
+  t += 0.013f;
+  if (t > PIECE_COUNT) {
+    t = 0.0f;
+  }
+}
+
+// The fused evaluation of one piece, including the derivatives and omega
+static void evaluatePiece(void* context) {
+  struct poly4d const *piece = &pieces[pieceNr % PIECE_COUNT];
+  const struct traj_eval ev = poly4d_eval(piece, piece->duration * 0.5f);
+  sink += ev.omega.x;
+  pieceNr++;
+}
@@ -0,0 +1,113 @@
+// File under benchmark estimator_ukf_kernels.c
+#include "estimator_ukf_kernels.h"
+
+#include <math.h>
+#include <string.h>
+#include "unity.h"
+#include "bench.h"
+
+#define N UKF_DIM_FILTER
+#define S UKF_SIGMA_POINTS
+
+static float initialP[N][N];
+static float P[N][N];
+static float x[N];
+static float F[N][N];
+static float h[UKF_MAX_BATCH][N];
+static float measurements[UKF_MAX_BATCH];
+static float weights[S];
+static float scales[N];
+static ukfBatch_t batch;
+static bool updated;
+
+static void resetState(void* context);
+static void predictAndUpdate(void* context);
+static void predictLinearMeasurement(const float sigma[S][N], const float h[N], float outputs[S]);
+
+void setUp(void) {
+  // A covariance with some correlation between the states
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      initialP[i][j] = (i == j) ? 0.1f : 0.01f / (1.0f + fabsf((float)(i - j)));
+    }
+  }
+
+  // A transition close to identity
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      F[i][j] = (i == j ? 1.0f : 0.0f) + 0.001f * (float)((i + 2 * j) % 5 - 2);
+    }
+  }
+
+  // Measurements of linear combinations of the position
+  memset(h, 0, sizeof(h));
+  for (int r = 0; r < UKF_MAX_BATCH; r++) {
+    h[r][r % 3] = 1.0f;
+    h[r][(r + 1) % 3] = 0.5f;
+    measurements[r] = 0.01f * (float)(r - 2);
+  }
+
+  ukfSigmaPointWeights(0.6f, weights, scales);
+  memset(&batch, 0, sizeof(batch));
+  updated = false;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testBenchmarkPredictAndBatchUpdate() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("ukfPredictAndBatchUpdate", resetState, predictAndUpdate, 0, BENCH_DEFAULT_SAMPLES, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  TEST_ASSERT_TRUE(updated);
+  for (int i = 0; i < N; i++) {
+    TEST_ASSERT_TRUE(isfinite(x[i]));
+    TEST_ASSERT_TRUE(isfinite(P[i][i]));
+  }
+}
+
+// Helpers ////////////////////////////////////////////////
+
+// Every sample starts from the same estimate
+static void resetState(void* context) {
+  memcpy(P, initialP, sizeof(P));
+  memset(x, 0, sizeof(x));
+}
+
+// A prediction followed by a batch of scalar measurements, as in one step of
+// the filter
+static void predictAndUpdate(void* context) {
+  float L[N][N];
+  float sigma[S][N];
+  float outputs[S];
+
+  memcpy(L, P, sizeof(P));
+  ukfCholeskyInPlace(&L[0][0], N);
+  ukfSigmaPoints(L, scales, x, sigma);
+  ukfPropagate(F, weights, sigma, P);
+
+  memcpy(L, P, sizeof(P));
+  ukfCholeskyInPlace(&L[0][0], N);
+  ukfSigmaPoints(L, scales, x, sigma);
+  for (int r = 0; r < UKF_MAX_BATCH; r++) {
+    float mean, variance;
+    predictLinearMeasurement(sigma, h[r], outputs);
+    ukfOutputStatistics(outputs, weights, &mean, &variance);
+    ukfBatchAdd(&batch, outputs, mean, measurements[r] - mean, 0.01f);
+  }
+  updated = ukfBatchUpdate(&batch, sigma, weights, x, P);
+}
+
+static void predictLinearMeasurement(const float sigma[S][N], const float h[N], float outputs[S]) {
+  for (int j = 0; j < S; j++) {
+    float sum = 0.0f;
+    for (int i = 0; i < N; i++) {
+      sum += h[i] * sigma[j][i];
+    }
+    outputs[j] = sum;
+  }
+}
@@ -0,0 +1,384 @@
+// File under test estimator_ukf_kernels.c
+#include "estimator_ukf_kernels.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+
+#define N UKF_DIM_FILTER
+#define S UKF_SIGMA_POINTS
+
+static float P[N][N];
+static float x[N];
+static float weights[S];
+static float scales[N];
+static ukfBatch_t batch;
+
+static float randomFloat(const float min, const float max);
+static void randomCovariance(float P[N][N]);
+static void randomLinearMeasurement(float h[N]);
+static void factorize(const float P[N][N], float L[N][N]);
+static void predictLinearMeasurement(const float sigma[S][N], const float h[N], float outputs[S]);
+static void referenceSigmaPoints(const float P[N][N], const float x[N], float sigma[N][S]);
+static void referencePredict(const float F[N][N], float P[N][N]);
+static void referenceScalarUpdate(const float h[N], const float measurement, const float noiseVariance, float x[N], float P[N][N]);
+static void assertMatricesAreEqual(const float expected[N][N], const float actual[N][N]);
+
+void setUp(void) {
+  srand(4711);
+  randomCovariance(P);
+  for (int i = 0; i < N; i++) {
+    x[i] = randomFloat(-0.1f, 0.1f);
+  }
+  ukfSigmaPointWeights(0.6f, weights, scales);
+  memset(&batch, 0, sizeof(batch));
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatCholeskyFactorIsLowerTriangularAndReproducesTheMatrix() {
+  // Fixture
+  float L[N][N];
+  memcpy(L, P, sizeof(L));
+
+  // Test
+  const bool actual = ukfCholeskyInPlace(&L[0][0], N);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      if (j > i) {
+        TEST_ASSERT_EQUAL_FLOAT(0.0f, L[i][j]);
+      }
+
+      float sum = 0.0f;
+      for (int k = 0; k < N; k++) {
+        sum += L[i][k] * L[j][k];
+      }
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, P[i][j], sum);
+    }
+  }
+}
+
+void testThatCholeskyFailsForMatrixThatIsNotPositiveDefinite() {
+  // Fixture
+  float A[2 * 2] = {1.0f, 2.0f, 2.0f, 1.0f};
+
+  // Test
+  const bool actual = ukfCholeskyInPlace(A, 2);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatSigmaPointsMatchTheNormalizedPointsTransformedByTheFactor() {
+  // Fixture
+  float L[N][N];
+  float expected[N][S];
+  float actual[S][N];
+  factorize(P, L);
+  referenceSigmaPoints(P, x, expected);
+
+  // Test
+  ukfSigmaPoints(L, scales, x, actual);
+
+  // Assert
+  for (int j = 0; j < S; j++) {
+    for (int i = 0; i < N; i++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, expected[i][j], actual[j][i]);
+    }
+  }
+}
+
+void testThatSigmaPointsHaveTheMeanAndCovarianceOfTheEstimate() {
+  // Fixture
+  float L[N][N];
+  float sigma[S][N];
+  factorize(P, L);
+
+  // Test
+  ukfSigmaPoints(L, scales, x, sigma);
+
+  // Assert
+  for (int i = 0; i < N; i++) {
+    float mean = 0.0f;
+    for (int j = 0; j < S; j++) {
+      mean += weights[j] * sigma[j][i];
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, x[i], mean);
+
+    for (int k = 0; k < N; k++) {
+      float covariance = 0.0f;
+      for (int j = 0; j < S; j++) {
+        covariance += weights[j] * (sigma[j][i] - x[i]) * (sigma[j][k] - x[k]);
+      }
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, P[i][k], covariance);
+    }
+  }
+}
+
+void testThatPropagationMatchesReference() {
+  // Fixture
+  float F[N][N];
+  float L[N][N];
+  float sigma[S][N];
+  float expected[N][N];
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      F[i][j] = (i == j ? 1.0f : 0.0f) + randomFloat(-0.05f, 0.05f);
+    }
+  }
+
+  memset(x, 0, sizeof(x));
+  memcpy(expected, P, sizeof(P));
+  referencePredict(F, expected);
+
+  factorize(P, L);
+  ukfSigmaPoints(L, scales, x, sigma);
+
+  // Test
+  ukfPropagate(F, weights, sigma, P);
+
+  // Assert
+  assertMatricesAreEqual(expected, P);
+}
+
+void testThatBatchUpdateMatchesSequentialScalarUpdates() {
+  // Fixture
+  float h[UKF_MAX_BATCH][N];
+  float measurements[UKF_MAX_BATCH];
+  const float noiseVariance = 0.01f;
+  float expectedX[N];
+  float expectedP[N][N];
+  memcpy(expectedX, x, sizeof(x));
+  memcpy(expectedP, P, sizeof(P));
+
+  for (int r = 0; r < UKF_MAX_BATCH; r++) {
+    randomLinearMeasurement(h[r]);
+    measurements[r] = randomFloat(-0.5f, 0.5f);
+    referenceScalarUpdate(h[r], measurements[r], noiseVariance, expectedX, expectedP);
+  }
+
+  float L[N][N];
+  float sigma[S][N];
+  float outputs[S];
+  factorize(P, L);
+  ukfSigmaPoints(L, scales, x, sigma);
+  for (int r = 0; r < UKF_MAX_BATCH; r++) {
+    float mean, variance;
+    predictLinearMeasurement(sigma, h[r], outputs);
+    ukfOutputStatistics(outputs, weights, &mean, &variance);
+    TEST_ASSERT_TRUE(ukfBatchAdd(&batch, outputs, mean, measurements[r] - mean, noiseVariance));
+  }
+
+  // Test
+  const bool actual = ukfBatchUpdate(&batch, sigma, weights, x, P);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_EQUAL_UINT8(0, batch.count);
+  for (int i = 0; i < N; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, expectedX[i], x[i]);
+  }
+  assertMatricesAreEqual(expectedP, P);
+}
+
+void testThatFullBatchRejectsMeasurement() {
+  // Fixture
+  float outputs[S] = {0};
+  for (int r = 0; r < UKF_MAX_BATCH; r++) {
+    ukfBatchAdd(&batch, outputs, 0.0f, 0.0f, 1.0f);
+  }
+
+  // Test
+  const bool actual = ukfBatchAdd(&batch, outputs, 0.0f, 0.0f, 1.0f);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_UINT8(UKF_MAX_BATCH, batch.count);
+}
+
+void testThatEmptyBatchDoesNotUpdateTheState() {
+  // Fixture
+  float sigma[S][N] = {0};
+  float expectedX[N];
+  memcpy(expectedX, x, sizeof(x));
+
+  // Test
+  const bool actual = ukfBatchUpdate(&batch, sigma, weights, x, P);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_FLOAT_ARRAY(expectedX, x, N);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static float randomFloat(const float min, const float max) {
+  return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+// P = B * B' + 0.01 * I
+static void randomCovariance(float P[N][N]) {
+  float B[N][N];
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      B[i][j] = randomFloat(-0.3f, 0.3f);
+    }
+  }
+
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      float sum = (i == j) ? 0.01f : 0.0f;
+      for (int k = 0; k < N; k++) {
+        sum += B[i][k] * B[j][k];
+      }
+      P[i][j] = sum;
+    }
+  }
+}
+
+static void randomLinearMeasurement(float h[N]) {
+  memset(h, 0, N * sizeof(float));
+  for (int i = 0; i < 3; i++) {
+    h[i] = randomFloat(-1.0f, 1.0f);
+  }
+}
+
+static void factorize(const float P[N][N], float L[N][N]) {
+  memcpy(L, P, N * N * sizeof(float));
+  TEST_ASSERT_TRUE(ukfCholeskyInPlace(&L[0][0], N));
+}
+
+static void predictLinearMeasurement(const float sigma[S][N], const float h[N], float outputs[S]) {
+  for (int j = 0; j < S; j++) {
+    float sum = 0.0f;
+    for (int i = 0; i < N; i++) {
+      sum += h[i] * sigma[j][i];
+    }
+    outputs[j] = sum;
+  }
+}
+
+// The sigma points as computed by the filter before the kernels, one sigma
+// point per column, with a full product of the factor and the normalized points
+static void referenceSigmaPoints(const float P[N][N], const float x[N], float sigma[N][S]) {
+  float L[N][N] = {0};
+  float templ[N][S] = {{0}};
+
+  const float weight1 = weights[1];
+  for (int i = 0; i < N; i++) {
+    const float tmp = 1.0f / sqrtf(((float)i + 1.0f) * ((float)i + 2.0f) * weight1);
+    for (int j = 1; j < i + 2; j++) {
+      templ[i][j] = -tmp;
+    }
+    templ[i][i + 2] = tmp * ((float)i + 1.0f);
+  }
+
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < i + 1; j++) {
+      float s = 0.0f;
+      for (int k = 0; k < j; k++) {
+        s += L[i][k] * L[j][k];
+      }
+      L[i][j] = (i == j) ? sqrtf(P[i][i] - s) : (1.0f / L[j][j] * (P[i][j] - s));
+    }
+  }
+
+  for (int j = 0; j < S; j++) {
+    for (int i = 0; i < N; i++) {
+      sigma[i][j] = 0.0f;
+      for (int k = 0; k < N; k++) {
+        sigma[i][j] += L[i][k] * templ[k][j];
+      }
+      sigma[i][j] += x[i];
+    }
+  }
+}
+
+// P = F * P * F' from the propagated sigma points, as the filter did before the kernels
+static void referencePredict(const float F[N][N], float P[N][N]) {
+  float sigma[N][S];
+  float propagated[N][S];
+  float zero[N] = {0};
+  float covNew[N][N] = {{0}};
+  referenceSigmaPoints(P, zero, sigma);
+
+  for (int j = 0; j < S; j++) {
+    for (int i = 0; i < N; i++) {
+      propagated[i][j] = 0.0f;
+      for (int k = 0; k < N; k++) {
+        propagated[i][j] += F[i][k] * sigma[k][j];
+      }
+    }
+  }
+
+  for (int k = 0; k < S; k++) {
+    for (int i = 0; i < N; i++) {
+      for (int j = 0; j < N; j++) {
+        covNew[i][j] += weights[k] * propagated[i][k] * propagated[j][k];
+      }
+    }
+  }
+
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      P[i][j] = 0.5f * (covNew[i][j] + covNew[j][i]);
+    }
+  }
+}
+
+// One scalar update with new sigma points, as the filter did before the kernels
+static void referenceScalarUpdate(const float h[N], const float measurement, const float noiseVariance, float x[N], float P[N][N]) {
+  float sigma[N][S];
+  float outputs[S];
+  referenceSigmaPoints(P, x, sigma);
+
+  float observation = 0.0f;
+  for (int j = 0; j < S; j++) {
+    outputs[j] = 0.0f;
+    for (int i = 0; i < N; i++) {
+      outputs[j] += h[i] * sigma[i][j];
+    }
+    observation += weights[j] * outputs[j];
+  }
+
+  float Pyy = noiseVariance;
+  float Pxy[N] = {0};
+  for (int j = 0; j < S; j++) {
+    Pyy += weights[j] * (outputs[j] - observation) * (outputs[j] - observation);
+    for (int i = 0; i < N; i++) {
+      Pxy[i] += weights[j] * (sigma[i][j] - x[i]) * (outputs[j] - observation);
+    }
+  }
+
+  float K[N];
+  for (int i = 0; i < N; i++) {
+    K[i] = Pxy[i] / Pyy;
+    x[i] += K[i] * (measurement - observation);
+  }
+
+  float covNew[N][N];
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      covNew[i][j] = P[i][j] - K[i] * K[j] * Pyy;
+    }
+  }
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      P[i][j] = 0.5f * covNew[i][j] + 0.5f * covNew[j][i];
+    }
+  }
+}
+
+static void assertMatricesAreEqual(const float expected[N][N], const float actual[N][N]) {
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f + 1e-3f * fabsf(expected[i][j]), expected[i][j], actual[i][j]);
+    }
+  }
+}
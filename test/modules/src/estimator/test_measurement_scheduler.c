@@ -0,0 +1,169 @@
+// File under test measurement_scheduler.c
+#include "measurement_scheduler.h"
+
+#include <string.h>
+#include "unity.h"
+
+static measurementScheduler_t scheduler;
+static measurement_t measurement;
+
+static void add(const MeasurementType type, const float value);
+static float valueOf(const measurement_t* m);
+
+void setUp(void) {
+  measurementSchedulerInit(&scheduler);
+  memset(&measurement, 0, sizeof(measurement));
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatEmptySchedulerHasNothingToTake() {
+  // Fixture
+  // Test
+  const bool actual = measurementSchedulerTake(&scheduler, &measurement);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatMeasurementsWithTheSamePriorityAreTakenFirstInFirstOut() {
+  // Fixture
+  add(MeasurementTypeTDOA, 1.0f);
+  add(MeasurementTypeSweepAngle, 2.0f);
+  add(MeasurementTypeTDOA, 3.0f);
+
+  // Test
+  // Assert
+  TEST_ASSERT_TRUE(measurementSchedulerTake(&scheduler, &measurement));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, valueOf(&measurement));
+  TEST_ASSERT_TRUE(measurementSchedulerTake(&scheduler, &measurement));
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, valueOf(&measurement));
+  TEST_ASSERT_TRUE(measurementSchedulerTake(&scheduler, &measurement));
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, valueOf(&measurement));
+  TEST_ASSERT_FALSE(measurementSchedulerTake(&scheduler, &measurement));
+}
+
+void testThatHigherPriorityMeasurementIsTakenFirst() {
+  // Fixture
+  add(MeasurementTypeBarometer, 1.0f);
+  add(MeasurementTypeTDOA, 2.0f);
+  add(MeasurementTypeTOF, 3.0f);
+
+  // Test
+  // Assert
+  TEST_ASSERT_TRUE(measurementSchedulerTake(&scheduler, &measurement));
+  TEST_ASSERT_EQUAL_INT(MeasurementTypeTOF, measurement.type);
+  TEST_ASSERT_TRUE(measurementSchedulerTake(&scheduler, &measurement));
+  TEST_ASSERT_EQUAL_INT(MeasurementTypeTDOA, measurement.type);
+  TEST_ASSERT_TRUE(measurementSchedulerTake(&scheduler, &measurement));
+  TEST_ASSERT_EQUAL_INT(MeasurementTypeBarometer, measurement.type);
+}
+
+void testThatPriorityCanBeChanged() {
+  // Fixture
+  measurementSchedulerSetPriority(&scheduler, MeasurementTypeTOF, measurementPriorityLow);
+  add(MeasurementTypeTOF, 1.0f);
+  add(MeasurementTypeTDOA, 2.0f);
+
+  // Test
+  measurementSchedulerTake(&scheduler, &measurement);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(MeasurementTypeTDOA, measurement.type);
+}
+
+void testThatPendingMeasurementsAreTakenAfterTheirPriorityIsChanged() {
+  // Fixture
+  add(MeasurementTypeTDOA, 1.0f);
+  add(MeasurementTypeTDOA, 2.0f);
+
+  // Test
+  measurementSchedulerSetPriority(&scheduler, MeasurementTypeTDOA, measurementPriorityHigh);
+  add(MeasurementTypeTDOA, 3.0f);
+
+  // Assert
+  TEST_ASSERT_TRUE(measurementSchedulerTake(&scheduler, &measurement));
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, valueOf(&measurement));
+  TEST_ASSERT_TRUE(measurementSchedulerTake(&scheduler, &measurement));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, valueOf(&measurement));
+  TEST_ASSERT_TRUE(measurementSchedulerTake(&scheduler, &measurement));
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, valueOf(&measurement));
+  TEST_ASSERT_FALSE(measurementSchedulerTake(&scheduler, &measurement));
+}
+
+void testThatTheOldestMeasurementWithTheSamePriorityIsDroppedWhenFull() {
+  // Fixture
+  add(MeasurementTypeTOF, 100.0f);
+  for (int i = 0; i < MEASUREMENT_SCHEDULER_LENGTH; i++) {
+    add(MeasurementTypeTDOA, (float)i);
+  }
+
+  // Test
+  measurement.type = MeasurementTypeTDOA;
+  measurement.data.tdoa.distanceDiff = 42.0f;
+  const bool actual = measurementSchedulerAdd(&scheduler, &measurement);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_UINT16(1, scheduler.droppedCount[MeasurementTypeTDOA]);
+  TEST_ASSERT_EQUAL_UINT16(0, scheduler.droppedCount[MeasurementTypeTOF]);
+
+  TEST_ASSERT_TRUE(measurementSchedulerTake(&scheduler, &measurement));
+  TEST_ASSERT_EQUAL_INT(MeasurementTypeTOF, measurement.type);
+  TEST_ASSERT_TRUE(measurementSchedulerTake(&scheduler, &measurement));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, valueOf(&measurement));
+  for (int i = 2; i < MEASUREMENT_SCHEDULER_LENGTH; i++) {
+    measurementSchedulerTake(&scheduler, &measurement);
+  }
+  TEST_ASSERT_TRUE(measurementSchedulerTake(&scheduler, &measurement));
+  TEST_ASSERT_EQUAL_FLOAT(42.0f, valueOf(&measurement));
+}
+
+void testThatMeasurementsLeftAtTheEndOfACycleAreDeferred() {
+  // Fixture
+  add(MeasurementTypeTOF, 1.0f);
+  add(MeasurementTypeTDOA, 2.0f);
+  add(MeasurementTypeTDOA, 3.0f);
+  measurementSchedulerTake(&scheduler, &measurement);
+
+  // Test
+  measurementSchedulerDefer(&scheduler);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT16(1, scheduler.processedCount[MeasurementTypeTOF]);
+  TEST_ASSERT_EQUAL_UINT16(0, scheduler.deferredCount[MeasurementTypeTOF]);
+  TEST_ASSERT_EQUAL_UINT16(2, scheduler.deferredCount[MeasurementTypeTDOA]);
+
+  TEST_ASSERT_TRUE(measurementSchedulerTake(&scheduler, &measurement));
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, valueOf(&measurement));
+}
+
+void testThatInitEmptiesTheSchedulerAndResetsStatistics() {
+  // Fixture
+  add(MeasurementTypeTDOA, 1.0f);
+  measurementSchedulerDefer(&scheduler);
+
+  // Test
+  measurementSchedulerInit(&scheduler);
+
+  // Assert
+  TEST_ASSERT_FALSE(measurementSchedulerTake(&scheduler, &measurement));
+  TEST_ASSERT_EQUAL_UINT16(0, scheduler.deferredCount[MeasurementTypeTDOA]);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void add(const MeasurementType type, const float value) {
+  measurement_t m;
+  memset(&m, 0, sizeof(m));
+  m.type = type;
+  m.data.tdoa.distanceDiff = value;
+  measurementSchedulerAdd(&scheduler, &m);
+}
+
+// All measurements in the tests carry their value where the TDoA distance difference is
+static float valueOf(const measurement_t* m) {
+  return m->data.tdoa.distanceDiff;
+}
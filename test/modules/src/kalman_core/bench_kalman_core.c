@@ -0,0 +1,139 @@
+// File under benchmark kalman_core.c
+#include "kalman_core.h"
+
+#include <math.h>
+#include <string.h>
+#include "unity.h"
+#include "bench.h"
+
+#include "kalman_core_kernels.h"
+
+// @BUILD_LIB ARM_DSP_MATH
+#include "cf_math.h"
+
+static kalmanCoreParams_t params;
+static kalmanCoreData_t initialData;
+static kalmanCoreData_t coreData;
+static uint32_t nowMs;
+static float A[KC_STATE_DIM][KC_STATE_DIM];
+static float h[KC_STATE_DIM];
+static float K[KC_STATE_DIM];
+
+static void resetState(void* context);
+static void predict(void* context);
+static void scalarUpdate(void* context);
+static void sandwich(void* context);
+static void scalarJoseph(void* context);
+static void assertStateIsFinite();
+
+void setUp(void) {
+  kalmanCoreDefaultParams(&params);
+  kalmanCoreInit(&initialData, &params, 0);
+  memcpy(&coreData, &initialData, sizeof(coreData));
+  nowMs = 0;
+
+  // A transition as in the prediction, position from velocity and a small
+  // coupling to the attitude error
+  const float dt = 0.01f;
+  memset(A, 0, sizeof(A));
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    A[i][i] = 1.0f;
+  }
+  A[KC_STATE_X][KC_STATE_PX] = dt;
+  A[KC_STATE_Y][KC_STATE_PY] = dt;
+  A[KC_STATE_Z][KC_STATE_PZ] = dt;
+  A[KC_STATE_PX][KC_STATE_D1] = -9.81f * dt;
+  A[KC_STATE_PY][KC_STATE_D0] = 9.81f * dt;
+
+  // A scalar measurement of z with a small gain
+  memset(h, 0, sizeof(h));
+  h[KC_STATE_Z] = 1.0f;
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    K[i] = 0.001f * (i + 1);
+  }
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testBenchmarkPredict() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("kalmanCorePredict", resetState, predict, 0, BENCH_DEFAULT_SAMPLES, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  assertStateIsFinite();
+}
+
+void testBenchmarkScalarUpdate() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("kalmanCoreScalarUpdate", resetState, scalarUpdate, 0, BENCH_DEFAULT_SAMPLES, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  assertStateIsFinite();
+}
+
+void testBenchmarkKernelSandwich() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("kalmanCoreKernelSandwich", resetState, sandwich, 0, BENCH_DEFAULT_SAMPLES, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  assertStateIsFinite();
+}
+
+void testBenchmarkKernelScalarJoseph() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("kalmanCoreKernelScalarJoseph", resetState, scalarJoseph, 0, BENCH_DEFAULT_SAMPLES, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  assertStateIsFinite();
+}
+
+// Helpers ////////////////////////////////////////////////
+
+// The updates reduce the covariance, start every sample from the same state
+static void resetState(void* context) {
+  memcpy(&coreData, &initialData, sizeof(coreData));
+  nowMs = 0;
+}
+
+// A prediction at the rate of the filter, flying with some rotation
+static void predict(void* context) {
+  Axis3f acc = {.x = 0.1f, .y = -0.2f, .z = 1.0f};
+  Axis3f gyro = {.x = 0.05f, .y = 0.02f, .z = -0.1f};
+  nowMs += 10;
+  kalmanCorePredict(&coreData, &acc, &gyro, nowMs, true);
+}
+
+// A position measurement in x, as from a motion capture system
+static void scalarUpdate(void* context) {
+  float h[KC_STATE_DIM] = {0};
+  arm_matrix_instance_f32 H = {1, KC_STATE_DIM, h};
+  h[KC_STATE_X] = 1.0f;
+  kalmanCoreScalarUpdate(&coreData, &H, 0.01f, 0.001f);
+}
+
+// The covariance part of the prediction, A P A'
+static void sandwich(void* context) {
+  kalmanCoreKernelSandwich(A, coreData.P);
+}
+
+// The covariance part of a scalar update, (I - K h) P (I - K h)'
+static void scalarJoseph(void* context) {
+  kalmanCoreKernelScalarJoseph(coreData.P, h, K);
+}
+
+static void assertStateIsFinite() {
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    TEST_ASSERT_TRUE(isfinite(coreData.S[i]));
+    TEST_ASSERT_TRUE(isfinite(coreData.P[i][i]));
+  }
+}
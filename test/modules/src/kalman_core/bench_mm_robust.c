@@ -0,0 +1,103 @@
+// File under benchmark mm_robust.c
+#include "mm_robust.h"
+#include "mm_tdoa_robust.h"
+#include "mm_distance_robust.h"
+
+#include <math.h>
+#include <string.h>
+#include "unity.h"
+#include "bench.h"
+
+#include "kalman_core.h"
+#include "kalman_core_kernels.h"
+
+// @BUILD_LIB ARM_DSP_MATH
+#include "cf_math.h"
+
+static kalmanCoreParams_t params;
+static kalmanCoreData_t initialData;
+static kalmanCoreData_t coreData;
+static tdoaMeasurement_t tdoa;
+static distanceMeasurement_t distance;
+
+static void resetState(void* context);
+static void tdoaUpdate(void* context);
+static void distanceUpdate(void* context);
+static float distanceTo(const float x, const float y, const float z);
+static void assertStateIsFinite();
+
+void setUp(void) {
+  kalmanCoreDefaultParams(&params);
+  kalmanCoreInit(&initialData, &params, 0);
+  initialData.S[KC_STATE_X] = 1.5f;
+  initialData.S[KC_STATE_Y] = 2.0f;
+  initialData.S[KC_STATE_Z] = 1.0f;
+
+  // Measurements with a small error from the estimated position, from
+  // anchors in the corners of a 4 x 4 x 3 m room
+  memset(&tdoa, 0, sizeof(tdoa));
+  tdoa.anchorPositions[0] = (point_t){.x = 0.0f, .y = 0.0f, .z = 0.0f};
+  tdoa.anchorPositions[1] = (point_t){.x = 4.0f, .y = 4.0f, .z = 3.0f};
+  tdoa.distanceDiff = distanceTo(4.0f, 4.0f, 3.0f) - distanceTo(0.0f, 0.0f, 0.0f) + 0.05f;
+  tdoa.stdDev = 0.15f;
+
+  memset(&distance, 0, sizeof(distance));
+  distance.x = 0.0f;
+  distance.y = 4.0f;
+  distance.z = 3.0f;
+  distance.distance = distanceTo(0.0f, 4.0f, 3.0f) + 0.05f;
+  distance.stdDev = 0.25f;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testBenchmarkRobustTdoaUpdate() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("kalmanCoreRobustUpdateWithTdoa", resetState, tdoaUpdate, 0, BENCH_DEFAULT_SAMPLES, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  assertStateIsFinite();
+}
+
+void testBenchmarkRobustDistanceUpdate() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("kalmanCoreRobustUpdateWithDistance", resetState, distanceUpdate, 0, BENCH_DEFAULT_SAMPLES, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  assertStateIsFinite();
+}
+
+// Helpers ////////////////////////////////////////////////
+
+// The updates reduce the covariance, start every sample from the same state
+static void resetState(void* context) {
+  memcpy(&coreData, &initialData, sizeof(coreData));
+}
+
+static void tdoaUpdate(void* context) {
+  kalmanCoreRobustUpdateWithTdoa(&coreData, &tdoa, 0);
+}
+
+static void distanceUpdate(void* context) {
+  kalmanCoreRobustUpdateWithDistance(&coreData, &distance);
+}
+
+static float distanceTo(const float x, const float y, const float z) {
+  const float dx = initialData.S[KC_STATE_X] - x;
+  const float dy = initialData.S[KC_STATE_Y] - y;
+  const float dz = initialData.S[KC_STATE_Z] - z;
+  return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+static void assertStateIsFinite() {
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    TEST_ASSERT_TRUE(isfinite(coreData.S[i]));
+    TEST_ASSERT_TRUE(isfinite(coreData.P[i][i]));
+  }
+}
@@ -0,0 +1,299 @@
+// File under test kalman_core_history.c
+#include "kalman_core_history.h"
+
+#include <math.h>
+#include <string.h>
+#include "unity.h"
+
+#include "mock_kalman_core.h"
+
+static kalmanCoreHistory_t history;
+static kalmanCoreData_t coreData;
+static Axis3f acc;
+static Axis3f gyro;
+
+static void fakePredict(kalmanCoreData_t* this, Axis3f* acc, Axis3f* gyro, const uint32_t nowMs, bool quadIsFlying, int cmock_num_calls);
+static bool fakeFinalize(kalmanCoreData_t* this, int cmock_num_calls);
+static void initState(kalmanCoreData_t* data, const uint32_t nowMs);
+static void recordAndPredict(const uint32_t nowMs);
+static void updateWithPositionX(kalmanCoreData_t* data, const float x, const float variance);
+static void assertStatesAreEqual(const kalmanCoreData_t* expected, const kalmanCoreData_t* actual);
+
+void setUp(void) {
+  kalmanCoreHistoryInit(&history);
+  initState(&coreData, 100);
+  memset(&acc, 0, sizeof(acc));
+  memset(&gyro, 0, sizeof(gyro));
+
+  kalmanCorePredict_StubWithCallback(fakePredict);
+  kalmanCoreFinalize_StubWithCallback(fakeFinalize);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatMeasurementWithoutTimestampIsFusedInTheCurrentState() {
+  // Fixture
+  recordAndPredict(110);
+
+  // Test
+  kalmanCoreData_t* actual = kalmanCoreHistoryRewind(&history, &coreData, 0);
+
+  // Assert
+  TEST_ASSERT_NULL(actual);
+}
+
+void testThatMeasurementAfterTheLastPredictionIsFusedInTheCurrentState() {
+  // Fixture
+  recordAndPredict(110);
+
+  // Test
+  kalmanCoreData_t* actual = kalmanCoreHistoryRewind(&history, &coreData, 110);
+
+  // Assert
+  TEST_ASSERT_NULL(actual);
+  TEST_ASSERT_EQUAL_UINT16(0, history.delayedCount);
+}
+
+void testThatMeasurementOlderThanTheHistoryIsFusedInTheCurrentState() {
+  // Fixture
+  recordAndPredict(110);
+
+  // Test
+  kalmanCoreData_t* actual = kalmanCoreHistoryRewind(&history, &coreData, 90);
+
+  // Assert
+  TEST_ASSERT_NULL(actual);
+  TEST_ASSERT_EQUAL_UINT16(1, history.tooOldCount);
+}
+
+void testThatTheLatestStateBeforeTheMeasurementIsUsed() {
+  // Fixture
+  recordAndPredict(110);
+  const float expectedX = coreData.S[KC_STATE_X];
+  recordAndPredict(120);
+  recordAndPredict(130);
+
+  // Test
+  kalmanCoreData_t* actual = kalmanCoreHistoryRewind(&history, &coreData, 115);
+
+  // Assert
+  TEST_ASSERT_NOT_NULL(actual);
+  TEST_ASSERT_EQUAL_UINT32(110, actual->lastPredictionMs);
+  TEST_ASSERT_EQUAL_FLOAT(expectedX, actual->S[KC_STATE_X]);
+  TEST_ASSERT_EQUAL_PTR(actual->P, actual->Pm.pData);
+  TEST_ASSERT_EQUAL_UINT16(1, history.delayedCount);
+}
+
+void testThatDelayedMeasurementGivesTheSameStateAsWhenFusedInTime() {
+  // Fixture
+  recordAndPredict(110);
+
+  kalmanCoreData_t expected;
+  memcpy(&expected, &coreData, sizeof(expected));
+  expected.Pm.pData = (float*)expected.P;
+  updateWithPositionX(&expected, 0.5f, 0.01f);
+  fakePredict(&expected, &acc, &gyro, 120, true, 0);
+  fakePredict(&expected, &acc, &gyro, 130, true, 0);
+
+  recordAndPredict(120);
+  recordAndPredict(130);
+
+  // Test
+  kalmanCoreData_t* pastData = kalmanCoreHistoryRewind(&history, &coreData, 110);
+  updateWithPositionX(pastData, 0.5f, 0.01f);
+  kalmanCoreHistoryApply(&history, &coreData);
+
+  // Assert
+  assertStatesAreEqual(&expected, &coreData);
+  TEST_ASSERT_TRUE(coreData.isUpdated);
+  TEST_ASSERT_EQUAL_UINT8(2, history.latestSteps);
+}
+
+void testThatMeasurementsFusedAfterTheRecordedStateAreKept() {
+  // Fixture
+  recordAndPredict(110);
+  recordAndPredict(120);
+  const float xWithoutMeasurement = coreData.S[KC_STATE_X];
+
+  // A measurement fused in the current state
+  coreData.S[KC_STATE_Y] += 1.0f;
+  const float expectedY = coreData.S[KC_STATE_Y];
+
+  // Test
+  kalmanCoreData_t* pastData = kalmanCoreHistoryRewind(&history, &coreData, 110);
+  updateWithPositionX(pastData, 0.5f, 0.01f);
+  kalmanCoreHistoryApply(&history, &coreData);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(expectedY, coreData.S[KC_STATE_Y]);
+  TEST_ASSERT_TRUE(coreData.S[KC_STATE_X] > xWithoutMeasurement);
+}
+
+void testThatAttitudeDifferenceIsAddedToTheAttitudeError() {
+  // Fixture
+  recordAndPredict(110);
+  recordAndPredict(120);
+
+  // Test
+  kalmanCoreData_t* pastData = kalmanCoreHistoryRewind(&history, &coreData, 110);
+  pastData->S[KC_STATE_D2] = 0.02f;
+  pastData->isUpdated = true;
+  kalmanCoreHistoryApply(&history, &coreData);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.0f, coreData.S[KC_STATE_D0]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.0f, coreData.S[KC_STATE_D1]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.02f, coreData.S[KC_STATE_D2]);
+}
+
+void testThatVarianceReductionIsLimited() {
+  // Fixture
+  recordAndPredict(110);
+
+  // Measurements fused in the current state have already reduced the variance
+  const float currentVariance = coreData.P[KC_STATE_X][KC_STATE_X] / 10.0f;
+  coreData.P[KC_STATE_X][KC_STATE_X] = currentVariance;
+
+  // Test
+  kalmanCoreData_t* pastData = kalmanCoreHistoryRewind(&history, &coreData, 100);
+  updateWithPositionX(pastData, 0.5f, 0.0001f);
+  kalmanCoreHistoryApply(&history, &coreData);
+
+  // Assert
+  TEST_ASSERT_TRUE(coreData.P[KC_STATE_X][KC_STATE_X] > 0.0f);
+  TEST_ASSERT_TRUE(coreData.P[KC_STATE_X][KC_STATE_X] < currentVariance);
+}
+
+void testThatTheOldestStateIsReplacedWhenTheHistoryIsFull() {
+  // Fixture
+  for (int i = 1; i <= KALMAN_CORE_HISTORY_LENGTH + 1; i++) {
+    recordAndPredict(100 + i * 10);
+  }
+
+  // Test
+  kalmanCoreData_t* oldest = kalmanCoreHistoryRewind(&history, &coreData, 100);
+  kalmanCoreData_t* secondOldest = kalmanCoreHistoryRewind(&history, &coreData, 110);
+
+  // Assert
+  TEST_ASSERT_NULL(oldest);
+  TEST_ASSERT_NOT_NULL(secondOldest);
+  TEST_ASSERT_EQUAL_UINT32(110, secondOldest->lastPredictionMs);
+}
+
+void testThatInitEmptiesTheHistory() {
+  // Fixture
+  recordAndPredict(110);
+
+  // Test
+  kalmanCoreHistoryInit(&history);
+
+  // Assert
+  TEST_ASSERT_NULL(kalmanCoreHistoryRewind(&history, &coreData, 100));
+}
+
+// Helpers ////////////////////////////////////////////////
+
+// Constant velocity, with the velocity in the global frame since the attitude is not changed
+static void fakePredict(kalmanCoreData_t* this, Axis3f* acc, Axis3f* gyro, const uint32_t nowMs, bool quadIsFlying, int cmock_num_calls) {
+  const float dt = (nowMs - this->lastPredictionMs) / 1000.0f;
+
+  for (int i = 0; i < 3; i++) {
+    const int pos = KC_STATE_X + i;
+    const int vel = KC_STATE_PX + i;
+    this->S[pos] += this->S[vel] * dt;
+
+    // P = A * P * A' with A = I + dt in (pos, vel)
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      this->P[pos][j] += dt * this->P[vel][j];
+    }
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      this->P[j][pos] += dt * this->P[j][vel];
+    }
+  }
+
+  this->lastPredictionMs = nowMs;
+  this->isUpdated = true;
+}
+
+// Moves the attitude error to the attitude, q = q * (1, d / 2)
+static bool fakeFinalize(kalmanCoreData_t* this, int cmock_num_calls) {
+  if (!this->isUpdated) {
+    return false;
+  }
+
+  const float* q = this->q;
+  const float d[4] = {1.0f, this->S[KC_STATE_D0] / 2.0f, this->S[KC_STATE_D1] / 2.0f, this->S[KC_STATE_D2] / 2.0f};
+  float r[4] = {
+    q[0] * d[0] - q[1] * d[1] - q[2] * d[2] - q[3] * d[3],
+    q[0] * d[1] + q[1] * d[0] + q[2] * d[3] - q[3] * d[2],
+    q[0] * d[2] - q[1] * d[3] + q[2] * d[0] + q[3] * d[1],
+    q[0] * d[3] + q[1] * d[2] - q[2] * d[1] + q[3] * d[0],
+  };
+  const float norm = sqrtf(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+  for (int i = 0; i < 4; i++) {
+    this->q[i] = r[i] / norm;
+  }
+
+  this->S[KC_STATE_D0] = 0.0f;
+  this->S[KC_STATE_D1] = 0.0f;
+  this->S[KC_STATE_D2] = 0.0f;
+  this->isUpdated = false;
+  return true;
+}
+
+static void initState(kalmanCoreData_t* data, const uint32_t nowMs) {
+  memset(data, 0, sizeof(kalmanCoreData_t));
+  data->S[KC_STATE_PX] = 1.0f;
+  data->S[KC_STATE_PY] = -0.5f;
+  data->q[0] = 1.0f;
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    data->P[i][i] = 0.1f;
+  }
+  data->P[KC_STATE_X][KC_STATE_PX] = data->P[KC_STATE_PX][KC_STATE_X] = 0.02f;
+  data->Pm.numRows = KC_STATE_DIM;
+  data->Pm.numCols = KC_STATE_DIM;
+  data->Pm.pData = (float*)data->P;
+  data->lastPredictionMs = nowMs;
+}
+
+static void recordAndPredict(const uint32_t nowMs) {
+  kalmanCoreHistoryRecord(&history, &coreData, &acc, &gyro, true);
+  fakePredict(&coreData, &acc, &gyro, nowMs, true, 0);
+  fakeFinalize(&coreData, 0);
+}
+
+static void updateWithPositionX(kalmanCoreData_t* data, const float x, const float variance) {
+  float K[KC_STATE_DIM];
+  const float innovationVariance = data->P[KC_STATE_X][KC_STATE_X] + variance;
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    K[i] = data->P[i][KC_STATE_X] / innovationVariance;
+  }
+
+  const float innovation = x - data->S[KC_STATE_X];
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    data->S[i] += K[i] * innovation;
+  }
+
+  float hP[KC_STATE_DIM];
+  for (int j = 0; j < KC_STATE_DIM; j++) {
+    hP[j] = data->P[KC_STATE_X][j];
+  }
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      data->P[i][j] -= K[i] * hP[j];
+    }
+  }
+
+  data->isUpdated = true;
+}
+
+static void assertStatesAreEqual(const kalmanCoreData_t* expected, const kalmanCoreData_t* actual) {
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, expected->S[i], actual->S[i]);
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, expected->P[i][j], actual->P[i][j]);
+    }
+  }
+}
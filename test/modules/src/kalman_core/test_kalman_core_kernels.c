@@ -0,0 +1,185 @@
+// File under test kalman_core_kernels.c
+#include "kalman_core_kernels.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+
+// Build the arm dsp math lib and use the "real thing" as reference
+// @BUILD_LIB ARM_DSP_MATH
+#include "cf_math.h"
+
+static float P[KC_STATE_DIM][KC_STATE_DIM];
+static float expected[KC_STATE_DIM][KC_STATE_DIM];
+
+static float randomFloat(const float min, const float max);
+static void randomCovariance(float P[KC_STATE_DIM][KC_STATE_DIM]);
+static void randomTransition(float A[KC_STATE_DIM][KC_STATE_DIM]);
+static void randomRotation(float R[3][3]);
+static void referenceSandwich(float A[KC_STATE_DIM][KC_STATE_DIM], float P[KC_STATE_DIM][KC_STATE_DIM]);
+static void referenceScalarJoseph(float P[KC_STATE_DIM][KC_STATE_DIM], float h[KC_STATE_DIM], float K[KC_STATE_DIM]);
+static void assertMatricesAreEqual(const float expected[KC_STATE_DIM][KC_STATE_DIM], const float actual[KC_STATE_DIM][KC_STATE_DIM]);
+
+void setUp(void) {
+  srand(4711);
+  randomCovariance(P);
+  memcpy(expected, P, sizeof(P));
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatSandwichMatchesReference() {
+  // Fixture
+  float A[KC_STATE_DIM][KC_STATE_DIM];
+  randomTransition(A);
+  referenceSandwich(A, expected);
+
+  // Test
+  kalmanCoreKernelSandwich(A, P);
+
+  // Assert
+  assertMatricesAreEqual(expected, P);
+}
+
+void testThatScalarJosephMatchesReference() {
+  // Fixture
+  float h[KC_STATE_DIM] = {0};
+  float K[KC_STATE_DIM];
+  h[KC_STATE_X] = randomFloat(-1.0f, 1.0f);
+  h[KC_STATE_Y] = randomFloat(-1.0f, 1.0f);
+  h[KC_STATE_Z] = randomFloat(-1.0f, 1.0f);
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    K[i] = randomFloat(-0.5f, 0.5f);
+  }
+  referenceScalarJoseph(expected, h, K);
+
+  // Test
+  kalmanCoreKernelScalarJoseph(P, h, K);
+
+  // Assert
+  assertMatricesAreEqual(expected, P);
+}
+
+void testThatRotateAttitudeMatchesReference() {
+  // Fixture
+  float R[3][3];
+  randomRotation(R);
+
+  float A[KC_STATE_DIM][KC_STATE_DIM] = {0};
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    A[i][i] = 1.0f;
+  }
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      A[KC_STATE_D0 + i][KC_STATE_D0 + j] = R[i][j];
+    }
+  }
+  referenceSandwich(A, expected);
+
+  // Test
+  kalmanCoreKernelRotateAttitude(P, R);
+
+  // Assert
+  assertMatricesAreEqual(expected, P);
+}
+
+void testThatScalarJosephKeepsTheCovarianceSymmetric() {
+  // Fixture
+  float h[KC_STATE_DIM] = {0};
+  float K[KC_STATE_DIM];
+  h[KC_STATE_Z] = 1.0f;
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    K[i] = P[i][KC_STATE_Z] / (P[KC_STATE_Z][KC_STATE_Z] + 0.01f);
+  }
+
+  // Test
+  kalmanCoreKernelScalarJoseph(P, h, K);
+
+  // Assert
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-6f, P[i][j], P[j][i]);
+    }
+  }
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static float randomFloat(const float min, const float max) {
+  return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+// P = B * B' + 0.01 * I
+static void randomCovariance(float P[KC_STATE_DIM][KC_STATE_DIM]) {
+  float B[KC_STATE_DIM][KC_STATE_DIM];
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      B[i][j] = randomFloat(-0.3f, 0.3f);
+    }
+  }
+
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      float sum = (i == j) ? 0.01f : 0.0f;
+      for (int k = 0; k < KC_STATE_DIM; k++) {
+        sum += B[i][k] * B[j][k];
+      }
+      P[i][j] = sum;
+    }
+  }
+}
+
+// Identity plus small random terms, like the linearized dynamics
+static void randomTransition(float A[KC_STATE_DIM][KC_STATE_DIM]) {
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      A[i][j] = (i == j ? 1.0f : 0.0f) + randomFloat(-0.05f, 0.05f);
+    }
+  }
+}
+
+static void randomRotation(float R[3][3]) {
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      R[i][j] = (i == j ? 1.0f : 0.0f) + randomFloat(-0.01f, 0.01f);
+    }
+  }
+}
+
+// The general matrix products used by the filter before the kernels
+static void referenceSandwich(float A[KC_STATE_DIM][KC_STATE_DIM], float P[KC_STATE_DIM][KC_STATE_DIM]) {
+  static float At[KC_STATE_DIM][KC_STATE_DIM];
+  static float AP[KC_STATE_DIM][KC_STATE_DIM];
+  arm_matrix_instance_f32 Am = {KC_STATE_DIM, KC_STATE_DIM, (float*)A};
+  arm_matrix_instance_f32 Atm = {KC_STATE_DIM, KC_STATE_DIM, (float*)At};
+  arm_matrix_instance_f32 APm = {KC_STATE_DIM, KC_STATE_DIM, (float*)AP};
+  arm_matrix_instance_f32 Pm = {KC_STATE_DIM, KC_STATE_DIM, (float*)P};
+
+  mat_trans(&Am, &Atm);
+  mat_mult(&Am, &Pm, &APm);
+  mat_mult(&APm, &Atm, &Pm);
+}
+
+// P = (KH - I) * P * (KH - I)', without the measurement noise term
+static void referenceScalarJoseph(float P[KC_STATE_DIM][KC_STATE_DIM], float h[KC_STATE_DIM], float K[KC_STATE_DIM]) {
+  static float A[KC_STATE_DIM][KC_STATE_DIM];
+  arm_matrix_instance_f32 Hm = {1, KC_STATE_DIM, h};
+  arm_matrix_instance_f32 Km = {KC_STATE_DIM, 1, K};
+  arm_matrix_instance_f32 Am = {KC_STATE_DIM, KC_STATE_DIM, (float*)A};
+
+  mat_mult(&Km, &Hm, &Am);
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    A[i][i] -= 1.0f;
+  }
+  referenceSandwich(A, P);
+}
+
+static void assertMatricesAreEqual(const float expected[KC_STATE_DIM][KC_STATE_DIM], const float actual[KC_STATE_DIM][KC_STATE_DIM]) {
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f + 1e-4f * fabsf(expected[i][j]), expected[i][j], actual[i][j]);
+    }
+  }
+}
@@ -0,0 +1,235 @@
+// File under test mm_robust.c
+#include "mm_robust.h"
+#include "mm_tdoa_robust.h"
+#include "mm_distance_robust.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+
+#include "mock_kalman_core.h"
+
+// Build the arm dsp math lib and use the "real thing" instead of mocking calls to it
+// @BUILD_LIB ARM_DSP_MATH
+
+#include "kalman_core_mm_robust_reference.c"
+
+static kalmanCoreData_t this;
+static robustUpdateResult_t actualResult;
+
+static void mockKalmanCoreUpdateWithPKE(kalmanCoreData_t* actualThis, arm_matrix_instance_f32 *Hm, arm_matrix_instance_f32 *Km, arm_matrix_instance_f32 *P_w_m, float error, int cmock_num_calls);
+static void randomCovariance(float P[KC_STATE_DIM][KC_STATE_DIM]);
+static float randomFloat(const float min, const float max);
+static void randomState(float S[KC_STATE_DIM]);
+static void randomTdoaMeasurement(tdoaMeasurement_t* tdoa, const bool outlier);
+static void randomDistanceMeasurement(distanceMeasurement_t* d, const bool outlier);
+static void assertResultsAreEqual(const robustUpdateResult_t* expected, const robustUpdateResult_t* actual);
+
+void setUp(void) {
+  memset(&this, 0, sizeof(this));
+  memset(&actualResult, 0, sizeof(actualResult));
+  memset(&referenceResult, 0, sizeof(referenceResult));
+
+  kalmanCoreUpdateWithPKE_StubWithCallback(mockKalmanCoreUpdateWithPKE);
+
+  srand(4711);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatTdoaUpdateMatchesReference() {
+  // Fixture
+  tdoaMeasurement_t tdoa;
+
+  for (int i = 0; i < 200; i++) {
+    randomCovariance(this.P);
+    randomState(this.S);
+    randomTdoaMeasurement(&tdoa, (i % 4) == 0);
+
+    // Test
+    referenceRobustUpdateWithTdoa(&this, &tdoa, 0);
+    kalmanCoreRobustUpdateWithTdoa(&this, &tdoa, 0);
+
+    // Assert
+    assertResultsAreEqual(&referenceResult, &actualResult);
+  }
+}
+
+void testThatDistanceUpdateMatchesReference() {
+  // Fixture
+  distanceMeasurement_t d;
+
+  for (int i = 0; i < 200; i++) {
+    randomCovariance(this.P);
+    randomState(this.S);
+    randomDistanceMeasurement(&d, (i % 4) == 0);
+
+    // Test
+    referenceRobustUpdateWithDistance(&this, &d);
+    kalmanCoreRobustUpdateWithDistance(&this, &d);
+
+    // Assert
+    assertResultsAreEqual(&referenceResult, &actualResult);
+  }
+}
+
+void testThatOutlierIsDownWeighted() {
+  // Fixture
+  distanceMeasurement_t d = {.x = 1.0f, .y = 0.0f, .z = 0.0f, .stdDev = 0.1f};
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    this.P[i][i] = 0.01f;
+  }
+
+  // Test
+  d.distance = 1.05f;
+  kalmanCoreRobustUpdateWithDistance(&this, &d);
+  const float inlierGain = actualResult.K[KC_STATE_X];
+
+  d.distance = 3.0f;
+  kalmanCoreRobustUpdateWithDistance(&this, &d);
+  const float outlierGain = actualResult.K[KC_STATE_X];
+
+  // Assert
+  TEST_ASSERT_TRUE(fabsf(outlierGain) < fabsf(inlierGain) * 0.1f);
+}
+
+void testThatResultDoesNotDependOnPreviousUpdate() {
+  // Fixture
+  distanceMeasurement_t d;
+  randomCovariance(this.P);
+  randomState(this.S);
+  randomDistanceMeasurement(&d, false);
+
+  kalmanCoreRobustUpdateWithDistance(&this, &d);
+  robustUpdateResult_t expected = actualResult;
+
+  distanceMeasurement_t outlier = d;
+  outlier.distance += 5.0f;
+  kalmanCoreRobustUpdateWithDistance(&this, &outlier);
+
+  // Test
+  kalmanCoreRobustUpdateWithDistance(&this, &d);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT_ARRAY(expected.K, actualResult.K, KC_STATE_DIM);
+}
+
+void testThatTdoaSampleWhereDroneIsInSamePositionAsAnchorIsIgnored() {
+  // Fixture
+  this.S[KC_STATE_X] = -1.0f;
+  this.P[KC_STATE_X][KC_STATE_X] = 1.0f;
+
+  tdoaMeasurement_t tdoa = {
+    .anchorPositions = {
+      {.x = -1.0f, .y = 0.0f, .z = 0.0f},
+      {.x = 1.0f, .y = 0.0f, .z = 0.0f},
+    },
+    .distanceDiff = 2.0f,
+    .stdDev = 0.123f,
+  };
+
+  // Test
+  kalmanCoreRobustUpdateWithTdoa(&this, &tdoa, 0);
+
+  // Assert
+  TEST_ASSERT_FALSE(actualResult.called);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void mockKalmanCoreUpdateWithPKE(kalmanCoreData_t* actualThis, arm_matrix_instance_f32 *Hm, arm_matrix_instance_f32 *Km, arm_matrix_instance_f32 *P_w_m, float error, int cmock_num_calls) {
+  TEST_ASSERT_EQUAL_PTR(&this, actualThis);
+  TEST_ASSERT_EQUAL_UINT16(1, Hm->numRows);
+  TEST_ASSERT_EQUAL_UINT16(KC_STATE_DIM, Hm->numCols);
+  TEST_ASSERT_EQUAL_UINT16(KC_STATE_DIM, Km->numRows);
+  TEST_ASSERT_EQUAL_UINT16(KC_STATE_DIM, P_w_m->numRows);
+  TEST_ASSERT_EQUAL_UINT16(KC_STATE_DIM, P_w_m->numCols);
+
+  memcpy(actualResult.h, Hm->pData, sizeof(actualResult.h));
+  memcpy(actualResult.K, Km->pData, sizeof(actualResult.K));
+  memcpy(actualResult.Pw, P_w_m->pData, sizeof(actualResult.Pw));
+  actualResult.error = error;
+  actualResult.called = true;
+}
+
+static float randomFloat(const float min, const float max) {
+  return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+// P = A * A' + 0.01 * I
+static void randomCovariance(float P[KC_STATE_DIM][KC_STATE_DIM]) {
+  float A[KC_STATE_DIM][KC_STATE_DIM];
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      A[i][j] = randomFloat(-0.3f, 0.3f);
+    }
+  }
+
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      float sum = (i == j) ? 0.01f : 0.0f;
+      for (int k = 0; k < KC_STATE_DIM; k++) {
+        sum += A[i][k] * A[j][k];
+      }
+      P[i][j] = sum;
+    }
+  }
+}
+
+static void randomState(float S[KC_STATE_DIM]) {
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    S[i] = randomFloat(-0.5f, 0.5f);
+  }
+
+  S[KC_STATE_X] = randomFloat(0.0f, 4.0f);
+  S[KC_STATE_Y] = randomFloat(0.0f, 4.0f);
+  S[KC_STATE_Z] = randomFloat(0.0f, 2.0f);
+}
+
+static void randomTdoaMeasurement(tdoaMeasurement_t* tdoa, const bool outlier) {
+  memset(tdoa, 0, sizeof(*tdoa));
+  for (int i = 0; i < 2; i++) {
+    tdoa->anchorPositions[i].x = randomFloat(-1.0f, 5.0f);
+    tdoa->anchorPositions[i].y = randomFloat(-1.0f, 5.0f);
+    tdoa->anchorPositions[i].z = randomFloat(0.0f, 3.0f);
+  }
+
+  const float x = this.S[KC_STATE_X] + randomFloat(-0.2f, 0.2f);
+  const float y = this.S[KC_STATE_Y] + randomFloat(-0.2f, 0.2f);
+  const float z = this.S[KC_STATE_Z] + randomFloat(-0.2f, 0.2f);
+  const float d0 = sqrtf(powf(x - tdoa->anchorPositions[0].x, 2) + powf(y - tdoa->anchorPositions[0].y, 2) + powf(z - tdoa->anchorPositions[0].z, 2));
+  const float d1 = sqrtf(powf(x - tdoa->anchorPositions[1].x, 2) + powf(y - tdoa->anchorPositions[1].y, 2) + powf(z - tdoa->anchorPositions[1].z, 2));
+
+  tdoa->distanceDiff = d1 - d0 + (outlier ? randomFloat(1.0f, 3.0f) : 0.0f);
+  tdoa->stdDev = randomFloat(0.05f, 0.3f);
+}
+
+static void randomDistanceMeasurement(distanceMeasurement_t* d, const bool outlier) {
+  memset(d, 0, sizeof(*d));
+  d->x = randomFloat(-1.0f, 5.0f);
+  d->y = randomFloat(-1.0f, 5.0f);
+  d->z = randomFloat(0.0f, 3.0f);
+
+  const float x = this.S[KC_STATE_X] + randomFloat(-0.2f, 0.2f);
+  const float y = this.S[KC_STATE_Y] + randomFloat(-0.2f, 0.2f);
+  const float z = this.S[KC_STATE_Z] + randomFloat(-0.2f, 0.2f);
+
+  d->distance = sqrtf(powf(x - d->x, 2) + powf(y - d->y, 2) + powf(z - d->z, 2)) + (outlier ? randomFloat(1.0f, 3.0f) : 0.0f);
+  d->stdDev = randomFloat(0.05f, 0.3f);
+}
+
+static void assertResultsAreEqual(const robustUpdateResult_t* expected, const robustUpdateResult_t* actual) {
+  TEST_ASSERT_TRUE(expected->called);
+  TEST_ASSERT_TRUE(actual->called);
+
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, expected->error, actual->error);
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected->h[i], actual->h[i]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f + 1e-3f * fabsf(expected->K[i]), expected->K[i], actual->K[i]);
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-4f + 1e-3f * fabsf(expected->Pw[i][j]), expected->Pw[i][j], actual->Pw[i][j]);
+    }
+  }
+}
@@ -0,0 +1,208 @@
+// File under test mm_sweep_angles.c
+#include "mm_sweep_angles.h"
+
+#include <string.h>
+#include "unity.h"
+
+#include "mock_kalman_core.h"
+#include "mock_outlierFilterLighthouse.h"
+
+// @BUILD_LIB ARM_DSP_MATH
+
+#define MAX_CALLS (SWEEP_ANGLE_BATCH_N_SENSORS * SWEEP_ANGLE_BATCH_N_SWEEPS)
+
+// The arguments of one call to kalmanCoreScalarUpdate()
+typedef struct {
+  float h[KC_STATE_DIM];
+  float error;
+  float stdMeasNoise;
+} scalarUpdateCall_t;
+
+typedef struct {
+  scalarUpdateCall_t calls[MAX_CALLS];
+  int count;
+} scalarUpdateLog_t;
+
+static kalmanCoreData_t this;
+static OutlierFilterLhState_t outlierFilterState;
+
+static vec3d sensorPos[SWEEP_ANGLE_BATCH_N_SENSORS];
+static vec3d rotorPos;
+static mat3d rotorRot;
+static mat3d rotorRotInv;
+static lighthouseCalibrationSweep_t calib[SWEEP_ANGLE_BATCH_N_SWEEPS];
+static sweepAngleBatchContext_t context;
+static sweepAngleBatchMeasurement_t batch;
+
+static scalarUpdateLog_t* activeLog;
+
+static void updateSequentially(const sweepAngleBatchMeasurement_t* batch, const uint32_t nowMs);
+static float calibrationMeasurementModel(const float x, const float y, const float z, const float t, const lighthouseCalibrationSweep_t* calib);
+static void mockScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32* Hm, float error, float stdMeasNoise, int cmock_num_calls);
+static void assertLogsAreEqual(const scalarUpdateLog_t* expected, const scalarUpdateLog_t* actual);
+
+void setUp(void) {
+  memset(&this, 0, sizeof(this));
+  this.S[KC_STATE_X] = 0.1f;
+  this.S[KC_STATE_Y] = -0.2f;
+  this.S[KC_STATE_Z] = 0.5f;
+  for (int i = 0; i < 3; i++) {
+    this.R[i][i] = 1.0f;
+  }
+
+  memset(&outlierFilterState, 0, sizeof(outlierFilterState));
+
+  // Deck sensors
+  const float offset = 0.015f;
+  vec3d deck[SWEEP_ANGLE_BATCH_N_SENSORS] = {{-offset, offset, 0}, {-offset, -offset, 0}, {offset, offset, 0}, {offset, -offset, 0}};
+  memcpy(sensorPos, deck, sizeof(sensorPos));
+
+  // A base station in a corner of the room, turned 90 degrees around the z axis
+  rotorPos[0] = -2.0f;
+  rotorPos[1] = 1.5f;
+  rotorPos[2] = 2.5f;
+  mat3d rot = {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}};
+  memcpy(rotorRot, rot, sizeof(rotorRot));
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      rotorRotInv[i][j] = rot[j][i];
+    }
+  }
+
+  memset(calib, 0, sizeof(calib));
+  calib[0].phase = 0.01f;
+  calib[1].phase = -0.02f;
+
+  context.sensorPos = sensorPos;
+  context.rotorPos = &rotorPos;
+  context.rotorRot = &rotorRot;
+  context.rotorRotInv = &rotorRotInv;
+  context.calib = calib;
+  context.calibrationMeasurementModel = calibrationMeasurementModel;
+  context.t[0] = -M_PI / 6;
+  context.t[1] = M_PI / 6;
+  context.stdDev = 0.001f;
+
+  memset(&batch, 0, sizeof(batch));
+  batch.context = &context;
+  batch.baseStationId = 1;
+  for (int sensor = 0; sensor < SWEEP_ANGLE_BATCH_N_SENSORS; sensor++) {
+    for (int sweep = 0; sweep < SWEEP_ANGLE_BATCH_N_SWEEPS; sweep++) {
+      batch.measuredSweepAngles[sensor][sweep] = 0.1f * (sensor + 1) - 0.05f * sweep;
+    }
+  }
+
+  outlierFilterLighthouseValidateSweep_IgnoreAndReturn(true);
+  kalmanCoreScalarUpdate_StubWithCallback(mockScalarUpdate);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatBatchUpdateWithAllAnglesIsEqualToSequentialUpdates() {
+  // Fixture
+  batch.validMap = 0xff;
+
+  scalarUpdateLog_t expected = {0};
+  scalarUpdateLog_t actual = {0};
+
+  activeLog = &expected;
+  updateSequentially(&batch, 100);
+
+  // Test
+  activeLog = &actual;
+  kalmanCoreUpdateWithSweepAngleBatch(&this, &batch, 100, &outlierFilterState);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(MAX_CALLS, expected.count);
+  assertLogsAreEqual(&expected, &actual);
+}
+
+void testThatBatchUpdateOnlyUsesValidAngles() {
+  // Fixture
+  // Sensor 0 both sweeps, sensor 2 sweep 1 and sensor 3 sweep 0
+  batch.validMap = 0x03 | (1 << (2 * SWEEP_ANGLE_BATCH_N_SWEEPS + 1)) | (1 << (3 * SWEEP_ANGLE_BATCH_N_SWEEPS));
+
+  scalarUpdateLog_t expected = {0};
+  scalarUpdateLog_t actual = {0};
+
+  activeLog = &expected;
+  updateSequentially(&batch, 100);
+
+  // Test
+  activeLog = &actual;
+  kalmanCoreUpdateWithSweepAngleBatch(&this, &batch, 100, &outlierFilterState);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(4, expected.count);
+  assertLogsAreEqual(&expected, &actual);
+}
+
+void testThatBatchUpdateWithNoValidAnglesDoesNotUpdate() {
+  // Fixture
+  batch.validMap = 0;
+
+  scalarUpdateLog_t actual = {0};
+  activeLog = &actual;
+
+  // Test
+  kalmanCoreUpdateWithSweepAngleBatch(&this, &batch, 100, &outlierFilterState);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, actual.count);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+// One sweep angle at the time, the way the angles are handled when they are not batched
+static void updateSequentially(const sweepAngleBatchMeasurement_t* batch, const uint32_t nowMs) {
+  const sweepAngleBatchContext_t* context = batch->context;
+
+  for (int sensor = 0; sensor < SWEEP_ANGLE_BATCH_N_SENSORS; sensor++) {
+    for (int sweep = 0; sweep < SWEEP_ANGLE_BATCH_N_SWEEPS; sweep++) {
+      if (batch->validMap & (1 << (sensor * SWEEP_ANGLE_BATCH_N_SWEEPS + sweep))) {
+        sweepAngleMeasurement_t sweepInfo = {
+          .timestamp = batch->timestamp,
+          .sensorPos = &context->sensorPos[sensor],
+          .rotorPos = context->rotorPos,
+          .rotorRot = context->rotorRot,
+          .rotorRotInv = context->rotorRotInv,
+          .sensorId = sensor,
+          .baseStationId = batch->baseStationId,
+          .sweepId = sweep,
+          .t = context->t[sweep],
+          .measuredSweepAngle = batch->measuredSweepAngles[sensor][sweep],
+          .stdDev = context->stdDev,
+          .calib = &context->calib[sweep],
+          .calibrationMeasurementModel = context->calibrationMeasurementModel,
+        };
+        kalmanCoreUpdateWithSweepAngles(&this, &sweepInfo, nowMs, &outlierFilterState);
+      }
+    }
+  }
+}
+
+static float calibrationMeasurementModel(const float x, const float y, const float z, const float t, const lighthouseCalibrationSweep_t* calib) {
+  const float ax = atan2f(y, x);
+  const float r = sqrtf(x * x + y * y);
+  return ax + asinf(z * tanf(t) / r) + calib->phase;
+}
+
+static void mockScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32* Hm, float error, float stdMeasNoise, int cmock_num_calls) {
+  TEST_ASSERT_TRUE(activeLog->count < MAX_CALLS);
+  scalarUpdateCall_t* call = &activeLog->calls[activeLog->count];
+  memcpy(call->h, Hm->pData, sizeof(call->h));
+  call->error = error;
+  call->stdMeasNoise = stdMeasNoise;
+  activeLog->count++;
+}
+
+static void assertLogsAreEqual(const scalarUpdateLog_t* expected, const scalarUpdateLog_t* actual) {
+  TEST_ASSERT_EQUAL_INT(expected->count, actual->count);
+  for (int i = 0; i < expected->count; i++) {
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(expected->calls[i].h, actual->calls[i].h, KC_STATE_DIM);
+    TEST_ASSERT_EQUAL_FLOAT(expected->calls[i].error, actual->calls[i].error);
+    TEST_ASSERT_EQUAL_FLOAT(expected->calls[i].stdMeasNoise, actual->calls[i].stdMeasNoise);
+  }
+}
@@ -0,0 +1,162 @@
+// @IGNORE_IF_NOT CONFIG_DECK_LIGHTHOUSE
+
+// File under test lighthouse_throttle.c
+#include "lighthouse_throttle.h"
+
+#include <string.h>
+#include "unity.h"
+#include "mock_estimator_kalman.h"
+
+static float covariance[3][3];
+static point_t position;
+static baseStationGeometry_t geometries[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
+static pulseProcessorResult_t angles;
+static uint32_t now;
+
+static void mockGetCovariance(float cov[3][3], int cmock_num_calls);
+static void mockGetPos(point_t* pos, int cmock_num_calls);
+static void setBaseStation(const int bs, const float x, const float y, const float z);
+static void runSamples(const int bsCount, const int durationMs, const int samplesPerSecond, int usedPerBs[]);
+
+void setUp(void) {
+  memset(covariance, 0, sizeof(covariance));
+  covariance[0][0] = 0.01f;
+  covariance[1][1] = 0.01f;
+  covariance[2][2] = 0.01f;
+  position = (point_t){.x = 0.0f, .y = 0.0f, .z = 0.0f};
+
+  memset(geometries, 0, sizeof(geometries));
+  memset(&angles, 0, sizeof(angles));
+  for (int bs = 0; bs < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; bs++) {
+    for (int sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
+      angles.baseStationMeasurementsLh2[bs].sensorMeasurements[sensor].validCount = 2;
+    }
+  }
+
+  estimatorKalmanGetEstimatedPosCovariance_StubWithCallback(mockGetCovariance);
+  estimatorKalmanGetEstimatedPos_StubWithCallback(mockGetPos);
+
+  // The throttle keeps state between tests, start each test well after the previous one
+  now += 10000;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatAllSamplesAreUsedBelowTheMaxRate() {
+  // Fixture
+  setBaseStation(0, 2.0f, 0.0f, 2.0f);
+  setBaseStation(1, -2.0f, 0.0f, 2.0f);
+  int used[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS] = {0};
+
+  // Test
+  runSamples(2, 2000, 40, used);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(80, used[0] + used[1]);
+}
+
+void testThatTheRateIsLimitedToTheMaxRate() {
+  // Fixture
+  setBaseStation(0, 2.0f, 0.0f, 2.0f);
+  setBaseStation(1, -2.0f, 0.0f, 2.0f);
+  setBaseStation(2, 0.0f, 2.0f, 2.0f);
+  setBaseStation(3, 0.0f, -2.0f, 2.0f);
+  runSamples(4, 2000, 200, NULL);
+  int used[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS] = {0};
+
+  // Test
+  runSamples(4, 2000, 200, used);
+
+  // Assert
+  const int total = used[0] + used[1] + used[2] + used[3];
+  TEST_ASSERT_INT_WITHIN(20, 100, total);
+}
+
+void testThatSamplesReducingTheLargestUncertaintyArePreferred() {
+  // Fixture
+  // Large uncertainty along the x-axis
+  covariance[0][0] = 0.5f;
+
+  // Base station 0 looks along the x-axis and does not see the uncertainty,
+  // base station 1 looks straight down
+  setBaseStation(0, 3.0f, 0.0f, 0.0f);
+  setBaseStation(1, 0.0f, 0.0f, 3.0f);
+  runSamples(2, 2000, 200, NULL);
+  int used[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS] = {0};
+
+  // Test
+  runSamples(2, 2000, 200, used);
+
+  // Assert
+  TEST_ASSERT_TRUE(used[1] > 2 * used[0]);
+}
+
+void testThatSimilarBaseStationsAreUsedEvenly() {
+  // Fixture
+  setBaseStation(0, 2.0f, 0.0f, 2.0f);
+  setBaseStation(1, -2.0f, 0.0f, 2.0f);
+  setBaseStation(2, 0.0f, 2.0f, 2.0f);
+  // Slightly closer, gives a slightly higher information gain
+  setBaseStation(3, 0.0f, -1.8f, 1.8f);
+  runSamples(4, 2000, 200, NULL);
+  int used[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS] = {0};
+
+  // Test
+  runSamples(4, 4000, 200, used);
+
+  // Assert
+  for (int bs = 0; bs < 4; bs++) {
+    TEST_ASSERT_TRUE(used[bs] > 20);
+  }
+}
+
+void testThatSamplesAreDiscardedRandomlyWithoutEstimatorCovariance() {
+  // Fixture
+  memset(covariance, 0, sizeof(covariance));
+  setBaseStation(0, 3.0f, 0.0f, 0.0f);
+  setBaseStation(1, 0.0f, 0.0f, 3.0f);
+  runSamples(2, 2000, 200, NULL);
+  int used[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS] = {0};
+
+  // Test
+  runSamples(2, 2000, 200, used);
+
+  // Assert
+  TEST_ASSERT_INT_WITHIN(20, 50, used[0]);
+  TEST_ASSERT_INT_WITHIN(20, 50, used[1]);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void mockGetCovariance(float cov[3][3], int cmock_num_calls) {
+  memcpy(cov, covariance, sizeof(covariance));
+}
+
+static void mockGetPos(point_t* pos, int cmock_num_calls) {
+  *pos = position;
+}
+
+static void setBaseStation(const int bs, const float x, const float y, const float z) {
+  geometries[bs].origin[0] = x;
+  geometries[bs].origin[1] = y;
+  geometries[bs].origin[2] = z;
+  geometries[bs].valid = true;
+}
+
+static void runSamples(const int bsCount, const int durationMs, const int samplesPerSecond, int usedPerBs[]) {
+  const int sampleCount = durationMs * samplesPerSecond / 1000;
+  const uint32_t startMs = now;
+
+  for (int i = 0; i < sampleCount; i++) {
+    const int bs = i % bsCount;
+    now = startMs + (uint32_t)i * 1000 / samplesPerSecond;
+    const bool used = throttleLh2SamplesFromBaseStation(now, bs, &angles, &geometries[bs]);
+    if (used && usedPerBs) {
+      usedPerBs[bs]++;
+    }
+  }
+
+  now = startMs + durationMs;
+}
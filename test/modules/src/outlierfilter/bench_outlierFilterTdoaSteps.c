@@ -0,0 +1,73 @@
+// File under benchmark outlierFilterTdoaSteps.c
+#include "outlierFilterTdoaSteps.h"
+
+#include <string.h>
+#include "unity.h"
+#include "bench.h"
+
+#define MEASUREMENTS_PER_SAMPLE 100
+
+static tdoaMeasurement_t tdoa;
+static vector_t jacobian;
+static point_t estPos;
+static uint32_t randomState;
+static int measurementCount;
+static int goodCount;
+
+static void validate(void* context);
+static float randomError();
+
+void setUp(void) {
+  memset(&tdoa, 0, sizeof(tdoa));
+  tdoa.anchorPositions[0].x = 0.0f;
+  tdoa.anchorPositions[1].x = 4.0f;
+  tdoa.anchorPositions[1].y = 4.0f;
+  tdoa.distanceDiff = 1.0f;
+
+  jacobian.x = 0.6f;
+  jacobian.y = -0.3f;
+  jacobian.z = 0.1f;
+
+  memset(&estPos, 0, sizeof(estPos));
+
+  randomState = 1;
+  measurementCount = 0;
+  goodCount = 0;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testBenchmarkValidateSteps() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("outlierFilterTdoaValidateSteps", 0, validate, 0, BENCH_DEFAULT_SAMPLES, MEASUREMENTS_PER_SAMPLE);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  TEST_ASSERT_TRUE(goodCount > measurementCount / 2);
+  TEST_ASSERT_TRUE(goodCount < measurementCount);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void validate(void* context) {
+  if (outlierFilterTdoaValidateSteps(&tdoa, randomError(), &jacobian, &estPos)) {
+    goodCount++;
+  }
+  measurementCount++;
+}
+
+// Mostly small errors with an outlier now and then, xorshift32
+static float randomError() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+
+  const float error = ((randomState & 0xffff) / 65536.0f - 0.5f) * 0.2f;
+  if ((randomState >> 16) % 20 == 0) {
+    return 10.0f * error + 1.5f;
+  }
+  return error;
+}
@@ -0,0 +1,355 @@
+// File under test DTR_window.c
+#include "DTR_window.h"
+
+#include <string.h>
+#include "unity.h"
+
+// The ring below only drives the windows of the nodes, the frames and acks are
+// passed directly between them. The token frames, the ack piggybacking and
+// the packet pool of token_ring.c are not part of it.
+
+#define NODE_COUNT 4
+#define PACKETS_PER_NODE 24
+#define WINDOW_SIZE 8
+#define MAX_ROTATIONS 200
+
+static dtrTopology topology = {.size = NODE_COUNT, .devices_ids = {3, 7, 4, 9}};
+static dtrWindow windows[NODE_COUNT];
+
+// Packets waiting to be added to the window of each node, in the order they were sent
+static dtrPacket packets[NODE_COUNT][PACKETS_PER_NODE];
+static int nextPacket[NODE_COUNT];
+
+// Number of times each packet has been delivered to each node
+static int deliveries[NODE_COUNT][PACKETS_PER_NODE][NODE_COUNT];
+static int acked[NODE_COUNT][PACKETS_PER_NODE];
+static int dropped[NODE_COUNT][PACKETS_PER_NODE];
+
+// Loss probability in percent, from a node to a node
+static int lossPercent[NODE_COUNT][NODE_COUNT];
+static uint32_t randomState;
+
+static void release(dtrPacket* packet, bool isAcked);
+static void initRing(const uint8_t windowSize);
+static void setLoss(const int percent);
+static void addUnicastPackets(const int count);
+static int runUntilAllReleased();
+static int indexOf(const uint8_t id);
+static bool receive(dtrWindow* window, const dtrPacket* packet);
+
+void setUp(void) {
+  memset(packets, 0, sizeof(packets));
+  memset(nextPacket, 0, sizeof(nextPacket));
+  memset(deliveries, 0, sizeof(deliveries));
+  memset(acked, 0, sizeof(acked));
+  memset(dropped, 0, sizeof(dropped));
+  setLoss(0);
+  randomState = 12345;
+
+  initRing(WINDOW_SIZE);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatAllPacketsAreDeliveredExactlyOnceWithoutLoss() {
+  // Fixture
+  addUnicastPackets(PACKETS_PER_NODE);
+
+  // Test
+  const int rotations = runUntilAllReleased();
+
+  // Assert
+  for (int node = 0; node < NODE_COUNT; node++) {
+    for (int i = 0; i < PACKETS_PER_NODE; i++) {
+      const int target = indexOf(packets[node][i].targetId);
+      TEST_ASSERT_EQUAL_INT(1, deliveries[node][i][target]);
+      TEST_ASSERT_EQUAL_INT(1, acked[node][i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, windows[node].retransmissions);
+  }
+
+  // Stop-and-wait needs one rotation per packet
+  TEST_ASSERT_TRUE(rotations <= PACKETS_PER_NODE / WINDOW_SIZE + 1);
+}
+
+void testThatAllPacketsAreDeliveredExactlyOnceOnALossyChannel() {
+  // Fixture
+  setLoss(20);
+  addUnicastPackets(PACKETS_PER_NODE);
+
+  // Test
+  const int rotations = runUntilAllReleased();
+
+  // Assert
+  uint32_t retransmissions = 0;
+  for (int node = 0; node < NODE_COUNT; node++) {
+    for (int i = 0; i < PACKETS_PER_NODE; i++) {
+      const int target = indexOf(packets[node][i].targetId);
+      TEST_ASSERT_EQUAL_INT(1, deliveries[node][i][target]);
+      TEST_ASSERT_EQUAL_INT(1, acked[node][i]);
+    }
+    retransmissions += windows[node].retransmissions;
+  }
+
+  TEST_ASSERT_TRUE(retransmissions > 0);
+  TEST_ASSERT_TRUE(rotations < PACKETS_PER_NODE / 2);
+}
+
+void testThatBroadcastIsDeliveredToAllOtherNodes() {
+  // Fixture
+  setLoss(20);
+  dtrPacket* packet = &packets[0][0];
+  packet->sourceId = topology.devices_ids[0];
+  packet->targetId = DTR_BROADCAST_ID;
+  nextPacket[0] = 1;
+  TEST_ASSERT_TRUE(dtrWindowAdd(&windows[0], packet));
+
+  // Test
+  runUntilAllReleased();
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, deliveries[0][0][0]);
+  for (int node = 1; node < NODE_COUNT; node++) {
+    TEST_ASSERT_EQUAL_INT(1, deliveries[0][0][node]);
+  }
+  TEST_ASSERT_EQUAL_INT(1, acked[0][0]);
+}
+
+void testThatPacketToUnknownTargetIsRejected() {
+  // Fixture
+  dtrPacket* packet = &packets[0][0];
+  packet->sourceId = topology.devices_ids[0];
+  packet->targetId = 42;
+
+  // Test
+  const bool actual = dtrWindowAdd(&windows[0], packet);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_UINT8(WINDOW_SIZE, dtrWindowFreeSlots(&windows[0]));
+}
+
+void testThatTheWindowIsLimitedToTheWindowSize() {
+  // Fixture
+  initRing(2);
+  for (int i = 0; i < 3; i++) {
+    packets[0][i].sourceId = topology.devices_ids[0];
+    packets[0][i].targetId = topology.devices_ids[1];
+  }
+
+  // Test
+  const bool first = dtrWindowAdd(&windows[0], &packets[0][0]);
+  const bool second = dtrWindowAdd(&windows[0], &packets[0][1]);
+  const bool third = dtrWindowAdd(&windows[0], &packets[0][2]);
+
+  // Assert
+  TEST_ASSERT_TRUE(first);
+  TEST_ASSERT_TRUE(second);
+  TEST_ASSERT_FALSE(third);
+  TEST_ASSERT_EQUAL_UINT8(0, dtrWindowFreeSlots(&windows[0]));
+}
+
+void testThatDuplicateFrameIsNotDeliveredButAckedAgain() {
+  // Fixture
+  dtrPacket* packet = &packets[0][0];
+  packet->sourceId = topology.devices_ids[0];
+  packet->targetId = topology.devices_ids[1];
+  dtrWindowAdd(&windows[0], packet);
+  dtrPacket token;
+
+  TEST_ASSERT_TRUE(dtrWindowReceive(&windows[1], packet));
+  dtrWindowAccept(&windows[1], packet);
+  dtrWindowWriteAcks(&windows[1], &token);
+
+  // Test
+  const bool actual = dtrWindowReceive(&windows[1], packet);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_UINT32(1, windows[1].duplicatePackets);
+  dtrWindowWriteAcks(&windows[1], &token);
+  TEST_ASSERT_EQUAL_UINT8(sizeof(dtrWindowAck), token.dataSize);
+}
+
+void testThatOutOfOrderFramesAreDelivered() {
+  // Fixture
+  for (int i = 0; i < 3; i++) {
+    packets[0][i].sourceId = topology.devices_ids[0];
+    packets[0][i].targetId = topology.devices_ids[1];
+    dtrWindowAdd(&windows[0], &packets[0][i]);
+  }
+
+  // Test
+  const bool third = receive(&windows[1], &packets[0][2]);
+  const bool first = receive(&windows[1], &packets[0][0]);
+  const bool second = receive(&windows[1], &packets[0][1]);
+  const bool secondAgain = receive(&windows[1], &packets[0][1]);
+
+  // Assert
+  TEST_ASSERT_TRUE(third);
+  TEST_ASSERT_TRUE(first);
+  TEST_ASSERT_TRUE(second);
+  TEST_ASSERT_FALSE(secondAgain);
+}
+
+void testThatFrameIsNotAckedUntilAccepted() {
+  // Fixture
+  dtrPacket* packet = &packets[0][0];
+  packet->sourceId = topology.devices_ids[0];
+  packet->targetId = topology.devices_ids[1];
+  dtrWindowAdd(&windows[0], packet);
+  dtrPacket token;
+
+  // The receiver could not deliver the frame, for instance since its queue was full
+  TEST_ASSERT_TRUE(dtrWindowReceive(&windows[1], packet));
+
+  // Test
+  dtrWindowWriteAcks(&windows[1], &token);
+  const bool actual = dtrWindowReceive(&windows[1], packet);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(0, token.dataSize);
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_EQUAL_UINT32(0, windows[1].deliveredPackets);
+}
+
+void testThatPacketIsDroppedIfTheTargetDoesNotAck() {
+  // Fixture
+  // Node 1 does not hear anything from node 0
+  lossPercent[0][1] = 100;
+  dtrPacket* packet = &packets[0][0];
+  packet->sourceId = topology.devices_ids[0];
+  packet->targetId = topology.devices_ids[1];
+  nextPacket[0] = 1;
+  dtrWindowAdd(&windows[0], packet);
+
+  // Test
+  runUntilAllReleased();
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, acked[0][0]);
+  TEST_ASSERT_EQUAL_INT(1, dropped[0][0]);
+  TEST_ASSERT_EQUAL_UINT32(DTR_WINDOW_MAX_SENDS - 1, windows[0].retransmissions);
+  TEST_ASSERT_EQUAL_UINT32(1, windows[0].droppedPackets);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void release(dtrPacket* packet, bool isAcked) {
+  const int node = indexOf(packet->sourceId);
+  const int i = packet - packets[node];
+  if (isAcked) {
+    acked[node][i]++;
+  } else {
+    dropped[node][i]++;
+  }
+}
+
+static void initRing(const uint8_t windowSize) {
+  for (int node = 0; node < NODE_COUNT; node++) {
+    dtrWindowInit(&windows[node], &topology, topology.devices_ids[node], windowSize, release);
+  }
+}
+
+static void setLoss(const int percent) {
+  for (int from = 0; from < NODE_COUNT; from++) {
+    for (int to = 0; to < NODE_COUNT; to++) {
+      lossPercent[from][to] = percent;
+    }
+  }
+}
+
+// Unicast packets to all other nodes in turn
+static void addUnicastPackets(const int count) {
+  for (int node = 0; node < NODE_COUNT; node++) {
+    for (int i = 0; i < count; i++) {
+      const int target = (node + 1 + i % (NODE_COUNT - 1)) % NODE_COUNT;
+      packets[node][i].sourceId = topology.devices_ids[node];
+      packets[node][i].targetId = topology.devices_ids[target];
+      packets[node][i].dataSize = 1;
+      packets[node][i].data[0] = i;
+    }
+    nextPacket[node] = 0;
+  }
+}
+
+static bool isLost(const int from, const int to) {
+  // Linear congruential generator, the same sequence in every run
+  randomState = randomState * 1103515245 + 12345;
+  return (int)((randomState >> 16) % 100) < lossPercent[from][to];
+}
+
+static bool isDone() {
+  for (int node = 0; node < NODE_COUNT; node++) {
+    if (dtrWindowFreeSlots(&windows[node]) != windows[node].windowSize) {
+      return false;
+    }
+    if (nextPacket[node] < PACKETS_PER_NODE && packets[node][nextPacket[node]].targetId != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Lets each window take a turn in ring order until all packets have been acked
+// or dropped. The frames and the acks written by dtrWindowWriteAcks() are
+// broadcast and may be lost on the way to each node, the turn itself always
+// passes to the next node.
+// @return The number of rotations of the ring
+static int runUntilAllReleased() {
+  int rotations = 0;
+  while (!isDone() && rotations < MAX_ROTATIONS) {
+    for (int holder = 0; holder < NODE_COUNT; holder++) {
+      dtrWindow* window = &windows[holder];
+
+      while (dtrWindowFreeSlots(window) > 0 && nextPacket[holder] < PACKETS_PER_NODE &&
+             packets[holder][nextPacket[holder]].targetId != 0) {
+        TEST_ASSERT_TRUE(dtrWindowAdd(window, &packets[holder][nextPacket[holder]]));
+        nextPacket[holder]++;
+      }
+
+      dtrPacket* frames[DTR_MAX_WINDOW_SIZE];
+      const uint8_t frameCount = dtrWindowGetFramesToSend(window, frames);
+      for (int f = 0; f < frameCount; f++) {
+        const int i = frames[f] - packets[holder];
+        for (int node = 0; node < NODE_COUNT; node++) {
+          if (node != holder && !isLost(holder, node) && receive(&windows[node], frames[f])) {
+            deliveries[holder][i][node]++;
+          }
+        }
+      }
+
+      dtrPacket token;
+      token.sourceId = topology.devices_ids[holder];
+      dtrWindowWriteAcks(window, &token);
+      for (int node = 0; node < NODE_COUNT; node++) {
+        if (node != holder && !isLost(holder, node)) {
+          dtrWindowHandleAcks(&windows[node], &token);
+        }
+      }
+    }
+    rotations++;
+  }
+
+  return rotations;
+}
+
+static int indexOf(const uint8_t id) {
+  for (int i = 0; i < NODE_COUNT; i++) {
+    if (topology.devices_ids[i] == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Receives a frame and accepts it if it is new, as when it is delivered
+static bool receive(dtrWindow* window, const dtrPacket* packet) {
+  if (!dtrWindowReceive(window, packet)) {
+    return false;
+  }
+  dtrWindowAccept(window, packet);
+  return true;
+}
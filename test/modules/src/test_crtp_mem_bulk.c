@@ -0,0 +1,442 @@
+// File under test crtp_mem_bulk.c
+#include "crtp_mem_bulk.h"
+
+#include <errno.h>
+#include <string.h>
+#include "unity.h"
+#include "mem.h"
+#include "mock_crtp.h"
+#include "mock_statsCnt.h"
+
+// Fake memory ------------------------------------
+
+#define FAKE_MEM_SIZE 4000
+static uint8_t fakeMem[FAKE_MEM_SIZE];
+
+static uint32_t handleFakeMemGetSize(void) { return FAKE_MEM_SIZE; }
+static bool handleFakeMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer);
+static bool handleFakeMemWrite(const uint32_t memAddr, const uint8_t writeLen, const uint8_t* buffer);
+
+static const MemoryHandlerDef_t fakeMemDef = {
+  .type = MEM_TYPE_APP,
+  .getSize = handleFakeMemGetSize,
+  .read = handleFakeMemRead,
+  .write = handleFakeMemWrite,
+};
+
+// The fake memory is registered after the mem tester
+static const uint8_t fakeMemId = 1;
+
+// Fake link --------------------------------------
+
+#define FAKE_LINK_QUEUE_SIZE 64
+static CRTPPacket toClient[FAKE_LINK_QUEUE_SIZE];
+static int toClientCount;
+static int dataPacketsFromFirmware;
+
+// Packets with these sequence numbers are lost the first time they are sent
+static uint16_t lostSeqs[8];
+static int lostSeqCount;
+static bool lostSeqUsed[8];
+
+static int fakeLinkSend(CRTPPacket* p, int cmock_num_calls);
+static bool isLostOnce(const uint16_t seq);
+static void setLost(const uint16_t* seqs, const int count);
+
+// Fake client ------------------------------------
+
+static uint32_t now;
+static uint8_t clientMem[FAKE_MEM_SIZE];
+
+static void sendReadStart(const uint8_t memId, const uint32_t addr, const uint32_t len, const uint8_t window);
+static void sendWriteStart(const uint8_t memId, const uint32_t addr, const uint32_t len);
+static int runBulkRead(const uint32_t addr, const uint32_t len, const uint8_t window);
+static int runBulkWrite(const uint32_t addr, const uint32_t len);
+
+void setUp(void) {
+  memReset();
+  memInit();
+  memoryRegisterHandler(&fakeMemDef);
+
+  for (int i = 0; i < FAKE_MEM_SIZE; i++) {
+    fakeMem[i] = (uint8_t)(i * 7 + 3);
+  }
+  memset(clientMem, 0, sizeof(clientMem));
+
+  toClientCount = 0;
+  dataPacketsFromFirmware = 0;
+  setLost(0, 0);
+  now = 1000;
+
+  crtpSendPacketBlock_StubWithCallback(fakeLinkSend);
+}
+
+void tearDown(void) {
+  // Abort any ongoing transfer
+  CRTPPacket p = {.size = 1, .data = {MEM_BULK_CMD_ABORT}};
+  crtpMemBulkProcess(&p, now);
+}
+
+void testThatBulkReadStartIsAcknowledged() {
+  // Fixture
+  // Test
+  sendReadStart(fakeMemId, 10, 100, 8);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, toClientCount);
+  TEST_ASSERT_EQUAL_UINT8(MEM_BULK_CMD_READ_START, toClient[0].data[0]);
+  TEST_ASSERT_EQUAL_UINT8(fakeMemId, toClient[0].data[1]);
+  TEST_ASSERT_EQUAL_UINT8(0, toClient[0].data[2]);
+  TEST_ASSERT_EQUAL_UINT8(MEM_BULK_CHUNK_SIZE, toClient[0].data[3]);
+  TEST_ASSERT_EQUAL_UINT8(8, toClient[0].data[4]);
+}
+
+void testThatBulkReadOutsideOfMemoryIsRejected() {
+  // Fixture
+  // Test
+  sendReadStart(fakeMemId, FAKE_MEM_SIZE - 10, 11, 8);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(EINVAL, toClient[0].data[2]);
+  TEST_ASSERT_EQUAL_UINT32(MEM_BULK_WAIT_FOREVER, crtpMemBulkRun(now));
+}
+
+void testThatTooShortBulkReadStartIsRejected() {
+  // Fixture
+  CRTPPacket p;
+  p.header = CRTP_HEADER(CRTP_PORT_MEM, MEM_BULK_CH);
+  p.data[0] = MEM_BULK_CMD_READ_START;
+  p.data[1] = fakeMemId;
+  memset(&p.data[2], 0, 9);
+  p.size = 10;
+
+  // Test
+  crtpMemBulkProcess(&p, now);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, toClientCount);
+  TEST_ASSERT_EQUAL_UINT8(EINVAL, toClient[0].data[2]);
+  TEST_ASSERT_EQUAL_UINT32(MEM_BULK_WAIT_FOREVER, crtpMemBulkRun(now));
+}
+
+void testThatBulkReadStreamsUpToTheWindowWithoutAck() {
+  // Fixture
+  sendReadStart(fakeMemId, 0, 1000, 4);
+  toClientCount = 0;
+
+  // Test
+  while (crtpMemBulkRun(now) == 0) {
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(4, dataPacketsFromFirmware);
+}
+
+void testThatBulkReadTransfersAllData() {
+  // Fixture
+  const uint32_t addr = 17;
+  const uint32_t len = 3000;
+
+  // Test
+  runBulkRead(addr, len, 16);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(&fakeMem[addr], &clientMem[addr], len);
+  TEST_ASSERT_EQUAL_INT((len + MEM_BULK_CHUNK_SIZE - 1) / MEM_BULK_CHUNK_SIZE, dataPacketsFromFirmware);
+  TEST_ASSERT_EQUAL_UINT32(MEM_BULK_WAIT_FOREVER, crtpMemBulkRun(now));
+}
+
+void testThatOnlyLostChunksAreSentAgainInBulkRead() {
+  // Fixture
+  const uint32_t len = 1000;
+  const uint16_t lost[] = {3, 4, 20};
+  setLost(lost, 3);
+
+  // Test
+  runBulkRead(0, len, 16);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(fakeMem, clientMem, len);
+  TEST_ASSERT_EQUAL_INT((len + MEM_BULK_CHUNK_SIZE - 1) / MEM_BULK_CHUNK_SIZE + 3, dataPacketsFromFirmware);
+}
+
+void testThatLastChunkIsSentAgainOnTimeout() {
+  // Fixture
+  const uint32_t len = 100;
+  const uint16_t lost[] = {3};
+  setLost(lost, 1);
+
+  // Test
+  runBulkRead(0, len, 16);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(fakeMem, clientMem, len);
+}
+
+void testThatBulkReadIsDroppedWhenClientIsGone() {
+  // Fixture
+  sendReadStart(fakeMemId, 0, 1000, 4);
+
+  // Test
+  uint32_t wait = 0;
+  for (int i = 0; i < 100 && wait != MEM_BULK_WAIT_FOREVER; i++) {
+    wait = crtpMemBulkRun(now);
+    if (wait != MEM_BULK_WAIT_FOREVER) {
+      now += wait;
+    }
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(MEM_BULK_WAIT_FOREVER, wait);
+  TEST_ASSERT_EQUAL_INT(4 + MEM_BULK_READ_MAX_TIMEOUTS, dataPacketsFromFirmware);
+}
+
+void testThatBulkWriteTransfersAllData() {
+  // Fixture
+  const uint32_t addr = 123;
+  const uint32_t len = 2000;
+  for (uint32_t i = 0; i < len; i++) {
+    clientMem[addr + i] = (uint8_t)(i * 13 + 1);
+  }
+
+  // Test
+  const int chunksSent = runBulkWrite(addr, len);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(&clientMem[addr], &fakeMem[addr], len);
+  TEST_ASSERT_EQUAL_INT((len + MEM_BULK_CHUNK_SIZE - 1) / MEM_BULK_CHUNK_SIZE, chunksSent);
+}
+
+void testThatOnlyLostChunksAreSentAgainInBulkWrite() {
+  // Fixture
+  const uint32_t len = 2000;
+  for (uint32_t i = 0; i < len; i++) {
+    clientMem[i] = (uint8_t)(i * 13 + 1);
+  }
+  const uint16_t lost[] = {0, 7, 8, 40};
+  setLost(lost, 4);
+
+  // Test
+  const int chunksSent = runBulkWrite(0, len);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(clientMem, fakeMem, len);
+  TEST_ASSERT_EQUAL_INT((len + MEM_BULK_CHUNK_SIZE - 1) / MEM_BULK_CHUNK_SIZE + 4, chunksSent);
+}
+
+void testThatBulkReadNeedsFewerRoundTripsThanTheReadChannel() {
+  // Fixture
+  const uint32_t len = 3000;
+  // One request per 24 bytes with the read channel
+  const int legacyRoundTrips = (len + 23) / 24;
+
+  // Test
+  const int acks = runBulkRead(0, len, MEM_BULK_MAX_WINDOW);
+
+  // Assert
+  TEST_ASSERT_TRUE(acks + 1 < legacyRoundTrips / 4);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static bool handleFakeMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer) {
+  memcpy(buffer, &fakeMem[memAddr], readLen);
+  return true;
+}
+
+static bool handleFakeMemWrite(const uint32_t memAddr, const uint8_t writeLen, const uint8_t* buffer) {
+  memcpy(&fakeMem[memAddr], buffer, writeLen);
+  return true;
+}
+
+static void setLost(const uint16_t* seqs, const int count) {
+  lostSeqCount = count;
+  for (int i = 0; i < count; i++) {
+    lostSeqs[i] = seqs[i];
+    lostSeqUsed[i] = false;
+  }
+}
+
+static bool isLostOnce(const uint16_t seq) {
+  for (int i = 0; i < lostSeqCount; i++) {
+    if (lostSeqs[i] == seq && !lostSeqUsed[i]) {
+      lostSeqUsed[i] = true;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static int fakeLinkSend(CRTPPacket* p, int cmock_num_calls) {
+  if (p->data[0] == MEM_BULK_CMD_READ_DATA) {
+    dataPacketsFromFirmware++;
+
+    uint16_t seq;
+    memcpy(&seq, &p->data[1], 2);
+    if (isLostOnce(seq)) {
+      return 1;
+    }
+  }
+
+  TEST_ASSERT_TRUE(toClientCount < FAKE_LINK_QUEUE_SIZE);
+  toClient[toClientCount++] = *p;
+  return 1;
+}
+
+static void sendReadStart(const uint8_t memId, const uint32_t addr, const uint32_t len, const uint8_t window) {
+  CRTPPacket p;
+  p.header = CRTP_HEADER(CRTP_PORT_MEM, MEM_BULK_CH);
+  p.data[0] = MEM_BULK_CMD_READ_START;
+  p.data[1] = memId;
+  memcpy(&p.data[2], &addr, 4);
+  memcpy(&p.data[6], &len, 4);
+  p.data[10] = window;
+  p.size = 11;
+  crtpMemBulkProcess(&p, now);
+}
+
+static void sendWriteStart(const uint8_t memId, const uint32_t addr, const uint32_t len) {
+  CRTPPacket p;
+  p.header = CRTP_HEADER(CRTP_PORT_MEM, MEM_BULK_CH);
+  p.data[0] = MEM_BULK_CMD_WRITE_START;
+  p.data[1] = memId;
+  memcpy(&p.data[2], &addr, 4);
+  memcpy(&p.data[6], &len, 4);
+  p.size = 10;
+  crtpMemBulkProcess(&p, now);
+}
+
+static void sendReadAck(const uint16_t nextSeq, const uint32_t received) {
+  CRTPPacket p;
+  p.header = CRTP_HEADER(CRTP_PORT_MEM, MEM_BULK_CH);
+  p.data[0] = MEM_BULK_CMD_READ_ACK;
+  memcpy(&p.data[1], &nextSeq, 2);
+  memcpy(&p.data[3], &received, 4);
+  p.size = 7;
+  crtpMemBulkProcess(&p, now);
+}
+
+// Runs a bulk read the way a client would, returns the number of ACKs sent
+static int runBulkRead(const uint32_t addr, const uint32_t len, const uint8_t window) {
+  const uint16_t chunkCount = (len + MEM_BULK_CHUNK_SIZE - 1) / MEM_BULK_CHUNK_SIZE;
+  uint16_t nextSeq = 0;
+  uint32_t received = 0;
+  int sinceAck = 0;
+  int acks = 0;
+
+  sendReadStart(fakeMemId, addr, len, window);
+  TEST_ASSERT_EQUAL_UINT8(0, toClient[0].data[2]);
+  toClientCount = 0;
+
+  for (int iteration = 0; iteration < 10000; iteration++) {
+    const uint32_t wait = crtpMemBulkRun(now);
+    if (wait == MEM_BULK_WAIT_FOREVER) {
+      break;
+    }
+    now += wait;
+
+    // Acknowledge holes and duplicates directly
+    bool ackNow = false;
+    for (int i = 0; i < toClientCount; i++) {
+      const CRTPPacket* p = &toClient[i];
+      TEST_ASSERT_EQUAL_UINT8(MEM_BULK_CMD_READ_DATA, p->data[0]);
+
+      uint16_t seq;
+      memcpy(&seq, &p->data[1], 2);
+      if (seq < nextSeq || seq - nextSeq >= 32) {
+        ackNow = true;
+        continue;
+      }
+
+      memcpy(&clientMem[addr + seq * MEM_BULK_CHUNK_SIZE], &p->data[3], p->size - 3);
+      if (seq > nextSeq) {
+        ackNow = true;
+      }
+      received |= 1u << (seq - nextSeq);
+      while (received & 1) {
+        received >>= 1;
+        nextSeq++;
+      }
+      sinceAck++;
+    }
+    toClientCount = 0;
+
+    if (ackNow || sinceAck >= window / 2 || nextSeq == chunkCount) {
+      sendReadAck(nextSeq, received);
+      acks++;
+      sinceAck = 0;
+    }
+  }
+
+  TEST_ASSERT_EQUAL_UINT16(chunkCount, nextSeq);
+  return acks;
+}
+
+// Runs a bulk write the way a client would, returns the number of chunks sent
+static int runBulkWrite(const uint32_t addr, const uint32_t len) {
+  const uint16_t chunkCount = (len + MEM_BULK_CHUNK_SIZE - 1) / MEM_BULK_CHUNK_SIZE;
+  uint16_t ackedSeq = 0;
+  uint16_t nextSeq = 0;
+  uint32_t resend = 0;
+  int chunksSent = 0;
+
+  sendWriteStart(fakeMemId, addr, len);
+  TEST_ASSERT_EQUAL_UINT8(0, toClient[0].data[2]);
+  const uint8_t window = toClient[0].data[4];
+  toClientCount = 0;
+
+  for (int iteration = 0; iteration < 10000 && ackedSeq < chunkCount; iteration++) {
+    uint16_t seq;
+    if (resend) {
+      const int i = __builtin_ctz(resend);
+      resend &= ~(1u << i);
+      seq = ackedSeq + i;
+    } else if (nextSeq < chunkCount && nextSeq - ackedSeq < window) {
+      seq = nextSeq++;
+    } else {
+      // Timeout, send the oldest chunk again
+      seq = ackedSeq;
+    }
+
+    chunksSent++;
+    if (!isLostOnce(seq)) {
+      CRTPPacket p;
+      p.header = CRTP_HEADER(CRTP_PORT_MEM, MEM_BULK_CH);
+      p.data[0] = MEM_BULK_CMD_WRITE_DATA;
+      memcpy(&p.data[1], &seq, 2);
+      const uint32_t offset = seq * MEM_BULK_CHUNK_SIZE;
+      const uint8_t chunkLen = (len - offset) < MEM_BULK_CHUNK_SIZE ? (len - offset) : MEM_BULK_CHUNK_SIZE;
+      memcpy(&p.data[3], &clientMem[addr + offset], chunkLen);
+      p.size = 3 + chunkLen;
+      crtpMemBulkProcess(&p, now);
+    }
+
+    for (int i = 0; i < toClientCount; i++) {
+      const CRTPPacket* p = &toClient[i];
+      TEST_ASSERT_EQUAL_UINT8(MEM_BULK_CMD_WRITE_ACK, p->data[0]);
+      TEST_ASSERT_EQUAL_UINT8(0, p->data[1]);
+
+      uint16_t ackSeq;
+      uint32_t received;
+      memcpy(&ackSeq, &p->data[2], 2);
+      memcpy(&received, &p->data[4], 4);
+      if (ackSeq < ackedSeq) {
+        continue;
+      }
+
+      const uint16_t advance = ackSeq - ackedSeq;
+      resend = advance >= 32 ? 0 : resend >> advance;
+      ackedSeq = ackSeq;
+      resend &= ~received;
+      if (received) {
+        const int highest = 31 - __builtin_clz(received);
+        resend |= ~received & ((1u << highest) - 1);
+      }
+    }
+    toClientCount = 0;
+  }
+
+  TEST_ASSERT_EQUAL_UINT16(chunkCount, ackedSeq);
+  return chunksSent;
+}
@@ -0,0 +1,114 @@
+// File under test crtp_tx_schedule.c
+#include "crtp_tx_schedule.h"
+
+#include <string.h>
+#include "unity.h"
+
+static crtpTxSchedule_t schedule;
+static bool hasPackets[CRTP_TX_PRIORITY_COUNT];
+
+static void setWaiting(bool high, bool normal, bool low);
+
+void setUp(void) {
+  crtpTxScheduleInit(&schedule);
+  setWaiting(false, false, false);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatNothingIsSelectedWhenAllQueuesAreEmpty() {
+  // Fixture
+  // Test
+  const crtpTxPriority_t actual = crtpTxScheduleNext(&schedule, hasPackets);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(CRTP_TX_PRIORITY_COUNT, actual);
+}
+
+void testThatTheHighestPriorityClassIsSelected() {
+  // Fixture
+  setWaiting(false, true, true);
+
+  // Test
+  const crtpTxPriority_t actual = crtpTxScheduleNext(&schedule, hasPackets);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(CRTP_TX_PRIORITY_NORMAL, actual);
+}
+
+void testThatLowPriorityGetsAMinimumShareOfTheLink() {
+  // Fixture
+  setWaiting(false, true, true);
+  const int sendCount = 10 * (CRTP_TX_MAX_SKIPPED + 1);
+  int lowCount = 0;
+
+  // Test
+  for (int i = 0; i < sendCount; i++) {
+    if (crtpTxScheduleNext(&schedule, hasPackets) == CRTP_TX_PRIORITY_LOW) {
+      lowCount++;
+    }
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(10, lowCount);
+  TEST_ASSERT_EQUAL_UINT32(10, schedule.agedCount);
+}
+
+void testThatLowPriorityIsSelectedAfterMaxSkipped() {
+  // Fixture
+  setWaiting(false, true, true);
+  for (int i = 0; i < CRTP_TX_MAX_SKIPPED; i++) {
+    TEST_ASSERT_EQUAL_INT(CRTP_TX_PRIORITY_NORMAL, crtpTxScheduleNext(&schedule, hasPackets));
+  }
+
+  // Test
+  const crtpTxPriority_t actual = crtpTxScheduleNext(&schedule, hasPackets);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(CRTP_TX_PRIORITY_LOW, actual);
+}
+
+void testThatTheWaitIsResetWhenTheQueueIsEmptied() {
+  // Fixture
+  setWaiting(false, true, true);
+  for (int i = 0; i < CRTP_TX_MAX_SKIPPED; i++) {
+    crtpTxScheduleNext(&schedule, hasPackets);
+  }
+  setWaiting(false, true, false);
+  crtpTxScheduleNext(&schedule, hasPackets);
+  setWaiting(false, true, true);
+
+  // Test
+  const crtpTxPriority_t actual = crtpTxScheduleNext(&schedule, hasPackets);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(CRTP_TX_PRIORITY_NORMAL, actual);
+}
+
+void testThatTheHighestOfTheWaitingClassesIsServedFirst() {
+  // Fixture
+  setWaiting(true, true, true);
+  for (int i = 0; i < CRTP_TX_MAX_SKIPPED; i++) {
+    TEST_ASSERT_EQUAL_INT(CRTP_TX_PRIORITY_HIGH, crtpTxScheduleNext(&schedule, hasPackets));
+  }
+
+  // Test
+  const crtpTxPriority_t first = crtpTxScheduleNext(&schedule, hasPackets);
+  const crtpTxPriority_t second = crtpTxScheduleNext(&schedule, hasPackets);
+  const crtpTxPriority_t third = crtpTxScheduleNext(&schedule, hasPackets);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(CRTP_TX_PRIORITY_NORMAL, first);
+  TEST_ASSERT_EQUAL_INT(CRTP_TX_PRIORITY_LOW, second);
+  TEST_ASSERT_EQUAL_INT(CRTP_TX_PRIORITY_HIGH, third);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void setWaiting(bool high, bool normal, bool low) {
+  hasPackets[CRTP_TX_PRIORITY_HIGH] = high;
+  hasPackets[CRTP_TX_PRIORITY_NORMAL] = normal;
+  hasPackets[CRTP_TX_PRIORITY_LOW] = low;
+}
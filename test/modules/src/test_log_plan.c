@@ -0,0 +1,350 @@
+// File under test log_plan.c
+#include "log_plan.h"
+
+#include <string.h>
+#include "unity.h"
+#include "num.h"
+
+#define OP_COUNT 16
+#define MAX_BLOCK_LEN 26
+#define RANDOM_ROUNDS 2000
+
+typedef union {
+  uint8_t u8;
+  uint16_t u16;
+  uint32_t u32;
+  int8_t i8;
+  int16_t i16;
+  int32_t i32;
+  float f;
+} value_t;
+
+static value_t values[OP_COUNT];
+static logByFunction_t functions[OP_COUNT];
+static logPlanOp_t ops[OP_COUNT];
+static logPlanStep_t steps[OP_COUNT];
+static uint32_t randomState;
+
+static int referenceRun(const logPlanOp_t* ops, const int opCount, uint8_t* dst, const uint32_t timestamp);
+static uint32_t randomNumber();
+static void randomValue(value_t* value, const uint8_t storageType);
+static int setupRandomOps(const bool byFunction);
+static void assertSameOutputAsReference(const int opCount);
+
+void setUp(void) {
+  memset(values, 0, sizeof(values));
+  memset(ops, 0, sizeof(ops));
+  memset(steps, 0, sizeof(steps));
+  randomState = 4711;
+
+  for (int i = 0; i < OP_COUNT; i++) {
+    functions[i].data = &values[i];
+  }
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatAllTypeCombinationsGiveTheSameBytesAsBefore() {
+  for (int round = 0; round < RANDOM_ROUNDS; round++) {
+    // Fixture
+    const int opCount = setupRandomOps(false);
+
+    // Test
+    // Assert
+    assertSameOutputAsReference(opCount);
+  }
+}
+
+void testThatAllTypeCombinationsByFunctionGiveTheSameBytesAsBefore() {
+  for (int round = 0; round < RANDOM_ROUNDS; round++) {
+    // Fixture
+    const int opCount = setupRandomOps(true);
+
+    // Test
+    // Assert
+    assertSameOutputAsReference(opCount);
+  }
+}
+
+void testThatContiguousVariablesAreMergedIntoOneCopy() {
+  // Fixture
+  struct {
+    float x;
+    float y;
+    float z;
+    uint16_t a;
+    int16_t b;
+  } state = {.x = 1.0f, .y = -2.0f, .z = 3.5f, .a = 17, .b = -4};
+
+  ops[0] = (logPlanOp_t){.variable = &state.x, .storageType = LOG_FLOAT, .logType = LOG_FLOAT};
+  ops[1] = (logPlanOp_t){.variable = &state.y, .storageType = LOG_FLOAT, .logType = LOG_FLOAT};
+  ops[2] = (logPlanOp_t){.variable = &state.z, .storageType = LOG_FLOAT, .logType = LOG_FLOAT};
+  ops[3] = (logPlanOp_t){.variable = &state.a, .storageType = LOG_UINT16, .logType = LOG_UINT16};
+  ops[4] = (logPlanOp_t){.variable = &state.b, .storageType = LOG_INT16, .logType = LOG_UINT16};
+
+  // Test
+  const int actual = logPlanCompile(ops, 5, steps);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, actual);
+  TEST_ASSERT_EQUAL_UINT8(16, steps[0].length);
+  assertSameOutputAsReference(5);
+}
+
+void testThatConvertedVariablesAreNotMerged() {
+  // Fixture
+  float state[3] = {1.0f, 2.0f, 3.0f};
+
+  ops[0] = (logPlanOp_t){.variable = &state[0], .storageType = LOG_FLOAT, .logType = LOG_FLOAT};
+  ops[1] = (logPlanOp_t){.variable = &state[1], .storageType = LOG_FLOAT, .logType = LOG_FP16};
+  ops[2] = (logPlanOp_t){.variable = &state[2], .storageType = LOG_FLOAT, .logType = LOG_FLOAT};
+
+  // Test
+  const int actual = logPlanCompile(ops, 3, steps);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(3, actual);
+  assertSameOutputAsReference(3);
+}
+
+void testThatUnknownStorageTypeIsLoggedAsZero() {
+  // Fixture
+  values[0].u32 = 0xffffffff;
+  ops[0] = (logPlanOp_t){.variable = &values[0], .storageType = LOG_FP16, .logType = LOG_UINT32};
+  ops[1] = (logPlanOp_t){.variable = &values[0], .storageType = 0, .logType = LOG_FLOAT};
+
+  // Test
+  const int stepCount = logPlanCompile(ops, 2, steps);
+
+  // Assert
+  uint8_t actual[8];
+  memset(actual, 0xaa, sizeof(actual));
+  TEST_ASSERT_EQUAL_INT(8, logPlanRun(steps, stepCount, actual, 0));
+  for (int i = 0; i < 8; i++) {
+    TEST_ASSERT_EQUAL_UINT8(0, actual[i]);
+  }
+}
+
+void testThatSyncBlockIsDueEveryDividerTickInItsPhase() {
+  // Fixture
+  int dueCount = 0;
+  int otherPhaseCount = 0;
+
+  // Test
+  for (uint32_t tick = 0; tick < 100; tick++) {
+    if (logPlanIsSyncDue(logSyncPhaseMotors, 10, logSyncPhaseMotors, tick)) {
+      TEST_ASSERT_EQUAL_UINT32(0, tick % 10);
+      dueCount++;
+    }
+    if (logPlanIsSyncDue(logSyncPhaseMotors, 10, logSyncPhaseController, tick)) {
+      otherPhaseCount++;
+    }
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(10, dueCount);
+  TEST_ASSERT_EQUAL_INT(0, otherPhaseCount);
+}
+
+void testThatBlockSampledByTheTimerIsNeverSyncDue() {
+  // Fixture
+  // Test
+  const bool actual = logPlanIsSyncDue(logSyncPhaseEstimator, 0, logSyncPhaseEstimator, 0);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatSyncPacketHasBlockIdTickAndData() {
+  // Fixture
+  values[0].f = 1.5f;
+  values[1].i16 = -2;
+  ops[0] = (logPlanOp_t){.variable = &values[0], .storageType = LOG_FLOAT, .logType = LOG_FLOAT};
+  ops[1] = (logPlanOp_t){.variable = &values[1], .storageType = LOG_INT16, .logType = LOG_INT16};
+  const int stepCount = logPlanCompile(ops, 2, steps);
+  uint8_t actual[LOG_PLAN_SYNC_HEADER_LENGTH + 6];
+
+  // Test
+  const int headerLength = logPlanWriteSyncHeader(actual, 7, 0x12345678);
+  const int dataLength = logPlanRun(steps, stepCount, &actual[headerLength], 0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(LOG_PLAN_SYNC_HEADER_LENGTH, headerLength);
+  TEST_ASSERT_EQUAL_INT(6, dataLength);
+  TEST_ASSERT_EQUAL_UINT8(7, actual[0]);
+  TEST_ASSERT_EQUAL_UINT8(0x78, actual[1]);
+  TEST_ASSERT_EQUAL_UINT8(0x56, actual[2]);
+  TEST_ASSERT_EQUAL_UINT8(0x34, actual[3]);
+  TEST_ASSERT_EQUAL_MEMORY(&values[0].f, &actual[4], 4);
+  TEST_ASSERT_EQUAL_MEMORY(&values[1].i16, &actual[8], 2);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+// Fetchers for variables logged by function, the value is stored in the data
+static uint8_t acquireUInt8(uint32_t timestamp, void* data) { return ((value_t*)data)->u8; }
+static uint16_t acquireUInt16(uint32_t timestamp, void* data) { return ((value_t*)data)->u16; }
+static uint32_t acquireUInt32(uint32_t timestamp, void* data) { return ((value_t*)data)->u32; }
+static int8_t acquireInt8(uint32_t timestamp, void* data) { return ((value_t*)data)->i8; }
+static int16_t acquireInt16(uint32_t timestamp, void* data) { return ((value_t*)data)->i16; }
+static int32_t acquireInt32(uint32_t timestamp, void* data) { return ((value_t*)data)->i32; }
+static float acquireFloat(uint32_t timestamp, void* data) { return ((value_t*)data)->f; }
+
+static const uint8_t referenceTypeLength[] = {
+  [LOG_UINT8] = 1, [LOG_UINT16] = 2, [LOG_UINT32] = 4, [LOG_INT8] = 1,
+  [LOG_INT16] = 2, [LOG_INT32] = 4, [LOG_FLOAT] = 4, [LOG_FP16] = 2,
+};
+
+// The per-op type dispatch the log system used before the plans
+static int referenceRun(const logPlanOp_t* ops, const int opCount, uint8_t* dst, const uint32_t timestamp) {
+  int size = 0;
+
+  for (int i = 0; i < opCount; i++) {
+    const logPlanOp_t* op = &ops[i];
+    const logByFunction_t* function = op->variable;
+    int valuei = 0;
+    float valuef = 0;
+
+    switch (op->storageType) {
+      case LOG_UINT8: {
+        uint8_t v;
+        if (op->byFunction) { v = function->acquireUInt8(timestamp, function->data); } else { memcpy(&v, op->variable, sizeof(v)); }
+        valuei = v;
+        break;
+      }
+      case LOG_INT8: {
+        int8_t v;
+        if (op->byFunction) { v = function->acquireInt8(timestamp, function->data); } else { memcpy(&v, op->variable, sizeof(v)); }
+        valuei = v;
+        break;
+      }
+      case LOG_UINT16: {
+        uint16_t v;
+        if (op->byFunction) { v = function->acquireUInt16(timestamp, function->data); } else { memcpy(&v, op->variable, sizeof(v)); }
+        valuei = v;
+        break;
+      }
+      case LOG_INT16: {
+        int16_t v;
+        if (op->byFunction) { v = function->acquireInt16(timestamp, function->data); } else { memcpy(&v, op->variable, sizeof(v)); }
+        valuei = v;
+        break;
+      }
+      case LOG_UINT32: {
+        uint32_t v;
+        if (op->byFunction) { v = function->acquireUInt32(timestamp, function->data); } else { memcpy(&v, op->variable, sizeof(v)); }
+        valuei = v;
+        break;
+      }
+      case LOG_INT32: {
+        int32_t v;
+        if (op->byFunction) { v = function->acquireInt32(timestamp, function->data); } else { memcpy(&v, op->variable, sizeof(v)); }
+        valuei = v;
+        break;
+      }
+      case LOG_FLOAT: {
+        float v;
+        if (op->byFunction) { v = function->aquireFloat(timestamp, function->data); } else { memcpy(&v, op->variable, sizeof(v)); }
+        valuei = v;
+        valuef = v;
+        break;
+      }
+    }
+
+    if (op->logType == LOG_FLOAT || op->logType == LOG_FP16) {
+      if (op->storageType != LOG_FLOAT) {
+        valuef = valuei;
+      }
+
+      if (op->logType == LOG_FLOAT) {
+        memcpy(&dst[size], &valuef, 4);
+        size += 4;
+      } else {
+        valuei = single2half(valuef);
+        memcpy(&dst[size], &valuei, 2);
+        size += 2;
+      }
+    } else {
+      memcpy(&dst[size], &valuei, referenceTypeLength[op->logType]);
+      size += referenceTypeLength[op->logType];
+    }
+  }
+
+  return size;
+}
+
+static uint32_t randomNumber() {
+  // Linear congruential generator, the same sequence in every run
+  randomState = randomState * 1103515245 + 12345;
+  return randomState >> 8;
+}
+
+static void randomValue(value_t* value, const uint8_t storageType) {
+  memset(value, 0, sizeof(*value));
+  const uint32_t r = randomNumber();
+
+  switch (storageType) {
+    case LOG_UINT8: value->u8 = r; break;
+    case LOG_UINT16: value->u16 = r; break;
+    case LOG_UINT32: value->u32 = r << 8 | (r & 0xff); break;
+    case LOG_INT8: value->i8 = r; break;
+    case LOG_INT16: value->i16 = r; break;
+    case LOG_INT32: value->i32 = (int32_t)(r << 8 | (r & 0xff)); break;
+    case LOG_FLOAT:
+      // Keep the float within the range of an int, converting outside of it is undefined
+      value->f = ((float)(int)(r & 0xffff) - 32768.0f) / (float)(1 + (r >> 16) % 100);
+      break;
+  }
+}
+
+// Random variables that fill a block, some of them next to each other in memory
+static int setupRandomOps(const bool byFunction) {
+  int length = 0;
+  int opCount = 0;
+
+  while (opCount < OP_COUNT) {
+    const uint8_t storageType = LOG_UINT8 + randomNumber() % 7;
+    const uint8_t logType = LOG_UINT8 + randomNumber() % 8;
+    if (length + referenceTypeLength[logType] > MAX_BLOCK_LEN) {
+      break;
+    }
+
+    randomValue(&values[opCount], storageType);
+    ops[opCount].storageType = storageType;
+    ops[opCount].logType = logType;
+    ops[opCount].byFunction = byFunction;
+    if (byFunction) {
+      functions[opCount].acquireUInt8 = acquireUInt8;
+      functions[opCount].acquireUInt16 = acquireUInt16;
+      functions[opCount].acquireUInt32 = acquireUInt32;
+      functions[opCount].acquireInt8 = acquireInt8;
+      functions[opCount].acquireInt16 = acquireInt16;
+      functions[opCount].acquireInt32 = acquireInt32;
+      functions[opCount].aquireFloat = acquireFloat;
+      ops[opCount].variable = &functions[opCount];
+    } else {
+      ops[opCount].variable = &values[opCount];
+    }
+
+    length += referenceTypeLength[logType];
+    opCount++;
+  }
+
+  return opCount;
+}
+
+static void assertSameOutputAsReference(const int opCount) {
+  uint8_t expected[MAX_BLOCK_LEN + 4];
+  uint8_t actual[MAX_BLOCK_LEN + 4];
+  memset(expected, 0, sizeof(expected));
+  memset(actual, 0, sizeof(actual));
+
+  const int stepCount = logPlanCompile(ops, opCount, steps);
+  const int expectedSize = referenceRun(ops, opCount, expected, 1234);
+  const int actualSize = logPlanRun(steps, stepCount, actual, 1234);
+
+  TEST_ASSERT_EQUAL_INT(expectedSize, actualSize);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, sizeof(expected));
+}
@@ -0,0 +1,317 @@
+// File under test peer_localization.c
+#include "peer_localization.h"
+
+#include <string.h>
+#include "unity.h"
+#include "mock_statsCnt.h"
+
+// Dummy mocks timer
+static uint32_t now = 0;
+uint32_t xTaskGetTickCount() {return now;}
+
+static positionMeasurement_t pos;
+
+static void tellPosition(int id, float x, float y, float z);
+
+void setUp(void) {
+  memset(&pos, 0, sizeof(pos));
+
+  // The table is static, replace all peers from earlier tests with far away
+  // peers that are stale by the time the test starts.
+  now += 100000;
+  for (int i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; i++) {
+    tellPosition(200 + i, 100.0f, 100.0f, 100.0f);
+  }
+  now += 100000;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatPositionIsFoundById() {
+  // Fixture
+  tellPosition(7, 1.0f, 2.0f, 3.0f);
+
+  // Test
+  peerLocalizationOtherPosition_t* actual = peerLocalizationGetPositionByID(7);
+
+  // Assert
+  TEST_ASSERT_NOT_NULL(actual);
+  TEST_ASSERT_EQUAL_UINT8(7, actual->id);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, actual->pos.y);
+  TEST_ASSERT_EQUAL_UINT32(now, actual->pos.timestamp);
+}
+
+void testThatUnknownIdIsNotFound() {
+  // Fixture
+  tellPosition(7, 1.0f, 2.0f, 3.0f);
+
+  // Test
+  // Assert
+  TEST_ASSERT_NULL(peerLocalizationGetPositionByID(8));
+  TEST_ASSERT_FALSE(peerLocalizationIsIDActive(8));
+  TEST_ASSERT_FALSE(peerLocalizationIsIDActive(0));
+}
+
+void testThatPositionIsUpdatedInPlace() {
+  // Fixture
+  tellPosition(7, 1.0f, 2.0f, 3.0f);
+  peerLocalizationOtherPosition_t* first = peerLocalizationGetPositionByID(7);
+
+  // Test
+  now += 10;
+  tellPosition(7, 4.0f, 5.0f, 6.0f);
+
+  // Assert
+  peerLocalizationOtherPosition_t* actual = peerLocalizationGetPositionByID(7);
+  TEST_ASSERT_EQUAL_PTR(first, actual);
+  TEST_ASSERT_EQUAL_FLOAT(4.0f, actual->pos.x);
+}
+
+void testThatPositionIsStoredWithTheGivenTimestamp() {
+  // Fixture
+  pos.x = 1.0f;
+
+  // Test
+  peerLocalizationTellPositionAt(7, &pos, now - 30);
+
+  // Assert
+  peerLocalizationOtherPosition_t* actual = peerLocalizationGetPositionByID(7);
+  TEST_ASSERT_NOT_NULL(actual);
+  TEST_ASSERT_EQUAL_UINT32(now - 30, actual->pos.timestamp);
+}
+
+void testThatOlderPositionDoesNotReplaceNewerPosition() {
+  // Fixture
+  tellPosition(7, 1.0f, 2.0f, 3.0f);
+  pos.x = 4.0f;
+
+  // Test
+  peerLocalizationTellPositionAt(7, &pos, now - 30);
+
+  // Assert
+  peerLocalizationOtherPosition_t* actual = peerLocalizationGetPositionByID(7);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, actual->pos.x);
+  TEST_ASSERT_EQUAL_UINT32(now, actual->pos.timestamp);
+}
+
+void testThatNewPeerIsRejectedWhenTableIsFullOfFreshPeers() {
+  // Fixture
+  for (int i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; i++) {
+    tellPosition(1 + i, 0.0f, 0.0f, 0.0f);
+  }
+
+  // Test
+  pos.x = 1.0f;
+  bool actual = peerLocalizationTellPosition(100, &pos);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_NULL(peerLocalizationGetPositionByID(100));
+}
+
+void testThatStalestPeerIsEvictedWhenTableIsFull() {
+  // Fixture
+  for (int i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; i++) {
+    tellPosition(1 + i, 0.0f, 0.0f, 0.0f);
+    now += 1;
+  }
+  now += 5000;
+  for (int i = 1; i < PEER_LOCALIZATION_MAX_NEIGHBORS; i++) {
+    tellPosition(1 + i, 0.0f, 0.0f, 0.0f);
+  }
+
+  // Test
+  pos.x = 1.0f;
+  bool actual = peerLocalizationTellPosition(100, &pos);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_NOT_NULL(peerLocalizationGetPositionByID(100));
+  TEST_ASSERT_NULL(peerLocalizationGetPositionByID(1));
+}
+
+void testThatStalestPeerIsEvictedWhenTheTickCounterWraps() {
+  // Fixture
+  // Move the clock to just before the wrap, in steps that keep the peers from
+  // setUp() older than the clock
+  while (now < UINT32_MAX - 100000) {
+    now += (UINT32_MAX - 100000 - now) < 0x40000000 ? (UINT32_MAX - 100000 - now) : 0x40000000;
+    for (int i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; i++) {
+      tellPosition(200 + i, 100.0f, 100.0f, 100.0f);
+    }
+  }
+  now = UINT32_MAX - 5;
+  tellPosition(1, 0.0f, 0.0f, 0.0f);
+  now += 10;
+  for (int i = 1; i < PEER_LOCALIZATION_MAX_NEIGHBORS; i++) {
+    tellPosition(1 + i, 0.0f, 0.0f, 0.0f);
+  }
+  now += 5000;
+  for (int i = 1; i < PEER_LOCALIZATION_MAX_NEIGHBORS; i++) {
+    tellPosition(1 + i, 0.0f, 0.0f, 0.0f);
+  }
+
+  // Test
+  pos.x = 1.0f;
+  bool actual = peerLocalizationTellPosition(100, &pos);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_NOT_NULL(peerLocalizationGetPositionByID(100));
+  TEST_ASSERT_NULL(peerLocalizationGetPositionByID(1));
+}
+
+void testThatNearestPeersAreReturnedInTableOrder() {
+  // Fixture
+  tellPosition(1, 5.0f, 0.0f, 0.0f);
+  tellPosition(2, 1.0f, 0.0f, 0.0f);
+  tellPosition(3, 3.0f, 0.0f, 0.0f);
+  tellPosition(4, 2.0f, 0.0f, 0.0f);
+  point_t center = {.x = 0.0f, .y = 0.0f, .z = 0.0f};
+  peerLocalizationOtherPosition_t const *result[3];
+
+  // Test
+  int actual = peerLocalizationGetNearest(&center, NULL, -1, result, 3, NULL);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(3, actual);
+  TEST_ASSERT_EQUAL_UINT8(2, result[0]->id);
+  TEST_ASSERT_EQUAL_UINT8(3, result[1]->id);
+  TEST_ASSERT_EQUAL_UINT8(4, result[2]->id);
+}
+
+void testThatNearestIgnoresOldPeers() {
+  // Fixture
+  tellPosition(1, 1.0f, 0.0f, 0.0f);
+  now += 500;
+  tellPosition(2, 2.0f, 0.0f, 0.0f);
+  point_t center = {.x = 0.0f, .y = 0.0f, .z = 0.0f};
+  peerLocalizationOtherPosition_t const *result[3];
+
+  // Test
+  int actual = peerLocalizationGetNearest(&center, NULL, 100, result, 3, NULL);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, actual);
+  TEST_ASSERT_EQUAL_UINT8(2, result[0]->id);
+}
+
+void testThatVelocityIsStoredWithThePosition() {
+  // Fixture
+  velocity_t vel = {.x = 1.0f, .y = 2.0f, .z = 3.0f};
+
+  // Test
+  peerLocalizationTellStateAt(7, &pos, &vel, now - 30);
+
+  // Assert
+  peerLocalizationOtherPosition_t* actual = peerLocalizationGetPositionByID(7);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, actual->vel.y);
+  TEST_ASSERT_EQUAL_UINT32(now - 30, actual->vel.timestamp);
+}
+
+void testThatPositionIsExtrapolatedToTheCurrentTime() {
+  // Fixture
+  velocity_t vel = {.x = 1.0f, .y = -2.0f, .z = 0.0f};
+  pos = (positionMeasurement_t){.x = 1.0f, .y = 0.0f, .z = 0.0f};
+  peerLocalizationTellStateAt(7, &pos, &vel, now - 50);
+  point_t actual;
+
+  // Test
+  peerLocalizationGetPosition(peerLocalizationGetPositionByID(7), &actual);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.05f, actual.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, -0.1f, actual.y);
+  TEST_ASSERT_EQUAL_UINT32(now, actual.timestamp);
+}
+
+void testThatExtrapolationIsLimited() {
+  // Fixture
+  velocity_t vel = {.x = 1.0f, .y = 0.0f, .z = 0.0f};
+  pos = (positionMeasurement_t){.x = 0.0f, .y = 0.0f, .z = 0.0f};
+  peerLocalizationTellStateAt(7, &pos, &vel, now - 500);
+  point_t actual;
+
+  // Test
+  peerLocalizationGetPosition(peerLocalizationGetPositionByID(7), &actual);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.1f, actual.x);
+}
+
+void testThatPositionWithoutVelocityIsNotExtrapolated() {
+  // Fixture
+  velocity_t vel = {.x = 1.0f, .y = 0.0f, .z = 0.0f};
+  peerLocalizationTellStateAt(7, &pos, &vel, now - 20);
+  tellPosition(7, 1.0f, 2.0f, 3.0f);
+  now += 50;
+  point_t actual;
+
+  // Test
+  peerLocalizationGetPosition(peerLocalizationGetPositionByID(7), &actual);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, actual.x);
+}
+
+void testThatNearestUsesExtrapolatedPositions() {
+  // Fixture
+  tellPosition(1, 1.5f, 0.0f, 0.0f);
+  velocity_t vel = {.x = -10.0f, .y = 0.0f, .z = 0.0f};
+  pos = (positionMeasurement_t){.x = 2.0f, .y = 0.0f, .z = 0.0f};
+  peerLocalizationTellStateAt(2, &pos, &vel, now - 100);
+  point_t center = {.x = 0.0f, .y = 0.0f, .z = 0.0f};
+  peerLocalizationOtherPosition_t const *result[1];
+
+  // Test
+  int actual = peerLocalizationGetNearest(&center, NULL, -1, result, 1, NULL);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, actual);
+  TEST_ASSERT_EQUAL_UINT8(2, result[0]->id);
+}
+
+void testThatNearestRanksByScaledDistance() {
+  // Fixture
+  tellPosition(1, 1.0f, 0.0f, 0.0f);
+  tellPosition(2, 0.0f, 0.0f, 1.5f);
+  point_t center = {.x = 0.0f, .y = 0.0f, .z = 0.0f};
+  struct vec scale = {.x = 0.3f, .y = 0.3f, .z = 0.9f};
+  peerLocalizationOtherPosition_t const *result[1];
+
+  // Test
+  int actual = peerLocalizationGetNearest(&center, &scale, -1, result, 1, NULL);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, actual);
+  TEST_ASSERT_EQUAL_UINT8(2, result[0]->id);
+}
+
+void testThatNearestCountsDroppedPeers() {
+  // Fixture
+  tellPosition(1, 5.0f, 0.0f, 0.0f);
+  tellPosition(2, 1.0f, 0.0f, 0.0f);
+  tellPosition(3, 3.0f, 0.0f, 0.0f);
+  tellPosition(4, 2.0f, 0.0f, 0.0f);
+  point_t center = {.x = 0.0f, .y = 0.0f, .z = 0.0f};
+  peerLocalizationOtherPosition_t const *result[2];
+  int nDropped = -1;
+
+  // Test
+  int actual = peerLocalizationGetNearest(&center, NULL, 1000, result, 2, &nDropped);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, actual);
+  TEST_ASSERT_EQUAL_INT(2, nDropped);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void tellPosition(int id, float x, float y, float z) {
+  pos.x = x;
+  pos.y = y;
+  pos.z = z;
+  peerLocalizationTellPosition(id, &pos);
+}
@@ -2,6 +2,8 @@
 #include "pptraj.h"
 #include "pptraj_compressed.h"
 
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -9,6 +11,10 @@
 
 // #define SHOW_OUTPUT
 
+static struct traj_eval referencePoly4dEval(struct poly4d const *p, float t);
+static void assertFloatIdentical(float expected, float actual);
+static void assertVecEqual(struct vec expected, struct vec actual);
+
 struct poly4d figure8_pieces[] = {
   {
     .p = {
@@ -431,3 +437,104 @@ void testCompressedFigure8RandomOrderQueries(void) {
   printf("Maximum difference = %.4f\n", maxdiff);
 #endif
 }
+
+void testFusedEvaluationMatchesDerivativesExactly(void) {
+  // Fixture
+  const int pieceCount = sizeof(figure8_pieces) / sizeof(figure8_pieces[0]);
+  struct poly4d piece = figure8_pieces[1];
+  // Add a non-zero z and yaw
+  memcpy(piece.p[2], figure8_pieces[2].p[0], sizeof(piece.p[2]));
+  memcpy(piece.p[3], figure8_pieces[3].p[1], sizeof(piece.p[3]));
+
+  for (int n = 0; n < pieceCount; n++) {
+    if (n > 0) {
+      piece = figure8_pieces[n];
+    }
+
+    for (float t = -0.1f; t < piece.duration + 0.1f; t += 0.05f) {
+      // Test
+      float actual[PP_N_DERIVS][4];
+      poly4d_eval_derivs(&piece, t, actual);
+
+      // Assert
+      struct poly4d deriv = piece;
+      for (int k = 0; k < PP_N_DERIVS; k++) {
+        for (int d = 0; d < 4; d++) {
+          assertFloatIdentical(polyval(deriv.p[d], t), actual[k][d]);
+        }
+        polyder4d(&deriv);
+      }
+    }
+  }
+}
+
+void testFusedPoly4dEvalMatchesReference(void) {
+  // Fixture
+  struct poly4d piece = figure8_pieces[4];
+  memcpy(piece.p[2], figure8_pieces[5].p[0], sizeof(piece.p[2]));
+  memcpy(piece.p[3], figure8_pieces[6].p[1], sizeof(piece.p[3]));
+
+  for (float t = 0.0f; t < piece.duration; t += 0.01f) {
+    // Test
+    struct traj_eval actual = poly4d_eval(&piece, t);
+
+    // Assert
+    struct traj_eval expected = referencePoly4dEval(&piece, t);
+    assertVecEqual(expected.pos, actual.pos);
+    assertVecEqual(expected.vel, actual.vel);
+    assertVecEqual(expected.acc, actual.acc);
+    assertVecEqual(expected.jerk, actual.jerk);
+    assertVecEqual(expected.omega, actual.omega);
+    assertFloatIdentical(expected.yaw, actual.yaw);
+  }
+}
+
+// Helpers ////////////////////////////////////////////////
+
+// poly4d_eval() as it was before the fused kernel, differentiates each
+// dimension and evaluates it with polyval()
+static struct traj_eval referencePoly4dEval(struct poly4d const *p, float t) {
+  struct traj_eval out;
+  struct poly4d deriv = *p;
+  out.pos = mkvec(polyval(deriv.p[0], t), polyval(deriv.p[1], t), polyval(deriv.p[2], t));
+  out.yaw = polyval(deriv.p[3], t);
+
+  polyder4d(&deriv);
+  out.vel = mkvec(polyval(deriv.p[0], t), polyval(deriv.p[1], t), polyval(deriv.p[2], t));
+  float dyaw = polyval(deriv.p[3], t);
+
+  polyder4d(&deriv);
+  out.acc = mkvec(polyval(deriv.p[0], t), polyval(deriv.p[1], t), polyval(deriv.p[2], t));
+
+  polyder4d(&deriv);
+  out.jerk = mkvec(polyval(deriv.p[0], t), polyval(deriv.p[1], t), polyval(deriv.p[2], t));
+
+  struct vec thrust = vadd(out.acc, mkvec(0, 0, 9.81f));
+  struct vec z_body = vnormalize(thrust);
+  struct vec x_world = mkvec(cosf(out.yaw), sinf(out.yaw), 0);
+  struct vec y_body = vnormalize(vcross(z_body, x_world));
+  struct vec x_body = vcross(y_body, z_body);
+
+  struct vec jerk_orth_zbody = vorthunit(out.jerk, z_body);
+  struct vec h_w = vscl(1.0f / vmag(thrust), jerk_orth_zbody);
+
+  out.omega.x = -vdot(h_w, y_body);
+  out.omega.y = vdot(h_w, x_body);
+  out.omega.z = z_body.z * dyaw;
+
+  return out;
+}
+
+// Bit exact comparison
+static void assertFloatIdentical(float expected, float actual) {
+  uint32_t expectedBits, actualBits;
+  memcpy(&expectedBits, &expected, sizeof(expectedBits));
+  memcpy(&actualBits, &actual, sizeof(actualBits));
+  TEST_ASSERT_EQUAL_HEX32(expectedBits, actualBits);
+}
+
+static void assertVecEqual(struct vec expected, struct vec actual) {
+  assertFloatIdentical(expected.x, actual.x);
+  assertFloatIdentical(expected.y, actual.y);
+  assertFloatIdentical(expected.z, actual.z);
+}
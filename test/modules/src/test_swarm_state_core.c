@@ -0,0 +1,238 @@
+// File under test swarm_state_core.c
+#include "swarm_state_core.h"
+
+#include <string.h>
+#include "unity.h"
+#include "peer_localization.h"
+#include "mock_statsCnt.h"
+
+#define PERIOD_US 100000
+#define SLOT_COUNT 10
+
+// Dummy mocks timer
+static uint32_t now = 0;
+uint32_t xTaskGetTickCount() {return now;}
+
+static swarmStateCore_t coreA;
+static swarmStateCore_t coreB;
+static swarmStateCore_t coreC;
+static swarmPeerState_t ownState;
+static swarmStatePacket_t packet;
+
+static size_t sendFrom(swarmStateCore_t* from, const uint64_t nowUs);
+static void setOwnState(float x, float y, float z);
+
+void setUp(void) {
+  // Peer localization keeps its table between tests, start each test well after the previous one
+  now += 100000;
+
+  swarmStateCoreInit(&coreA, 2);
+  swarmStateCoreInit(&coreB, 5);
+  swarmStateCoreInit(&coreC, 3);
+  memset(&packet, 0, sizeof(packet));
+  setOwnState(1.0f, 2.0f, 0.5f);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatStateIsQuantizedInThePacket() {
+  // Fixture
+  ownState.vel.x = -0.25f;
+  ownState.yaw = 1.5f;
+  ownState.status = SWARM_STATE_STATUS_FLYING;
+  size_t size = sendFrom(&coreA, 0);
+
+  // Test
+  bool actual = swarmStateCoreHandlePacket(&coreB, &packet, size, 0, now, PERIOD_US);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  swarmPeerState_t state;
+  TEST_ASSERT_TRUE(swarmStateCoreGetPeer(&coreB, 2, &state));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, state.pos.x);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 2.0f, state.pos.y);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, state.pos.z);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, -0.25f, state.vel.x);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001f, 1.5f, state.yaw);
+  TEST_ASSERT_EQUAL_UINT8(SWARM_STATE_STATUS_FLYING, state.status);
+}
+
+void testThatReceivedPositionIsAddedToPeerLocalization() {
+  // Fixture
+  size_t size = sendFrom(&coreA, 0);
+
+  // Test
+  swarmStateCoreHandlePacket(&coreB, &packet, size, 0, now, PERIOD_US);
+
+  // Assert
+  peerLocalizationOtherPosition_t* actual = peerLocalizationGetPositionByID(2);
+  TEST_ASSERT_NOT_NULL(actual);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 2.0f, actual->pos.y);
+  TEST_ASSERT_EQUAL_UINT32(now, actual->pos.timestamp);
+}
+
+void testThatInvalidPacketIsRejected() {
+  // Fixture
+  size_t size = sendFrom(&coreA, 0);
+  packet.header.count = SWARM_STATE_MAX_ENTRIES + 1;
+
+  // Test
+  bool actual = swarmStateCoreHandlePacket(&coreB, &packet, size, 0, now, PERIOD_US);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatClockIsSynchronizedToLowerId() {
+  // Fixture
+  coreA.clockOffsetUs = 30000;
+  const uint64_t nowUs = 1234567;
+  size_t size = sendFrom(&coreA, nowUs);
+
+  // Test
+  swarmStateCoreHandlePacket(&coreB, &packet, size, nowUs, now, PERIOD_US);
+
+  // Assert
+  const uint32_t expected = swarmStateCoreFramePhaseUs(&coreA, nowUs, PERIOD_US);
+  const uint32_t actual = swarmStateCoreFramePhaseUs(&coreB, nowUs, PERIOD_US);
+  TEST_ASSERT_UINT32_WITHIN(SWARM_STATE_PHASE_UNIT_US, expected, actual);
+  TEST_ASSERT_EQUAL_UINT8(2, coreB.referenceId);
+}
+
+void testThatClockIsNotSynchronizedToHigherId() {
+  // Fixture
+  coreB.clockOffsetUs = 30000;
+  size_t size = sendFrom(&coreB, 1234567);
+
+  // Test
+  swarmStateCoreHandlePacket(&coreA, &packet, size, 1234567, now, PERIOD_US);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(0, coreA.clockOffsetUs);
+  TEST_ASSERT_EQUAL_UINT8(0, coreA.referenceId);
+}
+
+void testThatClockIsSynchronizedWithTheLongestPeriod() {
+  // Fixture
+  const uint32_t periodUs = SWARM_STATE_MAX_PERIOD_MS * 1000;
+  coreA.clockOffsetUs = periodUs - 1000;
+  const uint64_t nowUs = 1234567;
+  ownState.pos.timestamp = now;
+  ownState.vel.timestamp = now;
+  size_t size = swarmStateCoreBuildPacket(&coreA, &ownState, nowUs, now, periodUs, &packet);
+
+  // Test
+  swarmStateCoreHandlePacket(&coreB, &packet, size, nowUs, now, periodUs);
+
+  // Assert
+  const uint32_t expected = swarmStateCoreFramePhaseUs(&coreA, nowUs, periodUs);
+  const uint32_t actual = swarmStateCoreFramePhaseUs(&coreB, nowUs, periodUs);
+  TEST_ASSERT_UINT32_WITHIN(SWARM_STATE_PHASE_UNIT_US, expected, actual);
+}
+
+void testThatOnlyOneCrazyflieSendsAtATime() {
+  // Fixture
+  swarmStateCore_t cores[SLOT_COUNT];
+  for (int i = 0; i < SLOT_COUNT; i++) {
+    swarmStateCoreInit(&cores[i], i + 1);
+  }
+
+  // Test
+  // Assert
+  for (uint64_t t = 0; t < 2 * PERIOD_US; t += 100) {
+    int sending = 0;
+    for (int i = 0; i < SLOT_COUNT; i++) {
+      if (swarmStateCoreTimeToSlotUs(&cores[i], t, PERIOD_US, SLOT_COUNT) == 0) {
+        sending++;
+      }
+    }
+    TEST_ASSERT_TRUE(sending <= 1);
+  }
+}
+
+void testThatTimeToSlotIsUntilTheStartOfTheSlot() {
+  // Fixture
+  // Slot of id 2 starts at 20 ms
+
+  // Test
+  uint32_t actual = swarmStateCoreTimeToSlotUs(&coreA, 5000, PERIOD_US, SLOT_COUNT);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(15000, actual);
+}
+
+void testThatLostPacketsAreCounted() {
+  // Fixture
+  size_t size = sendFrom(&coreA, 0);
+  swarmStateCoreHandlePacket(&coreB, &packet, size, 0, now, PERIOD_US);
+
+  // Test
+  now += 100;
+  sendFrom(&coreA, 0);
+  sendFrom(&coreA, 0);
+  now += 100;
+  size = sendFrom(&coreA, 0);
+  swarmStateCoreHandlePacket(&coreB, &packet, size, 0, now, PERIOD_US);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(2, coreB.receivedCount);
+  TEST_ASSERT_EQUAL_UINT32(2, coreB.lostCount);
+}
+
+void testThatHeardPeersAreRelayed() {
+  // Fixture
+  size_t size = sendFrom(&coreA, 0);
+  swarmStateCoreHandlePacket(&coreC, &packet, size, 0, now, PERIOD_US);
+
+  // Test
+  now += 20;
+  setOwnState(-1.0f, 0.0f, 0.0f);
+  size = sendFrom(&coreC, 0);
+  swarmStateCoreHandlePacket(&coreB, &packet, size, 0, now, PERIOD_US);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(2, packet.header.count);
+  swarmPeerState_t state;
+  TEST_ASSERT_TRUE(swarmStateCoreGetPeer(&coreB, 2, &state));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, state.pos.x);
+  TEST_ASSERT_EQUAL_UINT32(now - 20, state.pos.timestamp);
+  TEST_ASSERT_TRUE(swarmStateCoreGetPeer(&coreB, 3, &state));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, -1.0f, state.pos.x);
+}
+
+void testThatRelayedStateDoesNotReplaceNewerState() {
+  // Fixture
+  size_t size = sendFrom(&coreA, 0);
+  swarmStateCoreHandlePacket(&coreC, &packet, size, 0, now, PERIOD_US);
+  now += 20;
+  setOwnState(4.0f, 0.0f, 0.0f);
+  size = sendFrom(&coreA, 0);
+  swarmStateCoreHandlePacket(&coreB, &packet, size, 0, now, PERIOD_US);
+
+  // Test
+  now += 20;
+  size = sendFrom(&coreC, 0);
+  swarmStateCoreHandlePacket(&coreB, &packet, size, 0, now, PERIOD_US);
+
+  // Assert
+  swarmPeerState_t state;
+  TEST_ASSERT_TRUE(swarmStateCoreGetPeer(&coreB, 2, &state));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 4.0f, state.pos.x);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static size_t sendFrom(swarmStateCore_t* from, const uint64_t nowUs) {
+  ownState.pos.timestamp = now;
+  ownState.vel.timestamp = now;
+  return swarmStateCoreBuildPacket(from, &ownState, nowUs, now, PERIOD_US, &packet);
+}
+
+static void setOwnState(float x, float y, float z) {
+  memset(&ownState, 0, sizeof(ownState));
+  ownState.pos.x = x;
+  ownState.pos.y = y;
+  ownState.pos.z = z;
+}
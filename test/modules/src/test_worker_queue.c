@@ -0,0 +1,162 @@
+// File under test worker_queue.c
+#include "worker_queue.h"
+
+#include <errno.h>
+#include <string.h>
+#include "unity.h"
+
+static workerQueue_t queue;
+static workerJob_t job;
+
+static void functionA(void* arg);
+static void functionB(void* arg);
+static void functionC(void* arg);
+
+void setUp(void) {
+  workerQueueInit(&queue);
+  memset(&job, 0, sizeof(job));
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatEmptyQueueHasNothingToRun() {
+  // Fixture
+  // Test
+  const bool actual = workerQueueTake(&queue, 100, &job);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_UINT32(WORKER_QUEUE_WAIT_FOREVER, workerQueueTimeToNextMs(&queue, 100));
+}
+
+void testThatJobsWithTheSamePriorityAreRunFirstInFirstOut() {
+  // Fixture
+  workerQueueAdd(&queue, functionC, 0, workerPriorityNormal, 0, 100);
+  workerQueueAdd(&queue, functionA, 0, workerPriorityNormal, 0, 100);
+  workerQueueAdd(&queue, functionB, 0, workerPriorityNormal, 0, 100);
+
+  // Test
+  // Assert
+  TEST_ASSERT_TRUE(workerQueueTake(&queue, 100, &job));
+  TEST_ASSERT_EQUAL_PTR(functionC, job.function);
+  TEST_ASSERT_TRUE(workerQueueTake(&queue, 100, &job));
+  TEST_ASSERT_EQUAL_PTR(functionA, job.function);
+  TEST_ASSERT_TRUE(workerQueueTake(&queue, 100, &job));
+  TEST_ASSERT_EQUAL_PTR(functionB, job.function);
+  TEST_ASSERT_FALSE(workerQueueTake(&queue, 100, &job));
+}
+
+void testThatHigherPriorityJobIsRunFirst() {
+  // Fixture
+  workerQueueAdd(&queue, functionA, 0, workerPriorityLow, 0, 100);
+  workerQueueAdd(&queue, functionB, 0, workerPriorityNormal, 0, 100);
+  workerQueueAdd(&queue, functionC, 0, workerPriorityHigh, 0, 100);
+
+  // Test
+  // Assert
+  TEST_ASSERT_TRUE(workerQueueTake(&queue, 100, &job));
+  TEST_ASSERT_EQUAL_PTR(functionC, job.function);
+  TEST_ASSERT_TRUE(workerQueueTake(&queue, 100, &job));
+  TEST_ASSERT_EQUAL_PTR(functionB, job.function);
+  TEST_ASSERT_TRUE(workerQueueTake(&queue, 100, &job));
+  TEST_ASSERT_EQUAL_PTR(functionA, job.function);
+}
+
+void testThatDelayedJobIsNotRunBeforeItIsDue() {
+  // Fixture
+  workerQueueAdd(&queue, functionA, 0, workerPriorityHigh, 50, 100);
+  workerQueueAdd(&queue, functionB, 0, workerPriorityLow, 0, 100);
+
+  // Test
+  // Assert
+  TEST_ASSERT_TRUE(workerQueueTake(&queue, 120, &job));
+  TEST_ASSERT_EQUAL_PTR(functionB, job.function);
+  TEST_ASSERT_FALSE(workerQueueTake(&queue, 120, &job));
+  TEST_ASSERT_EQUAL_UINT32(30, workerQueueTimeToNextMs(&queue, 120));
+  TEST_ASSERT_TRUE(workerQueueTake(&queue, 150, &job));
+  TEST_ASSERT_EQUAL_PTR(functionA, job.function);
+}
+
+void testThatDelayIsHandledWhenTheTimeWrapsAround() {
+  // Fixture
+  const uint32_t nowMs = UINT32_MAX - 10;
+  workerQueueAdd(&queue, functionA, 0, workerPriorityNormal, 20, nowMs);
+
+  // Test
+  // Assert
+  TEST_ASSERT_FALSE(workerQueueTake(&queue, nowMs + 5, &job));
+  TEST_ASSERT_EQUAL_UINT32(15, workerQueueTimeToNextMs(&queue, nowMs + 5));
+  TEST_ASSERT_TRUE(workerQueueTake(&queue, nowMs + 20, &job));
+}
+
+void testThatIdenticalJobsAreCoalesced() {
+  // Fixture
+  int arg = 0;
+  workerQueueAdd(&queue, functionA, &arg, workerPriorityLow, 100, 100);
+
+  // Test
+  workerQueueAdd(&queue, functionA, &arg, workerPriorityNormal, 200, 110);
+  workerQueueAdd(&queue, functionA, &arg, workerPriorityLow, 10, 120);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(2, queue.coalescedCount);
+  TEST_ASSERT_TRUE(workerQueueTake(&queue, 130, &job));
+  TEST_ASSERT_EQUAL_PTR(functionA, job.function);
+  TEST_ASSERT_EQUAL_PTR(&arg, job.arg);
+  TEST_ASSERT_EQUAL_INT(workerPriorityNormal, job.priority);
+  TEST_ASSERT_FALSE(workerQueueTake(&queue, 1000, &job));
+}
+
+void testThatJobsWithDifferentArgumentsAreNotCoalesced() {
+  // Fixture
+  int arg1 = 0;
+  int arg2 = 0;
+
+  // Test
+  workerQueueAdd(&queue, functionA, &arg1, workerPriorityNormal, 0, 100);
+  workerQueueAdd(&queue, functionA, &arg2, workerPriorityNormal, 0, 100);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(0, queue.coalescedCount);
+  TEST_ASSERT_TRUE(workerQueueTake(&queue, 100, &job));
+  TEST_ASSERT_EQUAL_PTR(&arg1, job.arg);
+  TEST_ASSERT_TRUE(workerQueueTake(&queue, 100, &job));
+  TEST_ASSERT_EQUAL_PTR(&arg2, job.arg);
+}
+
+void testThatJobIsDroppedWhenTheQueueIsFull() {
+  // Fixture
+  static int args[WORKER_QUEUE_LENGTH];
+  for (int i = 0; i < WORKER_QUEUE_LENGTH; i++) {
+    TEST_ASSERT_EQUAL_INT(0, workerQueueAdd(&queue, functionA, &args[i], workerPriorityNormal, 0, 100));
+  }
+
+  // Test
+  const int actual = workerQueueAdd(&queue, functionB, 0, workerPriorityHigh, 0, 100);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(ENOMEM, actual);
+  TEST_ASSERT_EQUAL_UINT32(1, queue.droppedCount);
+}
+
+void testThatJobCanBeScheduledAgainAfterItHasBeenTaken() {
+  // Fixture
+  workerQueueAdd(&queue, functionA, 0, workerPriorityNormal, 0, 100);
+  workerQueueTake(&queue, 100, &job);
+
+  // Test
+  workerQueueAdd(&queue, functionA, 0, workerPriorityNormal, 0, 110);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(0, queue.coalescedCount);
+  TEST_ASSERT_TRUE(workerQueueTake(&queue, 110, &job));
+  TEST_ASSERT_EQUAL_UINT32(110, job.scheduledMs);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void functionA(void* arg) {}
+static void functionB(void* arg) {}
+static void functionC(void* arg) {}
@@ -0,0 +1,58 @@
+// clock_gettime() is not part of C11
+#define _POSIX_C_SOURCE 199309L
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define WARM_UP_SAMPLES 10
+
+static double nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compareDouble(const void* a, const void* b) {
+  const double da = *(const double*)a;
+  const double db = *(const double*)b;
+  return (da > db) - (da < db);
+}
+
+static double sample(benchFunction_t setup, benchFunction_t function, void* context, const int batch) {
+  if (setup) {
+    setup(context);
+  }
+
+  const double start = nowNs();
+  for (int i = 0; i < batch; i++) {
+    function(context);
+  }
+  return (nowNs() - start) / batch;
+}
+
+benchResult_t benchRun(const char* name, benchFunction_t setup, benchFunction_t function, void* context, const int samples, const int batch) {
+  benchResult_t result = {.samples = samples, .batch = batch};
+  double* times = malloc(sizeof(double) * samples);
+
+  for (int i = 0; i < WARM_UP_SAMPLES; i++) {
+    sample(setup, function, context, batch);
+  }
+
+  for (int i = 0; i < samples; i++) {
+    times[i] = sample(setup, function, context, batch);
+  }
+
+  qsort(times, samples, sizeof(double), compareDouble);
+  result.minNs = times[0];
+  result.medianNs = times[samples / 2];
+  result.p99Ns = times[(samples * 99 - 1) / 100];
+  free(times);
+
+  printf(BENCH_PREFIX "{\"name\": \"%s\", \"samples\": %d, \"batch\": %d, \"min_ns\": %.1f, \"median_ns\": %.1f, \"p99_ns\": %.1f}\n",
+    name, result.samples, result.batch, result.minNs, result.medianNs, result.p99Ns);
+
+  return result;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Timing of functions in the benchmarks, the bench_*.c files that are run
+// with `make bench`. The result of every benchmark is printed as a line
+// starting with BENCH_PREFIX followed by a JSON object, which is collected by
+// the rake bench task.
+
+#define BENCH_PREFIX "BENCH "
+#define BENCH_DEFAULT_SAMPLES 1000
+
+typedef void (*benchFunction_t)(void* context);
+
+typedef struct {
+  int samples;
+  int batch;
+
+  // Time per call of the measured function in nano seconds
+  double minNs;
+  double medianNs;
+  double p99Ns;
+} benchResult_t;
+
+/**
+ * @brief Time a function. Every sample times batch calls of the function,
+ * after a call to setup that is not included in the time. The function is
+ * called a number of times before the samples are taken to warm up caches.
+ *
+ * @param name Name of the benchmark in the results
+ * @param setup Called before each sample, may be 0
+ * @param function The function to time
+ * @param context Passed to setup and function
+ * @param samples The number of samples
+ * @param batch The number of calls per sample, use more than one for functions that are too fast for the clock
+ * @return benchResult_t The timing, also printed
+ */
+benchResult_t benchRun(const char* name, benchFunction_t setup, benchFunction_t function, void* context, const int samples, const int batch);
@@ -0,0 +1,91 @@
+// File under benchmark kve.c
+#include "kve/kve.h"
+#include "kve/kve_storage.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "bench.h"
+
+#define KVE_PARTITION_LENGTH (7*1024)
+#define KEY_COUNT 100
+
+static uint8_t kveData[KVE_PARTITION_LENGTH];
+static char keys[KEY_COUNT][24];
+static int keyNr;
+static int foundCount;
+
+static void fetch(void* context);
+
+static size_t read(size_t address, void* data, size_t length)
+{
+  if ((length == 0) || (address + length > KVE_PARTITION_LENGTH)) {
+    return 0;
+  }
+
+  memcpy(data, &kveData[address], length);
+
+  return length;
+}
+
+static size_t write(size_t address, const void* data, size_t length)
+{
+  if ((length == 0) || (address + length > KVE_PARTITION_LENGTH)) {
+    return 0;
+  }
+
+  memcpy(&kveData[address], data, length);
+
+  return length;
+}
+
+static void flush(void)
+{
+  // Not valid for RAM memory implementation.
+}
+
+static kveMemory_t kve = {
+  .memorySize = KVE_PARTITION_LENGTH,
+  .read = read,
+  .write = write,
+  .flush = flush,
+};
+
+void setUp(void) {
+  // Stored parameters, as written by the param system
+  kveFormat(&kve);
+  for (int i = 0; i < KEY_COUNT; i++) {
+    snprintf(keys[i], sizeof(keys[i]), "prm/group%d.param%d", i / 10, i % 10);
+    const float value = (float)i;
+    kveStore(&kve, keys[i], &value, sizeof(value));
+  }
+
+  keyNr = 0;
+  foundCount = 0;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testBenchmarkFetch() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("kveFetch", 0, fetch, 0, BENCH_DEFAULT_SAMPLES, KEY_COUNT);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  TEST_ASSERT_EQUAL_INT(keyNr, foundCount);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+// Fetches all keys in turn, the mean time is the time of a lookup half way
+// into the storage
+static void fetch(void* context) {
+  float value;
+  if (kveFetch(&kve, keys[keyNr % KEY_COUNT], &value, sizeof(value)) == sizeof(value)) {
+    foundCount++;
+  }
+  keyNr++;
+}
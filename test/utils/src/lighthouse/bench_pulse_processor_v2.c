@@ -0,0 +1,93 @@
+// @IGNORE_IF_NOT CONFIG_DECK_LIGHTHOUSE
+
+// File under benchmark pulse_processor_v2.c
+#include "pulse_processor_v2.h"
+
+#include <string.h>
+#include "unity.h"
+#include "bench.h"
+
+#include "mock_ootx_decoder.h"
+#include "mock_lighthouse_calibration.h"
+#include "mock_usec_time.h"
+#include "mock_pulse_processor.h"
+
+#define TIMESTAMP_MASK 0x00ffffff
+
+// Recorded frames from one V2 base station on channel 0, two revolutions. The
+// sequence is repeated with the timestamps moved by the length of the recording.
+static const pulseProcessorFrame_t recording[] = {
+  {.sensor = 0, .timestamp = 2156620, .offset = 0,      .channel = 0, .channelFound = false},
+  {.sensor = 2, .timestamp = 2156972, .offset = 165916, .channel = 0, .channelFound = true},
+  {.sensor = 1, .timestamp = 2157193, .offset = 0,      .channel = 0, .channelFound = true},
+  {.sensor = 3, .timestamp = 2157561, .offset = 0,      .channel = 0, .channelFound = true},
+  {.sensor = 2, .timestamp = 2290186, .offset = 0,      .channel = 0, .channelFound = false},
+  {.sensor = 0, .timestamp = 2290608, .offset = 299556, .channel = 0, .channelFound = true},
+  {.sensor = 3, .timestamp = 2290750, .offset = 0,      .channel = 0, .channelFound = true},
+  {.sensor = 1, .timestamp = 2291154, .offset = 0,      .channel = 0, .channelFound = true},
+  {.sensor = 0, .timestamp = 2635114, .offset = 0,      .channel = 0, .channelFound = false},
+  {.sensor = 2, .timestamp = 2635466, .offset = 165920, .channel = 0, .channelFound = true},
+  {.sensor = 1, .timestamp = 2635687, .offset = 0,      .channel = 0, .channelFound = true},
+  {.sensor = 3, .timestamp = 2636051, .offset = 0,      .channel = 0, .channelFound = true},
+  {.sensor = 2, .timestamp = 2768686, .offset = 0,      .channel = 0, .channelFound = false},
+  {.sensor = 0, .timestamp = 2769102, .offset = 299556, .channel = 0, .channelFound = true},
+  {.sensor = 3, .timestamp = 2769244, .offset = 0,      .channel = 0, .channelFound = true},
+  {.sensor = 1, .timestamp = 2769648, .offset = 0,      .channel = 0, .channelFound = true},
+};
+static const int recordingLength = sizeof(recording) / sizeof(recording[0]);
+static const uint32_t recordingDuration = 2 * (2635114 - 2156620);
+
+static pulseProcessor_t state;
+static pulseProcessorResult_t angles;
+static int frameNr;
+static int anglesCount;
+
+static void processPulse(void* context);
+static uint64_t fakeUsecTimestamp(int cmock_num_calls);
+
+void setUp(void) {
+  memset(&state, 0, sizeof(state));
+  memset(&angles, 0, sizeof(angles));
+  frameNr = 0;
+  anglesCount = 0;
+
+  ootxDecoderProcessBit_IgnoreAndReturn(false);
+  usecTimestamp_StubWithCallback(fakeUsecTimestamp);
+  pulseProcessorClear_Ignore();
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testBenchmarkProcessPulse() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("pulseProcessorV2ProcessPulse", 0, processPulse, 0, BENCH_DEFAULT_SAMPLES, recordingLength);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  TEST_ASSERT_TRUE(anglesCount > 0);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void processPulse(void* context) {
+  const uint32_t repetition = frameNr / recordingLength;
+  pulseProcessorFrame_t frame = recording[frameNr % recordingLength];
+  frame.timestamp = (frame.timestamp + repetition * recordingDuration) & TIMESTAMP_MASK;
+  frameNr++;
+
+  int baseStation;
+  int axis;
+  bool calibDataIsDecoded;
+  if (pulseProcessorV2ProcessPulse(&state, &frame, &angles, &baseStation, &axis, &calibDataIsDecoded)) {
+    anglesCount++;
+  }
+}
+
+// The time of the frames, the timestamps are in a 24 MHz clock
+static uint64_t fakeUsecTimestamp(int cmock_num_calls) {
+  const uint32_t repetition = frameNr / recordingLength;
+  return ((uint64_t)recording[frameNr % recordingLength].timestamp + (uint64_t)repetition * recordingDuration) / 24;
+}
@@ -0,0 +1,178 @@
+// File under benchmark tdoaEngine.c
+#include "tdoaEngine.h"
+
+#include <math.h>
+#include <string.h>
+#include "unity.h"
+#include "bench.h"
+
+#include "tdoaStorage.h"
+#include "tdoaStats.h"
+#include "clockCorrectionEngine.h"
+#include "physicalConstants.h"
+#include "mock_statsCnt.h"
+
+#define TS_FREQ (499.2e6 * 128)
+#define ANCHOR_TS_MASK 0xFFFFFFFFll
+#define TAG_TS_MASK 0xFFFFFFFFFFll
+
+#define MAX_ANCHOR_COUNT 32
+#define REMOTE_COUNT 7
+#define PACKET_INTERVAL_MS 1
+
+static tdoaEngineState_t engineState;
+
+// A noise free TDoA3 system, anchors in the corners of 4 x 4 x 3 m rooms in a row
+static struct {
+  int anchorCount;
+  point_t anchorPos[MAX_ANCHOR_COUNT];
+  int64_t anchorClockOffset[MAX_ANCHOR_COUNT];
+  uint8_t anchorSeqNr[MAX_ANCHOR_COUNT];
+  int64_t anchorTxTime[MAX_ANCHOR_COUNT];
+  point_t tagPos;
+  int64_t tagClockOffset;
+  int packetNr;
+
+  // The packet to process
+  tdoaAnchorContext_t anchorCtx;
+  int64_t txAn_in_cl_An;
+  int64_t rxAn_by_T_in_cl_T;
+  bool isPending;
+} sim;
+
+static int measurementCount;
+
+static void initAnchors(const int anchorCount);
+static void preparePacket(void* context);
+static void processPacket(void* context);
+static void tdoaMeasurementReceived(tdoaMeasurement_t* tdoa);
+static int64_t flightTime(const point_t* a, const point_t* b);
+
+void setUp(void) {
+  statsCntRateLoggerInit_Ignore();
+  tdoaEngineInit(&engineState, 0, tdoaMeasurementReceived, TS_FREQ, TdoaEngineMatchingAlgorithmRandom);
+
+  memset(&sim, 0, sizeof(sim));
+  initAnchors(8);
+  sim.tagPos.x = 1.1f;
+  sim.tagPos.y = 2.3f;
+  sim.tagPos.z = 1.2f;
+  sim.tagClockOffset = 987654321ll;
+
+  measurementCount = 0;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testBenchmarkProcessPacketFiltered() {
+  // Fixture
+  // Test
+  benchResult_t actual = benchRun("tdoaEngineProcessPacketFiltered", preparePacket, processPacket, 0, 10 * BENCH_DEFAULT_SAMPLES, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  TEST_ASSERT_TRUE(measurementCount > 9 * BENCH_DEFAULT_SAMPLES);
+}
+
+void testBenchmarkProcessPacketFilteredBestPair() {
+  // Fixture
+  engineState.matchingAlgorithm = TdoaEngineMatchingAlgorithmBestPair;
+  tdoaEngineSetPositionEstimate(&engineState, &sim.tagPos);
+
+  // Test
+  benchResult_t actual = benchRun("tdoaEngineProcessPacketFilteredBestPair", preparePacket, processPacket, 0, 10 * BENCH_DEFAULT_SAMPLES, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  TEST_ASSERT_TRUE(measurementCount > 9 * BENCH_DEFAULT_SAMPLES);
+}
+
+void testBenchmarkProcessPacketFilteredBestPairWith3MeasurementsPerPacket() {
+  // Fixture
+  engineState.matchingAlgorithm = TdoaEngineMatchingAlgorithmBestPair;
+  engineState.measurementsPerPacket = 3;
+  tdoaEngineSetPositionEstimate(&engineState, &sim.tagPos);
+
+  // Test
+  benchResult_t actual = benchRun("tdoaEngineProcessPacketFilteredBestPair3", preparePacket, processPacket, 0, 10 * BENCH_DEFAULT_SAMPLES, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  TEST_ASSERT_TRUE(measurementCount > 2 * 9 * BENCH_DEFAULT_SAMPLES);
+}
+
+// More anchors than fit in the storage with the default configuration, the
+// time includes the eviction of anchor contexts
+void testBenchmarkProcessPacketFilteredWith32Anchors() {
+  // Fixture
+  initAnchors(32);
+
+  // Test
+  benchResult_t actual = benchRun("tdoaEngineProcessPacketFiltered32Anchors", preparePacket, processPacket, 0, 10 * BENCH_DEFAULT_SAMPLES, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.medianNs > 0.0);
+  if (ANCHOR_STORAGE_COUNT >= 32) {
+    TEST_ASSERT_TRUE(measurementCount > 9 * BENCH_DEFAULT_SAMPLES);
+  }
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void initAnchors(const int anchorCount) {
+  sim.anchorCount = anchorCount;
+  for (int i = 0; i < anchorCount; i++) {
+    sim.anchorPos[i].x = 4.0f * (i & 1) + 6.0f * (i >> 3);
+    sim.anchorPos[i].y = 4.0f * ((i >> 1) & 1);
+    sim.anchorPos[i].z = 3.0f * ((i >> 2) & 1);
+    sim.anchorClockOffset[i] = 123456789ll * (i + 1);
+  }
+}
+
+// Stores the data of the previous packet, as the TDoA3 tag does after
+// processing, and sets up the context for the next packet
+static void preparePacket(void* context) {
+  if (sim.isPending) {
+    tdoaStorageSetRxTxData(&sim.anchorCtx, sim.rxAn_by_T_in_cl_T, sim.txAn_in_cl_An, sim.anchorSeqNr[sim.anchorCtx.anchorInfo->id]);
+    const point_t* pos = &sim.anchorPos[sim.anchorCtx.anchorInfo->id];
+    tdoaStorageSetAnchorPosition(&sim.anchorCtx, pos->x, pos->y, pos->z);
+    sim.anchorSeqNr[sim.anchorCtx.anchorInfo->id] = (sim.anchorSeqNr[sim.anchorCtx.anchorInfo->id] + 1) & 0x7f;
+  }
+
+  const uint8_t anchorId = sim.packetNr % sim.anchorCount;
+  const int64_t txTime = (int64_t)(sim.packetNr + 1) * PACKET_INTERVAL_MS * (int64_t)(TS_FREQ / 1000);
+  const uint32_t now_ms = (sim.packetNr + 1) * PACKET_INTERVAL_MS;
+  const point_t* anchorPos = &sim.anchorPos[anchorId];
+
+  tdoaEngineGetAnchorCtxForPacketProcessing(&engineState, anchorId, now_ms, &sim.anchorCtx);
+  for (int i = 1; i <= REMOTE_COUNT && i <= sim.packetNr; i++) {
+    const uint8_t remoteId = (anchorId + sim.anchorCount - i) % sim.anchorCount;
+    const int64_t tof = flightTime(&sim.anchorPos[remoteId], anchorPos);
+    const int64_t remoteRxTime = (sim.anchorTxTime[remoteId] + tof + sim.anchorClockOffset[anchorId]) & ANCHOR_TS_MASK;
+    tdoaStorageSetRemoteRxTime(&sim.anchorCtx, remoteId, remoteRxTime, (sim.anchorSeqNr[remoteId] - 1) & 0x7f);
+    tdoaStorageSetRemoteTimeOfFlight(&sim.anchorCtx, remoteId, tof);
+  }
+
+  sim.txAn_in_cl_An = (txTime + sim.anchorClockOffset[anchorId]) & ANCHOR_TS_MASK;
+  sim.rxAn_by_T_in_cl_T = (txTime + flightTime(anchorPos, &sim.tagPos) + sim.tagClockOffset) & TAG_TS_MASK;
+  sim.anchorTxTime[anchorId] = txTime;
+  sim.isPending = true;
+  sim.packetNr++;
+}
+
+static void processPacket(void* context) {
+  tdoaEngineProcessPacketFiltered(&engineState, &sim.anchorCtx, sim.txAn_in_cl_An, sim.rxAn_by_T_in_cl_T, false, 0);
+}
+
+static void tdoaMeasurementReceived(tdoaMeasurement_t* tdoa) {
+  measurementCount++;
+}
+
+static int64_t flightTime(const point_t* a, const point_t* b) {
+  const double dx = a->x - b->x;
+  const double dy = a->y - b->y;
+  const double dz = a->z - b->z;
+  return (int64_t)(sqrt(dx * dx + dy * dy + dz * dz) / SPEED_OF_LIGHT * TS_FREQ + 0.5);
+}
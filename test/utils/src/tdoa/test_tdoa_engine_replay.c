@@ -0,0 +1,424 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * test_tdoa_engine_replay.c - Replays a simulated TDoA3 packet stream
+ * through the tdoa engine and checks the quality of the generated
+ * measurements
+ */
+
+// File under test
+#include "tdoaEngine.h"
+
+#include "unity.h"
+
+#include <string.h>
+#include <math.h>
+#include "tdoaStorage.h"
+#include "tdoaStats.h"
+#include "clockCorrectionEngine.h"
+#include "physicalConstants.h"
+#include "mock_statsCnt.h"
+
+#define TS_FREQ (499.2e6 * 128)
+#define ANCHOR_TS_MASK 0xFFFFFFFFll
+#define TAG_TS_MASK 0xFFFFFFFFFFll
+
+#define MAX_ANCHORS 32
+#define REMOTE_COUNT 8
+#define PACKET_INTERVAL_MS 1
+
+static tdoaEngineState_t engineState;
+
+// Simulation of the system
+static struct {
+  int anchorCount;
+  point_t anchorPos[MAX_ANCHORS];
+  int64_t anchorClockOffset[MAX_ANCHORS];
+  uint8_t anchorSeqNr[MAX_ANCHORS];
+  point_t tagPos;
+  int64_t tagClockOffset;
+  double noiseStdDevTicks;
+  uint32_t randomState;
+
+  // The latest packets on air, used as remote data in the next packet
+  struct {
+    uint8_t id;
+    uint8_t seqNr;
+    int64_t txTime;
+  } history[REMOTE_COUNT];
+  int historyCount;
+
+  int packetNr;
+} sim;
+
+// Simple position only EKF, used to check the accuracy of the matching algorithms
+static struct {
+  bool isEnabled;
+  double p[3];
+  double P[3][3];
+} filter;
+
+static int measurementCount;
+static int badMeasurementCount;
+static double geometrySum;
+
+static void initSimulation(const int anchorCount);
+static void replayPacket();
+static void tdoaMeasurementReceived(tdoaMeasurement_t* tdoa);
+static uint32_t contextMissCount();
+static void initFilter();
+static double filterError();
+static void replayWithAlgorithm(const tdoaEngineMatchingAlgorithm_t algorithm, const int measurementsPerPacket, const int packetCount, double* error, double* measurementsPerPacketResult);
+
+
+void setUp(void) {
+  statsCntRateLoggerInit_Ignore();
+
+  measurementCount = 0;
+  badMeasurementCount = 0;
+  geometrySum = 0.0;
+  filter.isEnabled = false;
+  tdoaEngineInit(&engineState, 0, tdoaMeasurementReceived, TS_FREQ, TdoaEngineMatchingAlgorithmRandom);
+}
+
+void testThatReplayedPacketsFromAnchorsThatFitInStorageGenerateCorrectMeasurements() {
+  // Fixture
+  const int anchorCount = ANCHOR_STORAGE_COUNT;
+  initSimulation(anchorCount);
+
+  // Test
+  for (int i = 0; i < 100 * anchorCount; i++) {
+    replayPacket();
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(anchorCount, contextMissCount());
+  TEST_ASSERT_EQUAL_INT(0, badMeasurementCount);
+  TEST_ASSERT_TRUE(measurementCount > 90 * anchorCount);
+}
+
+void testThatReplayedPacketsFrom32AnchorsGenerateCorrectMeasurements() {
+  // Fixture
+  const int anchorCount = 32;
+  initSimulation(anchorCount);
+
+  // Test
+  for (int i = 0; i < 100 * anchorCount; i++) {
+    replayPacket();
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, badMeasurementCount);
+  if (ANCHOR_STORAGE_COUNT >= anchorCount) {
+    TEST_ASSERT_EQUAL_UINT32(anchorCount, contextMissCount());
+    TEST_ASSERT_TRUE(measurementCount > 90 * anchorCount);
+  } else {
+    // The anchors are heard in turn, so the least recently used context that
+    // is evicted always belongs to the next anchor. Every packet misses and
+    // no anchor has the history needed for a measurement.
+    TEST_ASSERT_EQUAL_UINT32(100 * anchorCount, contextMissCount());
+    TEST_ASSERT_EQUAL_INT(0, measurementCount);
+  }
+}
+
+void testThatBestPairMatchingGeneratesCorrectMeasurements() {
+  // Fixture
+  const int anchorCount = ANCHOR_STORAGE_COUNT;
+  initSimulation(anchorCount);
+  engineState.matchingAlgorithm = TdoaEngineMatchingAlgorithmBestPair;
+  tdoaEngineSetPositionEstimate(&engineState, &sim.tagPos);
+
+  // Test
+  for (int i = 0; i < 100 * anchorCount; i++) {
+    replayPacket();
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, badMeasurementCount);
+  TEST_ASSERT_TRUE(measurementCount > 90 * anchorCount);
+}
+
+void testThatBestPairMatchingGeneratesMultipleMeasurementsPerPacket() {
+  // Fixture
+  const int anchorCount = ANCHOR_STORAGE_COUNT;
+  initSimulation(anchorCount);
+  engineState.matchingAlgorithm = TdoaEngineMatchingAlgorithmBestPair;
+  engineState.measurementsPerPacket = 3;
+  tdoaEngineSetPositionEstimate(&engineState, &sim.tagPos);
+
+  // Test
+  for (int i = 0; i < 100 * anchorCount; i++) {
+    replayPacket();
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, badMeasurementCount);
+  TEST_ASSERT_TRUE(measurementCount > 3 * 90 * anchorCount);
+  TEST_ASSERT_TRUE(measurementCount <= 3 * 100 * anchorCount);
+}
+
+void testThatBestPairMatchingSelectsPairsWithBetterGeometryThanRandom() {
+  // Fixture
+  const int anchorCount = ANCHOR_STORAGE_COUNT;
+  initSimulation(anchorCount);
+  for (int i = 0; i < 100 * anchorCount; i++) {
+    replayPacket();
+  }
+  const double randomGeometry = geometrySum / measurementCount;
+
+  setUp();
+  initSimulation(anchorCount);
+  engineState.matchingAlgorithm = TdoaEngineMatchingAlgorithmBestPair;
+  tdoaEngineSetPositionEstimate(&engineState, &sim.tagPos);
+
+  // Test
+  for (int i = 0; i < 100 * anchorCount; i++) {
+    replayPacket();
+  }
+
+  // Assert
+  const double bestPairGeometry = geometrySum / measurementCount;
+  TEST_ASSERT_TRUE(bestPairGeometry > randomGeometry);
+}
+
+void testThatAllMatchingAlgorithmsTrackTheTagPositionWithNoise() {
+  // Fixture
+  const int packetCount = 20000;
+  const struct {
+    tdoaEngineMatchingAlgorithm_t algorithm;
+    int measurementsPerPacket;
+  } runs[] = {
+    {TdoaEngineMatchingAlgorithmRandom, 1},
+    {TdoaEngineMatchingAlgorithmYoungest, 1},
+    {TdoaEngineMatchingAlgorithmBestPair, 1},
+    {TdoaEngineMatchingAlgorithmBestPair, 3},
+  };
+
+  for (unsigned int i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+    // Test
+    double error = 0.0;
+    double measurementsPerPacket = 0.0;
+    replayWithAlgorithm(runs[i].algorithm, runs[i].measurementsPerPacket, packetCount, &error, &measurementsPerPacket);
+
+    // Assert
+    TEST_ASSERT_TRUE(error < 0.2);
+    TEST_ASSERT_TRUE(measurementsPerPacket > 0.5 * runs[i].measurementsPerPacket);
+  }
+}
+
+// Helpers ///////////////
+
+static void initSimulation(const int anchorCount) {
+  memset(&sim, 0, sizeof(sim));
+  sim.anchorCount = anchorCount;
+
+  // Anchors on two levels of a 4 x 4 grid, 3 m apart
+  for (int i = 0; i < anchorCount; i++) {
+    sim.anchorPos[i].x = 3.0f * (i % 4);
+    sim.anchorPos[i].y = 3.0f * ((i / 4) % 4);
+    sim.anchorPos[i].z = 3.0f * (i / 16);
+    sim.anchorClockOffset[i] = 123456789ll * (i + 1);
+  }
+
+  sim.tagPos.x = 4.1f;
+  sim.tagPos.y = 5.3f;
+  sim.tagPos.z = 1.2f;
+  sim.tagClockOffset = 987654321ll;
+  sim.randomState = 1;
+}
+
+static double randomGaussian() {
+  // xorshift32 and Box-Muller
+  double u[2];
+  for (int i = 0; i < 2; i++) {
+    sim.randomState ^= sim.randomState << 13;
+    sim.randomState ^= sim.randomState >> 17;
+    sim.randomState ^= sim.randomState << 5;
+    u[i] = (sim.randomState + 1.0) / 4294967297.0;
+  }
+
+  return sqrt(-2.0 * log(u[0])) * cos(2.0 * M_PI * u[1]);
+}
+
+static double distance(const point_t* a, const point_t* b) {
+  const double dx = a->x - b->x;
+  const double dy = a->y - b->y;
+  const double dz = a->z - b->z;
+  return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+static int64_t flightTime(const point_t* a, const point_t* b) {
+  return (int64_t)(distance(a, b) / SPEED_OF_LIGHT * TS_FREQ + 0.5);
+}
+
+static void replayPacket() {
+  const uint8_t anchorId = sim.packetNr % sim.anchorCount;
+  const int64_t txTime = (int64_t)(sim.packetNr + 1) * PACKET_INTERVAL_MS * (int64_t)(TS_FREQ / 1000);
+  const uint32_t now_ms = (sim.packetNr + 1) * PACKET_INTERVAL_MS;
+  const point_t* anchorPos = &sim.anchorPos[anchorId];
+  const uint8_t seqNr = sim.anchorSeqNr[anchorId];
+
+  const int64_t txAn_in_cl_An = (txTime + sim.anchorClockOffset[anchorId]) & ANCHOR_TS_MASK;
+  int64_t noise = 0;
+  if (sim.noiseStdDevTicks > 0.0) {
+    noise = (int64_t)(sim.noiseStdDevTicks * randomGaussian());
+  }
+  const int64_t rxAn_by_T_in_cl_T = (txTime + flightTime(anchorPos, &sim.tagPos) + sim.tagClockOffset + noise) & TAG_TS_MASK;
+
+  if (filter.isEnabled) {
+    const point_t position = {.x = filter.p[0], .y = filter.p[1], .z = filter.p[2]};
+    tdoaEngineSetPositionEstimate(&engineState, &position);
+  }
+
+  // Same sequence as in the TDoA3 tag
+  tdoaAnchorContext_t anchorCtx;
+  tdoaEngineGetAnchorCtxForPacketProcessing(&engineState, anchorId, now_ms, &anchorCtx);
+
+  for (int i = 0; i < sim.historyCount; i++) {
+    const uint8_t remoteId = sim.history[i].id;
+    const int64_t tof = flightTime(&sim.anchorPos[remoteId], anchorPos);
+    const int64_t remoteRxTime = (sim.history[i].txTime + tof + sim.anchorClockOffset[anchorId]) & ANCHOR_TS_MASK;
+    tdoaStorageSetRemoteRxTime(&anchorCtx, remoteId, remoteRxTime, sim.history[i].seqNr);
+    tdoaStorageSetRemoteTimeOfFlight(&anchorCtx, remoteId, tof);
+  }
+
+  tdoaEngineProcessPacketFiltered(&engineState, &anchorCtx, txAn_in_cl_An, rxAn_by_T_in_cl_T, false, 0);
+  tdoaStorageSetRxTxData(&anchorCtx, rxAn_by_T_in_cl_T, txAn_in_cl_An, seqNr);
+  tdoaStorageSetAnchorPosition(&anchorCtx, anchorPos->x, anchorPos->y, anchorPos->z);
+
+  // Update the simulation
+  memmove(&sim.history[1], &sim.history[0], sizeof(sim.history[0]) * (REMOTE_COUNT - 1));
+  sim.history[0].id = anchorId;
+  sim.history[0].seqNr = seqNr;
+  sim.history[0].txTime = txTime;
+  if (sim.historyCount < REMOTE_COUNT) {
+    sim.historyCount++;
+  }
+
+  sim.anchorSeqNr[anchorId] = (seqNr + 1) & 0x7f;
+  sim.packetNr++;
+}
+
+static void gradient(const point_t* position, const point_t* anchorA, const point_t* anchorB, double h[3]) {
+  const double dA = distance(position, anchorA);
+  const double dB = distance(position, anchorB);
+  h[0] = (position->x - anchorB->x) / dB - (position->x - anchorA->x) / dA;
+  h[1] = (position->y - anchorB->y) / dB - (position->y - anchorA->y) / dA;
+  h[2] = (position->z - anchorB->z) / dB - (position->z - anchorA->z) / dA;
+}
+
+static void filterUpdate(const tdoaMeasurement_t* tdoa) {
+  const point_t position = {.x = filter.p[0], .y = filter.p[1], .z = filter.p[2]};
+  const point_t* anchorA = &tdoa->anchorPositions[0];
+  const point_t* anchorB = &tdoa->anchorPositions[1];
+
+  double h[3];
+  gradient(&position, anchorA, anchorB, h);
+  const double predicted = distance(&position, anchorB) - distance(&position, anchorA);
+
+  double PHt[3];
+  for (int i = 0; i < 3; i++) {
+    PHt[i] = filter.P[i][0] * h[0] + filter.P[i][1] * h[1] + filter.P[i][2] * h[2];
+  }
+  const double S = h[0] * PHt[0] + h[1] * PHt[1] + h[2] * PHt[2] + tdoa->stdDev * tdoa->stdDev;
+
+  const double innovation = tdoa->distanceDiff - predicted;
+  for (int i = 0; i < 3; i++) {
+    filter.p[i] += PHt[i] / S * innovation;
+  }
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      filter.P[i][j] -= PHt[i] * PHt[j] / S;
+    }
+  }
+
+  // Process noise, keeps the filter from converging completely
+  for (int i = 0; i < 3; i++) {
+    filter.P[i][i] += 1e-6;
+  }
+}
+
+static void tdoaMeasurementReceived(tdoaMeasurement_t* tdoa) {
+  measurementCount++;
+
+  const point_t* anchorA = &sim.anchorPos[tdoa->anchorIds[0]];
+  const point_t* anchorB = &sim.anchorPos[tdoa->anchorIds[1]];
+  const double expected = distance(anchorB, &sim.tagPos) - distance(anchorA, &sim.tagPos);
+  if (sim.noiseStdDevTicks == 0.0 && fabs(tdoa->distanceDiff - expected) > 0.02) {
+    badMeasurementCount++;
+  }
+
+  double h[3];
+  gradient(&sim.tagPos, anchorA, anchorB, h);
+  geometrySum += sqrt(h[0] * h[0] + h[1] * h[1] + h[2] * h[2]);
+
+  if (filter.isEnabled) {
+    filterUpdate(tdoa);
+  }
+}
+
+static void initFilter() {
+  memset(&filter, 0, sizeof(filter));
+  filter.isEnabled = true;
+  filter.p[0] = 4.5;
+  filter.p[1] = 4.5;
+  filter.p[2] = 1.5;
+  for (int i = 0; i < 3; i++) {
+    filter.P[i][i] = 1.0;
+  }
+}
+
+static double filterError() {
+  const point_t position = {.x = filter.p[0], .y = filter.p[1], .z = filter.p[2]};
+  return distance(&position, &sim.tagPos);
+}
+
+static void replayWithAlgorithm(const tdoaEngineMatchingAlgorithm_t algorithm, const int measurementsPerPacket, const int packetCount, double* error, double* measurementsPerPacketResult) {
+  const double noiseStdDev = 0.05;
+
+  // Estimate the position with a filter to get the error
+  setUp();
+  initSimulation(ANCHOR_STORAGE_COUNT);
+  sim.noiseStdDevTicks = noiseStdDev / SPEED_OF_LIGHT * TS_FREQ;
+  engineState.matchingAlgorithm = algorithm;
+  engineState.measurementsPerPacket = measurementsPerPacket;
+  initFilter();
+
+  double errorSum = 0.0;
+  int errorCount = 0;
+  for (int i = 0; i < packetCount; i++) {
+    replayPacket();
+
+    // Skip the convergence of the filter
+    if (i >= packetCount / 2) {
+      errorSum += filterError();
+      errorCount++;
+    }
+  }
+  *error = errorSum / errorCount;
+  *measurementsPerPacketResult = (double)measurementCount / packetCount;
+}
+
+static uint32_t contextMissCount() {
+  return engineState.stats.contextMissCount.rateCounter.count;
+}
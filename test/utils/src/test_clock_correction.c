@@ -200,3 +200,18 @@ void testUpdateClockCorrectionWithSampleInTheInnerLimitOfTheAcceptableNoise() {
   TEST_ASSERT_EQUAL_DOUBLE(expectedClockCorrection, clockCorrectionStorage.clockCorrection);
   TEST_ASSERT_EQUAL_UINT(expectedClockCorrectionBucket, clockCorrectionStorage.clockCorrectionBucket);
 }
+
+void testGetQualityOfClockCorrection() {
+  // Fixture
+  clockCorrectionStorage_t clockCorrectionStorage = {
+    .clockCorrection = 1.0,
+    .clockCorrectionBucket = 2
+  };
+
+  // Test
+  const float result = clockCorrectionEngineGetQuality(&clockCorrectionStorage);
+
+  // Assert
+  const float expectedResult = 2.0f / CLOCK_CORRECTION_BUCKET_MAX;
+  TEST_ASSERT_EQUAL_FLOAT(expectedResult, result);
+}
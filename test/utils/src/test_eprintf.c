@@ -33,6 +33,7 @@
 static int putcMock(int c);
 static void verifyStdio(char* format, ...);
 static void verify(char* expected, char* format, ...);
+static int packArgs(uint8_t* buffer, int size, char* format, ...);
 static char actual[100];
 
 static void reset() {
@@ -265,6 +266,60 @@ void testThatPercentIsPrinted() {
   verify("This is 100% correct", "This is %d%% correct", 100);
 }
 
+void testThatArgumentsArePacked() {
+  // Fixture
+  uint8_t expected[] = {
+    0xfe, 0xff, 0xff, 0xff,  // -2
+    0x34, 0x12, 0x00, 0x00,  // 0x1234
+    0x00, 0x00, 0xc0, 0x3f,  // 1.5f
+    'a', 'b', '\0',
+    'z',
+    0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01,
+  };
+  uint8_t actual[30];
+
+  // Test
+  const int len = packArgs(actual, sizeof(actual), "%d %04x %.2f%% %s %c %llu\n", -2, 0x1234, 1.5, "ab", 'z', (uint64_t)0x0102030405060708);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(sizeof(expected), len);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, sizeof(expected));
+}
+
+void testThatTextWithoutArgumentsIsPackedToNothing() {
+  // Fixture
+  uint8_t actual[30];
+
+  // Test
+  const int len = packArgs(actual, sizeof(actual), "Some text\n");
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, len);
+}
+
+void testThatArgumentsThatDoNotFitAreLeftOut() {
+  // Fixture
+  uint8_t actual[6];
+
+  // Test
+  const int len = packArgs(actual, sizeof(actual), "%d %d", 1, 2);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(4, len);
+}
+
+void testThatStringThatDoesNotFitIsTruncated() {
+  // Fixture
+  uint8_t actual[8];
+
+  // Test
+  const int len = packArgs(actual, sizeof(actual), "%d %s %d", 1, "abcdefgh", 2);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(8, len);
+  TEST_ASSERT_EQUAL_STRING("abc", (char*)&actual[4]);
+}
+
 //////////////////////////////
 
 static int putcMock(int c) {
@@ -309,3 +364,13 @@ static void verify(char* expected, char* format, ...) {
   // Assert
   TEST_ASSERT_EQUAL_STRING(expected, actual);
 }
+
+static int packArgs(uint8_t* buffer, int size, char* format, ...) {
+  va_list ap;
+
+  va_start(ap, format);
+  const int len = evprintfPack(buffer, size, format, ap);
+  va_end(ap);
+
+  return len;
+}
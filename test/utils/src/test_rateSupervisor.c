@@ -143,3 +143,63 @@ void testThatValidationFailesAfterSkip() {
     // Assert
     TEST_ASSERT_FALSE(actual);
 }
+
+void testThatTimingMeasuresExecutionTime() {
+    // Fixture
+    rateSupervisorTiming_t timing;
+    rateSupervisorTimingInit(&timing, 100);
+    rateSupervisorTimingStart(&timing, 1000);
+
+    // Test
+    bool actual = rateSupervisorTimingStop(&timing, 1040);
+
+    // Assert
+    TEST_ASSERT_TRUE(actual);
+    TEST_ASSERT_EQUAL_UINT32(40, timing.latestUs);
+    TEST_ASSERT_EQUAL_UINT32(0, timing.overrunCount);
+}
+
+void testThatTimingCountsOverruns() {
+    // Fixture
+    rateSupervisorTiming_t timing;
+    rateSupervisorTimingInit(&timing, 100);
+    rateSupervisorTimingStart(&timing, 1000);
+
+    // Test
+    bool actual = rateSupervisorTimingStop(&timing, 1101);
+
+    // Assert
+    TEST_ASSERT_FALSE(actual);
+    TEST_ASSERT_EQUAL_UINT32(1, timing.overrunCount);
+}
+
+void testThatTimingWithoutBudgetNeverOverruns() {
+    // Fixture
+    rateSupervisorTiming_t timing;
+    rateSupervisorTimingInit(&timing, 0);
+    rateSupervisorTimingStart(&timing, 1000);
+
+    // Test
+    bool actual = rateSupervisorTimingStop(&timing, 100000);
+
+    // Assert
+    TEST_ASSERT_TRUE(actual);
+    TEST_ASSERT_EQUAL_UINT32(0, timing.overrunCount);
+}
+
+void testThatTimingMaxIsKeptPerWindow() {
+    // Fixture
+    rateSupervisorTiming_t timing;
+    rateSupervisorTimingInit(&timing, 0);
+    rateSupervisorTimingStart(&timing, 1000);
+    rateSupervisorTimingStop(&timing, 1050);
+    rateSupervisorTimingStart(&timing, 2000);
+    rateSupervisorTimingStop(&timing, 2020);
+
+    // Test
+    rateSupervisorTimingNewWindow(&timing);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(50, timing.latestMaxUs);
+    TEST_ASSERT_EQUAL_UINT32(0, timing.windowMaxUs);
+}
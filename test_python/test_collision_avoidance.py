@@ -0,0 +1,120 @@
+#!/usr/bin/env python
+
+import math
+import cffirmware
+
+
+def setup_collision_avoidance():
+    params = cffirmware.collision_avoidance_params_t()
+    params.ellipsoidRadii = cffirmware.mkvec(0.3, 0.3, 0.9)
+    params.bboxMin = cffirmware.mkvec(-math.inf, -math.inf, -math.inf)
+    params.bboxMax = cffirmware.mkvec(math.inf, math.inf, math.inf)
+    params.horizonSecs = 1.0
+    params.maxSpeed = 0.5
+    params.sidestepThreshold = 0.25
+    params.maxPeerLocAgeMillis = 5000
+    params.voronoiProjectionTolerance = 1e-5
+    params.voronoiProjectionMaxIters = 100
+
+    collisionState = cffirmware.collision_avoidance_state_t()
+    collisionState.lastFeasibleSetPosition = cffirmware.mkvec(math.nan, math.nan, math.nan)
+    collisionState.nActivePeers = 0
+
+    return params, collisionState
+
+
+def setup_velocity_setpoint(vx, vy):
+    setpoint = cffirmware.setpoint_t()
+    setpoint.mode.x = cffirmware.modeVelocity
+    setpoint.mode.y = cffirmware.modeVelocity
+    setpoint.mode.z = cffirmware.modeVelocity
+    setpoint.velocity.x = vx
+    setpoint.velocity.y = vy
+    setpoint.velocity.z = 0
+    return setpoint
+
+
+def test_that_far_away_peers_are_culled_from_the_cell():
+    # Fixture
+    params, collisionState = setup_collision_avoidance()
+    setpoint = setup_velocity_setpoint(0.2, 0.0)
+    state = cffirmware.state_t()
+    nOthers = 100
+
+    # Test
+    # 5 m spacing, no neighbor is within reach of the 0.5 m horizon box, so
+    # all of them are culled and only the 6 faces of the bounding box remain
+    cffirmware.collisionAvoidanceBenchmark(params, collisionState, nOthers, 5.0, 1, setpoint, state)
+
+    # Assert
+    assert collisionState.nCellRows == 6
+    assert math.isclose(setpoint.velocity.x, 0.2, rel_tol=1e-6)
+
+
+def test_that_close_peers_limit_velocity():
+    # Fixture
+    params, collisionState = setup_collision_avoidance()
+    setpoint = setup_velocity_setpoint(0.5, 0.0)
+    state = cffirmware.state_t()
+    nOthers = 100
+
+    # Test
+    # 0.8 m spacing, the cell wall towards the neighbor in +x is at 0.1 m
+    for _ in range(3):
+        setpoint = setup_velocity_setpoint(0.5, 0.0)
+        cffirmware.collisionAvoidanceBenchmark(params, collisionState, nOthers, 0.8, 1, setpoint, state)
+
+    # Assert
+    assert 6 < collisionState.nCellRows < nOthers + 6
+    assert collisionState.nActivePeers > 0
+    assert setpoint.velocity.x <= 0.1 + 1e-3
+
+
+def test_benchmark_collision_avoidance_swarm_sizes():
+    # Sweeps the swarm size and prints the time per call of the collision
+    # avoidance core. Run with `pytest -s` to see the table.
+    params, collisionState = setup_collision_avoidance()
+    state = cffirmware.state_t()
+    iterations = 200
+
+    print()
+    print("{:>8} {:>10} {:>12}".format("peers", "cell rows", "us / call"))
+    for nOthers in [10, 25, 50, 100, 150, 200]:
+        setpoint = setup_velocity_setpoint(0.3, 0.1)
+        collisionState.nActivePeers = 0
+        usPerCall = cffirmware.collisionAvoidanceBenchmark(
+            params, collisionState, nOthers, 0.8, iterations, setpoint, state)
+        print("{:>8} {:>10} {:>12.2f}".format(nOthers, collisionState.nCellRows, usPerCall))
+
+        assert collisionState.nCellRows <= nOthers + 6
+        assert math.isfinite(setpoint.velocity.x)
+        assert math.isfinite(setpoint.velocity.y)
+
+
+def test_extrapolated_peer_positions_keep_separation_with_latency():
+    # Sweeps the latency of the peer positions in a swarm flying through each
+    # other at 2 m/s and prints the smallest distance between two Crazyflies,
+    # with the peers seen where they were and extrapolated to the current time
+    # by peer localization. The latencies are those of the radio and
+    # positioning systems, up to the 100 ms extrapolation limit. Run with
+    # `pytest -s` to see the table.
+    params, _ = setup_collision_avoidance()
+    speed = 2.0
+    params.maxSpeed = speed
+    nCFs = 8
+
+    withoutLatency = cffirmware.collisionAvoidanceSwarmSimulation(params, nCFs, 1.5, speed, 0, True)
+
+    print()
+    print("{:>8} {:>10} {:>14}".format("latency", "stale", "extrapolated"))
+    for latencyMs in [0, 20, 40, 60, 80, 100]:
+        stale = cffirmware.collisionAvoidanceSwarmSimulation(params, nCFs, 1.5, speed, latencyMs, False)
+        extrapolated = cffirmware.collisionAvoidanceSwarmSimulation(params, nCFs, 1.5, speed, latencyMs, True)
+        print("{:>8} {:>10.3f} {:>14.3f}".format(latencyMs, stale, extrapolated))
+
+        # Extrapolation makes up for the latency
+        assert extrapolated > withoutLatency - 2e-3
+        assert extrapolated > 2 * 0.3
+
+    # Without it, the Crazyflies come measurably closer
+    assert stale < withoutLatency - 1e-2
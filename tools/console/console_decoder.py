@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+
+#  ,---------,       ____  _ __
+#  |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+#  | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+#  | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+#     +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+#
+#  Crazyflie control firmware
+#
+#  Copyright (C) 2024 Bitcraze AB
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, in version 3.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+#
+#  Print the console of a Crazyflie, with tokenized debug prints decoded
+#
+#  When the firmware is built with CONFIG_DEBUG_PRINT_TOKENIZED, DEBUG_PRINT
+#  sends the offset of the format string in the .consoleFmt table, followed by
+#  the arguments in binary form. The table is read from the elf file of the
+#  firmware that runs on the Crazyflie.
+#
+#  Usage: console_decoder.py build/cf2.elf --uri radio://0/80/2M
+
+import argparse
+import re
+import struct
+import sys
+import time
+
+try:
+    from elftools.elf.elffile import ELFFile
+except ImportError:
+    print('pytelftools missing, install to run this script', file=sys.stderr)
+    print('https://github.com/eliben/pyelftools#installing', file=sys.stderr)
+    sys.exit(1)
+
+CONSOLE_TEXT_CH = 0
+CONSOLE_TOKEN_CH = 1
+
+# A conversion of eprintf: flags, width, precision, length and conversion
+CONVERSION = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(ll|l)?([diuxXfsc%])')
+
+
+class TokenDecoder:
+    def __init__(self, elf_file_name):
+        with open(elf_file_name, 'rb') as f:
+            self._table = self._read_table(ELFFile(f))
+
+    def decode(self, data: bytes) -> str:
+        """Format the text of a packet from the token channel"""
+        token, = struct.unpack_from('<H', data)
+        if token >= len(self._table):
+            return '<unknown token {}>\n'.format(token)
+
+        fmt = self._format_at(token)
+        args = memoryview(data)[2:]
+        text = ''
+        position = 0
+
+        for match in CONVERSION.finditer(fmt):
+            text += fmt[position:match.start()]
+            position = match.end()
+            flags, length, conversion = match.groups()
+
+            if conversion == '%':
+                text += '%'
+                continue
+
+            value, args = self._unpack(args, length, conversion)
+            if value is None:
+                text += '<?>'
+            else:
+                text += ('%' + flags + conversion) % value
+
+        return text + fmt[position:]
+
+    def _unpack(self, args, length, conversion):
+        if conversion == 's':
+            end = bytes(args).find(b'\x00')
+            if end < 0:
+                return None, args[len(args):]
+            return bytes(args[:end]).decode('utf-8', errors='replace'), args[end + 1:]
+
+        if conversion == 'c':
+            code = 'B'
+        elif conversion == 'f':
+            code = 'f'
+        else:
+            code = 'q' if length == 'll' else 'i'
+            if conversion in 'uxX':
+                code = code.upper()
+
+        size = struct.calcsize('<' + code)
+        if len(args) < size:
+            return None, args[len(args):]
+
+        value, = struct.unpack_from('<' + code, args)
+        if conversion == 'c':
+            value = chr(value)
+        return value, args[size:]
+
+    def _format_at(self, token):
+        end = self._table.index(b'\x00', token)
+        return self._table[token:end].decode('utf-8', errors='replace')
+
+    def _read_table(self, elf):
+        symbols = elf.get_section_by_name('.symtab')
+        start = symbols.get_symbol_by_name('_consoleFmt_start')
+        stop = symbols.get_symbol_by_name('_consoleFmt_stop')
+        if not start or not stop:
+            print('No tokenized debug prints in the elf file', file=sys.stderr)
+            sys.exit(1)
+
+        start_addr = start[0]['st_value']
+        stop_addr = stop[0]['st_value']
+        for section in elf.iter_sections():
+            addr = section['sh_addr']
+            if section['sh_type'] != 'SHT_NOBITS' and addr <= start_addr and stop_addr <= addr + section['sh_size']:
+                return section.data()[start_addr - addr:stop_addr - addr]
+
+        print('The table of tokenized debug prints was not found', file=sys.stderr)
+        sys.exit(1)
+
+
+def print_console(uri, decoder):
+    import cflib.crtp
+    from cflib.crazyflie import Crazyflie
+    from cflib.crazyflie.syncCrazyflie import SyncCrazyflie
+    from cflib.crtp.crtpstack import CRTPPort
+
+    def packet_received(packet):
+        if packet.channel == CONSOLE_TOKEN_CH:
+            text = decoder.decode(packet.data)
+        else:
+            text = packet.data.decode('utf-8', errors='replace')
+        sys.stdout.write(text)
+        sys.stdout.flush()
+
+    cflib.crtp.init_drivers()
+    cf = Crazyflie(rw_cache='./cache')
+    cf.add_port_callback(CRTPPort.CONSOLE, packet_received)
+    with SyncCrazyflie(uri, cf=cf):
+        while True:
+            time.sleep(1)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Print the console with tokenized debug prints decoded')
+    parser.add_argument('elf', help='The elf file of the firmware running on the Crazyflie')
+    parser.add_argument('--uri', default='radio://0/80/2M', help='The URI of the Crazyflie')
+    args = parser.parse_args()
+
+    try:
+        print_console(args.uri, TokenDecoder(args.elf))
+    except KeyboardInterrupt:
+        pass
@@ -0,0 +1,78 @@
+#!/usr/bin/env python
+
+import argparse
+import json
+import os
+import sys
+
+# Compares benchmark results from `make bench` with a stored baseline and
+# flags functions that have become slower. Exits with 1 if there are
+# regressions.
+
+
+def load(path):
+    with open(path) as f:
+        return {result['name']: result for result in json.load(f)['benchmarks']}
+
+
+def change(baseline, latest):
+    if baseline <= 0.0:
+        return 0.0
+    return (latest - baseline) / baseline
+
+
+def is_regression(baseline, latest, threshold, min_delta_ns):
+    return change(baseline, latest) > threshold and latest - baseline > min_delta_ns
+
+
+if __name__ == "__main__":
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("baseline", help="stored results to compare with")
+    parser.add_argument("results", help="latest results")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="allowed relative increase of the median time, default 0.10")
+    parser.add_argument("--p99-threshold", type=float, default=0.25,
+                        help="allowed relative increase of the 99th percentile, default 0.25")
+    parser.add_argument("--min-delta-ns", type=float, default=20.0,
+                        help="smaller increases are seen as noise, default 20 ns")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.baseline):
+        print('No baseline in {}, store the results with `make bench_baseline`'.format(args.baseline))
+        sys.exit(0)
+
+    baseline = load(args.baseline)
+    results = load(args.results)
+
+    print('{:<40} {:>12} {:>12} {:>8} {:>12} {:>12} {:>8}'.format(
+        'function', 'median [ns]', 'baseline', 'change', 'p99 [ns]', 'baseline', 'change'))
+
+    regressions = []
+    for name, latest in sorted(results.items()):
+        if name not in baseline:
+            print('{:<40} {:>12.1f} {:>12} {:>8} {:>12.1f} {:>12} {:>8}'.format(
+                name, latest['median_ns'], '-', 'new', latest['p99_ns'], '-', 'new'))
+            continue
+
+        base = baseline[name]
+        median_regression = is_regression(base['median_ns'], latest['median_ns'], args.threshold, args.min_delta_ns)
+        p99_regression = is_regression(base['p99_ns'], latest['p99_ns'], args.p99_threshold, args.min_delta_ns)
+
+        flag = ''
+        if median_regression or p99_regression:
+            flag = ' REGRESSION'
+            regressions.append(name)
+
+        print('{:<40} {:>12.1f} {:>12.1f} {:>+7.1f}% {:>12.1f} {:>12.1f} {:>+7.1f}%{}'.format(
+            name,
+            latest['median_ns'], base['median_ns'], 100 * change(base['median_ns'], latest['median_ns']),
+            latest['p99_ns'], base['p99_ns'], 100 * change(base['p99_ns'], latest['p99_ns']),
+            flag))
+
+    for name in sorted(set(baseline) - set(results)):
+        print('{:<40} missing in the results'.format(name))
+
+    if regressions:
+        print('Regressions in: {}'.format(', '.join(regressions)))
+        sys.exit(1)
@@ -1,4 +1,5 @@
 require 'fileutils'
+require 'json'
 require './vendor/unity/auto/unity_test_summary'
 require './vendor/unity/auto/generate_test_runner'
 require './vendor/unity/auto/colour_reporter'
@@ -7,6 +8,7 @@ require './vendor/unity/auto/yaml_helper'
 module RakefileHelpers
 
   C_EXTENSION = '.c'
+  BENCH_PREFIX = 'BENCH '
 
   def load_configuration(config_file)
     $cfg_file = config_file
@@ -30,6 +32,12 @@ module RakefileHelpers
     FileList.new(path)
   end
 
+  def get_benchmark_files
+    path = $cfg['compiler']['unit_tests_path'] + 'bench_*' + C_EXTENSION
+    path.gsub!(/\\/, '/')
+    FileList.new(path)
+  end
+
   def get_local_include_dirs
     include_dirs = $cfg['compiler']['includes']['items'].dup
     include_dirs.delete_if {|dir| dir.is_a?(Array)}
@@ -197,11 +205,60 @@ module RakefileHelpers
     run_tests(test_files, defines, output_style)
   end
 
-  def run_tests(test_files, defines, output_style)
+  def parse_and_run_benchmarks(args)
+    defines = find_defines_in_args(args)
+    defines += find_defines_in_kconfig($cfg['kconfig']['config_file'])
+    bench_files = find_test_files_in_args(args)
+    output_style = find_output_style_in_args(args)
+
+    set_environment_vars($cfg['env'])
+
+    # No file names found in the args, find all files that are benchmarks
+    if bench_files.length == 0
+      bench_files = exclude_test_files(get_benchmark_files(), defines)
+    end
+
+    outputs = run_tests(bench_files, defines, output_style, benchmark: true)
+    write_benchmark_results(outputs)
+  end
+
+  # Benchmarks are built with the options in the benchmark section of the
+  # configuration, in a build directory of their own
+  def configure_benchmark
+    bench = $cfg['benchmark']
+    FileUtils.mkdir_p(bench['build_path'])
+    $cfg['compiler']['options'] = bench['compiler_options'].dup
+    $cfg['compiler']['build_path'] = bench['build_path']
+    $cfg['compiler']['object_files']['destination'] = bench['build_path']
+    $cfg['linker']['options'] = bench['linker_options'].dup
+    $cfg['linker']['object_files']['path'] = bench['build_path']
+    $cfg['linker']['bin_files']['destination'] = bench['build_path']
+  end
+
+  # Collects the results printed by the benchmarks, see test/testSupport/bench.h
+  def write_benchmark_results(outputs)
+    results = []
+    outputs.each do |file, output|
+      output.each_line do |line|
+        next unless line.start_with?(BENCH_PREFIX)
+        result = JSON.parse(line[BENCH_PREFIX.length..-1])
+        result['file'] = file
+        results << result
+      end
+    end
+
+    results_file = $cfg['benchmark']['results_file']
+    FileUtils.mkdir_p(File.dirname(results_file))
+    File.open(results_file, 'w') { |f| f.puts JSON.pretty_generate({'benchmarks' => results}) }
+    report "Wrote #{results.length} benchmark results to #{results_file}"
+  end
+
+  def run_tests(test_files, defines, output_style, benchmark: false)
     report 'Running system tests...'
 
     # Tack on TEST define for compiling unit tests
     load_configuration($cfg_file)
+    configure_benchmark if benchmark
     test_defines = ['TEST']
     $cfg['compiler']['defines']['items'] = [] if $cfg['compiler']['defines']['items'].nil?
     $cfg['compiler']['defines']['items'] << 'TEST'
@@ -215,6 +272,7 @@ module RakefileHelpers
     end
 
     include_dirs = get_local_include_dirs
+    outputs = {}
 
     # Build and execute each unit test
     test_files.each do |test|
@@ -286,7 +344,10 @@ module RakefileHelpers
         test_results += '.testpass'
       end
       File.open(test_results, 'w') { |f| f.print output }
+      outputs[test] = output
     end
+
+    return outputs
   end
 
   def build_application(main)